@@ -1,6 +1,9 @@
 #pragma once
 
 #include "Types.h"
+#include "TrafficShaper.h"
+#include "CongestionController.h"
+#include "PeerMetricsTable.h"
 #include <memory>
 #include <string>
 #include <vector>
@@ -13,9 +16,31 @@ namespace P2P {
 
 /**
  * BandwidthManager - Manages bandwidth optimization and adaptive bitrate control
+ *
+ * Per-peer metrics live in a PeerMetricsTable: the Update*Metrics calls are
+ * lock-free, and callers on hot paths can resolve a peer once with
+ * RegisterPeer() and pass the handle instead of the peer ID.
+ *
+ * Owns the TrafficShaper for outbound P2P packets and one
+ * CongestionController per peer, driven by OnPacketSent()/OnPacketAcked()/
+ * OnPacketLost(). With enable_adaptive_bitrate the sampler thread sets the
+ * shaper's link rate to the slowest peer's target rate; before any peer has
+ * feedback it lowers it from max_bitrate_kbps towards min_bitrate_kbps as
+ * the loss and latency reported through UpdatePacketLoss()/UpdateLatency()
+ * rise. Per-peer queries likewise fall back to those reports until that
+ * peer's controller has feedback.
+ *
+ * These are integration points with no producer yet: no transport surfaces
+ * per-packet acknowledgements, loss or RTT, and nothing calls the
+ * feedback or loss/latency methods. Until one does, the controllers stay
+ * without feedback, the congestion level stays at zero and the shaper runs
+ * at max_bitrate_kbps; adaptive bitrate is not active in practice.
  */
 class BandwidthManager {
 public:
+    using PeerHandle = PeerMetricsTable::Handle;
+    static constexpr PeerHandle INVALID_PEER = PeerMetricsTable::INVALID_HANDLE;
+
     BandwidthManager();
     ~BandwidthManager();
 
@@ -38,48 +63,116 @@ public:
     void Shutdown();
 
     /**
-     * Update bandwidth metrics for sent packet
+     * Get the metrics handle for a peer, registering it if needed
+     * @param peer_id The peer ID
+     * @return Handle, or INVALID_PEER if PeerMetricsTable::DEFAULT_CAPACITY
+     *         peers are already tracked (updates with it are ignored)
+     */
+    PeerHandle RegisterPeer(const std::string& peer_id);
+
+    /**
+     * Stop tracking a peer; its handle may be reused afterwards
      * @param peer_id The peer ID
+     */
+    void RemovePeer(const std::string& peer_id);
+
+    /**
+     * Update bandwidth metrics for sent packet
+     * @param peer_id The peer ID (or handle from RegisterPeer())
      * @param packet_size Size of the packet in bytes
      * @param priority Packet priority
      */
     void UpdateSentMetrics(const std::string& peer_id, size_t packet_size, PacketPriority priority);
+    void UpdateSentMetrics(PeerHandle peer, size_t packet_size, PacketPriority priority);
 
     /**
      * Update bandwidth metrics for received packet
-     * @param peer_id The peer ID
+     * @param peer_id The peer ID (or handle from RegisterPeer())
      * @param packet_size Size of the packet in bytes
      */
     void UpdateReceivedMetrics(const std::string& peer_id, size_t packet_size);
+    void UpdateReceivedMetrics(PeerHandle peer, size_t packet_size);
 
     /**
      * Update packet loss metrics
-     * @param peer_id The peer ID
+     * @param peer_id The peer ID (or handle from RegisterPeer())
      * @param packets_lost Number of packets lost
      */
     void UpdatePacketLoss(const std::string& peer_id, uint64_t packets_lost);
+    void UpdatePacketLoss(PeerHandle peer, uint64_t packets_lost);
 
     /**
-     * Update latency metrics
-     * @param peer_id The peer ID
+     * Update latency metrics (exponential moving average)
+     * @param peer_id The peer ID (or handle from RegisterPeer())
      * @param latency_ms Latency in milliseconds
      */
     void UpdateLatency(const std::string& peer_id, float latency_ms);
+    void UpdateLatency(PeerHandle peer, float latency_ms);
+
+    /**
+     * Record a packet handed to the transport for a peer
+     * @param peer_id The peer ID
+     * @param sequence Transport sequence number the peer's feedback echoes
+     * @param packet_size Bytes on the wire
+     * @param send_time_us Send time from CongestionController::NowMicros()
+     */
+    void OnPacketSent(const std::string& peer_id, uint64_t sequence, size_t packet_size, int64_t send_time_us);
+
+    /**
+     * Feed the peer's receipt of a packet
+     * Also refreshes the peer's average_latency_ms with the smoothed RTT.
+     * @param peer_id The peer ID
+     * @param sequence Sequence number given to OnPacketSent()
+     * @param arrival_time_us Arrival time on the peer's clock (microseconds)
+     * @return false if the peer or packet is unknown
+     */
+    bool OnPacketAcked(const std::string& peer_id, uint64_t sequence, int64_t arrival_time_us);
+
+    /**
+     * Feed a packet the peer reported missing
+     * @param peer_id The peer ID
+     * @param sequence Sequence number given to OnPacketSent()
+     * @return false if the peer or packet is unknown
+     */
+    bool OnPacketLost(const std::string& peer_id, uint64_t sequence);
 
     /**
      * Get current recommended bitrate for a peer
      * @param peer_id The peer ID
-     * @return Recommended bitrate in kbps
+     * @return The peer's congestion controller target in kbps; before the
+     *         controller has feedback, target_bitrate_kbps stepped down for
+     *         the peer's reported loss (over 2% / 5%) and latency (over
+     *         100 ms / 200 ms)
      */
     float GetRecommendedBitrate(const std::string& peer_id) const;
 
+    /**
+     * Get the rate to pace a peer's packets at
+     * @param peer_id The peer ID
+     * @return Bytes per second (GetRecommendedBitrate() / 8)
+     */
+    double GetPacingRate(const std::string& peer_id) const;
+
     /**
      * Check if congestion is detected for a peer
      * @param peer_id The peer ID
-     * @return true if congestion is detected
+     * @return true if the peer's one-way delay is trending up or its
+     *         feedback shows more than CongestionController::HIGH_LOSS loss;
+     *         before the controller has feedback, if the reported loss is
+     *         over 10% or latency over 300 ms
      */
     bool IsCongested(const std::string& peer_id) const;
 
+    /**
+     * Estimate the bitrate still available for outbound traffic
+     * Headroom under max_bitrate_kbps left by RecordSend() traffic, scaled
+     * down as loss and latency approach 10% loss or 300 ms latency. Nothing
+     * reports loss or latency yet (see the class comment), so in practice
+     * only the headroom varies. Lock-free (reads the snapshot).
+     * @return Available bitrate in kbps, at least min_bitrate_kbps
+     */
+    float GetAvailableBitrateKbps() const;
+
     /**
      * Get packet priority based on packet type
      * @param packet_type RO packet type
@@ -87,6 +180,15 @@ public:
      */
     static PacketPriority GetPacketPriority(uint16_t packet_type);
 
+    /**
+     * Get the priority of an outbound message
+     * A batch counts at its most urgent packet; anything else at its own type.
+     * @param data Packet or batch frame
+     * @param size Message size
+     * @return Packet priority level
+     */
+    static PacketPriority GetMessagePriority(const uint8_t* data, size_t size);
+
     /**
      * Should packet be dropped due to congestion
      * @param priority Packet priority
@@ -109,11 +211,49 @@ public:
     BandwidthMetrics GetOverallMetrics() const;
 
     /**
-     * Reset metrics for a peer
-     * @param peer_id The peer ID
+     * Reset metrics and congestion control state for a peer
+     * @param peer_id The peer ID (empty for every peer)
      */
     void ResetMetrics(const std::string& peer_id);
 
+    /**
+     * Record an outbound P2P message (PacketRouter calls this for every
+     * packet or batch the transport accepts)
+     * Lock-free (per-thread counter slots); safe to call from the hooked send path.
+     * @param packet_size Size of the packet in bytes
+     * @param priority Packet priority
+     */
+    void RecordSend(size_t packet_size, PacketPriority priority);
+
+    /**
+     * Get the latest aggregated metrics published by the sampler thread
+     * Refreshed every bandwidth_update_interval_ms; never takes the metrics mutex.
+     * bytes_sent/packets_sent/current_bitrate_kbps reflect RecordSend() traffic,
+     * the remaining fields aggregate the per-peer metrics.
+     * @return Snapshot (never null after Initialize)
+     */
+    std::shared_ptr<const BandwidthMetrics> GetMetricsSnapshot() const;
+
+    /**
+     * Check if a packet of this priority may be sent now
+     * Takes no tokens; use PacketSent() after sending or TrafficShaper::Submit().
+     * @param priority Packet priority
+     * @return true if the shaper has tokens and nothing of this priority is queued
+     */
+    bool CanSendPacket(PacketPriority priority) const;
+
+    /**
+     * Account a packet sent outside the shaper queues
+     * @param priority Packet priority
+     * @param packet_size Size of the packet in bytes
+     */
+    void PacketSent(PacketPriority priority, size_t packet_size);
+
+    /**
+     * Get the traffic shaper (configured by Initialize)
+     */
+    TrafficShaper& GetShaper();
+
 private:
     struct Impl;
     std::unique_ptr<Impl> impl_;
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Types.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace P2P {
+
+/**
+ * ChannelSelector - Picks the DataChannel a P2P message travels on
+ *
+ * Channels:
+ *   - DATA, reliable and ordered: key exchange, and the last resort
+ *   - STATE, unordered with no retransmissions: messages made up only of
+ *     packets the packet table marks unreliable (superseded state)
+ *   - URGENT, NORMAL, BULK, each reliable and ordered on its own SCTP
+ *     stream, so urgent packets never wait behind bulk data
+ *
+ * Priority classes share a channel when their packets may depend on each
+ * other's order: CRITICAL and HIGH (attacks, skills, pickups) go on URGENT
+ * together, LOW and BACKGROUND on BULK. Nothing in NORMAL or BULK refers to
+ * combat state, so losing order between those channels and URGENT costs
+ * nothing; it is what lets a CRITICAL packet overtake bulk data.
+ *
+ * A message (a bare packet or a batch frame) is classified in one pass over
+ * its packets, before the sender takes any lock.
+ */
+class ChannelSelector {
+public:
+    enum class Channel : uint8_t {
+        URGENT = 0,
+        NORMAL = 1,
+        BULK = 2,
+        STATE = 3,
+        DATA = 4
+    };
+
+    // URGENT, NORMAL and BULK are indexed by their value
+    static constexpr size_t PRIORITY_CHANNEL_COUNT = 3;
+    static constexpr uint16_t KEY_EXCHANGE_PACKET_TYPE = 0xFF00;
+
+    /**
+     * Where a message goes: preferred if that channel is open, otherwise
+     * fallback, otherwise DATA
+     */
+    struct Selection {
+        Channel preferred = Channel::DATA;
+        Channel fallback = Channel::DATA;
+    };
+
+    /**
+     * Classify a message
+     * @param data Bare packet or batch frame
+     * @param size Message size
+     * @return STATE (falling back to the priority channel) for all-unreliable
+     *         messages, DATA for key exchange, otherwise the channel of the
+     *         most urgent packet (falling back to DATA)
+     */
+    static Selection Select(const uint8_t* data, size_t size);
+
+    /**
+     * Channel for a priority class
+     */
+    static Channel ForPriority(PacketPriority priority);
+
+    /**
+     * DataChannel label of a channel
+     */
+    static const char* GetLabel(Channel channel);
+
+    /**
+     * Look up a channel by DataChannel label
+     * @return false if no channel has this label
+     */
+    static bool FromLabel(const std::string& label, Channel& channel);
+
+    static bool IsPriorityChannel(Channel channel) {
+        return static_cast<size_t>(channel) < PRIORITY_CHANNEL_COUNT;
+    }
+};
+
+} // namespace P2P
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace P2P {
+
+/**
+ * CompressionDictionary - Trained dictionaries for small-packet compression
+ *
+ * Most RO packets are a few dozen bytes, too short for LZ4 or zlib to find
+ * any repetition inside the packet itself. Priming the compressor with a
+ * dictionary of typical packet content gives it something to match against.
+ *
+ * A dictionary file holds one dictionary per opcode class. Class 0 is the
+ * generic dictionary used for every opcode not assigned elsewhere; the
+ * trainer (tools/dictionary_trainer) gives the heaviest opcodes their own
+ * class. The dictionary ID is a hash of the file content, so two peers
+ * agree on an ID only if they loaded byte-identical dictionaries.
+ *
+ * File layout (little-endian):
+ *   u32 magic "RODC", u16 version, u16 class count
+ *   per class: u16 opcode count, u16 opcodes[], u32 size, u8 dictionary[]
+ *
+ * Instances are immutable once built and safe to share between threads.
+ */
+class CompressionDictionary {
+public:
+    static constexpr uint32_t FILE_MAGIC = 0x43444F52;  // "RODC"
+    static constexpr uint16_t FILE_VERSION = 1;
+    static constexpr uint8_t GENERIC_CLASS = 0;
+    static constexpr size_t MAX_CLASSES = 16;
+    // LZ4's match window; zlib only uses the last 32 KB
+    static constexpr size_t MAX_DICTIONARY_SIZE = 64 * 1024;
+
+    /**
+     * Create a set with an empty generic class
+     */
+    CompressionDictionary();
+
+    /**
+     * Replace the generic (class 0) dictionary
+     * @return false if the dictionary is too large
+     */
+    bool SetGeneric(std::vector<uint8_t> dictionary);
+
+    /**
+     * Add a class for a group of opcodes
+     * @param opcodes Opcodes compressed with this dictionary
+     * @param dictionary Dictionary content
+     * @return false if the set is full, the dictionary is too large or an
+     *         opcode already belongs to another class
+     */
+    bool AddClass(const std::vector<uint16_t>& opcodes, std::vector<uint8_t> dictionary);
+
+    /**
+     * Get the class an opcode is compressed with
+     * @return Class index, GENERIC_CLASS for unassigned opcodes
+     */
+    uint8_t ClassOf(uint16_t type) const { return class_of_[type]; }
+
+    /**
+     * Get a class's dictionary (empty for out-of-range classes)
+     */
+    const std::vector<uint8_t>& GetDictionary(uint8_t cls) const;
+
+    /**
+     * Get the opcodes assigned to a class (empty for the generic class)
+     */
+    const std::vector<uint16_t>& GetOpcodes(uint8_t cls) const;
+
+    /**
+     * Get the number of classes, generic included
+     */
+    size_t GetClassCount() const { return classes_.size(); }
+
+    /**
+     * Get the dictionary ID (FNV-1a of the serialized set, never 0)
+     * Computed on each call; callers keep their own copy.
+     */
+    uint32_t GetId() const;
+
+    /**
+     * Serialize to the file layout
+     */
+    std::vector<uint8_t> Serialize() const;
+
+    /**
+     * Parse the file layout
+     * @return The dictionary set, or nullptr if the data is malformed
+     */
+    static std::unique_ptr<CompressionDictionary> Deserialize(const uint8_t* data, size_t size);
+
+    /**
+     * Load a dictionary file
+     * @return The dictionary set, or nullptr if the file is missing or malformed
+     */
+    static std::unique_ptr<CompressionDictionary> LoadFromFile(const std::string& path);
+
+    /**
+     * Write a dictionary file
+     * @return true if the whole file was written
+     */
+    bool SaveToFile(const std::string& path) const;
+
+private:
+    struct DictionaryClass {
+        std::vector<uint16_t> opcodes;
+        std::vector<uint8_t> dictionary;
+    };
+
+    std::vector<DictionaryClass> classes_;
+    // Class index per opcode, 64 KB so ClassOf is a single load
+    std::vector<uint8_t> class_of_;
+};
+
+} // namespace P2P
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "Types.h"
+#include "CompressionSelector.h"
+#include <functional>
 #include <memory>
 #include <vector>
 #include <string>
@@ -12,9 +14,40 @@ namespace P2P {
  * 
  * Handles packet compression using zlib or lz4
  * Compresses packets before encryption and decompresses after decryption
+ *
+ * With a trained dictionary loaded (CompressionConfig::dictionary_path) and
+ * the same dictionary ID agreed for the session, each packet is compressed
+ * against the dictionary of its opcode class (see CompressionDictionary).
+ *
+ * Every payload is a self-describing frame:
+ *   varint  (original_size << 5) | (dictionary << 4) | (stored << 3) | algorithm
+ *   u8      dictionary class (only if the dictionary bit is set)
+ *   body    compressed bytes, or the original bytes if stored
+ * The varint is 1-2 bytes for packets under 512 bytes. The receiver decodes
+ * with the algorithm named in the frame, not its own configuration, so
+ * peers with different settings interoperate. Packets that are too small or
+ * don't compress well enough are sent stored.
  */
 class CompressionManager {
 public:
+    // Algorithm IDs carried in the frame header (3 bits)
+    enum class Algorithm : uint8_t {
+        LZ4 = 0,   // LZ4 and LZ4HC share a block format
+        ZLIB = 1
+    };
+
+    /**
+     * Decoded frame header
+     */
+    struct FrameHeader {
+        Algorithm algorithm = Algorithm::LZ4;
+        bool stored = false;
+        bool dictionary = false;
+        uint8_t dictionary_class = 0;
+        size_t original_size = 0;
+        size_t header_size = 0;  // Bytes before the body
+    };
+
     /**
      * Get singleton instance
      */
@@ -23,24 +56,112 @@ public:
     /**
      * Initialize compression manager
      * @param config Configuration for compression settings
+     * @param max_packet_size Largest original size accepted from a frame
+     *        (P2PConfig::max_packet_size_bytes); capped at MAX_DECOMPRESSED_SIZE
      * @return true if successful, false otherwise
      */
-    bool Initialize(const CompressionConfig& config);
+    bool Initialize(const CompressionConfig& config, size_t max_packet_size = MAX_DECOMPRESSED_SIZE);
 
     /**
-     * Compress packet data
-     * @param data Input data to compress
-     * @return Compressed data, empty if compression failed
+     * Frame packet data, compressed if that pays off
+     * @param data Input data
+     * @return Compressed or stored frame, empty if data is empty
      */
     std::vector<uint8_t> Compress(const std::vector<uint8_t>& data);
 
     /**
-     * Decompress packet data
-     * @param data Compressed data to decompress
-     * @return Decompressed data, empty if decompression failed
+     * Unframe packet data
+     * @param data Compressed or stored frame
+     * @return Original data, empty if the frame is invalid
      */
     std::vector<uint8_t> Decompress(const std::vector<uint8_t>& data);
 
+    /**
+     * Get the worst-case output size of CompressInto (header included)
+     * @param size Input size
+     */
+    size_t GetMaxCompressedSize(size_t size) const;
+
+    /**
+     * Get the original size recorded in a frame header
+     * @return Original size, or 0 if the header is invalid or over the size cap
+     */
+    size_t GetDecompressedSize(const uint8_t* data, size_t size) const;
+
+    /**
+     * Whether CompressInto would try to compress this packet
+     * False when compression is disabled, or the packet is under
+     * min_size_for_compression and no dictionary applies to it.
+     */
+    bool ShouldCompress(const uint8_t* data, size_t size) const;
+
+    /**
+     * Compress into a frame in caller-provided storage
+     * @param data Input data
+     * @param size Input size
+     * @param out Output buffer (GetMaxCompressedSize(size) bytes is always enough)
+     * @param out_capacity Output buffer size
+     * @param out_size Bytes written
+     * @return true if compressed; false if the packet should go out as a
+     *         stored frame (see EncodeStoredHeader) because compression is
+     *         off, failed, or did not beat compression_ratio_threshold
+     */
+    bool CompressInto(const uint8_t* data, size_t size, uint8_t* out, size_t out_capacity, size_t& out_size);
+
+    /**
+     * Decompress a compressed frame into caller-provided storage
+     * @param data Frame (header included)
+     * @param size Frame size
+     * @param out Output buffer (GetDecompressedSize() bytes)
+     * @param out_capacity Output buffer size
+     * @param out_size Bytes written
+     * @return true if decompressed; stored frames are copied out
+     */
+    bool DecompressInto(const uint8_t* data, size_t size, uint8_t* out, size_t out_capacity, size_t& out_size);
+
+    /**
+     * Parse and validate a frame header
+     * Checks the algorithm ID, the size cap and, for stored frames, that the
+     * body is exactly the original size.
+     * @return false if the frame is malformed
+     */
+    bool ParseFrameHeader(const uint8_t* data, size_t size, FrameHeader& header) const;
+
+    /**
+     * Write the header of a stored frame
+     * @param size Original (= body) size
+     * @param out At least MAX_HEADER_SIZE bytes
+     * @return Header size in bytes
+     */
+    static size_t EncodeStoredHeader(size_t size, uint8_t* out);
+
+    /**
+     * Load a trained dictionary file
+     * Dictionary compression stays off until SetNegotiatedDictionary() is
+     * called with the matching ID.
+     * @param path Dictionary file written by the dictionary trainer
+     * @return true if the file was loaded
+     */
+    bool LoadDictionary(const std::string& path);
+
+    /**
+     * Get the ID of the loaded dictionary
+     * @return Dictionary ID, or 0 if none is loaded
+     */
+    uint32_t GetDictionaryId() const;
+
+    /**
+     * Apply the dictionary ID agreed for the session
+     * @param dictionary_id ID from the session, 0 if the session has none
+     * @return true if dictionary compression is now in use
+     */
+    bool SetNegotiatedDictionary(uint32_t dictionary_id);
+
+    /**
+     * Check if packets are being compressed with the dictionary
+     */
+    bool IsDictionaryActive() const;
+
     /**
      * Check if compression is enabled
      * @return true if compression is enabled
@@ -59,9 +180,35 @@ public:
      */
     std::string GetAlgorithmName() const;
 
+    /**
+     * Set where the adaptive selector reads the available link bitrate
+     * NetworkManager wires in BandwidthManager::GetAvailableBitrateKbps, which
+     * follows the P2P send rate but not loss or latency until the transports
+     * report them; a congested link does not yet shift the choice by itself.
+     * @param estimator Returns kbps currently available (called from the send
+     *        path once per evaluation interval)
+     */
+    void SetLinkEstimator(std::function<float()> estimator);
+
+    /**
+     * Get the codec currently used for a priority class
+     * @return The selector's choice in adaptive mode, else the fixed codec
+     */
+    CompressionSelector::Codec GetSelectedCodec(PacketPriority priority) const;
+
     CompressionManager();
     ~CompressionManager();
 
+    // Frame header fields (below the original size in the varint)
+    static constexpr uint32_t HEADER_ALGORITHM_MASK = 0x7;
+    static constexpr uint32_t HEADER_STORED_BIT = 1u << 3;
+    static constexpr uint32_t HEADER_DICTIONARY_BIT = 1u << 4;
+    static constexpr uint32_t HEADER_SIZE_SHIFT = 5;
+    // Varint (4 bytes at MAX_DECOMPRESSED_SIZE) plus the dictionary class
+    static constexpr size_t MAX_HEADER_SIZE = 5;
+    // Hard cap on the original size accepted from a header
+    static constexpr size_t MAX_DECOMPRESSED_SIZE = 1024 * 1024;
+
 private:
     struct Impl;
     std::unique_ptr<Impl> impl_;
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "Types.h"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace P2P {
+
+/**
+ * CompressionSelector - Picks a codec per packet class from live telemetry
+ *
+ * Packets are classed by their packet-table priority. For each class the
+ * selector keeps, per codec, the bytes in, bytes out and nanoseconds spent,
+ * and Evaluate() picks the codec with the lowest cost per input byte:
+ *
+ *   cost = (bytes_out / bytes_in) * link_ns_per_byte + cpu_ns_per_byte
+ *
+ * where link_ns_per_byte is the time one byte takes on the link at the
+ * currently available bitrate. A congested link makes output bytes
+ * expensive and favours stronger codecs; an idle one favours cheap codecs
+ * or none. If compression has used more than the CPU budget over an
+ * interval, every class sends uncompressed for a few intervals.
+ *
+ * One packet in EXPLORE_INTERVAL tries another codec so the estimates for
+ * codecs not currently chosen stay fresh. Telemetry is halved at each
+ * evaluation so old samples fade out.
+ *
+ * Choose() and Record() are lock-free; Evaluate() must not run concurrently
+ * with itself.
+ */
+class CompressionSelector {
+public:
+    enum class Codec : uint8_t {
+        NONE = 0,
+        LZ4_FAST,
+        LZ4_HC,
+        ZLIB
+    };
+
+    static constexpr size_t CODEC_COUNT = 4;
+    static constexpr size_t CLASS_COUNT = 5;  // One per PacketPriority
+    static constexpr uint32_t EXPLORE_INTERVAL = 64;
+    // A codec needs this much input before its estimate is trusted
+    static constexpr uint64_t MIN_SAMPLE_BYTES = 4096;
+    // Intervals spent uncompressed after going over the CPU budget
+    static constexpr int CPU_BACKOFF_INTERVALS = 5;
+
+    /**
+     * Telemetry for one (class, codec) pair since it was last halved
+     */
+    struct Stats {
+        uint64_t bytes_in = 0;
+        uint64_t bytes_out = 0;
+        uint64_t nanoseconds = 0;
+    };
+
+    /**
+     * @param initial Codec every class starts with
+     * @param cpu_budget Compression time allowed per wall-clock time
+     *        (0.05 = 5% of one core)
+     */
+    explicit CompressionSelector(Codec initial = Codec::LZ4_FAST, double cpu_budget = 0.05);
+
+    // Disable copy and move
+    CompressionSelector(const CompressionSelector&) = delete;
+    CompressionSelector& operator=(const CompressionSelector&) = delete;
+
+    /**
+     * Class index for a packet priority
+     */
+    static size_t ClassOf(PacketPriority priority) {
+        size_t cls = static_cast<size_t>(priority);
+        return cls < CLASS_COUNT ? cls : CLASS_COUNT - 1;
+    }
+
+    /**
+     * Codec to use for the next packet of a class (may be an exploration pick)
+     */
+    Codec Choose(size_t cls);
+
+    /**
+     * Record the outcome of one packet
+     * @param bytes_out Bytes actually sent (a stored frame if compression did not pay)
+     * @param nanoseconds Time spent compressing
+     */
+    void Record(size_t cls, Codec codec, size_t bytes_in, size_t bytes_out, uint64_t nanoseconds);
+
+    /**
+     * Re-pick every class's codec
+     * @param available_kbps Bitrate currently available on the link
+     * @param interval_ns Wall-clock time since the previous evaluation
+     */
+    void Evaluate(float available_kbps, uint64_t interval_ns);
+
+    /**
+     * Get a class's current codec (without exploration)
+     */
+    Codec GetChoice(size_t cls) const;
+
+    /**
+     * Get a snapshot of one (class, codec) pair's telemetry
+     */
+    Stats GetStats(size_t cls, Codec codec) const;
+
+    /**
+     * Whether the selector is backing off for CPU
+     */
+    bool IsCpuBound() const { return cpu_backoff_.load(std::memory_order_relaxed) > 0; }
+
+    /**
+     * Codec name for logs ("none", "lz4", "lz4hc", "zlib")
+     */
+    static const char* GetCodecName(Codec codec);
+
+private:
+    struct CodecStats {
+        std::atomic<uint64_t> bytes_in{0};
+        std::atomic<uint64_t> bytes_out{0};
+        std::atomic<uint64_t> nanoseconds{0};
+    };
+
+    // One cache line per class; the send path only touches its own
+    struct alignas(64) ClassState {
+        std::atomic<Codec> choice{Codec::LZ4_FAST};
+        std::atomic<uint32_t> packets{0};
+        std::array<CodecStats, CODEC_COUNT> codecs;
+    };
+
+    std::array<ClassState, CLASS_COUNT> classes_;
+    std::atomic<uint64_t> interval_ns_spent_{0};
+    std::atomic<int> cpu_backoff_{0};
+    double cpu_budget_;
+};
+
+} // namespace P2P
@@ -0,0 +1,195 @@
+#pragma once
+
+#include "Types.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace P2P {
+
+/**
+ * CongestionController - Per-peer delay- and loss-based send rate estimator
+ *
+ * Follows the shape of WebRTC's Google Congestion Control:
+ *
+ *   - Delay: packets sent within GROUP_INTERVAL_US of each other form a
+ *     group. For consecutive groups the change in one-way delay is
+ *     (arrival delta - send delta); it is accumulated, smoothed and the
+ *     slope of the last TRENDLINE_WINDOW values is taken by least squares.
+ *     A slope above an adaptive threshold for OVERUSE_TIME_US means queues
+ *     are building on the path (overuse); below minus the threshold they
+ *     are draining (underuse). Only deltas are used, so the sender's and
+ *     receiver's clocks need not agree.
+ *   - Rate: overuse cuts the delay-based rate to DECREASE_FACTOR times the
+ *     throughput the peer acknowledged; underuse holds it; otherwise it
+ *     grows by INCREASE_PER_SECOND, capped at 1.5x acknowledged throughput.
+ *   - Loss: over each LOSS_WINDOW_PACKETS reports, loss above HIGH_LOSS
+ *     backs the loss-based rate off by half the loss fraction, loss below
+ *     LOW_LOSS lets it grow by LOSS_INCREASE.
+ *
+ * The target is the smaller of the two rates, clamped to
+ * [min_bitrate_kbps, max_bitrate_kbps]; it starts at target_bitrate_kbps.
+ *
+ * Driven by the transport: OnPacketSent() when a packet leaves, and
+ * OnPacketAcked() / OnPacketLost() when the peer's feedback arrives.
+ * Times are microseconds; send and "now" times are on the local steady
+ * clock (NowMicros()), arrival times on the receiver's clock.
+ *
+ * Not thread-safe; the owner serializes calls per peer.
+ */
+class CongestionController {
+public:
+    enum class Usage : uint8_t {
+        NORMAL = 0,
+        UNDERUSING,
+        OVERUSING
+    };
+
+    // Packets remembered for feedback; older sequence numbers are forgotten
+    static constexpr size_t MAX_IN_FLIGHT = 1024;
+    static constexpr int64_t GROUP_INTERVAL_US = 5000;
+    static constexpr size_t TRENDLINE_WINDOW = 20;
+    static constexpr double TRENDLINE_SMOOTHING = 0.9;
+    static constexpr double TRENDLINE_GAIN = 4.0;
+    static constexpr double INITIAL_THRESHOLD_MS = 12.5;
+    static constexpr double MIN_THRESHOLD_MS = 6.0;
+    static constexpr double MAX_THRESHOLD_MS = 600.0;
+    static constexpr int64_t OVERUSE_TIME_US = 10000;
+    static constexpr float DECREASE_FACTOR = 0.85f;
+    static constexpr float INCREASE_PER_SECOND = 0.08f;
+    static constexpr int64_t ACKED_RATE_WINDOW_US = 500000;
+    static constexpr uint32_t LOSS_WINDOW_PACKETS = 20;
+    static constexpr float LOW_LOSS = 0.02f;
+    static constexpr float HIGH_LOSS = 0.10f;
+    static constexpr float LOSS_INCREASE = 1.05f;
+
+    /**
+     * @param config Bitrate bounds and start rate
+     */
+    explicit CongestionController(const BandwidthConfig& config);
+
+    /**
+     * Current time on the clock send and "now" times use
+     */
+    static int64_t NowMicros();
+
+    /**
+     * Record an outbound packet
+     * @param sequence Transport sequence number echoed back in feedback
+     * @param size Bytes on the wire
+     * @param send_time_us Local send time
+     */
+    void OnPacketSent(uint64_t sequence, size_t size, int64_t send_time_us);
+
+    /**
+     * Feed the peer's receipt of a packet
+     * @param sequence Sequence number given to OnPacketSent()
+     * @param arrival_time_us Arrival time on the receiver's clock
+     * @param now_us Local time the feedback arrived
+     * @return false if the packet is unknown (never sent, forgotten or already reported)
+     */
+    bool OnPacketAcked(uint64_t sequence, int64_t arrival_time_us, int64_t now_us);
+
+    /**
+     * Feed a packet the peer reported missing
+     * @return false if the packet is unknown
+     */
+    bool OnPacketLost(uint64_t sequence, int64_t now_us);
+
+    /**
+     * Target send rate in kbps
+     */
+    float GetTargetBitrateKbps() const;
+
+    /**
+     * Rate to pace this peer's packets at, in bytes per second
+     */
+    double GetPacingRateBytesPerSecond() const;
+
+    /**
+     * Current delay-gradient verdict
+     */
+    Usage GetUsage() const { return usage_; }
+
+    /**
+     * Loss fraction over the last completed loss window (0..1)
+     */
+    float GetLossFraction() const { return loss_fraction_; }
+
+    /**
+     * Smoothed round-trip time in milliseconds (0 before the first ack)
+     */
+    float GetRttMs() const { return rtt_ms_; }
+
+    /**
+     * Whether any ack or loss report has arrived
+     */
+    bool HasFeedback() const { return has_feedback_; }
+
+    /**
+     * Whether the path is overused or losing more than HIGH_LOSS
+     */
+    bool IsCongested() const;
+
+private:
+    struct SentPacket {
+        uint64_t sequence = 0;
+        int64_t send_time_us = 0;
+        uint32_t size = 0;
+        bool pending = false;
+    };
+
+    struct PacketGroup {
+        int64_t first_send_us = 0;
+        int64_t last_send_us = 0;
+        int64_t last_arrival_us = 0;
+        bool valid = false;
+    };
+
+    void UpdateDelay(int64_t send_time_us, int64_t arrival_time_us, int64_t now_us);
+    void UpdateTrendline(double delay_variation_ms, int64_t arrival_time_us, int64_t now_us);
+    void UpdateThreshold(double trend, int64_t now_us);
+    void UpdateDelayBasedRate(int64_t now_us);
+    void UpdateAckedRate(uint32_t size, int64_t now_us);
+    void CountLoss(bool lost);
+
+    float min_kbps_;
+    float max_kbps_;
+    float delay_based_kbps_;
+    float loss_based_kbps_;
+
+    std::array<SentPacket, MAX_IN_FLIGHT> sent_{};
+
+    // Delay gradient
+    PacketGroup current_group_;
+    PacketGroup previous_group_;
+    int64_t first_arrival_us_ = -1;
+    double accumulated_delay_ms_ = 0.0;
+    double smoothed_delay_ms_ = 0.0;
+    std::array<double, TRENDLINE_WINDOW> trend_x_{};  // Arrival time (ms)
+    std::array<double, TRENDLINE_WINDOW> trend_y_{};  // Smoothed delay (ms)
+    size_t trend_count_ = 0;
+    size_t trend_next_ = 0;
+    uint32_t num_deltas_ = 0;
+    double threshold_ms_ = INITIAL_THRESHOLD_MS;
+    int64_t last_threshold_update_us_ = -1;
+    double previous_trend_ = 0.0;
+    int64_t overuse_start_us_ = -1;
+    Usage usage_ = Usage::NORMAL;
+    int64_t last_rate_update_us_ = -1;
+
+    // Acknowledged throughput over ACKED_RATE_WINDOW_US
+    int64_t acked_window_start_us_ = -1;
+    uint64_t acked_window_bytes_ = 0;
+    float acked_kbps_ = 0.0f;
+
+    // Loss
+    uint32_t loss_window_acked_ = 0;
+    uint32_t loss_window_lost_ = 0;
+    float loss_fraction_ = 0.0f;
+
+    float rtt_ms_ = 0.0f;
+    bool has_feedback_ = false;
+};
+
+} // namespace P2P
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "PacketBuffer.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace P2P {
+
+/**
+ * FrameSplitter - Splits coalesced RO send buffers into individual packets
+ *
+ * The client often writes several packets with one send(). Frame boundaries
+ * come from the packet table: fixed-length opcodes use their table length,
+ * variable-length opcodes carry their length in bytes 2-3. Complete frames
+ * are emitted as views into the caller's buffer; only a frame that straddles
+ * two send() calls is copied, into per-stream pending storage.
+ *
+ * If an opcode's length is unknown, the rest of the buffer is emitted as one
+ * frame (the old whole-buffer behaviour) and any pending state is dropped.
+ */
+class FrameSplitter {
+public:
+    using FrameCallback = std::function<void(const PacketView&)>;
+
+    // FrameLength() results that are not a frame length
+    static constexpr size_t NEED_MORE = 0;
+    static constexpr size_t UNKNOWN_LENGTH = std::numeric_limits<size_t>::max();
+
+    // Minimum size of a variable-length frame (type + length word)
+    static constexpr size_t VARIABLE_HEADER_SIZE = 4;
+
+    // Streams with pending data beyond this are dropped to bound memory
+    static constexpr size_t MAX_PENDING_STREAMS = 256;
+
+    /**
+     * Determine the length of the frame starting at data
+     * @param data Frame bytes
+     * @param available Bytes available at data
+     * @return Frame length, NEED_MORE if the header is incomplete, or
+     *         UNKNOWN_LENGTH if the frame cannot be delimited
+     */
+    static size_t FrameLength(const uint8_t* data, size_t available);
+
+    /**
+     * Split a self-contained buffer (e.g. a datagram); a trailing partial
+     * frame is emitted as-is rather than kept
+     * @param data Buffer bytes
+     * @param size Buffer size
+     * @param on_frame Called once per frame
+     * @return Number of frames emitted
+     */
+    static size_t Split(const uint8_t* data, size_t size, const FrameCallback& on_frame);
+
+    /**
+     * Feed the next chunk of a byte stream (e.g. one send() on a TCP socket)
+     * @param stream_id Stream identifier (socket handle)
+     * @param data Chunk bytes
+     * @param size Chunk size
+     * @param on_frame Called once per complete frame
+     * @return Number of frames emitted
+     */
+    size_t Feed(uint64_t stream_id, const uint8_t* data, size_t size, const FrameCallback& on_frame);
+
+    /**
+     * Drop pending data for one stream
+     */
+    void Reset(uint64_t stream_id);
+
+    /**
+     * Drop pending data for all streams
+     */
+    void Clear();
+
+    /**
+     * Get the number of bytes held for a stream
+     */
+    size_t GetPendingSize(uint64_t stream_id) const;
+
+private:
+    // Emit complete frames from data; returns bytes consumed (all of them
+    // unless the tail is an incomplete frame)
+    static size_t EmitFrames(const uint8_t* data, size_t size, const FrameCallback& on_frame, size_t& frames);
+
+    mutable std::mutex mutex_;
+    std::unordered_map<uint64_t, std::vector<uint8_t>> pending_;
+};
+
+} // namespace P2P
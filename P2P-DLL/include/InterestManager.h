@@ -0,0 +1,122 @@
+#pragma once
+
+#include "Types.h"
+#include "PacketBuffer.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace P2P {
+
+/**
+ * InterestManager - Chooses which peers a P2P-routed packet goes to
+ *
+ * Each opcode carries an InterestClass in the packet table. Spatial classes
+ * (AOI, COMBAT) resolve to a radius around the local player; group classes
+ * (PARTY, GUILD) resolve to a member list; ZONE means every connected peer.
+ * PacketRouter hands the result to WebRTCManager, which does the actual
+ * peer selection.
+ *
+ * Positions come from movement packets: the local player's as they are sent,
+ * each peer's as it arrives over P2P (see DecodePosition). Group members come
+ * from the coordinator, which knows which peers share a party or guild.
+ *
+ * All getters are lock-free so they can run on the hooked send() path;
+ * member lists are published as immutable snapshots.
+ */
+class InterestManager {
+public:
+    using MemberList = std::vector<std::string>;
+
+    InterestManager();
+    ~InterestManager();
+
+    // Disable copy and move
+    InterestManager(const InterestManager&) = delete;
+    InterestManager& operator=(const InterestManager&) = delete;
+
+    /**
+     * Take the AOI and combat radii from configuration
+     */
+    void Configure(const P2PConfig& config);
+
+    /**
+     * Get the interest class for an opcode (from the packet table)
+     */
+    static InterestClass Classify(uint16_t type);
+
+    /**
+     * Whether a class is resolved by distance from the local player
+     */
+    static bool IsSpatial(InterestClass interest) {
+        return interest == InterestClass::AOI || interest == InterestClass::COMBAT;
+    }
+
+    /**
+     * Whether a class is resolved by group membership
+     */
+    static bool IsGroup(InterestClass interest) {
+        return interest == InterestClass::PARTY || interest == InterestClass::GUILD;
+    }
+
+    /**
+     * Get the radius for a spatial class
+     * @return Radius in map units, or 0 for non-spatial classes
+     */
+    float GetRadius(InterestClass interest) const;
+
+    /**
+     * Replace the member list of a group class
+     * @param group PARTY or GUILD
+     * @param peer_ids Peer IDs of the group members (the local player may be included)
+     * @return false if the class is not a group class
+     */
+    bool SetGroupMembers(InterestClass group, MemberList peer_ids);
+
+    /**
+     * Get the current member list of a group class
+     * @return Snapshot of the members (empty for non-group classes)
+     */
+    std::shared_ptr<const MemberList> GetGroupMembers(InterestClass group) const;
+
+    /**
+     * Read the map position out of a movement packet
+     * The walk request (MOVEMENT_PACKET_TYPE, MOVEMENT_PACKET_LENGTH bytes)
+     * packs its destination after the opcode as 10-bit x, 10-bit y and a
+     * 4-bit direction, most significant bit first.
+     * @param packet Any packet; only movement packets carry a position
+     * @param x Receives the x cell
+     * @param y Receives the y cell
+     * @return false if the packet is not a (complete) movement packet
+     */
+    static bool DecodePosition(const PacketView& packet, float& x, float& y);
+
+    /**
+     * Batcher destination key for a class
+     * ZONE maps to "" so unclassified traffic shares one batch as before.
+     */
+    static const char* GetDestinationKey(InterestClass interest);
+
+    /**
+     * Inverse of GetDestinationKey
+     * @return ZONE for unknown keys
+     */
+    static InterestClass FromDestinationKey(const std::string& key);
+
+    static constexpr uint16_t MOVEMENT_PACKET_TYPE = 0x0085;
+    static constexpr size_t MOVEMENT_PACKET_LENGTH = 5;
+    static constexpr float DEFAULT_AOI_RADIUS = 100.0f;
+    static constexpr float DEFAULT_COMBAT_RADIUS = 40.0f;
+
+private:
+    std::atomic<float> aoi_radius_{DEFAULT_AOI_RADIUS};
+    std::atomic<float> combat_radius_{DEFAULT_COMBAT_RADIUS};
+
+    // Accessed with std::atomic_load/store
+    std::shared_ptr<const MemberList> party_members_;
+    std::shared_ptr<const MemberList> guild_members_;
+};
+
+} // namespace P2P
@@ -1,16 +1,24 @@
 #pragma once
 
 #include "Types.h"
+#include <spdlog/fmt/fmt.h>
+#include <atomic>
+#include <iterator>
 #include <string>
+#include <string_view>
 #include <memory>
+#include <utility>
 
 namespace P2P {
 
 /**
  * Logger
- * 
+ *
  * Provides logging functionality using spdlog.
  * Singleton pattern for global access.
+ *
+ * The effective level lives in an atomic so the LOG_* macros can reject a
+ * disabled message before its arguments are evaluated or formatted.
  */
 class Logger {
 public:
@@ -21,7 +29,7 @@ public:
 
     /**
      * Initialize logger with configuration
-     * 
+     *
      * @param config Logging configuration
      * @return true if initialized successfully, false otherwise
      */
@@ -42,6 +50,33 @@ public:
     void Error(const std::string& message, const std::string& correlation_id = "");
     void Fatal(const std::string& message, const std::string& correlation_id = "");
 
+    /**
+     * Check whether a message at the given level would be written
+     * Lock-free; safe to call from any thread before building a message.
+     */
+    static bool ShouldLog(LogLevel level) {
+        int value = static_cast<int>(level);
+        if (value < min_level_.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        return level != LogLevel::DEBUG || debug_enabled_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Write an already-built message, tagged with the thread's correlation ID
+     */
+    void Write(LogLevel level, std::string_view message);
+
+    /**
+     * Format with fmt-style arguments and write (used by the LOG_*_FMT macros)
+     */
+    template <typename... Args>
+    void WriteFormat(LogLevel level, fmt::format_string<Args...> format, Args&&... args) {
+        fmt::memory_buffer buffer;
+        fmt::format_to(std::back_inserter(buffer), format, std::forward<Args>(args)...);
+        Write(level, std::string_view(buffer.data(), buffer.size()));
+    }
+
     // Runtime debug toggle
     void SetDebugEnabled(bool enabled);
     bool IsDebugEnabled() const;
@@ -50,22 +85,56 @@ public:
     void SetCorrelationId(const std::string& id);
     std::string GetCorrelationId() const;
 
+    /**
+     * Get the correlation ID without copying it
+     * Backed by a thread-local cache that is refreshed only when the ID changes;
+     * the view stays valid until the next call on the same thread.
+     */
+    std::string_view CorrelationIdView() const;
+
 private:
     Logger() = default;
     ~Logger() = default;
     Logger(const Logger&) = delete;
     Logger& operator=(const Logger&) = delete;
 
+    // Levels at or above this are written; starts above FATAL so nothing is
+    // logged before Initialize()
+    static inline std::atomic<int> min_level_{static_cast<int>(LogLevel::FATAL) + 1};
+    static inline std::atomic<bool> debug_enabled_{false};
+
     class Impl;
     std::unique_ptr<Impl> impl_;
 };
 
-#define LOG_TRACE(msg) P2P::Logger::GetInstance().Trace(msg, P2P::Logger::GetInstance().GetCorrelationId())
-#define LOG_DEBUG(msg) P2P::Logger::GetInstance().Debug(msg, P2P::Logger::GetInstance().GetCorrelationId())
-#define LOG_INFO(msg) P2P::Logger::GetInstance().Info(msg, P2P::Logger::GetInstance().GetCorrelationId())
-#define LOG_WARN(msg) P2P::Logger::GetInstance().Warn(msg, P2P::Logger::GetInstance().GetCorrelationId())
-#define LOG_ERROR(msg) P2P::Logger::GetInstance().Error(msg, P2P::Logger::GetInstance().GetCorrelationId())
-#define LOG_FATAL(msg) P2P::Logger::GetInstance().Fatal(msg, P2P::Logger::GetInstance().GetCorrelationId())
+#define P2P_LOG_AT(level, msg) \
+    do { \
+        if (P2P::Logger::ShouldLog(level)) { \
+            P2P::Logger::GetInstance().Write(level, msg); \
+        } \
+    } while (0)
 
-} // namespace P2P
+#define P2P_LOG_FMT_AT(level, ...) \
+    do { \
+        if (P2P::Logger::ShouldLog(level)) { \
+            P2P::Logger::GetInstance().WriteFormat(level, __VA_ARGS__); \
+        } \
+    } while (0)
+
+// Message argument is only evaluated when the level is enabled
+#define LOG_TRACE(msg) P2P_LOG_AT(P2P::LogLevel::TRACE, msg)
+#define LOG_DEBUG(msg) P2P_LOG_AT(P2P::LogLevel::DEBUG, msg)
+#define LOG_INFO(msg) P2P_LOG_AT(P2P::LogLevel::INFO, msg)
+#define LOG_WARN(msg) P2P_LOG_AT(P2P::LogLevel::WARN, msg)
+#define LOG_ERROR(msg) P2P_LOG_AT(P2P::LogLevel::ERR, msg)
+#define LOG_FATAL(msg) P2P_LOG_AT(P2P::LogLevel::FATAL, msg)
 
+// fmt-style variants for hot paths: LOG_DEBUG_FMT("type=0x{:04X} len={}", type, len)
+#define LOG_TRACE_FMT(...) P2P_LOG_FMT_AT(P2P::LogLevel::TRACE, __VA_ARGS__)
+#define LOG_DEBUG_FMT(...) P2P_LOG_FMT_AT(P2P::LogLevel::DEBUG, __VA_ARGS__)
+#define LOG_INFO_FMT(...) P2P_LOG_FMT_AT(P2P::LogLevel::INFO, __VA_ARGS__)
+#define LOG_WARN_FMT(...) P2P_LOG_FMT_AT(P2P::LogLevel::WARN, __VA_ARGS__)
+#define LOG_ERROR_FMT(...) P2P_LOG_FMT_AT(P2P::LogLevel::ERR, __VA_ARGS__)
+#define LOG_FATAL_FMT(...) P2P_LOG_FMT_AT(P2P::LogLevel::FATAL, __VA_ARGS__)
+
+} // namespace P2P
@@ -6,6 +6,7 @@
 #include <detours/detours.h>
 #include "Types.h"
 #include "PacketRouter.h"
+#include "FrameSplitter.h"
 #include <memory>
 
 namespace P2P {
@@ -61,6 +62,7 @@ private:
     static int (WINAPI* Original_WSASend)(SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
                                          LPDWORD lpNumberOfBytesSent, DWORD dwFlags,
                                          LPWSAOVERLAPPED lpOverlapped, LPWSAOVERLAPPED_COMPLETION_ROUTINE lpCompletionRoutine);
+    static int (WINAPI* Original_closesocket)(SOCKET s);
 
     // Hooked functions
     static int WINAPI Hooked_send(SOCKET s, const char* buf, int len, int flags);
@@ -69,12 +71,16 @@ private:
     static int WINAPI Hooked_WSASend(SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
                                     LPDWORD lpNumberOfBytesSent, DWORD dwFlags,
                                     LPWSAOVERLAPPED lpOverlapped, LPWSAOVERLAPPED_COMPLETION_ROUTINE lpCompletionRoutine);
+    static int WINAPI Hooked_closesocket(SOCKET s);
 
     // Helper methods
-    bool ProcessOutgoingPacket(const char* data, int length);
-    static Packet ParsePacket(const char* data, int length);
+    bool ProcessOutgoingData(SOCKET s, const char* data, int length, bool is_stream);
+    // Forget a stream's partial frame; preserves the caller's WSAGetLastError()
+    void ResetStream(SOCKET s);
+    bool ProcessOutgoingPacket(const PacketView& packet);
 
     std::shared_ptr<PacketRouter> packet_router_;
+    FrameSplitter frame_splitter_;
     bool hooks_installed_;
 };
 
@@ -115,6 +115,12 @@ private:
      */
     void SendSessionRequest();
 
+    /**
+     * Send a message to the coordinator (local SDP and ICE candidates)
+     * @return true if the message was handed to the signaling client
+     */
+    bool SendSignalingMessage(const std::string& message);
+
     struct Impl;
     std::unique_ptr<Impl> impl_;
 };
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "Types.h"
+#include "PacketBuffer.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace P2P {
+
+/**
+ * PacketBatcher - Coalesces small outbound P2P packets into batch frames
+ *
+ * Packets are queued per destination and flushed as one message when the
+ * batch reaches packet_batch_size packets, would exceed MAX_BATCH_BYTES, or
+ * has been open for packet_batch_timeout_ms. One transport message (and one
+ * signature) then covers the whole batch.
+ *
+ * Batch frame layout (little-endian, RO variable-length style):
+ *   [0xFF01][total_length u16][len u16][packet]...[len u16][packet]
+ * total_length covers the header and entries but not a trailing signature.
+ * A batch holding a single packet is sent as the bare packet.
+ */
+class PacketBatcher {
+public:
+    /**
+     * Called with a completed batch. The buffer has tailroom reserved for a
+     * signature. Runs after the batcher lock is released, so other threads
+     * keep adding packets meanwhile (and a thread waiting for its turn to
+     * flush does not hold the lock either); calls are serialised, in the
+     * order the batches were completed. Must not call back into the batcher.
+     * @return true if the batch was sent
+     */
+    using FlushCallback = std::function<bool(const std::string& destination, PacketBuffer& batch)>;
+    using PacketCallback = std::function<void(const PacketView&)>;
+
+    static constexpr uint16_t BATCH_PACKET_TYPE = 0xFF01;
+    static constexpr size_t BATCH_HEADER_SIZE = 4;
+    static constexpr size_t ENTRY_HEADER_SIZE = 2;
+
+    // Keep a batch within a single SCTP/QUIC packet
+    static constexpr size_t MAX_BATCH_BYTES = 1200;
+
+    // Room left behind the batch for the ED25519 signature
+    static constexpr size_t SIGNATURE_TAILROOM = 64;
+
+    PacketBatcher();
+    ~PacketBatcher();
+
+    // Disable copy and move
+    PacketBatcher(const PacketBatcher&) = delete;
+    PacketBatcher& operator=(const PacketBatcher&) = delete;
+
+    /**
+     * Configure batching and start the timeout flusher
+     * @param config Performance configuration (batch size and timeout)
+     * @param on_flush Called for every completed batch
+     * @return true if batching is enabled
+     */
+    bool Initialize(const PerformanceConfig& config, FlushCallback on_flush);
+
+    /**
+     * Flush everything and stop the timeout flusher
+     */
+    void Shutdown();
+
+    /**
+     * Check whether batching is enabled
+     */
+    bool IsEnabled() const;
+
+    /**
+     * Queue a packet for a destination
+     * @param destination Destination key (peer ID, or empty for all peers)
+     * @param packet Packet to queue (copied)
+     * @return true if queued; false if batching is disabled or the packet is
+     *         too large to batch, in which case the caller sends it directly
+     */
+    bool Add(const std::string& destination, const PacketView& packet);
+
+    /**
+     * Flush the open batch for a destination, if any
+     * Returns once it, and any batch already being flushed, has been sent.
+     * @return true if nothing was pending or the batch was sent
+     */
+    bool Flush(const std::string& destination);
+
+    /**
+     * Flush all open batches
+     * Returns once they, and any batch already being flushed, have been sent.
+     */
+    void FlushAll();
+
+    /**
+     * Split a received message into its packets
+     * Non-batch messages are passed through as a single packet.
+     * @param data Message bytes (a trailing signature is ignored)
+     * @param size Message size
+     * @param on_packet Called once per packet
+     * @return false if the batch frame is malformed
+     */
+    static bool Unbatch(const uint8_t* data, size_t size, const PacketCallback& on_packet);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace P2P
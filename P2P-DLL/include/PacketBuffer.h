@@ -0,0 +1,173 @@
+#pragma once
+
+#include "Types.h"
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace P2P {
+
+/**
+ * PacketView - Non-owning view over a single RO packet
+ *
+ * Points directly into the buffer handed to the hooked send() (or any other
+ * caller-owned memory), so routing decisions can be made without copying.
+ * A view is only valid for as long as the memory it points to.
+ */
+struct PacketView {
+    const uint8_t* data = nullptr;
+    size_t length = 0;
+    uint16_t type = 0;  // Packet type for routing decisions
+
+    PacketView() = default;
+
+    /**
+     * Create a view and read the packet type from the first two bytes (little-endian)
+     * @param packet_data Packet bytes
+     * @param packet_length Packet length in bytes
+     */
+    PacketView(const uint8_t* packet_data, size_t packet_length)
+        : data(packet_data), length(packet_length) {
+        if (packet_data && packet_length >= 2) {
+            type = static_cast<uint16_t>(packet_data[0]) |
+                   (static_cast<uint16_t>(packet_data[1]) << 8);
+        }
+    }
+
+    /**
+     * Create a view over an owning Packet
+     * @param packet The packet to view
+     * @return View pointing into packet.data
+     */
+    static PacketView FromPacket(const Packet& packet) {
+        PacketView view;
+        view.data = packet.data.data();
+        view.length = packet.length;
+        view.type = packet.type;
+        return view;
+    }
+
+    bool Empty() const { return data == nullptr || length == 0; }
+};
+
+class PacketBufferPool;
+
+/**
+ * PacketBuffer - Owning, pool-backed packet buffer
+ *
+ * Storage is taken from PacketBufferPool and handed back on destruction, so
+ * steady-state sends do not hit the heap. The buffer keeps headroom in front
+ * of the payload and tailroom behind it, which lets later stages add headers
+ * (IV, frame headers) and trailers (signature, GCM tag) without moving data.
+ */
+class PacketBuffer {
+public:
+    PacketBuffer() = default;
+    ~PacketBuffer();
+
+    // Move-only
+    PacketBuffer(PacketBuffer&& other) noexcept;
+    PacketBuffer& operator=(PacketBuffer&& other) noexcept;
+    PacketBuffer(const PacketBuffer&) = delete;
+    PacketBuffer& operator=(const PacketBuffer&) = delete;
+
+    uint8_t* Data() { return storage_.data() + offset_; }
+    const uint8_t* Data() const { return storage_.data() + offset_; }
+    size_t Size() const { return size_; }
+    bool Empty() const { return size_ == 0; }
+
+    size_t Capacity() const { return storage_.size(); }
+    size_t Headroom() const { return offset_; }
+    size_t Tailroom() const { return storage_.size() - offset_ - size_; }
+
+    /**
+     * Replace the payload with a copy of the given bytes (headroom is kept)
+     * @param data Source bytes
+     * @param size Number of bytes
+     */
+    void Assign(const uint8_t* data, size_t size);
+
+    /**
+     * Grow the payload at the front into the headroom
+     * @param size Number of bytes to prepend
+     * @return Pointer to the new first byte, or nullptr if headroom is too small
+     */
+    uint8_t* Prepend(size_t size);
+
+    /**
+     * Drop bytes from the front of the payload (they become headroom)
+     * @param size Number of bytes to drop
+     */
+    void Consume(size_t size);
+
+    /**
+     * Grow the payload at the back, reallocating if the tailroom is too small
+     * @param size Number of bytes to append
+     * @return Pointer to the first appended byte
+     */
+    uint8_t* Append(size_t size);
+
+    /**
+     * Set the payload size, reallocating if it does not fit
+     * @param size New payload size
+     */
+    void Resize(size_t size);
+
+    /**
+     * Get a non-owning view of the payload
+     */
+    PacketView View() const { return PacketView(Data(), size_); }
+
+private:
+    friend class PacketBufferPool;
+
+    std::vector<uint8_t> storage_;
+    size_t offset_ = 0;
+    size_t size_ = 0;
+};
+
+/**
+ * PacketBufferPool - Free list of packet storage reused across sends
+ */
+class PacketBufferPool {
+public:
+    /**
+     * Get the global instance (singleton pattern)
+     */
+    static PacketBufferPool& GetInstance();
+
+    /**
+     * Acquire an empty buffer
+     * @param capacity Minimum payload capacity (excluding headroom)
+     * @param headroom Bytes reserved in front of the payload
+     * @return Empty buffer with at least the requested room
+     */
+    PacketBuffer Acquire(size_t capacity, size_t headroom = 0);
+
+    /**
+     * Return storage to the pool (called by PacketBuffer)
+     */
+    void Release(std::vector<uint8_t>&& storage);
+
+    /**
+     * Get the number of buffers currently held by the pool
+     */
+    size_t GetFreeCount() const;
+
+    // Limits on what the pool keeps around
+    static constexpr size_t MAX_POOLED_BUFFERS = 256;
+    static constexpr size_t MAX_POOLED_CAPACITY = 64 * 1024;
+    static constexpr size_t MIN_BUFFER_CAPACITY = 512;
+
+private:
+    PacketBufferPool() = default;
+    ~PacketBufferPool() = default;
+    PacketBufferPool(const PacketBufferPool&) = delete;
+    PacketBufferPool& operator=(const PacketBufferPool&) = delete;
+
+    mutable std::mutex mutex_;
+    std::vector<std::vector<uint8_t>> free_;
+};
+
+} // namespace P2P
@@ -1,9 +1,11 @@
 #pragma once
 
 #include "Types.h"
+#include "PacketBuffer.h"
 #include <memory>
 #include <string>
 #include <functional>
+#include <vector>
 #include "ITransport.h"
 #include "SecurityManager.h"
 
@@ -46,14 +48,19 @@ public:
      * @param packet The packet to route
      * @return The routing decision
      */
+    RouteDecision DecideRoute(const PacketView& packet);
     RouteDecision DecideRoute(const Packet& packet);
 
     /**
      * Route a packet based on the decision
+     * A P2P packet may be deferred: batched, or held back by the traffic
+     * shaper. It then counts as routed here, and if the deferred send fails
+     * it falls back to the server on its own.
      * @param packet The packet to route
      * @param decision The routing decision
-     * @return true if routing succeeded
+     * @return true if the packet was sent or accepted for deferred sending
      */
+    bool RoutePacket(const PacketView& packet, RouteDecision decision);
     bool RoutePacket(const Packet& packet, RouteDecision decision);
 
     /**
@@ -97,6 +104,33 @@ public:
      */
     void SetTransport(ITransport* transport);
 
+    /**
+     * Configure outbound batching of small P2P packets
+     * @param config Performance configuration (enable_packet_batching,
+     *               packet_batch_size, packet_batch_timeout_ms)
+     */
+    void ConfigureBatching(const PerformanceConfig& config);
+
+    /**
+     * Configure interest management (AOI and combat radii)
+     * @param config P2P configuration (aoi_radius, combat_radius)
+     */
+    void ConfigureInterest(const P2PConfig& config);
+
+    /**
+     * Set the peers that receive PARTY-class packets
+     * While the list is empty, PARTY-class packets go to the server instead.
+     * @param peer_ids Peer IDs of the party members
+     */
+    void SetPartyMembers(std::vector<std::string> peer_ids);
+
+    /**
+     * Set the peers that receive GUILD-class packets
+     * While the list is empty, GUILD-class packets go to the server instead.
+     * @param peer_ids Peer IDs of the guild members
+     */
+    void SetGuildMembers(std::vector<std::string> peer_ids);
+
 public:
     /**
      * Set the SecurityManager for signing/encryption
@@ -106,19 +140,35 @@ public:
     /**
      * Set the server send function (for actual server routing)
      * The function should return true if the packet was sent successfully.
+     * The view is only valid for the duration of the call.
      */
-    void SetServerSendFunction(std::function<bool(const Packet&)> send_func);
+    void SetServerSendFunction(std::function<bool(const PacketView&)> send_func);
 
 private:
     /**
      * Route packet to server
      */
-    bool RouteToServer(const Packet& packet);
+    bool RouteToServer(const PacketView& packet);
 
     /**
      * Route packet to P2P peers
+     * @return true if sent, or batched/queued for a later send (whose failure
+     *         falls back to the server without reaching the caller)
+     */
+    bool RouteToP2P(const PacketView& packet);
+
+    /**
+     * Sign and send one packet to P2P peers, falling back to the server
+     * Called directly or from the traffic shaper's scheduler thread.
+     * @param target Interest class selecting the receiving peers
+     */
+    bool SendToP2P(const PacketView& packet, InterestClass target);
+
+    /**
+     * Sign and send a completed batch (PacketBatcher flush callback)
+     * @param target Interest class shared by every packet in the batch
      */
-    bool RouteToP2P(const Packet& packet);
+    bool SendBatch(InterestClass target, PacketBuffer& batch);
 
     // Pimpl idiom for implementation details
     struct Impl;
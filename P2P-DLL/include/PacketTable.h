@@ -0,0 +1,153 @@
+#pragma once
+
+#include "Types.h"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace P2P {
+
+/**
+ * PacketDescriptor - Everything the send path needs to know about one opcode
+ *
+ * Packed into 32 bits so the whole 64K-entry table is 256 KB and a lookup
+ * is a single load:
+ *   bits 0-1   route      (stored XOR SERVER)
+ *   bits 2-4   priority   (stored XOR LOW)
+ *   bit  5     batchable
+ *   bit  6     variable length (length word at offset 2)
+ *   bit  7     defined (opcode is present in the table)
+ *   bits 8-10  interest   (which peers receive it when routed P2P)
+ *   bit  11    unreliable (superseded state; may be lost or reordered)
+ *   bits 16-31 fixed length in bytes (0 = unknown / variable)
+ *
+ * Fields are stored XOR'd with their defaults so a zero word is the default
+ * descriptor (SERVER, LOW, ZONE, unknown length) and the table can be zero-initialised.
+ */
+struct PacketDescriptor {
+    uint32_t bits = 0;
+
+    static constexpr uint32_t ROUTE_SHIFT = 0;
+    static constexpr uint32_t ROUTE_MASK = 0x3;
+    static constexpr uint32_t PRIORITY_SHIFT = 2;
+    static constexpr uint32_t PRIORITY_MASK = 0x7;
+    static constexpr uint32_t BATCHABLE_BIT = 1u << 5;
+    static constexpr uint32_t VARIABLE_LENGTH_BIT = 1u << 6;
+    static constexpr uint32_t DEFINED_BIT = 1u << 7;
+    static constexpr uint32_t INTEREST_SHIFT = 8;
+    static constexpr uint32_t INTEREST_MASK = 0x7;
+    static constexpr uint32_t UNRELIABLE_BIT = 1u << 11;
+    static constexpr uint32_t LENGTH_SHIFT = 16;
+
+    static constexpr uint32_t ROUTE_DEFAULT = static_cast<uint32_t>(RouteDecision::SERVER);
+    static constexpr uint32_t PRIORITY_DEFAULT = static_cast<uint32_t>(PacketPriority::LOW);
+
+    /**
+     * Build a descriptor
+     * @param route Route decision when P2P is enabled
+     * @param priority Bandwidth priority
+     * @param fixed_length Fixed packet length in bytes, or 0 if variable/unknown
+     * @param batchable Whether the packet may be coalesced with others
+     * @param variable_length Whether the length is carried in bytes 2-3
+     * @param interest Peers the packet is relevant to when routed P2P
+     * @param unreliable Whether a newer packet supersedes it, so it may go
+     *        over the unordered, no-retransmit state channel
+     */
+    static constexpr PacketDescriptor Make(RouteDecision route, PacketPriority priority,
+                                           uint16_t fixed_length, bool batchable,
+                                           bool variable_length = false,
+                                           InterestClass interest = InterestClass::ZONE,
+                                           bool unreliable = false) {
+        PacketDescriptor descriptor;
+        descriptor.bits = DEFINED_BIT |
+            (((static_cast<uint32_t>(route) ^ ROUTE_DEFAULT) & ROUTE_MASK) << ROUTE_SHIFT) |
+            (((static_cast<uint32_t>(priority) ^ PRIORITY_DEFAULT) & PRIORITY_MASK) << PRIORITY_SHIFT) |
+            (batchable ? BATCHABLE_BIT : 0u) |
+            (variable_length ? VARIABLE_LENGTH_BIT : 0u) |
+            (unreliable ? UNRELIABLE_BIT : 0u) |
+            ((static_cast<uint32_t>(interest) & INTEREST_MASK) << INTEREST_SHIFT) |
+            (static_cast<uint32_t>(fixed_length) << LENGTH_SHIFT);
+        return descriptor;
+    }
+
+    constexpr RouteDecision Route() const {
+        return static_cast<RouteDecision>(((bits >> ROUTE_SHIFT) & ROUTE_MASK) ^ ROUTE_DEFAULT);
+    }
+    constexpr PacketPriority Priority() const {
+        return static_cast<PacketPriority>(((bits >> PRIORITY_SHIFT) & PRIORITY_MASK) ^ PRIORITY_DEFAULT);
+    }
+    constexpr InterestClass Interest() const {
+        return static_cast<InterestClass>((bits >> INTEREST_SHIFT) & INTEREST_MASK);
+    }
+    constexpr uint16_t FixedLength() const { return static_cast<uint16_t>(bits >> LENGTH_SHIFT); }
+    constexpr bool IsBatchable() const { return (bits & BATCHABLE_BIT) != 0; }
+    constexpr bool IsVariableLength() const { return (bits & VARIABLE_LENGTH_BIT) != 0; }
+    constexpr bool IsUnreliable() const { return (bits & UNRELIABLE_BIT) != 0; }
+    constexpr bool IsDefined() const { return (bits & DEFINED_BIT) != 0; }
+};
+
+static_assert(sizeof(PacketDescriptor) == sizeof(uint32_t), "PacketDescriptor must stay 32 bits");
+
+/**
+ * PacketTable - Single source of truth for per-opcode routing and priority
+ *
+ * The default table is built once, on first use, from the opcode list in
+ * PacketTable.cpp. Config overrides are applied to a copy which is then
+ * published with one pointer swap, so Lookup() never takes a lock.
+ */
+class PacketTable {
+public:
+    static constexpr size_t TABLE_SIZE = 65536;
+    using Table = std::array<PacketDescriptor, TABLE_SIZE>;
+
+    /**
+     * Get the global instance (singleton pattern)
+     */
+    static PacketTable& GetInstance();
+
+    /**
+     * Look up the descriptor for an opcode
+     * @param type RO packet type
+     * @return Descriptor (default descriptor for unknown opcodes)
+     */
+    PacketDescriptor Lookup(uint16_t type) const {
+        return (*active_.load(std::memory_order_acquire))[type];
+    }
+
+    /**
+     * Apply per-opcode overrides on top of the default table
+     * @param overrides Overrides from configuration
+     * @return true if all overrides were valid, false if any were skipped
+     */
+    bool ApplyOverrides(const std::vector<PacketTypeOverride>& overrides);
+
+    /**
+     * Drop all overrides and go back to the default table
+     */
+    void Reset();
+
+    /**
+     * Get the default table (built on the first call)
+     */
+    static const Table& GetDefaultTable();
+
+private:
+    PacketTable();
+    ~PacketTable() = default;
+    PacketTable(const PacketTable&) = delete;
+    PacketTable& operator=(const PacketTable&) = delete;
+
+    std::atomic<const Table*> active_;
+
+    // Override tables are kept alive for the lifetime of the process since
+    // readers may still hold the previous pointer; they are only built at
+    // config load, so this stays tiny.
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<Table>> override_tables_;
+};
+
+} // namespace P2P
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "Types.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace P2P {
+
+/**
+ * PeerMetricsTable - Fixed-capacity per-peer traffic counters
+ *
+ * Each peer gets a small integer handle and one cache-line-sized block of
+ * relaxed atomic counters, so updates for different peers never share a
+ * line and no update takes a lock. Only Acquire() and Release() lock; they
+ * republish the peer ID to handle map as an immutable snapshot that Find()
+ * reads without locking.
+ *
+ * Read() and Aggregate() load each counter on its own; a reader racing
+ * updates may see one counter a packet ahead of another. A released handle
+ * may be handed to a new peer, so callers should stop using a handle once
+ * they release it.
+ */
+class PeerMetricsTable {
+public:
+    using Handle = uint32_t;
+    static constexpr Handle INVALID_HANDLE = UINT32_MAX;
+    static constexpr size_t DEFAULT_CAPACITY = 256;
+    // Weight of the previous average in AddLatencySample()
+    static constexpr float LATENCY_SMOOTHING = 0.8f;
+
+    explicit PeerMetricsTable(size_t capacity = DEFAULT_CAPACITY);
+    ~PeerMetricsTable();
+
+    // Disable copy and move (handles index into the blocks)
+    PeerMetricsTable(const PeerMetricsTable&) = delete;
+    PeerMetricsTable& operator=(const PeerMetricsTable&) = delete;
+
+    /**
+     * Get a peer's handle, registering the peer if needed
+     * @return Handle, or INVALID_HANDLE if the table is full
+     */
+    Handle Acquire(const std::string& peer_id);
+
+    /**
+     * Look up a peer's handle (lock-free)
+     * @return Handle, or INVALID_HANDLE if not registered
+     */
+    Handle Find(const std::string& peer_id) const;
+
+    /**
+     * Unregister a peer; its handle may be reused afterwards
+     */
+    void Release(const std::string& peer_id);
+
+    /**
+     * Unregister every peer
+     */
+    void Clear();
+
+    size_t Size() const;
+    size_t Capacity() const { return capacity_; }
+
+    // Counter updates; invalid handles are ignored
+    void AddSent(Handle handle, size_t bytes);
+    void AddReceived(Handle handle, size_t bytes);
+    void AddLost(Handle handle, uint64_t packets);
+
+    /**
+     * Fold a latency sample into the peer's moving average
+     */
+    void AddLatencySample(Handle handle, float latency_ms);
+
+    /**
+     * Replace the peer's latency (e.g. with an already smoothed RTT)
+     */
+    void SetLatency(Handle handle, float latency_ms);
+
+    /**
+     * Zero a peer's counters, keeping its registration
+     */
+    void Reset(Handle handle);
+
+    /**
+     * Zero every registered peer's counters
+     */
+    void ResetAll();
+
+    /**
+     * Current counters for one peer
+     * packet_loss_percent is packets_lost / (packets_received + packets_lost).
+     * @return Zeroed metrics for an invalid or unregistered handle
+     */
+    BandwidthMetrics Read(Handle handle) const;
+
+    /**
+     * Sums over every registered peer; latency and loss are per-peer averages
+     */
+    BandwidthMetrics Aggregate() const;
+
+private:
+    using IdMap = std::unordered_map<std::string, Handle>;
+
+    struct alignas(64) Block {
+        std::atomic<uint64_t> bytes_sent{0};
+        std::atomic<uint64_t> bytes_received{0};
+        std::atomic<uint64_t> packets_sent{0};
+        std::atomic<uint64_t> packets_received{0};
+        std::atomic<uint64_t> packets_lost{0};
+        std::atomic<float> latency_ms{0.0f};
+        std::atomic<int64_t> last_update_ns{0};
+        std::atomic<bool> in_use{false};
+    };
+
+    Block* GetBlock(Handle handle) const;
+    void ResetBlock(Block& block) const;
+    void PublishIds();
+
+    size_t capacity_;
+    std::unique_ptr<Block[]> blocks_;
+
+    // Registration (cold path)
+    std::mutex mutex_;
+    IdMap ids_;
+    std::vector<Handle> free_handles_;
+    // Copy of ids_ read by Find() (accessed with std::atomic_load/store)
+    std::shared_ptr<const IdMap> id_snapshot_;
+};
+
+} // namespace P2P
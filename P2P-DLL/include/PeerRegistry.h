@@ -0,0 +1,131 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace P2P {
+
+class WebRTCPeerConnection;
+
+/**
+ * PeerRegistry - Dense, fixed-capacity table of peer connections
+ *
+ * Each peer gets a small integer handle that stays valid until the peer is
+ * erased. Peer IDs map to handles through an open-addressing hash table
+ * (linear probing, backward-shift deletion), so lookups are O(1) with no
+ * string compares beyond the final match.
+ *
+ * The fields read on every broadcast and AOI pass (connected flag, position,
+ * score) are kept as structure-of-arrays indexed by handle, and live handles
+ * are kept packed in one vector, so iteration touches contiguous memory
+ * instead of chasing one shared_ptr per peer.
+ *
+ * Not thread-safe, except the connected flags, which may be updated from
+ * transport callbacks while the owner holds its own lock.
+ */
+class PeerRegistry {
+public:
+    using Handle = uint32_t;
+    static constexpr Handle INVALID_HANDLE = UINT32_MAX;
+    static constexpr size_t DEFAULT_CAPACITY = 50;
+
+    explicit PeerRegistry(size_t capacity = DEFAULT_CAPACITY);
+    ~PeerRegistry();
+
+    // Disable copy and move (connected flags are referenced by handle from callbacks)
+    PeerRegistry(const PeerRegistry&) = delete;
+    PeerRegistry& operator=(const PeerRegistry&) = delete;
+
+    /**
+     * Drop every peer and resize the table
+     * @param capacity Maximum number of peers
+     */
+    void Reset(size_t capacity);
+
+    /**
+     * Drop every peer, keeping the capacity
+     */
+    void Clear();
+
+    /**
+     * Add a peer
+     * @param peer_id Peer ID (must not already be registered)
+     * @param peer Peer connection
+     * @return Handle, or INVALID_HANDLE if the ID is taken or the table is full
+     */
+    Handle Insert(const std::string& peer_id, std::shared_ptr<WebRTCPeerConnection> peer);
+
+    /**
+     * Look up a peer by ID
+     * @return Handle, or INVALID_HANDLE if not registered
+     */
+    Handle Find(const std::string& peer_id) const;
+
+    /**
+     * Remove a peer; its handle may be reused afterwards
+     * @return true if the handle was live
+     */
+    bool Erase(Handle handle);
+
+    bool IsValid(Handle handle) const { return handle < capacity_ && in_use_[handle]; }
+    size_t Size() const { return live_.size(); }
+    size_t Capacity() const { return capacity_; }
+    bool Full() const { return live_.size() >= capacity_; }
+
+    /**
+     * Live handles, packed; invalidated by Insert/Erase
+     */
+    const std::vector<Handle>& Handles() const { return live_; }
+
+    const std::string& GetPeerId(Handle handle) const { return peer_ids_[handle]; }
+    const std::shared_ptr<WebRTCPeerConnection>& GetPeer(Handle handle) const { return peers_[handle]; }
+
+    // Hot per-peer fields
+    bool IsConnected(Handle handle) const { return connected_[handle].load(std::memory_order_relaxed); }
+    void SetConnected(Handle handle, bool connected) { connected_[handle].store(connected, std::memory_order_relaxed); }
+
+    float GetPositionX(Handle handle) const { return pos_x_[handle]; }
+    float GetPositionY(Handle handle) const { return pos_y_[handle]; }
+    float GetPositionZ(Handle handle) const { return pos_z_[handle]; }
+    void SetPosition(Handle handle, float x, float y, float z);
+
+    float GetScore(Handle handle) const { return score_[handle]; }
+    void SetScore(Handle handle, float score) { score_[handle] = score; }
+
+private:
+    struct Bucket {
+        uint32_t hash = 0;
+        Handle handle = INVALID_HANDLE;
+    };
+
+    static uint32_t Hash(const std::string& peer_id);
+    size_t FindBucket(const std::string& peer_id, uint32_t hash) const;
+    void EraseBucket(size_t index);
+
+    size_t capacity_ = 0;
+    size_t bucket_mask_ = 0;
+    std::vector<Bucket> buckets_;
+
+    // Cold per-peer data
+    std::vector<std::string> peer_ids_;
+    std::vector<std::shared_ptr<WebRTCPeerConnection>> peers_;
+    std::vector<uint8_t> in_use_;
+    std::vector<Handle> free_handles_;
+
+    // Live handles, packed, and each handle's position in live_
+    std::vector<Handle> live_;
+    std::vector<uint32_t> live_index_;
+
+    // Hot per-peer data (structure-of-arrays)
+    std::unique_ptr<std::atomic<bool>[]> connected_;
+    std::vector<float> pos_x_;
+    std::vector<float> pos_y_;
+    std::vector<float> pos_z_;
+    std::vector<float> score_;
+};
+
+} // namespace P2P
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "PacketBuffer.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace P2P {
+
+/**
+ * PeerSendQueue - Bounded outbound queue for one peer
+ *
+ * Producers (the game thread inside the hooked send()) only move a pooled
+ * buffer into the queue; the transport call happens later on a
+ * SendWorkerPool thread. A slow or stalled DataChannel therefore backs up
+ * its own queue instead of blocking the sender or other peers. When the
+ * queue is full, new packets are dropped and counted.
+ */
+class PeerSendQueue {
+public:
+    /**
+     * Performs the actual transport send
+     * @return true if the transport accepted the message
+     */
+    using SendFunction = std::function<bool(const uint8_t* data, size_t size)>;
+
+    static constexpr size_t DEFAULT_MAX_QUEUED = 256;
+
+    /**
+     * @param peer_id Peer ID (for logging)
+     * @param send Transport send function
+     * @param max_queued Packets held before new ones are dropped
+     */
+    PeerSendQueue(std::string peer_id, SendFunction send, size_t max_queued = DEFAULT_MAX_QUEUED);
+
+    // Disable copy and move
+    PeerSendQueue(const PeerSendQueue&) = delete;
+    PeerSendQueue& operator=(const PeerSendQueue&) = delete;
+
+    const std::string& GetPeerId() const { return peer_id_; }
+
+    bool IsConnected() const { return connected_.load(std::memory_order_acquire); }
+    void SetConnected(bool connected) { connected_.store(connected, std::memory_order_release); }
+
+    /**
+     * Queue a packet without touching the transport
+     * @return false if the queue is full (the packet is dropped)
+     */
+    bool Push(PacketBuffer&& packet);
+
+    /**
+     * Send queued packets on the calling thread
+     * Only one thread may drain a queue at a time (see SendWorkerPool).
+     * @param max_packets Upper bound on packets sent in this call
+     * @return Number of packets handed to the transport
+     */
+    size_t Drain(size_t max_packets);
+
+    /**
+     * Send directly, bypassing the queue (used when no worker pool is running)
+     */
+    bool SendNow(const uint8_t* data, size_t size);
+
+    bool Empty() const;
+    uint64_t GetDroppedCount() const { return dropped_.load(std::memory_order_relaxed); }
+
+    /**
+     * Claim the right to schedule this queue on a worker
+     * @return true if the caller must schedule it (it was not already scheduled)
+     */
+    bool MarkScheduled() { return !scheduled_.exchange(true, std::memory_order_acq_rel); }
+    void ClearScheduled() { scheduled_.store(false, std::memory_order_release); }
+
+private:
+    std::string peer_id_;
+    SendFunction send_;
+    size_t max_queued_;
+
+    mutable std::mutex mutex_; // Guards queue_ only; never held across a send
+    std::deque<PacketBuffer> queue_;
+
+    std::atomic<bool> connected_{false};
+    std::atomic<bool> scheduled_{false};
+    std::atomic<uint64_t> dropped_{0};
+};
+
+/**
+ * SendWorkerPool - Transport threads that drain PeerSendQueues
+ *
+ * A queue is scheduled at most once at a time, so each peer's packets stay
+ * in order while different peers are sent in parallel. Each turn sends at
+ * most DRAIN_BUDGET packets before the queue goes to the back of the line.
+ */
+class SendWorkerPool {
+public:
+    static constexpr size_t DRAIN_BUDGET = 32;
+
+    SendWorkerPool();
+    ~SendWorkerPool();
+
+    // Disable copy and move
+    SendWorkerPool(const SendWorkerPool&) = delete;
+    SendWorkerPool& operator=(const SendWorkerPool&) = delete;
+
+    /**
+     * Start the worker threads (restarts if already running)
+     * @param threads Number of threads (io_thread_pool_size)
+     * @return true if at least one thread is running
+     */
+    bool Start(size_t threads);
+
+    /**
+     * Stop and join the worker threads; packets still queued are dropped
+     */
+    void Stop();
+
+    bool IsRunning() const;
+
+    /**
+     * Queue a packet for a peer and wake a worker if needed
+     * @return false if the peer's queue is full
+     */
+    bool Submit(const std::shared_ptr<PeerSendQueue>& queue, PacketBuffer&& packet);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace P2P
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "PacketBuffer.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace P2P {
+
+/**
+ * ReorderWindow - Receive window for one peer's unordered, unreliable stream
+ *
+ * Packets carry a 32-bit sequence number (compared with wraparound). The
+ * window delivers them in sequence order:
+ *   - the next expected packet is delivered at once, followed by any
+ *     buffered packets it unblocks
+ *   - a packet ahead of a gap is buffered until the gap fills or it has
+ *     waited the jitter budget; then the missing packets are given up on
+ *   - a packet behind what was already delivered is stale and dropped, as
+ *     is a duplicate of a buffered one
+ *   - a packet more than the window capacity ahead flushes the window and
+ *     restarts it there
+ * With a zero jitter budget nothing is held: gaps are skipped at once and
+ * only stale packets are dropped.
+ *
+ * Buffered packets are released when later packets arrive and by Poll(),
+ * which the owner calls periodically. Not thread-safe.
+ */
+class ReorderWindow {
+public:
+    using DeliverFunction = std::function<void(const uint8_t* data, size_t size)>;
+
+    static constexpr size_t DEFAULT_CAPACITY = 64;
+    static constexpr int64_t DEFAULT_JITTER_BUDGET_US = 40000;
+
+    enum class Result {
+        DELIVERED,  // Delivered (possibly with buffered packets after it)
+        BUFFERED,   // Waiting for earlier packets
+        STALE,      // Older than what was already delivered; dropped
+        DUPLICATE   // Already buffered; dropped
+    };
+
+    struct Stats {
+        uint64_t delivered = 0;
+        uint64_t reordered = 0;  // Delivered after waiting in the buffer
+        uint64_t stale = 0;
+        uint64_t duplicates = 0;
+        uint64_t skipped = 0;    // Sequence numbers given up on
+    };
+
+    /**
+     * @param jitter_budget_us Longest a packet waits for earlier ones
+     * @param capacity Packets the window spans (rounded up to a power of two)
+     */
+    explicit ReorderWindow(int64_t jitter_budget_us = DEFAULT_JITTER_BUDGET_US,
+                           size_t capacity = DEFAULT_CAPACITY);
+
+    /**
+     * Set how long a packet may wait for earlier ones (microseconds)
+     */
+    void SetJitterBudget(int64_t jitter_budget_us) { jitter_budget_us_ = jitter_budget_us; }
+    int64_t GetJitterBudget() const { return jitter_budget_us_; }
+
+    /**
+     * Accept one packet
+     * @param sequence Sender's sequence number
+     * @param now_us Arrival time (any monotonic clock, microseconds)
+     * @param deliver Called for every packet released, in order
+     */
+    Result Push(uint32_t sequence, const uint8_t* data, size_t size, int64_t now_us, const DeliverFunction& deliver);
+
+    /**
+     * Release buffered packets that have waited the jitter budget
+     * @return Number of packets delivered
+     */
+    size_t Poll(int64_t now_us, const DeliverFunction& deliver);
+
+    /**
+     * Drop everything and wait for a new first packet
+     */
+    void Reset();
+
+    size_t GetBufferedCount() const { return buffered_; }
+    const Stats& GetStats() const { return stats_; }
+
+private:
+    struct Slot {
+        uint32_t sequence = 0;
+        int64_t arrival_us = 0;
+        bool used = false;
+        PacketBuffer packet;
+    };
+
+    Slot& SlotFor(uint32_t sequence) { return slots_[sequence % slots_.size()]; }
+    // Deliver the next expected packet and everything buffered after it
+    void DeliverInOrder(const DeliverFunction& deliver);
+    // Lowest buffered packet, or nullptr
+    Slot* FirstBuffered();
+    void SkipTo(uint32_t sequence);
+
+    std::vector<Slot> slots_;
+    int64_t jitter_budget_us_;
+    uint32_t next_ = 0;  // Next sequence number to deliver
+    bool started_ = false;
+    size_t buffered_ = 0;
+    Stats stats_;
+};
+
+} // namespace P2P
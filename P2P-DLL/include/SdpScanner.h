@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace P2P {
+
+/**
+ * SdpScanner - Forward-only line scanner over an SDP blob
+ *
+ * Yields one line at a time as a view into the caller's string, with the
+ * CRLF (or bare LF) stripped. Nothing is copied or allocated, so pulling
+ * one attribute out of an offer costs a single pass over the text.
+ */
+class SdpScanner {
+public:
+    explicit SdpScanner(std::string_view sdp) : rest_(sdp) {}
+
+    /**
+     * Advance to the next line
+     * @param line Set to the line without its terminator
+     * @return false once the SDP is exhausted
+     */
+    bool Next(std::string_view& line);
+
+    /**
+     * Find the first line starting with a prefix
+     * @param sdp SDP text
+     * @param prefix Line prefix, e.g. "a=mid:"
+     * @return The rest of that line after the prefix, or an empty view
+     */
+    static std::string_view FindValue(std::string_view sdp, std::string_view prefix);
+
+    /**
+     * Extract the sender's peer ID from an offer
+     * Looks for "a=mid:peerid-<id>", falling back to "a=msid-semantic: WMS <id>".
+     * @return The peer ID, or an empty string if the SDP names none
+     */
+    static std::string ExtractPeerId(std::string_view sdp);
+
+private:
+    std::string_view rest_;
+};
+
+} // namespace P2P
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "PacketBuffer.h"
 #include <memory>
 #include <vector>
 #include <cstdint>
@@ -17,6 +18,23 @@ namespace P2P {
  */
 class SecurityManager {
 public:
+    // Size of a detached ED25519 signature appended to P2P packets
+    static constexpr size_t ED25519_SIGNATURE_SIZE = 64;
+
+    // Packets and batch frames are signed over a context-tagged BLAKE2b digest
+    static constexpr size_t SIGNATURE_DIGEST_SIZE = 32;
+
+    // Index of a per-peer key slot
+    using PeerKeyHandle = uint32_t;
+    static constexpr PeerKeyHandle INVALID_PEER_KEY = UINT32_MAX;
+    static constexpr size_t DEFAULT_MAX_PEER_KEYS = 50;
+
+    // AES-256-GCM frame overhead: IV in front of the ciphertext, tag behind it
+    static constexpr size_t ENCRYPTION_HEADROOM = 12;
+    static constexpr size_t ENCRYPTION_TAILROOM = 16;
+    // Headroom for the IV plus the largest stored compression frame header
+    static constexpr size_t PACKET_HEADROOM = ENCRYPTION_HEADROOM + 5;
+
     SecurityManager();
     ~SecurityManager();
 
@@ -29,21 +47,56 @@ public:
     // ED25519: Load private key from file
     bool LoadED25519Key(const std::string& key_path);
 
-    // ED25519: Sign outbound packet
+    // ED25519: Sign outbound packet (over its packet-context digest)
     bool SignPacketED25519(const uint8_t* data, size_t size, std::vector<uint8_t>& signature_out);
 
-    // ED25519: Check if signature is enabled
+    // ED25519: Sign outbound packet into caller-provided storage (ED25519_SIGNATURE_SIZE bytes)
+    bool SignPacketED25519(const uint8_t* data, size_t size, uint8_t* signature_out);
+
+    // ED25519: Check if signing is enabled and a key is loaded
     bool IsSignatureEnabled() const;
 
     // ED25519: Verify packet signature
     bool VerifyPacketED25519(const uint8_t* data, size_t size, const uint8_t* signature);
 
+    /**
+     * ED25519: Sign a batch frame once for all the packets it carries
+     * Signs a BLAKE2b-256 digest of the frame under the batch context tag,
+     * so a batch signature never verifies as a packet signature (or the
+     * other way round).
+     * @param data Batch frame (without signature)
+     * @param size Frame size
+     * @param signature_out ED25519_SIGNATURE_SIZE bytes
+     * @return true if signed
+     */
+    bool SignBatchED25519(const uint8_t* data, size_t size, uint8_t* signature_out);
+
+    /**
+     * ED25519: Verify a signature made with SignBatchED25519
+     */
+    bool VerifyBatchED25519(const uint8_t* data, size_t size, const uint8_t* signature);
+
+    /**
+     * ED25519: Verify the trailing signature PacketRouter appends to a P2P frame
+     * Batch frames are checked as batches, anything else as a packet. Takes
+     * no locks, so callback threads for different peers verify concurrently.
+     * @param data Frame followed by its signature
+     * @param size Size including the signature
+     * @param payload_size Set to the size without the signature
+     * @return true if the signature verified
+     */
+    bool VerifyFrameED25519(const uint8_t* data, size_t size, size_t& payload_size);
+
     /**
      * Initialize the security manager
+     * Sizes the per-peer key table on the first call; later calls must pass
+     * the same max_peers, since the table is never reallocated.
      * @param encryption_enabled Whether encryption is enabled
-     * @return true if initialization succeeded
+     * @param max_peers Number of per-peer key slots
+     * @return true if initialization succeeded, false if max_peers differs
+     *         from an earlier call
      */
-    bool Initialize(bool encryption_enabled);
+    bool Initialize(bool encryption_enabled, size_t max_peers = DEFAULT_MAX_PEER_KEYS);
 
     /**
      * Shutdown the security manager
@@ -68,6 +121,22 @@ public:
      */
     bool DecryptPacket(const uint8_t* data, size_t size, std::vector<uint8_t>& decrypted_out);
 
+    /**
+     * Compress and encrypt a packet in place
+     * On return the buffer holds IV + ciphertext + tag, ready for the transport.
+     * Reserve PACKET_HEADROOM / ENCRYPTION_TAILROOM up front to avoid a copy.
+     * @param buffer Plaintext packet; replaced by the encrypted frame
+     * @return true if encryption succeeded
+     */
+    bool EncryptPacket(PacketBuffer& buffer);
+
+    /**
+     * Decrypt and decompress a packet in place
+     * @param buffer Encrypted frame; replaced by the plaintext packet
+     * @return true if decryption succeeded
+     */
+    bool DecryptPacket(PacketBuffer& buffer);
+
     /**
      * Validate a packet
      * @param data Input data
@@ -99,15 +168,20 @@ public:
 
     /**
      * Get the public key for transmission to peer
+     * Still available after DeriveSharedKey has consumed the keypair.
      * @return Public key in DER format, empty if not generated
      */
     std::vector<uint8_t> GetPublicKey() const;
 
     /**
      * Derive shared encryption key from peer's public key
-     * Uses ECDH to compute shared secret, then HKDF-SHA256 to derive AES-256 key
+     * Uses ECDH to compute shared secret, then HKDF-SHA256 to derive one
+     * AES-256 key per direction (ordered by public key, so each end sends
+     * with the key the other receives with). Replaces any earlier key.
+     * Consumes the keypair: deriving again needs a new GenerateECDHKeypair.
+     * Does not change IsEncryptionEnabled, which Initialize sets.
      * @param peer_public_key Peer's public key in DER format
-     * @return true if key derivation succeeded
+     * @return true if key derivation succeeded, false without an unused keypair
      */
     bool DeriveSharedKey(const std::vector<uint8_t>& peer_public_key);
 
@@ -117,6 +191,75 @@ public:
      */
     bool IsKeyReady() const;
 
+    // Per-peer keys
+    //
+    // Each peer gets its own ECDHE handshake and AES key in a fixed slot, so
+    // handshakes with different peers run concurrently and never overwrite
+    // each other's key. Encrypt/decrypt index the slot without locking.
+
+    /**
+     * Assign a key slot to a peer (returns the existing slot if it has one)
+     * @param peer_id Peer ID
+     * @return Slot handle, or INVALID_PEER_KEY if all max_peers slots are taken
+     */
+    PeerKeyHandle AcquirePeerKey(const std::string& peer_id);
+
+    /**
+     * Wipe a peer's keys and free its slot
+     * @param handle Slot handle from AcquirePeerKey
+     */
+    void ReleasePeerKey(PeerKeyHandle handle);
+
+    /**
+     * Generate the ECDHE keypair for one peer's handshake
+     * @param handle Slot handle from AcquirePeerKey
+     * @return true if keypair generation succeeded
+     */
+    bool GenerateECDHKeypair(PeerKeyHandle handle);
+
+    /**
+     * Get one peer handshake's public key
+     * Still available after DeriveSharedKey has consumed the keypair.
+     * @param handle Slot handle from AcquirePeerKey
+     * @return Public key in DER format, empty if not generated
+     */
+    std::vector<uint8_t> GetPublicKey(PeerKeyHandle handle) const;
+
+    /**
+     * Derive a peer's AES-256 send and receive keys from its public key
+     * Consumes the slot's keypair, since deriving from it again would
+     * restart the nonce counter under the same keys. Rekeying takes a new
+     * GenerateECDHKeypair on both ends; frames sealed under the old keys
+     * then no longer decrypt. From then on this peer's traffic is sealed,
+     * whatever Initialize set for the manager.
+     * @param handle Slot handle from AcquirePeerKey
+     * @param peer_public_key Peer's public key in DER format
+     * @return true if key derivation succeeded, false without an unused keypair
+     */
+    bool DeriveSharedKey(PeerKeyHandle handle, const std::vector<uint8_t>& peer_public_key);
+
+    /**
+     * Check if a peer's key has been derived
+     * @param handle Slot handle from AcquirePeerKey
+     */
+    bool IsKeyReady(PeerKeyHandle handle) const;
+
+    /**
+     * Compress and encrypt a packet in place with a peer's key
+     * @param handle Slot handle from AcquirePeerKey
+     * @param buffer Plaintext packet; replaced by the encrypted frame
+     * @return true if encryption succeeded
+     */
+    bool EncryptPacket(PeerKeyHandle handle, PacketBuffer& buffer);
+
+    /**
+     * Decrypt and decompress a packet in place with a peer's key
+     * @param handle Slot handle from AcquirePeerKey
+     * @param buffer Encrypted frame; replaced by the plaintext packet
+     * @return true if decryption succeeded
+     */
+    bool DecryptPacket(PeerKeyHandle handle, PacketBuffer& buffer);
+
 private:
     // Pimpl idiom for implementation details
     struct Impl;
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace P2P {
+
+/**
+ * SpatialGrid - Uniform cell-hash index over peer positions
+ *
+ * Peers are bucketed by the (x, y) map cell they stand on; only occupied
+ * cells are stored, so the index costs nothing for empty map space. Moving
+ * a peer within its cell only rewrites its coordinates. Queries visit just
+ * the cells that can contain a match and then apply the exact 3D distance,
+ * matching the AOI test WebRTCPeerConnection::IsWithinAOI used before.
+ *
+ * Handles are small integers (PeerRegistry handles). Not thread-safe.
+ * WebRTCManager does not maintain one: with at most max_peers peers its
+ * lock-free snapshot scan is cheaper than updating an index under the
+ * manager lock on every position report. The grid is kept for callers
+ * tracking enough positions (e.g. whole-map entities) to need it.
+ */
+class SpatialGrid {
+public:
+    using Handle = uint32_t;
+
+    // Side of one grid cell in map units; roughly one client view range
+    static constexpr float DEFAULT_CELL_SIZE = 32.0f;
+
+    explicit SpatialGrid(float cell_size = DEFAULT_CELL_SIZE);
+
+    /**
+     * Change the cell size and re-bucket every entry
+     * @param cell_size Cell side in map units (must be > 0)
+     */
+    void SetCellSize(float cell_size);
+    float GetCellSize() const { return cell_size_; }
+
+    /**
+     * Insert a handle or move it to a new position
+     */
+    void Update(Handle handle, float x, float y, float z);
+
+    /**
+     * Remove a handle (no-op if absent)
+     */
+    void Remove(Handle handle);
+
+    void Clear();
+    bool Contains(Handle handle) const { return handle < entries_.size() && entries_[handle].present; }
+    size_t Size() const { return size_; }
+
+    /**
+     * Collect handles within radius of a point (3D distance, inclusive)
+     * @param out Cleared, then filled in no particular order
+     */
+    void QueryRadius(float x, float y, float z, float radius, std::vector<Handle>& out) const;
+
+    /**
+     * Collect the k handles nearest to a point, nearest first
+     * @param out Cleared, then filled with up to k handles
+     */
+    void QueryNearest(float x, float y, float z, size_t k, std::vector<Handle>& out) const;
+
+private:
+    struct Entry {
+        float x = 0.0f;
+        float y = 0.0f;
+        float z = 0.0f;
+        uint64_t cell = 0;
+        uint32_t slot = 0; // Index within the cell's handle list
+        bool present = false;
+    };
+
+    int32_t CellCoord(float value) const;
+    static uint64_t CellKey(int32_t cx, int32_t cy);
+    void AddToCell(Handle handle, Entry& entry);
+    void RemoveFromCell(Entry& entry);
+    float DistanceSquared(Handle handle, float x, float y, float z) const;
+
+    float cell_size_;
+    float inv_cell_size_;
+    size_t size_ = 0;
+    std::vector<Entry> entries_; // Indexed by handle
+    std::unordered_map<uint64_t, std::vector<Handle>> cells_;
+};
+
+} // namespace P2P
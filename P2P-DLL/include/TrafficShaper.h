@@ -0,0 +1,118 @@
+#pragma once
+
+#include "Types.h"
+#include "PacketBuffer.h"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+namespace P2P {
+
+/**
+ * TrafficShaper - Hierarchical token-bucket shaper for outbound P2P traffic
+ *
+ * Two levels of token buckets, refilled lock-free from the send path:
+ *   - one link bucket at the link rate (max_bitrate_kbps, lowered by the
+ *     BandwidthManager under congestion), which every packet draws from
+ *   - one bucket per PacketPriority. CRITICAL's is a reserve
+ *     (critical_reserve_kbps) it may spend even when the link bucket is
+ *     empty; for the other priorities it is a cap (high_priority_kbps, ...)
+ *     on top of the link bucket.
+ * Buckets allow a burst of burst_ms at their rate.
+ *
+ * Packets that cannot go at once wait in one bounded queue per priority.
+ * A scheduler thread drains them: CRITICAL strictly first, then HIGH to
+ * BACKGROUND by deficit round robin weighted by their rates. Lower
+ * priorities never take link tokens while CRITICAL packets wait, so a
+ * burst of LOW traffic cannot hold up CRITICAL packets, and HIGH traffic
+ * cannot starve LOW entirely. A priority's DRR deficit may grow past its
+ * usual cap to cover a packet larger than that cap, so no packet size can
+ * block a queue. When a queue is full, new packets of that priority are
+ * dropped and counted.
+ */
+class TrafficShaper {
+public:
+    /**
+     * Sends a packet the scheduler released
+     * @param tag Value given to Submit()
+     */
+    using TransmitFunction = std::function<void(PacketPriority priority, uint32_t tag, PacketBuffer& packet)>;
+
+    enum class Verdict {
+        SEND_NOW,  // Tokens taken; the caller sends the packet itself
+        QUEUED,    // Copied into a queue; TransmitFunction sends it later
+        DROPPED    // Queue full
+    };
+
+    static constexpr size_t PRIORITY_COUNT = 5;
+    static constexpr size_t DEFAULT_MAX_QUEUED = 256;
+    // Smallest DRR quantum (one MTU-sized packet per round)
+    static constexpr int64_t MIN_QUANTUM_BYTES = 1500;
+    // Assured bytes a priority may send per DRR round
+    static constexpr int64_t QUANTUM_MS = 5;
+    // Longest the scheduler sleeps while packets wait for tokens
+    static constexpr int64_t MAX_WAIT_MS = 10;
+
+    TrafficShaper();
+    ~TrafficShaper();
+
+    // Disable copy and move
+    TrafficShaper(const TrafficShaper&) = delete;
+    TrafficShaper& operator=(const TrafficShaper&) = delete;
+
+    /**
+     * Apply rates, burst and queue limits (may be called while running)
+     */
+    void Configure(const BandwidthConfig& config);
+
+    /**
+     * Start the scheduler thread (restarts if already running)
+     * @return false if shaping is disabled in the configuration
+     */
+    bool Start(TransmitFunction transmit);
+
+    /**
+     * Stop and join the scheduler
+     * Packets still queued are discarded and counted in GetDroppedPackets().
+     */
+    void Stop();
+
+    bool IsRunning() const;
+
+    /**
+     * Admit or queue one outbound packet
+     * Lock-free when the priority's queue is empty and tokens are available.
+     * Without a running scheduler every packet is SEND_NOW (and still charged).
+     * @param tag Opaque value handed back to the TransmitFunction
+     */
+    Verdict Submit(PacketPriority priority, const uint8_t* data, size_t size, uint32_t tag);
+
+    /**
+     * Charge traffic that was sent without Submit()
+     */
+    void Charge(PacketPriority priority, size_t size);
+
+    /**
+     * Whether a packet of this priority would go out now (takes no tokens)
+     */
+    bool CanSend(PacketPriority priority) const;
+
+    /**
+     * Set the link rate (kbps)
+     */
+    void SetLinkRate(float kbps);
+    float GetLinkRate() const;
+
+    size_t GetQueuedPackets(PacketPriority priority) const;
+    uint64_t GetSentBytes(PacketPriority priority) const;
+    uint64_t GetDroppedPackets(PacketPriority priority) const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace P2P
@@ -78,6 +78,20 @@ struct WebRTCConfig {
     bool enable_rtp_data_channels;
 };
 
+/**
+ * Per-opcode override of the default packet table
+ * Empty strings / negative values leave the default in place.
+ */
+struct PacketTypeOverride {
+    uint16_t type = 0;
+    std::string route;     // "p2p", "server", "broadcast" or "drop"
+    std::string priority;  // "critical", "high", "normal", "low" or "background"
+    int fixed_length = -1; // 0 = variable/unknown
+    int batchable = -1;    // 0 or 1
+    int unreliable = -1;   // 0 or 1 (1 = may use the unordered, unreliable state channel)
+    std::string interest;  // "zone", "aoi", "combat", "party" or "guild"
+};
+
 struct P2PConfig {
     bool enabled;
     int max_peers;
@@ -91,9 +105,17 @@ struct P2PConfig {
     bool quic_enabled = false;
     // Mesh/AOI extensions
     float aoi_radius = 100.0f; // Area of interest radius (meters)
+    float combat_radius = 40.0f; // Radius for combat packets (meters)
     int mesh_refresh_interval_ms = 5000; // Mesh refresh interval
     float peer_score_threshold = 0.5f; // Minimum score to keep peer
     int prune_interval_ms = 10000; // Peer pruning interval
+    // Unordered, no-retransmit DataChannel for packets marked unreliable
+    bool state_channel_enabled = true;
+    int state_jitter_budget_ms = 40; // How long a state update may wait for earlier ones
+    // Reliable "urgent"/"normal"/"bulk" DataChannels (see ChannelSelector)
+    bool priority_channels_enabled = true;
+    // Packet table overrides
+    std::vector<PacketTypeOverride> packet_types;
 };
 
 /**
@@ -107,6 +129,15 @@ struct BandwidthConfig {
     float target_bitrate_kbps = 2000.0f;
     bool enable_adaptive_bitrate = true;
     bool packet_priority_enabled = true;
+    // Traffic shaping of outbound P2P packets (see TrafficShaper)
+    bool traffic_shaping_enabled = true;
+    float critical_reserve_kbps = 128.0f;  // Usable by CRITICAL even when the link is full
+    float high_priority_kbps = 256.0f;     // Caps for the other priorities
+    float normal_priority_kbps = 512.0f;
+    float low_priority_kbps = 768.0f;
+    float background_kbps = 128.0f;
+    int shaper_burst_ms = 50;              // Burst each bucket allows at its rate
+    int shaper_queue_packets = 256;        // Per-priority queue limit
 };
 
 /**
@@ -114,11 +145,14 @@ struct BandwidthConfig {
  */
 struct CompressionConfig {
     bool enabled = true;
-    std::string algorithm = "lz4";  // "lz4" or "zlib"
+    std::string algorithm = "lz4";  // "lz4", "zlib" or "adaptive" (picked per packet class)
     int compression_level = 6;  // Default compression level (0-9 for zlib, 0-12 for lz4)
     int min_size_for_compression = 100;  // Minimum packet size to compress (bytes)
     float compression_ratio_threshold = 0.8f;  // Only compress if ratio < threshold
     bool enable_metrics = true;  // Track compression statistics
+    std::string dictionary_path;  // Trained dictionary file ("" = none)
+    int adaptive_interval_ms = 2000;  // How often "adaptive" re-picks codecs
+    float cpu_budget_percent = 5.0f;  // Compression CPU time allowed before "adaptive" stops compressing
 };
 
 struct SecurityConfig {
@@ -153,12 +187,14 @@ struct ZonesConfig {
     std::map<std::string, int> max_peers_per_zone;
 };
 
+// Zero defaults are what a config without a "performance" section has always
+// had: no send workers (sends run inline) and no batching
 struct PerformanceConfig {
-    int worker_threads;
-    int io_thread_pool_size;
-    bool enable_packet_batching;
-    int packet_batch_size;
-    int packet_batch_timeout_ms;
+    int worker_threads = 0;
+    int io_thread_pool_size = 0;
+    bool enable_packet_batching = false;
+    int packet_batch_size = 0;
+    int packet_batch_timeout_ms = 0;
 };
 
 struct HostConfig {
@@ -221,6 +257,17 @@ enum class PacketPriority {
     BACKGROUND   // Bulk data, least critical
 };
 
+/**
+ * Interest class - which peers a P2P-routed packet is relevant to
+ */
+enum class InterestClass {
+    ZONE,    // Every connected peer in the zone
+    AOI,     // Peers within the area of interest (movement, pickups)
+    COMBAT,  // Peers within the combat radius (attacks, skills)
+    PARTY,   // Party members only
+    GUILD    // Guild members only
+};
+
 /**
  * Peer information
  */
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "Types.h"
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -14,15 +16,25 @@ class WebRTCPeerConnection;
  */
 class WebRTCManager {
 public:
+    /**
+     * Local SDP ready to be sent to a peer through signaling
+     * @param type "offer" or "answer"
+     */
+    using OnLocalDescriptionCallback = std::function<void(const std::string& peer_id, const std::string& type,
+                                                          const std::string& sdp)>;
+
+    /**
+     * Local ICE candidate ready to be trickled to a peer through signaling
+     */
+    using OnLocalCandidateCallback = std::function<void(const std::string& peer_id, const std::string& candidate,
+                                                        const std::string& mid)>;
+
     WebRTCManager();
     ~WebRTCManager();
 
-    // AOI/mesh: Set local player position
+    // AOI/mesh: Set local player position (PacketRouter feeds it from outbound movement packets)
     void SetLocalPosition(float x, float y, float z);
 
-    // AOI/mesh: Refresh mesh (prune, score, AOI)
-    void RefreshMesh();
-
     // AOI/mesh: Set AOI radius
     void SetAOIRadius(float radius);
 
@@ -47,6 +59,22 @@ public:
     bool Initialize(const std::vector<std::string>& stun, const std::vector<std::string>& turn,
                    const std::string& turn_username, const std::string& turn_credential, int max);
 
+    /**
+     * Start the transport threads that drain per-peer send queues
+     * @param config Performance configuration (io_thread_pool_size; 0 sends inline)
+     */
+    void ConfigureSendWorkers(const PerformanceConfig& config);
+
+    /**
+     * Configure each peer's per-priority channels and unordered, unreliable
+     * state channel
+     * Applies to peer connections created afterwards. Starts a thread that
+     * releases received state updates once they have waited the jitter budget.
+     * @param config P2P configuration (priority_channels_enabled,
+     *        state_channel_enabled, state_jitter_budget_ms)
+     */
+    void ConfigureDataChannels(const P2PConfig& config);
+
     /**
      * Shutdown the WebRTC manager
      */
@@ -72,6 +100,38 @@ public:
      */
     std::shared_ptr<WebRTCPeerConnection> GetPeerConnection(const std::string& peer_id);
 
+    /**
+     * Update a peer's position (used for AOI queries and sends)
+     * Positions in the movement packets a peer sends us are applied
+     * automatically.
+     * @param peer_id The peer ID
+     */
+    void SetPeerPosition(const std::string& peer_id, float x, float y, float z);
+
+    /**
+     * Get peers within a radius of the local position
+     * Lock-free: checks every peer in the send snapshot, like
+     * SendDataWithinRadius.
+     * @param radius Radius in map units
+     * @return Peer IDs, in no particular order
+     */
+    std::vector<std::string> GetPeersWithinRadius(float radius) const;
+
+    /**
+     * Get the peers nearest to the local position
+     * Lock-free, like GetPeersWithinRadius.
+     * @param count Maximum number of peers
+     * @return Peer IDs, nearest first
+     */
+    std::vector<std::string> GetNearestPeers(size_t count) const;
+
+    /**
+     * Update a peer's score
+     * @param peer_id The peer ID
+     * @param score The new score
+     */
+    void SetPeerScore(const std::string& peer_id, float score);
+
     /**
      * Get list of connected peer IDs
      * @return Vector of connected peer IDs
@@ -92,23 +152,84 @@ public:
 
     /**
      * Send data to all connected peers
-     * @极 data The data to send
+     * Does not take the manager lock; the data is copied into each peer's
+     * send queue and handed to the transport on a worker thread.
+     * @param data The data to send
      * @param size The size of the data
-     * @return true if data was sent successfully
+     * @return true if at least one peer accepted the data
      */
     bool SendData(const void* data, size_t size);
 
+    /**
+     * Send data to connected peers within a radius of the local position
+     * Like SendData, does not take the manager lock: targets are picked from
+     * the published peer snapshot by each peer's latest reported position.
+     * @param data The data to send
+     * @param size The size of the data
+     * @param radius Radius in map units
+     * @return true if at least one peer accepted the data, or no connected peer is in range
+     */
+    bool SendDataWithinRadius(const void* data, size_t size, float radius);
+
+    /**
+     * Send data to a set of connected peers
+     * Unknown or disconnected peer IDs are skipped. Does not take the manager
+     * lock.
+     * @param data The data to send
+     * @param size The size of the data
+     * @param peer_ids Target peer IDs
+     * @return true if at least one peer accepted the data, or no target is connected
+     */
+    bool SendDataToPeers(const void* data, size_t size, const std::vector<std::string>& peer_ids);
+
+    /**
+     * Set the callbacks that carry local SDP and ICE candidates to signaling
+     * Must be set before negotiation starts; they run on libdatachannel threads.
+     */
+    void SetSignalingCallbacks(OnLocalDescriptionCallback on_description, OnLocalCandidateCallback on_candidate);
+
+    /**
+     * Start negotiating with a peer as the offerer
+     * Creates the connection if needed and returns immediately; the offer and
+     * candidates are emitted through the signaling callbacks.
+     * @param peer_id The peer ID
+     * @return true if negotiation started
+     */
+    bool CreateOffer(const std::string& peer_id);
+
     /**
      * Process a WebRTC offer from a peer
+     * Returns once the remote description is set; the answer is emitted
+     * through the signaling callbacks.
      * @param offer The SDP offer string
+     * @param sender_id Sender's peer ID from signaling; if empty it is read
+     *                from the SDP ("a=mid:peerid-<id>" or the WMS id)
+     */
+    void ProcessOffer(const std::string& offer, const std::string& sender_id = "");
+
+    /**
+     * Process a WebRTC answer to an offer we sent
+     * @param peer_id The peer ID
+     * @param answer The SDP answer string
+     * @return true if the answer was applied
      */
-    void ProcessOffer(const std::string& offer);
+    bool ProcessAnswer(const std::string& peer_id, const std::string& answer);
 
     /**
-     * Add an ICE candidate from a peer
+     * Add a trickled ICE candidate from a peer
+     * @param peer_id The peer ID
      * @param candidate The ICE candidate string
+     * @param mid Media stream ID (empty for the bundle)
+     * @return true if the candidate was added or queued
+     */
+    bool AddIceCandidate(const std::string& peer_id, const std::string& candidate, const std::string& mid);
+
+    /**
+     * Set the SecurityManager used for per-peer key exchange
+     * Applies to peer connections created afterwards.
+     * @param security_manager The SecurityManager instance (not owned)
      */
-    void AddIceCandidate(const std::string& candidate);
+    void SetSecurityManager(class SecurityManager* security_manager);
 
 private:
     // Pimpl idiom for implementation details
@@ -8,15 +8,36 @@
 
 namespace P2P {
 
+class PacketBuffer;
+
 /**
  * WebRTCPeerConnection - Manages a WebRTC peer-to-peer connection
+ *
+ * Opens these DataChannels:
+ *   - "data", reliable and ordered, for key exchange and as the fallback
+ *   - "urgent", "normal" and "bulk", reliable and ordered, each its own
+ *     SCTP stream so a CRITICAL packet never waits behind BACKGROUND data.
+ *     CRITICAL and HIGH share "urgent" so combat packets keep their order;
+ *     see ChannelSelector for the mapping.
+ *   - "state", unordered with no retransmissions, for packets the packet
+ *     table marks unreliable (superseded state such as movement). State
+ *     messages carry a sequence number; the receiver runs them through a
+ *     ReorderWindow so a lost message never holds up later ones and stale
+ *     ones are dropped.
+ * The offerer creates the channels; the answerer adopts them by label.
+ *
+ * With a SecurityManager set, the ECDHE key exchange runs on "data" when it
+ * opens. The remote may install its key and start sending on the other
+ * channels before our key is in, so sealed messages that arrive early are
+ * held (up to a bound) and delivered in arrival order once it is.
  */
 class WebRTCPeerConnection {
 public:
     // Callback types
     using OnDataCallback = std::function<void(const uint8_t*, size_t)>;
     using OnStateChangeCallback = std::function<void(bool)>;
-    using OnIceCandidateCallback = std::function<void(const std::string&)>;
+    using OnIceCandidateCallback = std::function<void(const std::string& candidate, const std::string& mid)>;
+    using OnLocalDescriptionCallback = std::function<void(const std::string& type, const std::string& sdp)>;
 
     explicit WebRTCPeerConnection(const std::string& peer_id);
     ~WebRTCPeerConnection();
@@ -57,21 +78,24 @@ public:
     void Close();
 
     /**
-     * Create an SDP offer
-     * @param sdp_out Output SDP string
-     * @return true if offer creation succeeded
+     * Start creating an SDP offer (trickle ICE)
+     * Returns without waiting for ICE gathering: the offer is delivered through
+     * the local description callback and each candidate through the ICE
+     * candidate callback as it is found.
+     * @return true if negotiation started
      */
-    bool CreateOffer(std::string& sdp_out);
+    bool CreateOffer();
 
     /**
-     * Create an SDP answer
-     * @param sdp_out Output SDP string
-     * @return true if answer creation succeeded
+     * Start creating an SDP answer to the remote offer (trickle ICE)
+     * Like CreateOffer, the result arrives through the callbacks.
+     * @return true if negotiation started
      */
-    bool CreateAnswer(std::string& sdp_out);
+    bool CreateAnswer();
 
     /**
      * Set remote SDP description
+     * Applies any ICE candidates that arrived before it.
      * @param sdp The remote SDP
      * @return true if setting succeeded
      */
@@ -79,13 +103,44 @@ public:
 
     /**
      * Add ICE candidate
+     * Held back until the remote description is set.
      * @param candidate The ICE candidate string
-     * @return true if adding succeeded
+     * @param mid Media stream ID the candidate belongs to (empty for the bundle)
+     * @return true if the candidate was added or queued
+     */
+    bool AddIceCandidate(const std::string& candidate, const std::string& mid = "");
+
+    /**
+     * Configure the state channel (call before negotiation starts)
+     * @param enabled Whether to open and send on the state channel
+     * @param jitter_budget_ms How long a received state update may wait for
+     *        earlier ones before they are given up on
      */
-    bool AddIceCandidate(const std::string& candidate);
+    void ConfigureStateChannel(bool enabled, int jitter_budget_ms);
+
+    /**
+     * Configure the per-priority channels (call before negotiation starts)
+     * When disabled, no priority channels are opened and everything but
+     * state goes over "data".
+     * @param enabled Whether to open and send on the priority channels
+     */
+    void ConfigurePriorityChannels(bool enabled);
+
+    /**
+     * Release received state updates that have waited the jitter budget
+     * Call periodically; cheap when nothing is buffered.
+     */
+    void PollStateChannel();
 
     /**
      * Send data over the data channel
+     * With a SecurityManager set, everything but the key exchange is
+     * compressed and sealed with this peer's key, and nothing is sent until
+     * the key exchange has completed.
+     * Unreliable packets (or batches of only unreliable packets) go over the
+     * state channel while it is open. Anything else goes over the channel of
+     * its priority (a batch's most urgent packet), or "data" if that channel
+     * is not open.
      * @param data Data buffer
      * @param size Data size
      * @return true if send succeeded
@@ -117,11 +172,17 @@ public:
     void SetOnStateChangeCallback(OnStateChangeCallback callback);
 
     /**
-     * Set callback for ICE candidates
+     * Set callback for local ICE candidates (trickled to the remote peer)
      * @param callback The callback function
      */
     void SetOnIceCandidateCallback(OnIceCandidateCallback callback);
 
+    /**
+     * Set callback for the local SDP offer/answer
+     * @param callback The callback function
+     */
+    void SetOnLocalDescriptionCallback(OnLocalDescriptionCallback callback);
+
     /**
      * Set SecurityManager for encryption key exchange
      * @param security_manager The SecurityManager instance
@@ -142,9 +203,19 @@ private:
     struct Impl;
     std::unique_ptr<Impl> impl_;
 
+    // Wire handlers on impl_->dc / impl_->state_dc / impl_->priority_dc (called with the mutex held)
+    void SetupDataChannel();
+    void SetupStateChannel();
+    void SetupPriorityChannel(size_t index);
+    void HandleStateMessage(const uint8_t* data, size_t size);
+
     // ECDHE Key Exchange helper methods
     void InitiateKeyExchange();
     void HandleReceivedData(const uint8_t* data, size_t size);
+    void DeliverPackets(const uint8_t* data, size_t size);
+    void DecryptAndDeliver(PacketBuffer& frame);
+    void ReplayEarlyMessages();
+    void ClearEarlyMessages();
     void HandleKeyExchangePacket(const uint8_t* data, size_t size);
 };
 
@@ -1,5 +1,7 @@
 #include "../../include/BandwidthManager.h"
 #include "../../include/Logger.h"
+#include "../../include/PacketTable.h"
+#include "../../include/PacketBatcher.h"
 #include <algorithm>
 #include <cmath>
 #include <thread>
@@ -7,19 +9,181 @@
 #include <iomanip>
 #include <map>
 #include <array>
+#include <condition_variable>
 
 namespace P2P {
 
+namespace {
+
+// Send-path counters are striped across cache-line-sized slots; each thread
+// sticks to one slot so concurrent senders never share a line.
+constexpr size_t SEND_COUNTER_SLOTS = 16;
+
+struct alignas(64) SendCounterSlot {
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> packets{0};
+};
+
+size_t GetThreadCounterSlot() {
+    static std::atomic<size_t> next_slot{0};
+    thread_local size_t slot = next_slot.fetch_add(1, std::memory_order_relaxed) % SEND_COUNTER_SLOTS;
+    return slot;
+}
+
+// Congestion thresholds for peers whose controller has no feedback yet
+constexpr float FALLBACK_LOSS_PERCENT = 10.0f;
+constexpr float FALLBACK_LATENCY_MS = 300.0f;
+
+// 0 = clear link, 1 = at the fallback loss or latency threshold
+float CongestionLevel(const BandwidthMetrics& metrics) {
+    float congestion = std::max(metrics.packet_loss_percent / FALLBACK_LOSS_PERCENT,
+                                metrics.average_latency_ms / FALLBACK_LATENCY_MS);
+    return std::min(std::max(congestion, 0.0f), 1.0f);
+}
+
+// Target bitrate stepped down for reported loss and latency, for peers
+// whose controller has no feedback yet
+float FallbackBitrateKbps(const BandwidthConfig& config, const BandwidthMetrics& metrics) {
+    float bitrate = config.target_bitrate_kbps;
+
+    // Reduce bitrate based on packet loss
+    if (metrics.packet_loss_percent > 5.0f) {
+        bitrate *= 0.7f;
+    } else if (metrics.packet_loss_percent > 2.0f) {
+        bitrate *= 0.85f;
+    }
+
+    // Reduce bitrate based on high latency
+    if (metrics.average_latency_ms > 200.0f) {
+        bitrate *= 0.6f;
+    } else if (metrics.average_latency_ms > 100.0f) {
+        bitrate *= 0.8f;
+    }
+
+    return std::max(std::min(bitrate, config.max_bitrate_kbps), config.min_bitrate_kbps);
+}
+
+} // namespace
+
 // Implementation details
 struct BandwidthManager::Impl {
     BandwidthConfig config;
-    std::map<std::string, BandwidthMetrics> peer_metrics;
+    PeerMetricsTable peer_metrics;  // Lock-free updates, indexed by peer handle
+    std::map<std::string, CongestionController> controllers;  // Guarded by mutex
     std::array<std::atomic<uint64_t>, 5> priority_bytes_sent{};
     std::array<std::atomic<uint64_t>, 5> priority_packets_sent{};
     std::mutex mutex;
     std::atomic<bool> initialized{false};
+
+    // Send-path counters (RecordSend)
+    std::array<SendCounterSlot, SEND_COUNTER_SLOTS> send_counters;
+
+    TrafficShaper shaper;
+
+    // Periodic sampler publishing aggregated metrics
+    std::thread sampler_thread;
+    std::mutex sampler_mutex;
+    std::condition_variable sampler_cv;
+    bool sampler_running = false;
+    std::shared_ptr<const BandwidthMetrics> snapshot = std::make_shared<BandwidthMetrics>();
+    uint64_t last_sample_bytes = 0;
+    std::chrono::steady_clock::time_point last_sample_time = std::chrono::steady_clock::now();
+
+    void StartSampler();
+    void StopSampler();
+    void SamplerLoop(BandwidthManager* owner);
+
+    // Smallest controller target (kbps), or 0 if no peer's controller has feedback
+    float SlowestPeerKbps();
 };
 
+float BandwidthManager::Impl::SlowestPeerKbps() {
+    std::lock_guard<std::mutex> lock(mutex);
+    float slowest = 0.0f;
+    for (const auto& [peer_id, controller] : controllers) {
+        if (!controller.HasFeedback()) {
+            continue;
+        }
+        float target = controller.GetTargetBitrateKbps();
+        if (slowest == 0.0f || target < slowest) {
+            slowest = target;
+        }
+    }
+    return slowest;
+}
+
+void BandwidthManager::Impl::StartSampler() {
+    std::lock_guard<std::mutex> lock(sampler_mutex);
+    if (sampler_running) {
+        return;
+    }
+    sampler_running = true;
+    last_sample_time = std::chrono::steady_clock::now();
+}
+
+void BandwidthManager::Impl::StopSampler() {
+    {
+        std::lock_guard<std::mutex> lock(sampler_mutex);
+        sampler_running = false;
+    }
+    sampler_cv.notify_all();
+    if (sampler_thread.joinable()) {
+        sampler_thread.join();
+    }
+}
+
+void BandwidthManager::Impl::SamplerLoop(BandwidthManager* owner) {
+    auto interval = std::chrono::milliseconds(std::max(config.bandwidth_update_interval_ms, 100));
+    std::unique_lock<std::mutex> lock(sampler_mutex);
+    while (sampler_running) {
+        sampler_cv.wait_for(lock, interval, [this]() { return !sampler_running; });
+        if (!sampler_running) {
+            break;
+        }
+        lock.unlock();
+
+        // One O(peers) walk per interval instead of one per packet
+        auto metrics = std::make_shared<BandwidthMetrics>(owner->GetOverallMetrics());
+
+        uint64_t bytes = 0;
+        uint64_t packets = 0;
+        for (const auto& slot : send_counters) {
+            bytes += slot.bytes.load(std::memory_order_relaxed);
+            packets += slot.packets.load(std::memory_order_relaxed);
+        }
+        auto now = std::chrono::steady_clock::now();
+        float elapsed_s = std::chrono::duration<float>(now - last_sample_time).count();
+        if (elapsed_s > 0.0f) {
+            metrics->current_bitrate_kbps = static_cast<float>(bytes - last_sample_bytes) * 8.0f / 1000.0f / elapsed_s;
+        }
+        metrics->bytes_sent = bytes;
+        metrics->packets_sent = packets;
+        last_sample_bytes = bytes;
+        last_sample_time = now;
+
+        LOG_DEBUG_FMT("Bandwidth: sent={}B, recv={}B, rate={:.1f}kbps, loss={:.2f}%, avg_latency={:.1f}ms",
+                      metrics->bytes_sent, metrics->bytes_received, metrics->current_bitrate_kbps,
+                      metrics->packet_loss_percent, metrics->average_latency_ms);
+
+        // Broadcasts reach every peer, so the slowest peer's controller sets
+        // the link rate; without feedback, shape to less of the link as loss
+        // and latency build up
+        if (config.enable_adaptive_bitrate) {
+            float slowest = SlowestPeerKbps();
+            if (slowest > 0.0f) {
+                shaper.SetLinkRate(slowest);
+            } else {
+                float range = std::max(config.max_bitrate_kbps - config.min_bitrate_kbps, 0.0f);
+                shaper.SetLinkRate(config.max_bitrate_kbps - range * CongestionLevel(*metrics));
+            }
+        }
+
+        std::atomic_store(&snapshot, std::shared_ptr<const BandwidthMetrics>(std::move(metrics)));
+
+        lock.lock();
+    }
+}
+
 BandwidthManager::BandwidthManager() : impl_(std::make_unique<Impl>()) {
     // Initialize atomic arrays
     for (auto& count : impl_->priority_bytes_sent) {
@@ -30,21 +194,35 @@ BandwidthManager::BandwidthManager() : impl_(std::make_unique<Impl>()) {
     }
 }
 
-BandwidthManager::~BandwidthManager() = default;
+BandwidthManager::~BandwidthManager() {
+    impl_->StopSampler();
+}
 
 bool BandwidthManager::Initialize(const BandwidthConfig& config) {
-    std::lock_guard<std::mutex> lock(impl_->mutex);
-    impl_->config = config;
-    impl_->initialized = true;
-    
+    {
+        std::lock_guard<std::mutex> lock(impl_->mutex);
+        impl_->config = config;
+        impl_->initialized = true;
+    }
+    impl_->shaper.Configure(config);
+
+    // Start the metrics sampler
+    impl_->StopSampler();
+    impl_->StartSampler();
+    impl_->sampler_thread = std::thread(&Impl::SamplerLoop, impl_.get(), this);
+
     LOG_INFO("BandwidthManager initialized");
     return true;
 }
 
 void BandwidthManager::Shutdown() {
+    impl_->StopSampler();
+    impl_->shaper.Stop();
+
     std::lock_guard<std::mutex> lock(impl_->mutex);
     impl_->initialized = false;
-    impl_->peer_metrics.clear();
+    impl_->peer_metrics.Clear();
+    impl_->controllers.clear();
     
     // Reset atomic counters
     for (auto& count : impl_->priority_bytes_sent) {
@@ -53,137 +231,204 @@ void BandwidthManager::Shutdown() {
     for (auto& count : impl_->priority_packets_sent) {
         count.store(0);
     }
+    for (auto& slot : impl_->send_counters) {
+        slot.bytes.store(0);
+        slot.packets.store(0);
+    }
+    impl_->last_sample_bytes = 0;
+    std::atomic_store(&impl_->snapshot, std::shared_ptr<const BandwidthMetrics>(std::make_shared<BandwidthMetrics>()));
+}
+
+void BandwidthManager::RecordSend(size_t packet_size, PacketPriority priority) {
+    auto& slot = impl_->send_counters[GetThreadCounterSlot()];
+    slot.bytes.fetch_add(packet_size, std::memory_order_relaxed);
+    slot.packets.fetch_add(1, std::memory_order_relaxed);
+
+    size_t priority_idx = static_cast<size_t>(priority);
+    if (priority_idx < impl_->priority_bytes_sent.size()) {
+        impl_->priority_bytes_sent[priority_idx].fetch_add(packet_size, std::memory_order_relaxed);
+        impl_->priority_packets_sent[priority_idx].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+std::shared_ptr<const BandwidthMetrics> BandwidthManager::GetMetricsSnapshot() const {
+    return std::atomic_load(&impl_->snapshot);
+}
+
+BandwidthManager::PeerHandle BandwidthManager::RegisterPeer(const std::string& peer_id) {
+    PeerHandle handle = impl_->peer_metrics.Acquire(peer_id);
+    if (handle == PeerMetricsTable::INVALID_HANDLE) {
+        LOG_WARN_FMT("Bandwidth metrics table full ({} peers); not tracking {}",
+                     impl_->peer_metrics.Capacity(), peer_id);
+    }
+    return handle;
+}
+
+void BandwidthManager::RemovePeer(const std::string& peer_id) {
+    impl_->peer_metrics.Release(peer_id);
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    impl_->controllers.erase(peer_id);
 }
 
 void BandwidthManager::UpdateSentMetrics(const std::string& peer_id, size_t packet_size, PacketPriority priority) {
     if (!impl_->initialized) return;
+    UpdateSentMetrics(RegisterPeer(peer_id), packet_size, priority);
+}
+
+void BandwidthManager::UpdateSentMetrics(PeerHandle peer, size_t packet_size, PacketPriority priority) {
+    if (!impl_->initialized) return;
+
+    impl_->peer_metrics.AddSent(peer, packet_size);
 
-    std::lock_guard<std::mutex> lock(impl_->mutex);
-    
-    // Update peer metrics
-    auto& metrics = impl_->peer_metrics[peer_id];
-    metrics.bytes_sent += packet_size;
-    metrics.packets_sent++;
-    metrics.last_update = std::chrono::steady_clock::now();
-    
     // Update priority counters
     size_t priority_idx = static_cast<size_t>(priority);
     if (priority_idx < impl_->priority_bytes_sent.size()) {
-        impl_->priority_bytes_sent[priority_idx] += packet_size;
-        impl_->priority_packets_sent[priority_idx]++;
+        impl_->priority_bytes_sent[priority_idx].fetch_add(packet_size, std::memory_order_relaxed);
+        impl_->priority_packets_sent[priority_idx].fetch_add(1, std::memory_order_relaxed);
     }
 }
 
 void BandwidthManager::UpdateReceivedMetrics(const std::string& peer_id, size_t packet_size) {
     if (!impl_->initialized) return;
+    impl_->peer_metrics.AddReceived(RegisterPeer(peer_id), packet_size);
+}
 
-    std::lock_guard<std::mutex> lock(impl_->mutex);
-    
-    auto& metrics = impl_->peer_metrics[peer_id];
-    metrics.bytes_received += packet_size;
-    metrics.packets_received++;
-    metrics.last_update = std::chrono::steady_clock::now();
+void BandwidthManager::UpdateReceivedMetrics(PeerHandle peer, size_t packet_size) {
+    if (!impl_->initialized) return;
+    impl_->peer_metrics.AddReceived(peer, packet_size);
 }
 
 void BandwidthManager::UpdatePacketLoss(const std::string& peer_id, uint64_t packets_lost) {
     if (!impl_->initialized) return;
+    impl_->peer_metrics.AddLost(RegisterPeer(peer_id), packets_lost);
+}
 
-    std::lock_guard<std::mutex> lock(impl_->mutex);
-    
-    auto& metrics = impl_->peer_metrics[peer_id];
-    metrics.packets_lost += packets_lost;
-    metrics.last_update = std::chrono::steady_clock::now();
-    
-    // Calculate packet loss percentage
-    uint64_t total_packets = metrics.packets_received + metrics.packets_lost;
-    if (total_packets > 0) {
-        metrics.packet_loss_percent = (static_cast<float>(metrics.packets_lost) / total_packets) * 100.0f;
-    }
+void BandwidthManager::UpdatePacketLoss(PeerHandle peer, uint64_t packets_lost) {
+    if (!impl_->initialized) return;
+    impl_->peer_metrics.AddLost(peer, packets_lost);
 }
 
 void BandwidthManager::UpdateLatency(const std::string& peer_id, float latency_ms) {
     if (!impl_->initialized) return;
+    impl_->peer_metrics.AddLatencySample(RegisterPeer(peer_id), latency_ms);
+}
+
+void BandwidthManager::UpdateLatency(PeerHandle peer, float latency_ms) {
+    if (!impl_->initialized) return;
+    impl_->peer_metrics.AddLatencySample(peer, latency_ms);
+}
+
+void BandwidthManager::OnPacketSent(const std::string& peer_id, uint64_t sequence, size_t packet_size,
+                                    int64_t send_time_us) {
+    if (!impl_->initialized) return;
 
     std::lock_guard<std::mutex> lock(impl_->mutex);
-    
-    auto& metrics = impl_->peer_metrics[peer_id];
-    
-    // Simple exponential moving average for latency
-    if (metrics.average_latency_ms == 0.0f) {
-        metrics.average_latency_ms = latency_ms;
-    } else {
-        metrics.average_latency_ms = 0.8f * metrics.average_latency_ms + 0.2f * latency_ms;
+    auto it = impl_->controllers.find(peer_id);
+    if (it == impl_->controllers.end()) {
+        it = impl_->controllers.emplace(peer_id, CongestionController(impl_->config)).first;
     }
-    metrics.last_update = std::chrono::steady_clock::now();
+    it->second.OnPacketSent(sequence, packet_size, send_time_us);
 }
 
-float BandwidthManager::GetRecommendedBitrate(const std::string& peer_id) const {
-    if (!impl_->initialized) return 0.0f;
+bool BandwidthManager::OnPacketAcked(const std::string& peer_id, uint64_t sequence, int64_t arrival_time_us) {
+    if (!impl_->initialized) return false;
 
+    int64_t now_us = CongestionController::NowMicros();
     std::lock_guard<std::mutex> lock(impl_->mutex);
-    
-    const auto it = impl_->peer_metrics.find(peer_id);
-    if (it == impl_->peer_metrics.end()) {
-        return impl_->config.target_bitrate_kbps;
+    auto it = impl_->controllers.find(peer_id);
+    if (it == impl_->controllers.end() || !it->second.OnPacketAcked(sequence, arrival_time_us, now_us)) {
+        return false;
     }
-    
-    const auto& metrics = it->second;
-    
-    // Simple adaptive bitrate algorithm
-    float base_bitrate = 1000.0f; // Default target bitrate
-    
-    // Reduce bitrate based on packet loss
-    if (metrics.packet_loss_percent > 5.0f) {
-        base_bitrate *= 0.7f; // Reduce by 30% for high packet loss
-    } else if (metrics.packet_loss_percent > 2.0f) {
-        base_bitrate *= 0.85f; // Reduce by 15% for moderate packet loss
+
+    impl_->peer_metrics.SetLatency(RegisterPeer(peer_id), it->second.GetRttMs());
+    return true;
+}
+
+bool BandwidthManager::OnPacketLost(const std::string& peer_id, uint64_t sequence) {
+    if (!impl_->initialized) return false;
+
+    int64_t now_us = CongestionController::NowMicros();
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    auto it = impl_->controllers.find(peer_id);
+    if (it == impl_->controllers.end() || !it->second.OnPacketLost(sequence, now_us)) {
+        return false;
     }
-    
-    // Reduce bitrate based on high latency
-    if (metrics.average_latency_ms > 200.0f) {
-        base_bitrate *= 0.6f; // Reduce by 40% for very high latency
-    } else if (metrics.average_latency_ms > 100.0f) {
-        base_bitrate *= 0.8f; // Reduce by 20% for high latency
+
+    impl_->peer_metrics.AddLost(RegisterPeer(peer_id), 1);
+    return true;
+}
+
+float BandwidthManager::GetRecommendedBitrate(const std::string& peer_id) const {
+    if (!impl_->initialized) return 0.0f;
+
+    {
+        std::lock_guard<std::mutex> lock(impl_->mutex);
+        const auto it = impl_->controllers.find(peer_id);
+        if (it != impl_->controllers.end() && it->second.HasFeedback()) {
+            return it->second.GetTargetBitrateKbps();
+        }
     }
-    
-    // Ensure minimum bitrate
-    return std::max(base_bitrate, 100.0f);
+    return FallbackBitrateKbps(impl_->config, GetMetrics(peer_id));
+}
+
+double BandwidthManager::GetPacingRate(const std::string& peer_id) const {
+    return static_cast<double>(GetRecommendedBitrate(peer_id)) * 1000.0 / 8.0;
 }
 
 bool BandwidthManager::IsCongested(const std::string& peer_id) const {
     if (!impl_->initialized) return false;
 
-    std::lock_guard<std::mutex> lock(impl_->mutex);
-    
-    const auto it = impl_->peer_metrics.find(peer_id);
-    if (it == impl_->peer_metrics.end()) {
-        return false;
+    {
+        std::lock_guard<std::mutex> lock(impl_->mutex);
+        const auto it = impl_->controllers.find(peer_id);
+        if (it != impl_->controllers.end() && it->second.HasFeedback()) {
+            return it->second.IsCongested();
+        }
     }
-    
-    const auto& metrics = it->second;
-    
-    // Congestion detection based on packet loss and latency
-    return metrics.packet_loss_percent > 10.0f || metrics.average_latency_ms > 300.0f;
+    BandwidthMetrics metrics = GetMetrics(peer_id);
+    return metrics.packet_loss_percent > FALLBACK_LOSS_PERCENT || metrics.average_latency_ms > FALLBACK_LATENCY_MS;
+}
+
+float BandwidthManager::GetAvailableBitrateKbps() const {
+    auto snapshot = GetMetricsSnapshot();
+    if (!snapshot) {
+        return impl_->config.target_bitrate_kbps;
+    }
+
+    float headroom = impl_->config.max_bitrate_kbps - snapshot->current_bitrate_kbps;
+    return std::max(impl_->config.min_bitrate_kbps, headroom * (1.0f - CongestionLevel(*snapshot)));
+}
+
+bool BandwidthManager::CanSendPacket(PacketPriority priority) const {
+    return impl_->shaper.CanSend(priority);
+}
+
+void BandwidthManager::PacketSent(PacketPriority priority, size_t packet_size) {
+    impl_->shaper.Charge(priority, packet_size);
+    RecordSend(packet_size, priority);
+}
+
+TrafficShaper& BandwidthManager::GetShaper() {
+    return impl_->shaper;
 }
 
 PacketPriority BandwidthManager::GetPacketPriority(uint16_t packet_type) {
-    // Map RO packet types to priorities
-    switch (packet_type) {
-        case 0x0089: // Movement
-        case 0x009F: // Item pickup
-            return PacketPriority::CRITICAL;
-        
-        case 0x008C: // Chat
-        case 0x00A2: // Skill use
-            return PacketPriority::HIGH;
-        
-        case 0x00A7: // Emotion
-        case 0x00B0: // Party info
-            return PacketPriority::NORMAL;
-        
-        default:
-            return PacketPriority::LOW;
+    // Priority comes from the shared packet table (same source as routing)
+    return PacketTable::GetInstance().Lookup(packet_type).Priority();
+}
+
+PacketPriority BandwidthManager::GetMessagePriority(const uint8_t* data, size_t size) {
+    if (!data || size < 2) {
+        return PacketPriority::LOW;
     }
+    bool any = false;
+    PacketPriority priority = PacketPriority::BACKGROUND;
+    PacketBatcher::Unbatch(data, size, [&](const PacketView& packet) {
+        any = true;
+        priority = std::min(priority, GetPacketPriority(packet.type));
+    });
+    // A malformed batch yields nothing; fall back to the frame's own type
+    return any ? priority : GetPacketPriority(PacketView(data, size).type);
 }
 
 bool BandwidthManager::ShouldDropPacket(PacketPriority priority, float current_congestion) const {
@@ -210,63 +455,26 @@ bool BandwidthManager::ShouldDropPacket(PacketPriority priority, float current_c
 }
 
 BandwidthMetrics BandwidthManager::GetMetrics(const std::string& peer_id) const {
-    std::lock_guard<std::mutex> lock(impl_->mutex);
-    
-    const auto it = impl_->peer_metrics.find(peer_id);
-    if (it != impl_->peer_metrics.end()) {
-        return it->second;
-    }
-    
-    return BandwidthMetrics{};
+    return impl_->peer_metrics.Read(impl_->peer_metrics.Find(peer_id));
 }
 
 BandwidthMetrics BandwidthManager::GetOverallMetrics() const {
-    std::lock_guard<std::mutex> lock(impl_->mutex);
-    
-    BandwidthMetrics overall;
-    for (const auto& [peer_id, metrics] : impl_->peer_metrics) {
-        overall.bytes_sent += metrics.bytes_sent;
-        overall.bytes_received += metrics.bytes_received;
-        overall.packets_sent += metrics.packets_sent;
-        overall.packets_received += metrics.packets_received;
-        overall.packets_lost += metrics.packets_lost;
-    }
-    
-    // Calculate averages
-    if (!impl_->peer_metrics.empty()) {
-        float total_latency = 0.0f;
-        float total_loss = 0.0f;
-        
-        for (const auto& [peer_id, metrics] : impl_->peer_metrics) {
-            total_latency += metrics.average_latency_ms;
-            total_loss += metrics.packet_loss_percent;
-        }
-        
-        overall.average_latency_ms = total_latency / impl_->peer_metrics.size();
-        overall.packet_loss_percent = total_loss / impl_->peer_metrics.size();
-    }
-    
-    overall.last_update = std::chrono::steady_clock::now();
-    return overall;
+    return impl_->peer_metrics.Aggregate();
 }
 
 void BandwidthManager::ResetMetrics(const std::string& peer_id) {
+    if (peer_id.empty()) {
+        impl_->peer_metrics.ResetAll();
+    } else {
+        impl_->peer_metrics.Reset(impl_->peer_metrics.Find(peer_id));
+    }
+
     std::lock_guard<std::mutex> lock(impl_->mutex);
-    
     if (peer_id.empty()) {
-        // Reset all metrics
-        for (auto& [id, metrics] : impl_->peer_metrics) {
-            metrics = BandwidthMetrics{};
-            metrics.last_update = std::chrono::steady_clock::now();
-        }
+        impl_->controllers.clear();
     } else {
-        // Reset specific peer metrics
-        auto it = impl_->peer_metrics.find(peer_id);
-        if (it != impl_->peer_metrics.end()) {
-            it->second = BandwidthMetrics{};
-            it->second.last_update = std::chrono::steady_clock::now();
-        }
+        impl_->controllers.erase(peer_id);
     }
 }
 
-} // namespace P2P
\ No newline at end of file
+} // namespace P2P
@@ -0,0 +1,257 @@
+#include "../../include/CongestionController.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace P2P {
+
+namespace {
+
+// Adaptive threshold gains: it rises slowly towards large trends and falls
+// quickly back towards small ones
+constexpr double THRESHOLD_GAIN_UP = 0.0087;
+constexpr double THRESHOLD_GAIN_DOWN = 0.039;
+// Trends this far above the threshold are spikes and do not move it
+constexpr double THRESHOLD_SPIKE_MS = 15.0;
+constexpr double MAX_THRESHOLD_STEP_MS = 100.0;
+constexpr uint32_t MAX_TREND_DELTAS = 60;
+constexpr double RTT_SMOOTHING = 0.875;
+
+} // namespace
+
+CongestionController::CongestionController(const BandwidthConfig& config)
+    : min_kbps_(std::max(config.min_bitrate_kbps, 0.0f)),
+      max_kbps_(std::max(config.max_bitrate_kbps, min_kbps_)),
+      delay_based_kbps_(std::min(std::max(config.target_bitrate_kbps, min_kbps_), max_kbps_)),
+      loss_based_kbps_(delay_based_kbps_) {
+}
+
+int64_t CongestionController::NowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void CongestionController::OnPacketSent(uint64_t sequence, size_t size, int64_t send_time_us) {
+    SentPacket& packet = sent_[sequence % MAX_IN_FLIGHT];
+    packet.sequence = sequence;
+    packet.send_time_us = send_time_us;
+    packet.size = static_cast<uint32_t>(std::min<size_t>(size, UINT32_MAX));
+    packet.pending = true;
+}
+
+bool CongestionController::OnPacketAcked(uint64_t sequence, int64_t arrival_time_us, int64_t now_us) {
+    SentPacket& packet = sent_[sequence % MAX_IN_FLIGHT];
+    if (!packet.pending || packet.sequence != sequence) {
+        return false;
+    }
+    packet.pending = false;
+    has_feedback_ = true;
+
+    float rtt_sample = static_cast<float>(now_us - packet.send_time_us) / 1000.0f;
+    if (rtt_sample >= 0.0f) {
+        rtt_ms_ = rtt_ms_ == 0.0f ? rtt_sample
+                                  : static_cast<float>(RTT_SMOOTHING) * rtt_ms_ +
+                                        static_cast<float>(1.0 - RTT_SMOOTHING) * rtt_sample;
+    }
+
+    UpdateAckedRate(packet.size, now_us);
+    CountLoss(false);
+    UpdateDelay(packet.send_time_us, arrival_time_us, now_us);
+    UpdateDelayBasedRate(now_us);
+    return true;
+}
+
+bool CongestionController::OnPacketLost(uint64_t sequence, int64_t now_us) {
+    (void)now_us;
+    SentPacket& packet = sent_[sequence % MAX_IN_FLIGHT];
+    if (!packet.pending || packet.sequence != sequence) {
+        return false;
+    }
+    packet.pending = false;
+    has_feedback_ = true;
+    CountLoss(true);
+    return true;
+}
+
+float CongestionController::GetTargetBitrateKbps() const {
+    float target = std::min(delay_based_kbps_, loss_based_kbps_);
+    return std::min(std::max(target, min_kbps_), max_kbps_);
+}
+
+double CongestionController::GetPacingRateBytesPerSecond() const {
+    return static_cast<double>(GetTargetBitrateKbps()) * 1000.0 / 8.0;
+}
+
+bool CongestionController::IsCongested() const {
+    return usage_ == Usage::OVERUSING || loss_fraction_ > HIGH_LOSS;
+}
+
+void CongestionController::UpdateDelay(int64_t send_time_us, int64_t arrival_time_us, int64_t now_us) {
+    if (!current_group_.valid) {
+        current_group_ = {send_time_us, send_time_us, arrival_time_us, true};
+        return;
+    }
+    // Reordered feedback for a group that is already closed
+    if (send_time_us < current_group_.first_send_us) {
+        return;
+    }
+    if (send_time_us - current_group_.first_send_us <= GROUP_INTERVAL_US) {
+        current_group_.last_send_us = std::max(current_group_.last_send_us, send_time_us);
+        current_group_.last_arrival_us = std::max(current_group_.last_arrival_us, arrival_time_us);
+        return;
+    }
+
+    // A packet from a later group closes the current one
+    if (previous_group_.valid) {
+        double send_delta_ms = static_cast<double>(current_group_.last_send_us - previous_group_.last_send_us) / 1000.0;
+        double arrival_delta_ms =
+            static_cast<double>(current_group_.last_arrival_us - previous_group_.last_arrival_us) / 1000.0;
+        UpdateTrendline(arrival_delta_ms - send_delta_ms, current_group_.last_arrival_us, now_us);
+    }
+    previous_group_ = current_group_;
+    current_group_ = {send_time_us, send_time_us, arrival_time_us, true};
+}
+
+void CongestionController::UpdateTrendline(double delay_variation_ms, int64_t arrival_time_us, int64_t now_us) {
+    if (first_arrival_us_ < 0) {
+        first_arrival_us_ = arrival_time_us;
+    }
+    num_deltas_ = std::min(num_deltas_ + 1, MAX_TREND_DELTAS);
+    accumulated_delay_ms_ += delay_variation_ms;
+    smoothed_delay_ms_ = TRENDLINE_SMOOTHING * smoothed_delay_ms_ + (1.0 - TRENDLINE_SMOOTHING) * accumulated_delay_ms_;
+
+    trend_x_[trend_next_] = static_cast<double>(arrival_time_us - first_arrival_us_) / 1000.0;
+    trend_y_[trend_next_] = smoothed_delay_ms_;
+    trend_next_ = (trend_next_ + 1) % TRENDLINE_WINDOW;
+    trend_count_ = std::min(trend_count_ + 1, TRENDLINE_WINDOW);
+    if (trend_count_ < TRENDLINE_WINDOW) {
+        return;
+    }
+
+    // Least-squares slope of smoothed delay over arrival time
+    double mean_x = 0.0;
+    double mean_y = 0.0;
+    for (size_t i = 0; i < TRENDLINE_WINDOW; ++i) {
+        mean_x += trend_x_[i];
+        mean_y += trend_y_[i];
+    }
+    mean_x /= TRENDLINE_WINDOW;
+    mean_y /= TRENDLINE_WINDOW;
+    double numerator = 0.0;
+    double denominator = 0.0;
+    for (size_t i = 0; i < TRENDLINE_WINDOW; ++i) {
+        double dx = trend_x_[i] - mean_x;
+        numerator += dx * (trend_y_[i] - mean_y);
+        denominator += dx * dx;
+    }
+    if (denominator == 0.0) {
+        return;
+    }
+    double trend = static_cast<double>(num_deltas_) * (numerator / denominator) * TRENDLINE_GAIN;
+
+    if (trend > threshold_ms_) {
+        if (overuse_start_us_ < 0) {
+            overuse_start_us_ = now_us;
+        }
+        // Sustained and not already easing off
+        if (now_us - overuse_start_us_ >= OVERUSE_TIME_US && trend >= previous_trend_) {
+            usage_ = Usage::OVERUSING;
+        }
+    } else if (trend < -threshold_ms_) {
+        overuse_start_us_ = -1;
+        usage_ = Usage::UNDERUSING;
+    } else {
+        overuse_start_us_ = -1;
+        usage_ = Usage::NORMAL;
+    }
+    previous_trend_ = trend;
+    UpdateThreshold(trend, now_us);
+}
+
+void CongestionController::UpdateThreshold(double trend, int64_t now_us) {
+    if (last_threshold_update_us_ < 0) {
+        last_threshold_update_us_ = now_us;
+    }
+    double magnitude = std::fabs(trend);
+    if (magnitude > threshold_ms_ + THRESHOLD_SPIKE_MS) {
+        last_threshold_update_us_ = now_us;
+        return;
+    }
+    double gain = magnitude < threshold_ms_ ? THRESHOLD_GAIN_DOWN : THRESHOLD_GAIN_UP;
+    double elapsed_ms = std::min(static_cast<double>(now_us - last_threshold_update_us_) / 1000.0,
+                                 MAX_THRESHOLD_STEP_MS);
+    threshold_ms_ += gain * (magnitude - threshold_ms_) * elapsed_ms;
+    threshold_ms_ = std::min(std::max(threshold_ms_, MIN_THRESHOLD_MS), MAX_THRESHOLD_MS);
+    last_threshold_update_us_ = now_us;
+}
+
+void CongestionController::UpdateDelayBasedRate(int64_t now_us) {
+    if (last_rate_update_us_ < 0) {
+        last_rate_update_us_ = now_us;
+        return;
+    }
+    double elapsed_s = std::min(static_cast<double>(now_us - last_rate_update_us_) / 1e6, 1.0);
+    last_rate_update_us_ = now_us;
+
+    switch (usage_) {
+        case Usage::OVERUSING: {
+            // Relative to what actually got through, so repeated overuse
+            // reports do not compound
+            float base = acked_kbps_ > 0.0f ? acked_kbps_ : delay_based_kbps_;
+            delay_based_kbps_ = std::min(delay_based_kbps_, DECREASE_FACTOR * base);
+            break;
+        }
+        case Usage::UNDERUSING:
+            // Hold while the queues drain
+            break;
+        case Usage::NORMAL: {
+            float increased = delay_based_kbps_ *
+                              static_cast<float>(std::pow(1.0 + INCREASE_PER_SECOND, std::max(elapsed_s, 0.0)));
+            // Do not run far ahead of what the peer has shown it can take
+            if (acked_kbps_ > 0.0f) {
+                increased = std::min(increased, 1.5f * acked_kbps_ + 10.0f);
+            }
+            delay_based_kbps_ = std::max(delay_based_kbps_, increased);
+            break;
+        }
+    }
+    delay_based_kbps_ = std::min(std::max(delay_based_kbps_, min_kbps_), max_kbps_);
+}
+
+void CongestionController::UpdateAckedRate(uint32_t size, int64_t now_us) {
+    if (acked_window_start_us_ < 0) {
+        acked_window_start_us_ = now_us;
+    }
+    acked_window_bytes_ += size;
+    int64_t elapsed_us = now_us - acked_window_start_us_;
+    if (elapsed_us >= ACKED_RATE_WINDOW_US) {
+        acked_kbps_ = static_cast<float>(static_cast<double>(acked_window_bytes_) * 8.0 * 1000.0 /
+                                         static_cast<double>(elapsed_us));
+        acked_window_start_us_ = now_us;
+        acked_window_bytes_ = 0;
+    }
+}
+
+void CongestionController::CountLoss(bool lost) {
+    if (lost) {
+        ++loss_window_lost_;
+    } else {
+        ++loss_window_acked_;
+    }
+    uint32_t total = loss_window_acked_ + loss_window_lost_;
+    if (total < LOSS_WINDOW_PACKETS) {
+        return;
+    }
+
+    loss_fraction_ = static_cast<float>(loss_window_lost_) / static_cast<float>(total);
+    if (loss_fraction_ > HIGH_LOSS) {
+        loss_based_kbps_ *= 1.0f - 0.5f * loss_fraction_;
+    } else if (loss_fraction_ < LOW_LOSS) {
+        loss_based_kbps_ *= LOSS_INCREASE;
+    }
+    loss_based_kbps_ = std::min(std::max(loss_based_kbps_, min_kbps_), max_kbps_);
+    loss_window_acked_ = 0;
+    loss_window_lost_ = 0;
+}
+
+} // namespace P2P
@@ -0,0 +1,211 @@
+#include "../../include/PeerMetricsTable.h"
+#include <chrono>
+
+namespace P2P {
+
+namespace {
+
+int64_t NowNanoseconds() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Touch(std::atomic<int64_t>& last_update_ns) {
+    last_update_ns.store(NowNanoseconds(), std::memory_order_relaxed);
+}
+
+} // namespace
+
+PeerMetricsTable::PeerMetricsTable(size_t capacity)
+    : capacity_(capacity), blocks_(new Block[capacity]), id_snapshot_(std::make_shared<IdMap>()) {
+    free_handles_.reserve(capacity);
+    // Lowest handles first
+    for (size_t i = capacity; i > 0; --i) {
+        free_handles_.push_back(static_cast<Handle>(i - 1));
+    }
+}
+
+PeerMetricsTable::~PeerMetricsTable() = default;
+
+PeerMetricsTable::Handle PeerMetricsTable::Acquire(const std::string& peer_id) {
+    Handle handle = Find(peer_id);
+    if (handle != INVALID_HANDLE) {
+        return handle;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = ids_.find(peer_id);
+    if (it != ids_.end()) {
+        return it->second;
+    }
+    if (free_handles_.empty()) {
+        return INVALID_HANDLE;
+    }
+    handle = free_handles_.back();
+    free_handles_.pop_back();
+
+    Block& block = blocks_[handle];
+    ResetBlock(block);
+    block.in_use.store(true, std::memory_order_release);
+    ids_.emplace(peer_id, handle);
+    PublishIds();
+    return handle;
+}
+
+PeerMetricsTable::Handle PeerMetricsTable::Find(const std::string& peer_id) const {
+    auto snapshot = std::atomic_load(&id_snapshot_);
+    auto it = snapshot->find(peer_id);
+    return it != snapshot->end() ? it->second : INVALID_HANDLE;
+}
+
+void PeerMetricsTable::Release(const std::string& peer_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = ids_.find(peer_id);
+    if (it == ids_.end()) {
+        return;
+    }
+    blocks_[it->second].in_use.store(false, std::memory_order_release);
+    free_handles_.push_back(it->second);
+    ids_.erase(it);
+    PublishIds();
+}
+
+void PeerMetricsTable::Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& [peer_id, handle] : ids_) {
+        blocks_[handle].in_use.store(false, std::memory_order_release);
+        free_handles_.push_back(handle);
+    }
+    ids_.clear();
+    PublishIds();
+}
+
+size_t PeerMetricsTable::Size() const {
+    return std::atomic_load(&id_snapshot_)->size();
+}
+
+void PeerMetricsTable::AddSent(Handle handle, size_t bytes) {
+    if (Block* block = GetBlock(handle)) {
+        block->bytes_sent.fetch_add(bytes, std::memory_order_relaxed);
+        block->packets_sent.fetch_add(1, std::memory_order_relaxed);
+        Touch(block->last_update_ns);
+    }
+}
+
+void PeerMetricsTable::AddReceived(Handle handle, size_t bytes) {
+    if (Block* block = GetBlock(handle)) {
+        block->bytes_received.fetch_add(bytes, std::memory_order_relaxed);
+        block->packets_received.fetch_add(1, std::memory_order_relaxed);
+        Touch(block->last_update_ns);
+    }
+}
+
+void PeerMetricsTable::AddLost(Handle handle, uint64_t packets) {
+    if (Block* block = GetBlock(handle)) {
+        block->packets_lost.fetch_add(packets, std::memory_order_relaxed);
+        Touch(block->last_update_ns);
+    }
+}
+
+void PeerMetricsTable::AddLatencySample(Handle handle, float latency_ms) {
+    Block* block = GetBlock(handle);
+    if (!block) {
+        return;
+    }
+    float average = block->latency_ms.load(std::memory_order_relaxed);
+    float updated;
+    do {
+        updated = average == 0.0f ? latency_ms
+                                  : LATENCY_SMOOTHING * average + (1.0f - LATENCY_SMOOTHING) * latency_ms;
+    } while (!block->latency_ms.compare_exchange_weak(average, updated, std::memory_order_relaxed));
+    Touch(block->last_update_ns);
+}
+
+void PeerMetricsTable::SetLatency(Handle handle, float latency_ms) {
+    if (Block* block = GetBlock(handle)) {
+        block->latency_ms.store(latency_ms, std::memory_order_relaxed);
+        Touch(block->last_update_ns);
+    }
+}
+
+void PeerMetricsTable::Reset(Handle handle) {
+    if (Block* block = GetBlock(handle)) {
+        ResetBlock(*block);
+    }
+}
+
+void PeerMetricsTable::ResetAll() {
+    for (size_t i = 0; i < capacity_; ++i) {
+        if (blocks_[i].in_use.load(std::memory_order_acquire)) {
+            ResetBlock(blocks_[i]);
+        }
+    }
+}
+
+BandwidthMetrics PeerMetricsTable::Read(Handle handle) const {
+    BandwidthMetrics metrics;
+    const Block* block = GetBlock(handle);
+    if (!block || !block->in_use.load(std::memory_order_acquire)) {
+        return metrics;
+    }
+    metrics.bytes_sent = block->bytes_sent.load(std::memory_order_relaxed);
+    metrics.bytes_received = block->bytes_received.load(std::memory_order_relaxed);
+    metrics.packets_sent = block->packets_sent.load(std::memory_order_relaxed);
+    metrics.packets_received = block->packets_received.load(std::memory_order_relaxed);
+    metrics.packets_lost = block->packets_lost.load(std::memory_order_relaxed);
+    metrics.average_latency_ms = block->latency_ms.load(std::memory_order_relaxed);
+    uint64_t total_packets = metrics.packets_received + metrics.packets_lost;
+    if (total_packets > 0) {
+        metrics.packet_loss_percent = (static_cast<float>(metrics.packets_lost) / total_packets) * 100.0f;
+    }
+    metrics.last_update = std::chrono::steady_clock::time_point(
+        std::chrono::nanoseconds(block->last_update_ns.load(std::memory_order_relaxed)));
+    return metrics;
+}
+
+BandwidthMetrics PeerMetricsTable::Aggregate() const {
+    BandwidthMetrics overall;
+    float total_latency = 0.0f;
+    float total_loss = 0.0f;
+    size_t peers = 0;
+    for (size_t i = 0; i < capacity_; ++i) {
+        if (!blocks_[i].in_use.load(std::memory_order_acquire)) {
+            continue;
+        }
+        BandwidthMetrics metrics = Read(static_cast<Handle>(i));
+        overall.bytes_sent += metrics.bytes_sent;
+        overall.bytes_received += metrics.bytes_received;
+        overall.packets_sent += metrics.packets_sent;
+        overall.packets_received += metrics.packets_received;
+        overall.packets_lost += metrics.packets_lost;
+        total_latency += metrics.average_latency_ms;
+        total_loss += metrics.packet_loss_percent;
+        ++peers;
+    }
+    if (peers > 0) {
+        overall.average_latency_ms = total_latency / peers;
+        overall.packet_loss_percent = total_loss / peers;
+    }
+    overall.last_update = std::chrono::steady_clock::now();
+    return overall;
+}
+
+PeerMetricsTable::Block* PeerMetricsTable::GetBlock(Handle handle) const {
+    return handle < capacity_ ? &blocks_[handle] : nullptr;
+}
+
+void PeerMetricsTable::ResetBlock(Block& block) const {
+    block.bytes_sent.store(0, std::memory_order_relaxed);
+    block.bytes_received.store(0, std::memory_order_relaxed);
+    block.packets_sent.store(0, std::memory_order_relaxed);
+    block.packets_received.store(0, std::memory_order_relaxed);
+    block.packets_lost.store(0, std::memory_order_relaxed);
+    block.latency_ms.store(0.0f, std::memory_order_relaxed);
+    Touch(block.last_update_ns);
+}
+
+void PeerMetricsTable::PublishIds() {
+    std::atomic_store(&id_snapshot_, std::shared_ptr<const IdMap>(std::make_shared<IdMap>(ids_)));
+}
+
+} // namespace P2P
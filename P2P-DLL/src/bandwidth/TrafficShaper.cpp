@@ -0,0 +1,454 @@
+#include "../../include/TrafficShaper.h"
+#include "../../include/Logger.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace P2P {
+
+namespace {
+
+constexpr int64_t NS_PER_SECOND = 1000000000;
+constexpr int64_t NS_PER_MS = 1000000;
+// Shortest scheduler sleep while waiting for tokens
+constexpr int64_t MIN_WAIT_NS = NS_PER_MS / 2;
+
+int64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int64_t KbpsToBytesPerSecond(float kbps) {
+    return static_cast<int64_t>(std::max(kbps, 0.0f) * 1000.0f / 8.0f);
+}
+
+size_t PriorityIndex(PacketPriority priority) {
+    size_t index = static_cast<size_t>(priority);
+    return index < TrafficShaper::PRIORITY_COUNT ? index : TrafficShaper::PRIORITY_COUNT - 1;
+}
+
+/**
+ * Token bucket in bytes, refilled lazily by whoever looks at it
+ *
+ * A bucket admits while it holds any tokens, so a packet larger than the
+ * remaining tokens still goes and leaves the bucket in debt (bounded by the
+ * burst size); later packets wait until the debt is paid back.
+ */
+struct alignas(64) TokenBucket {
+    std::atomic<int64_t> tokens{0};
+    std::atomic<int64_t> last_refill_ns{0};
+    std::atomic<int64_t> rate{0};   // Bytes per second
+    std::atomic<int64_t> burst{0};  // Bytes
+
+    void SetRate(int64_t bytes_per_second, int64_t burst_ms) {
+        rate.store(bytes_per_second, std::memory_order_relaxed);
+        burst.store(std::max(bytes_per_second * burst_ms / 1000, TrafficShaper::MIN_QUANTUM_BYTES),
+                    std::memory_order_relaxed);
+    }
+
+    void Refill(int64_t now) {
+        int64_t last = last_refill_ns.load(std::memory_order_relaxed);
+        int64_t elapsed = now - last;
+        int64_t bytes_per_second = rate.load(std::memory_order_relaxed);
+        if (elapsed <= 0 || bytes_per_second <= 0) {
+            return;
+        }
+        // Idle for longer than it takes to fill the burst: just fill it
+        int64_t cap = burst.load(std::memory_order_relaxed);
+        bool fill = elapsed >= cap * NS_PER_SECOND / bytes_per_second;
+        int64_t add = fill ? cap : elapsed * bytes_per_second / NS_PER_SECOND;
+        if (add == 0) {
+            return;  // Under a byte so far; let the time accumulate
+        }
+        // Advance by exactly the time the credited bytes took so fractions carry
+        // over; the thread that moves the timestamp is the one that adds tokens
+        int64_t next = fill ? now : last + add * NS_PER_SECOND / bytes_per_second;
+        if (!last_refill_ns.compare_exchange_strong(last, next, std::memory_order_relaxed)) {
+            return;
+        }
+        int64_t current = tokens.load(std::memory_order_relaxed);
+        while (current < cap &&
+               !tokens.compare_exchange_weak(current, std::min(current + add, cap), std::memory_order_relaxed)) {
+        }
+    }
+
+    bool HasTokens() const {
+        return tokens.load(std::memory_order_relaxed) > 0;
+    }
+
+    bool TryTake(int64_t bytes) {
+        int64_t current = tokens.load(std::memory_order_relaxed);
+        while (current > 0) {
+            if (tokens.compare_exchange_weak(current, current - bytes, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Debit(int64_t bytes) {
+        int64_t floor = -burst.load(std::memory_order_relaxed);
+        int64_t current = tokens.load(std::memory_order_relaxed);
+        while (!tokens.compare_exchange_weak(current, std::max(current - bytes, floor), std::memory_order_relaxed)) {
+        }
+    }
+
+    // Nanoseconds until the bucket admits again
+    int64_t TimeUntilTokens() const {
+        int64_t current = tokens.load(std::memory_order_relaxed);
+        int64_t bytes_per_second = rate.load(std::memory_order_relaxed);
+        if (current > 0) {
+            return 0;
+        }
+        if (bytes_per_second <= 0) {
+            return TrafficShaper::MAX_WAIT_MS * NS_PER_MS;
+        }
+        return (1 - current) * NS_PER_SECOND / bytes_per_second;
+    }
+};
+
+struct QueuedPacket {
+    PacketBuffer buffer;
+    uint32_t tag = 0;
+};
+
+} // namespace
+
+struct TrafficShaper::Impl {
+    static constexpr size_t CRITICAL = static_cast<size_t>(PacketPriority::CRITICAL);
+
+    TokenBucket link;
+    std::array<TokenBucket, PRIORITY_COUNT> priority_buckets;  // CRITICAL: reserve, others: cap
+
+    std::atomic<float> link_kbps{0.0f};
+    std::atomic<int64_t> burst_ms{50};
+    std::atomic<size_t> max_queued{DEFAULT_MAX_QUEUED};
+    std::atomic<bool> enabled{true};
+    std::atomic<bool> active{false};
+
+    // Packets queued or being transmitted by the scheduler, per priority.
+    // The send path only takes the lock-free route while this is 0, which
+    // keeps each priority's packets in order.
+    std::array<std::atomic<size_t>, PRIORITY_COUNT> pending{};
+    std::array<std::atomic<uint64_t>, PRIORITY_COUNT> sent_bytes{};
+    std::array<std::atomic<uint64_t>, PRIORITY_COUNT> dropped{};
+
+    std::mutex mutex;  // Guards the queues and scheduler state; never held across a transmit
+    std::condition_variable cv;
+    std::array<std::deque<QueuedPacket>, PRIORITY_COUNT> queues;
+    bool running = false;
+    bool wake = false;
+    std::thread thread;
+    TransmitFunction transmit;
+
+    // Scheduler thread only
+    std::array<int64_t, PRIORITY_COUNT> deficit{};
+
+    bool Admit(size_t priority, int64_t bytes) {
+        if (priority == CRITICAL) {
+            // Reserve first (the link is charged regardless), then the link
+            if (priority_buckets[CRITICAL].TryTake(bytes)) {
+                link.Debit(bytes);
+                return true;
+            }
+            return link.TryTake(bytes);
+        }
+        // Strict priority: nothing else takes link tokens while CRITICAL waits
+        if (pending[CRITICAL].load(std::memory_order_acquire) != 0 ||
+            !priority_buckets[priority].HasTokens() || !link.TryTake(bytes)) {
+            return false;
+        }
+        priority_buckets[priority].Debit(bytes);
+        return true;
+    }
+
+    int64_t Quantum(size_t priority) const {
+        return std::max(priority_buckets[priority].rate.load(std::memory_order_relaxed) * QUANTUM_MS / 1000,
+                        MIN_QUANTUM_BYTES);
+    }
+
+    // Size of the packet at the head of a queue (0 if empty)
+    int64_t HeadSize(size_t priority) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return queues[priority].empty() ? 0 : static_cast<int64_t>(queues[priority].front().buffer.Size());
+    }
+
+    /**
+     * Send the head of a queue if tokens allow
+     * @param budget DRR deficit the packet must fit in and is charged to
+     *        (nullptr for strict priority)
+     */
+    bool SendHead(size_t priority, int64_t* budget);
+
+    /**
+     * How long the scheduler may sleep before a waiting packet could go
+     * @return -1 if nothing is queued
+     */
+    int64_t WaitNs();
+
+    void Run();
+};
+
+bool TrafficShaper::Impl::SendHead(size_t priority, int64_t* budget) {
+    int64_t size;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (queues[priority].empty()) {
+            return false;
+        }
+        size = static_cast<int64_t>(queues[priority].front().buffer.Size());
+    }
+    if ((budget && size > *budget) || !Admit(priority, size)) {
+        return false;
+    }
+
+    // Only this thread pops, so the head is still the packet admitted above
+    QueuedPacket packet;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        packet = std::move(queues[priority].front());
+        queues[priority].pop_front();
+    }
+    transmit(static_cast<PacketPriority>(priority), packet.tag, packet.buffer);
+    sent_bytes[priority].fetch_add(static_cast<uint64_t>(size), std::memory_order_relaxed);
+    pending[priority].fetch_sub(1, std::memory_order_release);
+    if (budget) {
+        *budget -= size;
+    }
+    return true;
+}
+
+int64_t TrafficShaper::Impl::WaitNs() {
+    int64_t wait = -1;
+    for (size_t p = 0; p < PRIORITY_COUNT; ++p) {
+        if (pending[p].load(std::memory_order_relaxed) == 0) {
+            continue;
+        }
+        int64_t ready = p == CRITICAL
+            ? std::min(priority_buckets[p].TimeUntilTokens(), link.TimeUntilTokens())
+            : std::max(priority_buckets[p].TimeUntilTokens(), link.TimeUntilTokens());
+        wait = wait < 0 ? ready : std::min(wait, ready);
+    }
+    return wait < 0 ? wait : std::min(std::max(wait, MIN_WAIT_NS), MAX_WAIT_MS * NS_PER_MS);
+}
+
+void TrafficShaper::Impl::Run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (running) {
+        wake = false;
+        lock.unlock();
+
+        int64_t now = NowNs();
+        link.Refill(now);
+        for (auto& bucket : priority_buckets) {
+            bucket.Refill(now);
+        }
+
+        // Strict priority: CRITICAL goes as far as tokens allow, and again
+        // after every packet of a lower priority
+        bool sent = false;
+        while (SendHead(CRITICAL, nullptr)) {
+            sent = true;
+        }
+
+        // One deficit-round-robin round over the other priorities
+        for (size_t p = 0; p < PRIORITY_COUNT; ++p) {
+            if (p == CRITICAL) {
+                continue;
+            }
+            if (pending[p].load(std::memory_order_relaxed) == 0) {
+                deficit[p] = 0;
+                continue;
+            }
+            // Capped so a queue stalled on tokens does not bank a burst, but
+            // never below the head packet, or one larger than the cap would
+            // block its queue for good
+            int64_t cap = std::max(2 * Quantum(p), HeadSize(p));
+            deficit[p] = std::min(deficit[p] + Quantum(p), cap);
+            while (SendHead(p, &deficit[p])) {
+                sent = true;
+                while (SendHead(CRITICAL, nullptr)) {
+                }
+            }
+        }
+
+        lock.lock();
+        if (!sent && running && !wake) {
+            int64_t wait = WaitNs();
+            if (wait < 0) {
+                cv.wait(lock, [this]() { return !running || wake; });
+            } else {
+                cv.wait_for(lock, std::chrono::nanoseconds(wait), [this]() { return !running || wake; });
+            }
+        }
+    }
+}
+
+TrafficShaper::TrafficShaper() : impl_(std::make_unique<Impl>()) {
+    Configure(BandwidthConfig{});
+}
+
+TrafficShaper::~TrafficShaper() {
+    Stop();
+}
+
+void TrafficShaper::Configure(const BandwidthConfig& config) {
+    const float priority_kbps[PRIORITY_COUNT] = {
+        config.critical_reserve_kbps,
+        config.high_priority_kbps,
+        config.normal_priority_kbps,
+        config.low_priority_kbps,
+        config.background_kbps,
+    };
+    impl_->burst_ms.store(std::max<int64_t>(config.shaper_burst_ms, 1), std::memory_order_relaxed);
+    for (size_t p = 0; p < PRIORITY_COUNT; ++p) {
+        impl_->priority_buckets[p].SetRate(KbpsToBytesPerSecond(priority_kbps[p]), impl_->burst_ms.load());
+    }
+    impl_->max_queued.store(static_cast<size_t>(std::max(config.shaper_queue_packets, 1)), std::memory_order_relaxed);
+    impl_->enabled.store(config.traffic_shaping_enabled, std::memory_order_relaxed);
+    SetLinkRate(config.max_bitrate_kbps);
+}
+
+bool TrafficShaper::Start(TransmitFunction transmit) {
+    Stop();
+    if (!impl_->enabled.load(std::memory_order_relaxed) || !transmit) {
+        LOG_INFO("Traffic shaping disabled");
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    impl_->transmit = std::move(transmit);
+    impl_->deficit.fill(0);
+    impl_->running = true;
+    impl_->active.store(true, std::memory_order_release);
+    impl_->thread = std::thread(&Impl::Run, impl_.get());
+    LOG_INFO_FMT("Traffic shaping started (link {:.0f} kbps)", GetLinkRate());
+    return true;
+}
+
+void TrafficShaper::Stop() {
+    std::thread thread;
+    {
+        std::lock_guard<std::mutex> lock(impl_->mutex);
+        impl_->active.store(false, std::memory_order_release);
+        impl_->running = false;
+        thread = std::move(impl_->thread);
+    }
+    impl_->cv.notify_all();
+    if (thread.joinable()) {
+        thread.join();
+    }
+
+    // Queued packets were accepted but never sent: count them as dropped
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    size_t discarded = 0;
+    for (size_t p = 0; p < PRIORITY_COUNT; ++p) {
+        size_t queued = impl_->queues[p].size();
+        impl_->dropped[p].fetch_add(queued, std::memory_order_relaxed);
+        discarded += queued;
+        impl_->queues[p].clear();
+        impl_->pending[p].store(0, std::memory_order_relaxed);
+    }
+    if (discarded > 0) {
+        LOG_WARN_FMT("Traffic shaper stopped with {} packet(s) queued; counted as dropped", discarded);
+    }
+}
+
+bool TrafficShaper::IsRunning() const {
+    return impl_->active.load(std::memory_order_acquire);
+}
+
+TrafficShaper::Verdict TrafficShaper::Submit(PacketPriority priority, const uint8_t* data, size_t size, uint32_t tag) {
+    size_t p = PriorityIndex(priority);
+    if (!impl_->active.load(std::memory_order_acquire)) {
+        Charge(priority, size);
+        return Verdict::SEND_NOW;
+    }
+
+    int64_t now = NowNs();
+    impl_->link.Refill(now);
+    impl_->priority_buckets[p].Refill(now);
+    if (impl_->pending[p].load(std::memory_order_acquire) == 0 &&
+        impl_->Admit(p, static_cast<int64_t>(size))) {
+        impl_->sent_bytes[p].fetch_add(size, std::memory_order_relaxed);
+        return Verdict::SEND_NOW;
+    }
+
+    PacketBuffer buffer = PacketBufferPool::GetInstance().Acquire(size);
+    buffer.Assign(data, size);
+    {
+        std::lock_guard<std::mutex> lock(impl_->mutex);
+        if (!impl_->running) {
+            Charge(priority, size);
+            return Verdict::SEND_NOW;
+        }
+        if (impl_->queues[p].size() < impl_->max_queued.load(std::memory_order_relaxed)) {
+            impl_->queues[p].push_back(QueuedPacket{std::move(buffer), tag});
+            impl_->pending[p].fetch_add(1, std::memory_order_release);
+            impl_->wake = true;
+            impl_->cv.notify_one();
+            return Verdict::QUEUED;
+        }
+    }
+
+    uint64_t dropped = impl_->dropped[p].fetch_add(1, std::memory_order_relaxed) + 1;
+    // Rate-limit the warning to powers of two
+    if ((dropped & (dropped - 1)) == 0) {
+        LOG_WARN_FMT("Shaper queue full for priority {}: {} packet(s) dropped", p, dropped);
+    }
+    return Verdict::DROPPED;
+}
+
+void TrafficShaper::Charge(PacketPriority priority, size_t size) {
+    size_t p = PriorityIndex(priority);
+    int64_t now = NowNs();
+    impl_->link.Refill(now);
+    impl_->priority_buckets[p].Refill(now);
+    impl_->priority_buckets[p].Debit(static_cast<int64_t>(size));
+    impl_->link.Debit(static_cast<int64_t>(size));
+    impl_->sent_bytes[p].fetch_add(size, std::memory_order_relaxed);
+}
+
+bool TrafficShaper::CanSend(PacketPriority priority) const {
+    size_t p = PriorityIndex(priority);
+    if (!impl_->active.load(std::memory_order_acquire)) {
+        return true;
+    }
+    int64_t now = NowNs();
+    impl_->link.Refill(now);
+    impl_->priority_buckets[p].Refill(now);
+    if (impl_->pending[p].load(std::memory_order_acquire) != 0) {
+        return false;
+    }
+    if (p == Impl::CRITICAL) {
+        return impl_->priority_buckets[p].HasTokens() || impl_->link.HasTokens();
+    }
+    return impl_->pending[Impl::CRITICAL].load(std::memory_order_acquire) == 0 &&
+           impl_->priority_buckets[p].HasTokens() && impl_->link.HasTokens();
+}
+
+void TrafficShaper::SetLinkRate(float kbps) {
+    impl_->link_kbps.store(std::max(kbps, 0.0f), std::memory_order_relaxed);
+    impl_->link.SetRate(KbpsToBytesPerSecond(kbps), impl_->burst_ms.load(std::memory_order_relaxed));
+}
+
+float TrafficShaper::GetLinkRate() const {
+    return impl_->link_kbps.load(std::memory_order_relaxed);
+}
+
+size_t TrafficShaper::GetQueuedPackets(PacketPriority priority) const {
+    return impl_->pending[PriorityIndex(priority)].load(std::memory_order_relaxed);
+}
+
+uint64_t TrafficShaper::GetSentBytes(PacketPriority priority) const {
+    return impl_->sent_bytes[PriorityIndex(priority)].load(std::memory_order_relaxed);
+}
+
+uint64_t TrafficShaper::GetDroppedPackets(PacketPriority priority) const {
+    return impl_->dropped[PriorityIndex(priority)].load(std::memory_order_relaxed);
+}
+
+} // namespace P2P
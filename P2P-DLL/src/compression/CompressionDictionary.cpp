@@ -0,0 +1,229 @@
+#include "../../include/CompressionDictionary.h"
+#include "../../include/Logger.h"
+#include <fstream>
+#include <iterator>
+
+namespace P2P {
+
+namespace {
+
+constexpr uint32_t FNV_OFFSET_BASIS = 2166136261u;
+constexpr uint32_t FNV_PRIME = 16777619u;
+
+void PutU16(std::vector<uint8_t>& out, uint16_t value) {
+    out.push_back(static_cast<uint8_t>(value));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+}
+
+void PutU32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) {
+        out.push_back(static_cast<uint8_t>(value >> shift));
+    }
+}
+
+// Bounds-checked little-endian reader over the file bytes
+class Reader {
+public:
+    Reader(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+    bool U16(uint16_t& value) {
+        if (size_ - offset_ < 2) {
+            return false;
+        }
+        value = static_cast<uint16_t>(data_[offset_] | (data_[offset_ + 1] << 8));
+        offset_ += 2;
+        return true;
+    }
+
+    bool U32(uint32_t& value) {
+        if (size_ - offset_ < 4) {
+            return false;
+        }
+        value = 0;
+        for (int i = 3; i >= 0; --i) {
+            value = (value << 8) | data_[offset_ + static_cast<size_t>(i)];
+        }
+        offset_ += 4;
+        return true;
+    }
+
+    bool Bytes(size_t count, std::vector<uint8_t>& out) {
+        if (size_ - offset_ < count) {
+            return false;
+        }
+        out.assign(data_ + offset_, data_ + offset_ + count);
+        offset_ += count;
+        return true;
+    }
+
+    bool AtEnd() const { return offset_ == size_; }
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+    size_t offset_ = 0;
+};
+
+const std::vector<uint8_t>& EmptyDictionary() {
+    static const std::vector<uint8_t> empty;
+    return empty;
+}
+
+const std::vector<uint16_t>& EmptyOpcodes() {
+    static const std::vector<uint16_t> empty;
+    return empty;
+}
+
+} // namespace
+
+CompressionDictionary::CompressionDictionary()
+    : classes_(1), class_of_(65536, GENERIC_CLASS) {
+}
+
+bool CompressionDictionary::SetGeneric(std::vector<uint8_t> dictionary) {
+    if (dictionary.size() > MAX_DICTIONARY_SIZE) {
+        return false;
+    }
+    classes_[GENERIC_CLASS].dictionary = std::move(dictionary);
+    return true;
+}
+
+bool CompressionDictionary::AddClass(const std::vector<uint16_t>& opcodes, std::vector<uint8_t> dictionary) {
+    if (classes_.size() >= MAX_CLASSES || dictionary.size() > MAX_DICTIONARY_SIZE || opcodes.empty()) {
+        return false;
+    }
+    for (uint16_t type : opcodes) {
+        if (class_of_[type] != GENERIC_CLASS) {
+            return false;
+        }
+    }
+
+    const uint8_t cls = static_cast<uint8_t>(classes_.size());
+    DictionaryClass entry;
+    for (uint16_t type : opcodes) {
+        // A duplicate within the list is harmless; keep the first
+        if (class_of_[type] == GENERIC_CLASS) {
+            class_of_[type] = cls;
+            entry.opcodes.push_back(type);
+        }
+    }
+    entry.dictionary = std::move(dictionary);
+    classes_.push_back(std::move(entry));
+    return true;
+}
+
+const std::vector<uint8_t>& CompressionDictionary::GetDictionary(uint8_t cls) const {
+    return cls < classes_.size() ? classes_[cls].dictionary : EmptyDictionary();
+}
+
+const std::vector<uint16_t>& CompressionDictionary::GetOpcodes(uint8_t cls) const {
+    return cls < classes_.size() ? classes_[cls].opcodes : EmptyOpcodes();
+}
+
+uint32_t CompressionDictionary::GetId() const {
+    uint32_t hash = FNV_OFFSET_BASIS;
+    for (uint8_t byte : Serialize()) {
+        hash = (hash ^ byte) * FNV_PRIME;
+    }
+    // 0 means "no dictionary" in session capabilities
+    return hash != 0 ? hash : 1;
+}
+
+std::vector<uint8_t> CompressionDictionary::Serialize() const {
+    std::vector<uint8_t> out;
+    PutU32(out, FILE_MAGIC);
+    PutU16(out, FILE_VERSION);
+    PutU16(out, static_cast<uint16_t>(classes_.size()));
+    for (const auto& entry : classes_) {
+        PutU16(out, static_cast<uint16_t>(entry.opcodes.size()));
+        for (uint16_t type : entry.opcodes) {
+            PutU16(out, type);
+        }
+        PutU32(out, static_cast<uint32_t>(entry.dictionary.size()));
+        out.insert(out.end(), entry.dictionary.begin(), entry.dictionary.end());
+    }
+    return out;
+}
+
+std::unique_ptr<CompressionDictionary> CompressionDictionary::Deserialize(const uint8_t* data, size_t size) {
+    if (!data) {
+        return nullptr;
+    }
+
+    Reader reader(data, size);
+    uint32_t magic = 0;
+    uint16_t version = 0;
+    uint16_t class_count = 0;
+    if (!reader.U32(magic) || !reader.U16(version) || !reader.U16(class_count)) {
+        LOG_ERROR("Compression dictionary: truncated header");
+        return nullptr;
+    }
+    if (magic != FILE_MAGIC || version != FILE_VERSION) {
+        LOG_ERROR_FMT("Compression dictionary: bad magic {:#x} or version {}", magic, version);
+        return nullptr;
+    }
+    if (class_count == 0 || class_count > MAX_CLASSES) {
+        LOG_ERROR_FMT("Compression dictionary: invalid class count {}", class_count);
+        return nullptr;
+    }
+
+    auto result = std::make_unique<CompressionDictionary>();
+    for (uint16_t cls = 0; cls < class_count; ++cls) {
+        uint16_t opcode_count = 0;
+        if (!reader.U16(opcode_count)) {
+            LOG_ERROR("Compression dictionary: truncated class");
+            return nullptr;
+        }
+        std::vector<uint16_t> opcodes(opcode_count);
+        for (auto& type : opcodes) {
+            if (!reader.U16(type)) {
+                LOG_ERROR("Compression dictionary: truncated opcode list");
+                return nullptr;
+            }
+        }
+        uint32_t dictionary_size = 0;
+        std::vector<uint8_t> dictionary;
+        if (!reader.U32(dictionary_size) || dictionary_size > MAX_DICTIONARY_SIZE ||
+            !reader.Bytes(dictionary_size, dictionary)) {
+            LOG_ERROR_FMT("Compression dictionary: class {} has a truncated or oversized dictionary", cls);
+            return nullptr;
+        }
+
+        bool added = cls == GENERIC_CLASS
+            ? opcodes.empty() && result->SetGeneric(std::move(dictionary))
+            : result->AddClass(opcodes, std::move(dictionary));
+        if (!added) {
+            LOG_ERROR_FMT("Compression dictionary: class {} has an invalid opcode list", cls);
+            return nullptr;
+        }
+    }
+
+    if (!reader.AtEnd()) {
+        LOG_ERROR("Compression dictionary: trailing data");
+        return nullptr;
+    }
+    return result;
+}
+
+std::unique_ptr<CompressionDictionary> CompressionDictionary::LoadFromFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        LOG_ERROR("Compression dictionary: cannot open " + path);
+        return nullptr;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return Deserialize(data.data(), data.size());
+}
+
+bool CompressionDictionary::SaveToFile(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        LOG_ERROR("Compression dictionary: cannot create " + path);
+        return false;
+    }
+    std::vector<uint8_t> data = Serialize();
+    file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    return static_cast<bool>(file);
+}
+
+} // namespace P2P
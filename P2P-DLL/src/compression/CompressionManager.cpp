@@ -1,4 +1,6 @@
 #include "../../include/CompressionManager.h"
+#include "../../include/CompressionDictionary.h"
+#include "../../include/PacketTable.h"
 #include "../../include/ConfigManager.h"
 #include "../../include/Logger.h"
 #include <zlib.h>
@@ -7,25 +9,363 @@
 #include <memory>
 #include <vector>
 #include <string>
-#include <sstream>
-#include <iomanip>
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <cstring>
 
 namespace P2P {
 
+namespace {
+
+/**
+ * Per-thread compressor state, reused for every packet the thread compresses
+ *
+ * LZ4 and LZ4HC run on caller-owned state blocks (the *_extState APIs), and
+ * zlib keeps one deflate and one inflate stream that are reset between
+ * packets instead of being allocated and initialised by every
+ * compress2/uncompress call. Everything is freed when the thread exits.
+ */
+struct ThreadCompressionState {
+    std::unique_ptr<char[]> lz4_state;
+    std::unique_ptr<char[]> lz4hc_state;
+    // Working stream for dictionary compression, overwritten per packet
+    LZ4_stream_t* lz4_dict_stream = nullptr;
+
+    z_stream deflater{};
+    bool deflater_ready = false;
+    int deflater_level = 0;
+
+    z_stream inflater{};
+    bool inflater_ready = false;
+
+    ThreadCompressionState() = default;
+    ThreadCompressionState(const ThreadCompressionState&) = delete;
+    ThreadCompressionState& operator=(const ThreadCompressionState&) = delete;
+
+    ~ThreadCompressionState() {
+        if (lz4_dict_stream) {
+            LZ4_freeStream(lz4_dict_stream);
+        }
+        if (deflater_ready) {
+            deflateEnd(&deflater);
+        }
+        if (inflater_ready) {
+            inflateEnd(&inflater);
+        }
+    }
+
+    void* Lz4State() {
+        if (!lz4_state) {
+            lz4_state = std::make_unique<char[]>(static_cast<size_t>(LZ4_sizeofState()));
+        }
+        return lz4_state.get();
+    }
+
+    void* Lz4HcState() {
+        if (!lz4hc_state) {
+            lz4hc_state = std::make_unique<char[]>(static_cast<size_t>(LZ4_sizeofStateHC()));
+        }
+        return lz4hc_state.get();
+    }
+
+    LZ4_stream_t* Lz4DictStream() {
+        if (!lz4_dict_stream) {
+            lz4_dict_stream = LZ4_createStream();
+        }
+        return lz4_dict_stream;
+    }
+
+    z_stream* Deflater(int level) {
+        if (deflater_ready && deflater_level == level) {
+            return deflateReset(&deflater) == Z_OK ? &deflater : nullptr;
+        }
+        if (deflater_ready) {
+            deflateEnd(&deflater);
+            deflater_ready = false;
+        }
+        deflater = z_stream{};
+        if (deflateInit(&deflater, level) != Z_OK) {
+            return nullptr;
+        }
+        deflater_ready = true;
+        deflater_level = level;
+        return &deflater;
+    }
+
+    z_stream* Inflater() {
+        if (inflater_ready) {
+            return inflateReset(&inflater) == Z_OK ? &inflater : nullptr;
+        }
+        inflater = z_stream{};
+        if (inflateInit(&inflater) != Z_OK) {
+            return nullptr;
+        }
+        inflater_ready = true;
+        return &inflater;
+    }
+};
+
+ThreadCompressionState& GetThreadState() {
+    thread_local ThreadCompressionState state;
+    return state;
+}
+
+/**
+ * A loaded dictionary set plus one LZ4 stream per class with that class's
+ * dictionary already loaded. LZ4_loadDict hashes the whole dictionary, so
+ * it is done once here; compressing a packet copies the prepared stream
+ * into the thread's working stream instead.
+ */
+struct LoadedDictionary {
+    std::unique_ptr<const CompressionDictionary> set;
+    uint32_t id = 0;
+    std::vector<LZ4_stream_t*> lz4_templates;  // nullptr for empty classes
+
+    LoadedDictionary() = default;
+    LoadedDictionary(const LoadedDictionary&) = delete;
+    LoadedDictionary& operator=(const LoadedDictionary&) = delete;
+
+    ~LoadedDictionary() {
+        for (LZ4_stream_t* stream : lz4_templates) {
+            if (stream) {
+                LZ4_freeStream(stream);
+            }
+        }
+    }
+};
+
+// Frame header varints: 7 bits per byte, low bits first
+constexpr size_t MAX_VARINT_SIZE = CompressionManager::MAX_HEADER_SIZE - 1;
+
+size_t VarintSize(uint32_t value) {
+    size_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        ++size;
+    }
+    return size;
+}
+
+size_t WriteVarint(uint32_t value, uint8_t* out) {
+    size_t size = 0;
+    while (value >= 0x80) {
+        out[size++] = static_cast<uint8_t>(value | 0x80);
+        value >>= 7;
+    }
+    out[size++] = static_cast<uint8_t>(value);
+    return size;
+}
+
+bool ReadVarint(const uint8_t* data, size_t size, uint32_t& value, size_t& length) {
+    value = 0;
+    for (size_t i = 0; i < size && i < MAX_VARINT_SIZE; ++i) {
+        value |= static_cast<uint32_t>(data[i] & 0x7F) << (7 * i);
+        if ((data[i] & 0x80) == 0) {
+            length = i + 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
 struct CompressionManager::Impl {
+    using Codec = CompressionSelector::Codec;
+
+    // Link bitrate assumed when no estimator is set
+    static constexpr float DEFAULT_LINK_KBPS = 2000.0f;
+    // Packets between clock checks in MaybeEvaluate
+    static constexpr uint32_t EVALUATION_CHECK_PACKETS = 64;
+
     bool enabled = false;
-    bool use_lz4 = true;
+    Codec fixed_codec = Codec::LZ4_FAST;
     int compression_level = 6;
+    bool metrics_enabled = true;
+    size_t min_size_for_compression = 0;
+    float compression_ratio_threshold = 1.0f;
+    size_t max_packet_size = MAX_DECOMPRESSED_SIZE;
+
+    // Accessed with std::atomic_load/store; only used while dictionary_active
+    std::shared_ptr<const LoadedDictionary> dictionary;
+    std::atomic<bool> dictionary_active{false};
+
+    // Adaptive codec selection (null when the algorithm is fixed)
+    std::unique_ptr<CompressionSelector> selector;
+    int64_t evaluation_interval_ns = 0;
+    std::atomic<uint32_t> evaluation_tick{0};
+    std::atomic<int64_t> next_evaluation_ns{0};
+    std::atomic<int64_t> last_evaluation_ns{0};
+    std::mutex link_mutex;
+    std::function<float()> link_estimator;
     
     // Statistics - Thread-safe atomic counters
     std::atomic<uint64_t> total_original{0};
     std::atomic<uint64_t> total_compressed{0};
     std::atomic<uint64_t> compression_count{0};
-    
-    // LZ4 context
-    LZ4_stream_t* lz4_stream = nullptr;
-    LZ4_streamHC_t* lz4hc_stream = nullptr;
+
+    /**
+     * Dictionary for a packet's opcode class, if one is agreed and non-empty
+     * @param dictionary Holds the set alive while its bytes are in use
+     */
+    const std::vector<uint8_t>* SelectDictionary(const uint8_t* data, size_t size,
+                                                 std::shared_ptr<const LoadedDictionary>& dictionary,
+                                                 uint8_t& dictionary_class) const {
+        if (size < 2 || !dictionary_active.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        dictionary = std::atomic_load(&this->dictionary);
+        if (!dictionary) {
+            return nullptr;
+        }
+        uint16_t type = static_cast<uint16_t>(data[0] | (data[1] << 8));
+        dictionary_class = dictionary->set->ClassOf(type);
+        const auto& bytes = dictionary->set->GetDictionary(dictionary_class);
+        return bytes.empty() ? nullptr : &bytes;
+    }
+
+    /**
+     * Compress one packet into a frame with the given codec
+     * @return false if it should go out stored instead
+     */
+    bool CompressWith(Codec codec, const uint8_t* data, size_t size,
+                      uint8_t* out, size_t out_capacity, size_t& out_size) {
+        // Pick the dictionary for this packet's opcode class, if one is agreed
+        std::shared_ptr<const LoadedDictionary> dictionary;
+        uint8_t dictionary_class = 0;
+        const std::vector<uint8_t>* dictionary_bytes =
+            SelectDictionary(data, size, dictionary, dictionary_class);
+
+        // Frame header: original size, dictionary flag and algorithm, then the class
+        const Algorithm algorithm = codec == Codec::ZLIB ? Algorithm::ZLIB : Algorithm::LZ4;
+        uint32_t value = (static_cast<uint32_t>(size) << HEADER_SIZE_SHIFT) | static_cast<uint32_t>(algorithm);
+        if (dictionary_bytes) {
+            value |= HEADER_DICTIONARY_BIT;
+        }
+        size_t header_size = WriteVarint(value, out);
+        if (dictionary_bytes) {
+            out[header_size++] = dictionary_class;
+        }
+
+        // Cap the output at what still beats the ratio threshold (and a stored
+        // frame), so incompressible data makes the compressor give up early
+        size_t max_frame = std::min(static_cast<size_t>(static_cast<double>(size) * compression_ratio_threshold),
+                                    size + VarintSize(static_cast<uint32_t>(size) << HEADER_SIZE_SHIFT) - 1);
+        if (max_frame <= header_size) {
+            return false;
+        }
+        uint8_t* body = out + header_size;
+        size_t body_capacity = std::min(out_capacity, max_frame) - header_size;
+
+        size_t compressed_size = 0;
+        if (algorithm == Algorithm::LZ4) {
+            // LZ4 compression on this thread's reusable state
+            ThreadCompressionState& state = GetThreadState();
+            int result;
+            if (dictionary_bytes) {
+                // Start from the class's prepared stream. HC levels are not used
+                // here: for packets this small the dictionary is what matters.
+                LZ4_stream_t* stream = state.Lz4DictStream();
+                if (!stream) {
+                    LOG_ERROR("LZ4 dictionary stream unavailable");
+                    return false;
+                }
+                std::memcpy(stream, dictionary->lz4_templates[dictionary_class], sizeof(LZ4_stream_t));
+                result = LZ4_compress_fast_continue(
+                    stream,
+                    reinterpret_cast<const char*>(data),
+                    reinterpret_cast<char*>(body),
+                    static_cast<int>(size),
+                    static_cast<int>(body_capacity),
+                    1
+                );
+            } else if (codec == Codec::LZ4_HC) {
+                result = LZ4_compress_HC_extStateHC(
+                    state.Lz4HcState(),
+                    reinterpret_cast<const char*>(data),
+                    reinterpret_cast<char*>(body),
+                    static_cast<int>(size),
+                    static_cast<int>(body_capacity),
+                    compression_level > 9 ? compression_level : LZ4HC_CLEVEL_DEFAULT
+                );
+            } else {
+                result = LZ4_compress_fast_extState(
+                    state.Lz4State(),
+                    reinterpret_cast<const char*>(data),
+                    reinterpret_cast<char*>(body),
+                    static_cast<int>(size),
+                    static_cast<int>(body_capacity),
+                    1 // Acceleration (1 = LZ4_compress_default)
+                );
+            }
+
+            // 0 means the output would not fit under the cap
+            if (result <= 0) {
+                LOG_TRACE_FMT("LZ4 output over the ratio cap for {} bytes, sending stored", size);
+                return false;
+            }
+            compressed_size = static_cast<size_t>(result);
+        } else {
+            // Zlib compression: same stream format as compress2, on a reset stream
+            z_stream* stream = GetThreadState().Deflater(
+                compression_level >= 1 && compression_level <= 9 ? compression_level : Z_DEFAULT_COMPRESSION);
+            if (!stream) {
+                LOG_ERROR("Zlib deflate stream unavailable");
+                return false;
+            }
+            if (dictionary_bytes &&
+                deflateSetDictionary(stream, dictionary_bytes->data(),
+                                     static_cast<uInt>(dictionary_bytes->size())) != Z_OK) {
+                LOG_ERROR("Zlib dictionary rejected");
+                return false;
+            }
+            stream->next_in = const_cast<Bytef*>(data);
+            stream->avail_in = static_cast<uInt>(size);
+            stream->next_out = body;
+            stream->avail_out = static_cast<uInt>(body_capacity);
+            int result = deflate(stream, Z_FINISH);
+            if (result != Z_STREAM_END) {
+                LOG_TRACE_FMT("Zlib output over the ratio cap for {} bytes ({}), sending stored", size, result);
+                return false;
+            }
+            compressed_size = static_cast<size_t>(stream->total_out);
+        }
+
+        out_size = header_size + compressed_size;
+        LOG_DEBUG_FMT("Compressed {} bytes to {} bytes with {} (ratio: {:.2f})",
+                      size, out_size, CompressionSelector::GetCodecName(codec), static_cast<double>(size) / out_size);
+        return true;
+    }
+
+    /**
+     * Re-evaluate the adaptive selector if the interval has passed
+     * Checks the clock only every EVALUATION_CHECK_PACKETS packets; one
+     * caller wins the evaluation, the rest carry on.
+     */
+    void MaybeEvaluate() {
+        if (evaluation_tick.fetch_add(1, std::memory_order_relaxed) % EVALUATION_CHECK_PACKETS != 0) {
+            return;
+        }
+        int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        int64_t due = next_evaluation_ns.load(std::memory_order_relaxed);
+        if (now < due || !next_evaluation_ns.compare_exchange_strong(due, now + evaluation_interval_ns)) {
+            return;
+        }
+
+        float available_kbps = DEFAULT_LINK_KBPS;
+        {
+            std::lock_guard<std::mutex> lock(link_mutex);
+            if (link_estimator) {
+                available_kbps = link_estimator();
+            }
+        }
+        int64_t previous = last_evaluation_ns.exchange(now, std::memory_order_relaxed);
+        selector->Evaluate(available_kbps, static_cast<uint64_t>(now - previous));
+    }
 };
 
 CompressionManager::CompressionManager() : impl_(std::make_unique<Impl>()) {
@@ -33,12 +373,6 @@ CompressionManager::CompressionManager() : impl_(std::make_unique<Impl>()) {
 }
 
 CompressionManager::~CompressionManager() {
-    if (impl_->lz4_stream) {
-        LZ4_freeStream(impl_->lz4_stream);
-    }
-    if (impl_->lz4hc_stream) {
-        LZ4_freeStreamHC(impl_->lz4hc_stream);
-    }
     LOG_DEBUG("CompressionManager destroyed");
 }
 
@@ -47,177 +381,331 @@ CompressionManager& CompressionManager::GetInstance() {
     return instance;
 }
 
-bool CompressionManager::Initialize(const CompressionConfig& config) {
+bool CompressionManager::Initialize(const CompressionConfig& config, size_t max_packet_size) {
     impl_->enabled = config.enabled;
-    impl_->use_lz4 = config.algorithm == "lz4";
     impl_->compression_level = config.compression_level;
+    impl_->metrics_enabled = config.enable_metrics;
+    impl_->min_size_for_compression = static_cast<size_t>(std::max(config.min_size_for_compression, 0));
+    impl_->compression_ratio_threshold = config.compression_ratio_threshold;
+    // Decoding is always on, so the cap applies even with compression disabled
+    impl_->max_packet_size = max_packet_size > 0 ? std::min(max_packet_size, MAX_DECOMPRESSED_SIZE)
+                                                 : MAX_DECOMPRESSED_SIZE;
     
     if (!impl_->enabled) {
         LOG_INFO("Compression is disabled");
         return true;
     }
     
-    // Initialize LZ4 streams if using LZ4
-    if (impl_->use_lz4) {
-        if (impl_->compression_level > 9) {
-            impl_->lz4hc_stream = LZ4_createStreamHC();
-            if (!impl_->lz4hc_stream) {
-                LOG_ERROR("Failed to create LZ4 HC stream");
-                impl_->enabled = false;
-                return false;
-            }
-        } else {
-            impl_->lz4_stream = LZ4_createStream();
-            if (!impl_->lz4_stream) {
-                LOG_ERROR("Failed to create LZ4 stream");
-                impl_->enabled = false;
-                return false;
-            }
-        }
-        std::ostringstream oss;
-        oss << "LZ4 compression initialized (level: " << impl_->compression_level << ")";
-        LOG_INFO(oss.str());
+    if (!config.dictionary_path.empty() && !LoadDictionary(config.dictionary_path)) {
+        LOG_WARN("Compression dictionary unavailable, small packets will compress poorly");
+    }
+
+    // Compressor state is created lazily per thread (see ThreadCompressionState)
+    impl_->selector.reset();
+    if (config.algorithm == "adaptive" && !config.enable_metrics) {
+        LOG_WARN("Adaptive compression needs enable_metrics, using LZ4");
+    }
+    if (config.algorithm == "adaptive" && config.enable_metrics) {
+        impl_->fixed_codec = Impl::Codec::LZ4_FAST;
+        impl_->selector = std::make_unique<CompressionSelector>(
+            Impl::Codec::LZ4_FAST, std::max(config.cpu_budget_percent, 0.0f) / 100.0);
+        impl_->evaluation_interval_ns = static_cast<int64_t>(std::max(config.adaptive_interval_ms, 100)) * 1000000;
+        int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        impl_->last_evaluation_ns.store(now, std::memory_order_relaxed);
+        impl_->next_evaluation_ns.store(now + impl_->evaluation_interval_ns, std::memory_order_relaxed);
+        LOG_INFO_FMT("Adaptive compression initialized (re-evaluated every {} ms, CPU budget {}%)",
+                     config.adaptive_interval_ms, config.cpu_budget_percent);
+    } else if (config.algorithm == "zlib") {
+        impl_->fixed_codec = Impl::Codec::ZLIB;
+        LOG_INFO_FMT("Zlib compression initialized (level: {})", impl_->compression_level);
     } else {
-        std::ostringstream oss;
-        oss << "Zlib compression initialized (level: " << impl_->compression_level << ")";
-        LOG_INFO(oss.str());
+        impl_->fixed_codec = impl_->compression_level > 9 ? Impl::Codec::LZ4_HC : Impl::Codec::LZ4_FAST;
+        LOG_INFO_FMT("LZ4 compression initialized (level: {})", impl_->compression_level);
     }
     
     return true;
 }
 
-std::vector<uint8_t> CompressionManager::Compress(const std::vector<uint8_t>& data) {
-    if (!impl_->enabled || data.empty()) {
-        return data;
+size_t CompressionManager::GetMaxCompressedSize(size_t size) const {
+    // Either codec may be picked per packet in adaptive mode
+    size_t bound = std::max(static_cast<size_t>(LZ4_compressBound(static_cast<int>(size))),
+                            static_cast<size_t>(compressBound(static_cast<uLong>(size))));
+    // A stored frame is never larger than a compressed one would be allowed to be
+    return MAX_HEADER_SIZE + std::max(bound, size);
+}
+
+size_t CompressionManager::GetDecompressedSize(const uint8_t* data, size_t size) const {
+    FrameHeader header;
+    return ParseFrameHeader(data, size, header) ? header.original_size : 0;
+}
+
+bool CompressionManager::ParseFrameHeader(const uint8_t* data, size_t size, FrameHeader& header) const {
+    uint32_t value = 0;
+    size_t varint_size = 0;
+    if (!data || !ReadVarint(data, size, value, varint_size)) {
+        return false;
     }
-    
-    // Store original size for decompression (4-byte header)
-    const uint32_t original_size = static_cast<uint32_t>(data.size());
-    
-    std::vector<uint8_t> compressed_data;
-    
-    if (impl_->use_lz4) {
-        // LZ4 compression
-        const int max_compressed_size = LZ4_compressBound(static_cast<int>(data.size()));
-        compressed_data.resize(max_compressed_size);
-        
-        int compressed_size;
-        if (impl_->compression_level > 9) {
-            compressed_size = LZ4_compress_HC(
-                reinterpret_cast<const char*>(data.data()),
-                reinterpret_cast<char*>(compressed_data.data()),
-                static_cast<int>(data.size()),
-                max_compressed_size,
-                impl_->compression_level
-            );
-        } else {
-            compressed_size = LZ4_compress_default(
-                reinterpret_cast<const char*>(data.data()),
-                reinterpret_cast<char*>(compressed_data.data()),
-                static_cast<int>(data.size()),
-                max_compressed_size
-            );
-        }
-        
-        if (compressed_size <= 0) {
-            LOG_ERROR("LZ4 compression failed");
-            return data;
-        }
-        
-        compressed_data.resize(compressed_size);
-    } else {
-        // Zlib compression
-        uLongf compressed_size = compressBound(static_cast<uLong>(data.size()));
-        compressed_data.resize(compressed_size);
-        
-        int result = compress2(
-            compressed_data.data(),
-            &compressed_size,
-            data.data(),
-            static_cast<uLong>(data.size()),
-            impl_->compression_level
-        );
-        
-        if (result != Z_OK) {
-            std::ostringstream oss;
-            oss << "Zlib compression failed: " << result;
-            LOG_ERROR(oss.str());
-            return data;
-        }
-        
-        compressed_data.resize(compressed_size);
+
+    header.algorithm = static_cast<Algorithm>(value & HEADER_ALGORITHM_MASK);
+    header.stored = (value & HEADER_STORED_BIT) != 0;
+    header.dictionary = (value & HEADER_DICTIONARY_BIT) != 0;
+    header.original_size = value >> HEADER_SIZE_SHIFT;
+    header.header_size = varint_size;
+    header.dictionary_class = 0;
+
+    if (header.original_size > impl_->max_packet_size) {
+        LOG_WARN_FMT("Compressed frame claims {} bytes, over the {} byte cap",
+                     header.original_size, impl_->max_packet_size);
+        return false;
     }
-    
-    // Prepend 4-byte header with original size
-    std::vector<uint8_t> result;
-    result.reserve(sizeof(original_size) + compressed_data.size());
-    result.resize(sizeof(original_size));
-    std::memcpy(result.data(), &original_size, sizeof(original_size));
-    result.insert(result.end(), compressed_data.begin(), compressed_data.end());
-    
-    // Update statistics atomically (relaxed ordering sufficient for counters)
-    impl_->total_original.fetch_add(data.size(), std::memory_order_relaxed);
-    impl_->total_compressed.fetch_add(result.size(), std::memory_order_relaxed);
-    impl_->compression_count.fetch_add(1, std::memory_order_relaxed);
-    
-    std::ostringstream oss;
-    oss << "Compressed " << data.size() << " bytes to " << result.size() << " bytes (ratio: ";
-    oss << std::fixed << std::setprecision(2) << (static_cast<double>(data.size()) / result.size()) << ")";
-    LOG_DEBUG(oss.str());
-    
-    return result;
+    if (header.stored) {
+        // Stored frames carry no algorithm or dictionary and hold the bytes as-is
+        return !header.dictionary && (value & HEADER_ALGORITHM_MASK) == 0 &&
+               size - varint_size == header.original_size;
+    }
+    if (header.algorithm != Algorithm::LZ4 && header.algorithm != Algorithm::ZLIB) {
+        LOG_WARN_FMT("Compressed frame uses unknown algorithm {}", value & HEADER_ALGORITHM_MASK);
+        return false;
+    }
+    if (header.dictionary) {
+        if (size <= varint_size) {
+            return false;
+        }
+        header.dictionary_class = data[varint_size];
+        ++header.header_size;
+    }
+    return header.original_size > 0 && size > header.header_size;
 }
 
-std::vector<uint8_t> CompressionManager::Decompress(const std::vector<uint8_t>& data) {
-    if (!impl_->enabled || data.empty()) {
-        return data;
+size_t CompressionManager::EncodeStoredHeader(size_t size, uint8_t* out) {
+    return WriteVarint((static_cast<uint32_t>(size) << HEADER_SIZE_SHIFT) | HEADER_STORED_BIT, out);
+}
+
+bool CompressionManager::LoadDictionary(const std::string& path) {
+    auto set = CompressionDictionary::LoadFromFile(path);
+    if (!set) {
+        return false;
     }
-    
-    // For now, we'll assume the original size is stored in the first 4 bytes
-    // In a real implementation, we'd need a proper header format
-    if (data.size() < 4) {
-        LOG_ERROR("Compressed data too small for header");
-        return data;
+
+    auto loaded = std::make_shared<LoadedDictionary>();
+    loaded->id = set->GetId();
+    loaded->lz4_templates.resize(set->GetClassCount(), nullptr);
+    for (size_t cls = 0; cls < set->GetClassCount(); ++cls) {
+        const auto& dictionary = set->GetDictionary(static_cast<uint8_t>(cls));
+        if (dictionary.empty()) {
+            continue;
+        }
+        LZ4_stream_t* stream = LZ4_createStream();
+        if (!stream) {
+            LOG_ERROR("Failed to allocate LZ4 dictionary stream");
+            return false;
+        }
+        loaded->lz4_templates[cls] = stream;
+        LZ4_loadDict(stream, reinterpret_cast<const char*>(dictionary.data()), static_cast<int>(dictionary.size()));
     }
-    
-    uint32_t original_size;
-    std::memcpy(&original_size, data.data(), sizeof(original_size));
-    
-    std::vector<uint8_t> decompressed(original_size);
-    
-    if (impl_->use_lz4) {
+    loaded->set = std::move(set);
+
+    // A new dictionary has to be agreed again before it is used
+    impl_->dictionary_active.store(false, std::memory_order_release);
+    LOG_INFO_FMT("Compression dictionary {:08x} loaded from {} ({} classes)",
+                 loaded->id, path, loaded->set->GetClassCount());
+    std::atomic_store(&impl_->dictionary, std::shared_ptr<const LoadedDictionary>(std::move(loaded)));
+    return true;
+}
+
+uint32_t CompressionManager::GetDictionaryId() const {
+    auto dictionary = std::atomic_load(&impl_->dictionary);
+    return dictionary ? dictionary->id : 0;
+}
+
+bool CompressionManager::SetNegotiatedDictionary(uint32_t dictionary_id) {
+    auto dictionary = std::atomic_load(&impl_->dictionary);
+    bool active = dictionary_id != 0 && dictionary && dictionary->id == dictionary_id;
+    if (dictionary_id != 0 && !active) {
+        LOG_WARN_FMT("Session compression dictionary {:08x} does not match local dictionary {:08x}",
+                     dictionary_id, dictionary ? dictionary->id : 0u);
+    } else if (active) {
+        LOG_INFO_FMT("Compression dictionary {:08x} in use", dictionary_id);
+    }
+    impl_->dictionary_active.store(active, std::memory_order_release);
+    return active;
+}
+
+bool CompressionManager::IsDictionaryActive() const {
+    return impl_->dictionary_active.load(std::memory_order_acquire);
+}
+
+bool CompressionManager::ShouldCompress(const uint8_t* data, size_t size) const {
+    if (!impl_->enabled || !data || size == 0 || size > MAX_DECOMPRESSED_SIZE) {
+        return false;
+    }
+    if (size >= impl_->min_size_for_compression) {
+        return true;
+    }
+    // Small packets are only worth it with a dictionary
+    std::shared_ptr<const LoadedDictionary> dictionary;
+    uint8_t dictionary_class = 0;
+    return impl_->SelectDictionary(data, size, dictionary, dictionary_class) != nullptr;
+}
+
+bool CompressionManager::CompressInto(const uint8_t* data, size_t size,
+                                      uint8_t* out, size_t out_capacity, size_t& out_size) {
+    if (!ShouldCompress(data, size) || out_capacity <= MAX_HEADER_SIZE) {
+        return false;
+    }
+
+    // Adaptive mode: the selector picks the codec for this packet's class
+    CompressionSelector* selector = impl_->selector.get();
+    size_t cls = 0;
+    CompressionSelector::Codec codec = impl_->fixed_codec;
+    if (selector) {
+        uint16_t type = size >= 2 ? static_cast<uint16_t>(data[0] | (data[1] << 8)) : 0;
+        cls = CompressionSelector::ClassOf(PacketTable::GetInstance().Lookup(type).Priority());
+        codec = selector->Choose(cls);
+        impl_->MaybeEvaluate();
+        if (codec == CompressionSelector::Codec::NONE) {
+            return false;
+        }
+    }
+
+    if (!impl_->metrics_enabled) {
+        return impl_->CompressWith(codec, data, size, out, out_capacity, out_size);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    bool compressed = impl_->CompressWith(codec, data, size, out, out_capacity, out_size);
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    if (selector) {
+        // A packet that ends up stored still cost the time spent trying
+        size_t sent = compressed ? out_size : size + VarintSize(static_cast<uint32_t>(size) << HEADER_SIZE_SHIFT);
+        selector->Record(cls, codec, size, sent, static_cast<uint64_t>(elapsed.count()));
+    }
+    if (compressed) {
+        // Update statistics atomically (relaxed ordering sufficient for counters)
+        impl_->total_original.fetch_add(size, std::memory_order_relaxed);
+        impl_->total_compressed.fetch_add(out_size, std::memory_order_relaxed);
+        impl_->compression_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    return compressed;
+}
+
+bool CompressionManager::DecompressInto(const uint8_t* data, size_t size,
+                                        uint8_t* out, size_t out_capacity, size_t& out_size) {
+    FrameHeader header;
+    if (!ParseFrameHeader(data, size, header)) {
+        LOG_ERROR("Invalid compression frame header");
+        return false;
+    }
+    size_t original_size = header.original_size;
+    if (original_size > out_capacity) {
+        LOG_ERROR_FMT("Decompression buffer too small: need {}, have {}", original_size, out_capacity);
+        return false;
+    }
+
+    const uint8_t* body = data + header.header_size;
+    size_t body_size = size - header.header_size;
+    if (header.stored) {
+        std::memcpy(out, body, body_size);
+        out_size = body_size;
+        return true;
+    }
+
+    // The sender's dictionary class, if it used one
+    std::shared_ptr<const LoadedDictionary> dictionary;
+    const std::vector<uint8_t>* dictionary_bytes = nullptr;
+    if (header.dictionary) {
+        if (impl_->dictionary_active.load(std::memory_order_acquire)) {
+            dictionary = std::atomic_load(&impl_->dictionary);
+        }
+        if (dictionary) {
+            dictionary_bytes = &dictionary->set->GetDictionary(header.dictionary_class);
+        }
+        if (!dictionary_bytes || dictionary_bytes->empty()) {
+            LOG_ERROR_FMT("Compressed data uses dictionary class {} which is not available",
+                          header.dictionary_class);
+            return false;
+        }
+    }
+
+    // Decode with the sender's algorithm, whatever ours is
+    if (header.algorithm == Algorithm::LZ4) {
         // LZ4 decompression
-        int decompressed_size = LZ4_decompress_safe(
-            reinterpret_cast<const char*>(data.data() + sizeof(original_size)),
-            reinterpret_cast<char*>(decompressed.data()),
-            static_cast<int>(data.size() - sizeof(original_size)),
-            static_cast<int>(original_size)
-        );
-        
+        int decompressed_size = dictionary_bytes
+            ? LZ4_decompress_safe_usingDict(
+                  reinterpret_cast<const char*>(body),
+                  reinterpret_cast<char*>(out),
+                  static_cast<int>(body_size),
+                  static_cast<int>(original_size),
+                  reinterpret_cast<const char*>(dictionary_bytes->data()),
+                  static_cast<int>(dictionary_bytes->size()))
+            : LZ4_decompress_safe(
+                  reinterpret_cast<const char*>(body),
+                  reinterpret_cast<char*>(out),
+                  static_cast<int>(body_size),
+                  static_cast<int>(original_size));
+
         if (decompressed_size != static_cast<int>(original_size)) {
-            std::ostringstream oss;
-            oss << "LZ4 decompression failed: expected " << original_size << ", got " << decompressed_size;
-            LOG_ERROR(oss.str());
-            return data;
+            LOG_ERROR_FMT("LZ4 decompression failed: expected {}, got {}", original_size, decompressed_size);
+            return false;
         }
     } else {
-        // Zlib decompression
-        uLongf decompressed_size = original_size;
-        int result = uncompress(
-            decompressed.data(),
-            &decompressed_size,
-            data.data() + sizeof(original_size),
-            static_cast<uLong>(data.size() - sizeof(original_size))
-        );
-        
-        if (result != Z_OK || decompressed_size != original_size) {
-            std::ostringstream oss;
-            oss << "Zlib decompression failed: " << result;
-            LOG_ERROR(oss.str());
-            return data;
+        // Zlib decompression on this thread's reset inflate stream
+        z_stream* stream = GetThreadState().Inflater();
+        if (!stream) {
+            LOG_ERROR("Zlib inflate stream unavailable");
+            return false;
+        }
+        stream->next_in = const_cast<Bytef*>(body);
+        stream->avail_in = static_cast<uInt>(body_size);
+        stream->next_out = out;
+        stream->avail_out = static_cast<uInt>(original_size);
+        int result = inflate(stream, Z_FINISH);
+        if (result == Z_NEED_DICT && dictionary_bytes) {
+            if (inflateSetDictionary(stream, dictionary_bytes->data(),
+                                     static_cast<uInt>(dictionary_bytes->size())) != Z_OK) {
+                LOG_ERROR("Zlib dictionary does not match the compressed data");
+                return false;
+            }
+            result = inflate(stream, Z_FINISH);
+        }
+        if (result != Z_STREAM_END || stream->total_out != original_size) {
+            LOG_ERROR_FMT("Zlib decompression failed: {}", result);
+            return false;
         }
     }
-    
+
+    out_size = original_size;
+    return true;
+}
+
+std::vector<uint8_t> CompressionManager::Compress(const std::vector<uint8_t>& data) {
+    if (data.empty()) {
+        return data;
+    }
+
+    std::vector<uint8_t> result(GetMaxCompressedSize(data.size()));
+    size_t compressed_size = 0;
+    if (!CompressInto(data.data(), data.size(), result.data(), result.size(), compressed_size)) {
+        compressed_size = EncodeStoredHeader(data.size(), result.data());
+        std::memcpy(result.data() + compressed_size, data.data(), data.size());
+        compressed_size += data.size();
+    }
+    result.resize(compressed_size);
+    return result;
+}
+
+std::vector<uint8_t> CompressionManager::Decompress(const std::vector<uint8_t>& data) {
+    FrameHeader header;
+    if (!ParseFrameHeader(data.data(), data.size(), header)) {
+        return {};
+    }
+
+    std::vector<uint8_t> decompressed(header.original_size);
+    size_t decompressed_size = 0;
+    if (!DecompressInto(data.data(), data.size(), decompressed.data(), decompressed.size(), decompressed_size)) {
+        return {};
+    }
     return decompressed;
 }
 
@@ -236,7 +724,19 @@ double CompressionManager::GetCompressionRatio() const {
 }
 
 std::string CompressionManager::GetAlgorithmName() const {
-    return impl_->use_lz4 ? "LZ4" : "Zlib";
+    if (impl_->selector) {
+        return "Adaptive";
+    }
+    return impl_->fixed_codec == Impl::Codec::ZLIB ? "Zlib" : "LZ4";
+}
+
+void CompressionManager::SetLinkEstimator(std::function<float()> estimator) {
+    std::lock_guard<std::mutex> lock(impl_->link_mutex);
+    impl_->link_estimator = std::move(estimator);
+}
+
+CompressionSelector::Codec CompressionManager::GetSelectedCodec(PacketPriority priority) const {
+    return impl_->selector ? impl_->selector->GetChoice(CompressionSelector::ClassOf(priority)) : impl_->fixed_codec;
 }
 
 } // namespace P2P
\ No newline at end of file
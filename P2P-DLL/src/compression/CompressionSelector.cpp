@@ -0,0 +1,128 @@
+#include "../../include/CompressionSelector.h"
+#include "../../include/Logger.h"
+
+namespace P2P {
+
+namespace {
+
+constexpr CompressionSelector::Codec EXPLORE_ORDER[] = {
+    CompressionSelector::Codec::LZ4_FAST,
+    CompressionSelector::Codec::LZ4_HC,
+    CompressionSelector::Codec::ZLIB,
+};
+
+void Halve(std::atomic<uint64_t>& counter) {
+    counter.fetch_sub(counter.load(std::memory_order_relaxed) / 2, std::memory_order_relaxed);
+}
+
+} // namespace
+
+CompressionSelector::CompressionSelector(Codec initial, double cpu_budget)
+    : cpu_budget_(cpu_budget) {
+    for (auto& state : classes_) {
+        state.choice.store(initial, std::memory_order_relaxed);
+    }
+}
+
+CompressionSelector::Codec CompressionSelector::Choose(size_t cls) {
+    ClassState& state = classes_[cls < CLASS_COUNT ? cls : CLASS_COUNT - 1];
+    uint32_t packet = state.packets.fetch_add(1, std::memory_order_relaxed);
+    if (packet % EXPLORE_INTERVAL == EXPLORE_INTERVAL - 1) {
+        constexpr size_t candidates = sizeof(EXPLORE_ORDER) / sizeof(EXPLORE_ORDER[0]);
+        return EXPLORE_ORDER[(packet / EXPLORE_INTERVAL) % candidates];
+    }
+    if (cpu_backoff_.load(std::memory_order_relaxed) > 0) {
+        return Codec::NONE;
+    }
+    return state.choice.load(std::memory_order_relaxed);
+}
+
+void CompressionSelector::Record(size_t cls, Codec codec, size_t bytes_in, size_t bytes_out, uint64_t nanoseconds) {
+    ClassState& state = classes_[cls < CLASS_COUNT ? cls : CLASS_COUNT - 1];
+    CodecStats& stats = state.codecs[static_cast<size_t>(codec) % CODEC_COUNT];
+    stats.bytes_in.fetch_add(bytes_in, std::memory_order_relaxed);
+    stats.bytes_out.fetch_add(bytes_out, std::memory_order_relaxed);
+    stats.nanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+    interval_ns_spent_.fetch_add(nanoseconds, std::memory_order_relaxed);
+}
+
+void CompressionSelector::Evaluate(float available_kbps, uint64_t interval_ns) {
+    // CPU budget: back off to no compression for a few intervals when over it
+    uint64_t spent = interval_ns_spent_.exchange(0, std::memory_order_relaxed);
+    int backoff = cpu_backoff_.load(std::memory_order_relaxed);
+    if (interval_ns > 0 && static_cast<double>(spent) > cpu_budget_ * static_cast<double>(interval_ns)) {
+        if (backoff == 0) {
+            LOG_WARN_FMT("Compression used {:.1f}% CPU (budget {:.1f}%), sending uncompressed",
+                         100.0 * static_cast<double>(spent) / static_cast<double>(interval_ns), 100.0 * cpu_budget_);
+        }
+        backoff = CPU_BACKOFF_INTERVALS;
+    } else if (backoff > 0) {
+        --backoff;
+    }
+    cpu_backoff_.store(backoff, std::memory_order_relaxed);
+
+    // Nanoseconds one byte occupies the link (kbps -> bits per ns)
+    double link_ns_per_byte = available_kbps > 0.0f ? 8.0e6 / static_cast<double>(available_kbps) : 0.0;
+
+    for (size_t cls = 0; cls < CLASS_COUNT; ++cls) {
+        ClassState& state = classes_[cls];
+        Codec current = state.choice.load(std::memory_order_relaxed);
+        Codec best = Codec::NONE;
+        double best_cost = link_ns_per_byte;  // Uncompressed: one byte out per byte in, no CPU
+        bool measured = false;
+        for (Codec codec : EXPLORE_ORDER) {
+            const CodecStats& stats = state.codecs[static_cast<size_t>(codec)];
+            uint64_t bytes_in = stats.bytes_in.load(std::memory_order_relaxed);
+            if (bytes_in < MIN_SAMPLE_BYTES) {
+                continue;
+            }
+            measured = true;
+            double ratio = static_cast<double>(stats.bytes_out.load(std::memory_order_relaxed)) / bytes_in;
+            double cpu_ns_per_byte = static_cast<double>(stats.nanoseconds.load(std::memory_order_relaxed)) / bytes_in;
+            double cost = ratio * link_ns_per_byte + cpu_ns_per_byte;
+            if (cost < best_cost) {
+                best_cost = cost;
+                best = codec;
+            }
+        }
+
+        // No link estimate or no data yet: keep what we have
+        if (measured && link_ns_per_byte > 0.0 && best != current) {
+            LOG_DEBUG_FMT("Compression class {}: {} -> {} ({:.2f} ns/byte)",
+                          cls, GetCodecName(current), GetCodecName(best), best_cost);
+            state.choice.store(best, std::memory_order_relaxed);
+        }
+
+        for (auto& stats : state.codecs) {
+            Halve(stats.bytes_in);
+            Halve(stats.bytes_out);
+            Halve(stats.nanoseconds);
+        }
+    }
+}
+
+CompressionSelector::Codec CompressionSelector::GetChoice(size_t cls) const {
+    return classes_[cls < CLASS_COUNT ? cls : CLASS_COUNT - 1].choice.load(std::memory_order_relaxed);
+}
+
+CompressionSelector::Stats CompressionSelector::GetStats(size_t cls, Codec codec) const {
+    const CodecStats& stats = classes_[cls < CLASS_COUNT ? cls : CLASS_COUNT - 1]
+                                  .codecs[static_cast<size_t>(codec) % CODEC_COUNT];
+    Stats result;
+    result.bytes_in = stats.bytes_in.load(std::memory_order_relaxed);
+    result.bytes_out = stats.bytes_out.load(std::memory_order_relaxed);
+    result.nanoseconds = stats.nanoseconds.load(std::memory_order_relaxed);
+    return result;
+}
+
+const char* CompressionSelector::GetCodecName(Codec codec) {
+    switch (codec) {
+        case Codec::NONE: return "none";
+        case Codec::LZ4_FAST: return "lz4";
+        case Codec::LZ4_HC: return "lz4hc";
+        case Codec::ZLIB: return "zlib";
+        default: return "unknown";
+    }
+}
+
+} // namespace P2P
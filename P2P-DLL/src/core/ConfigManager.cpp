@@ -1,13 +1,67 @@
 #include "ConfigManager.h"
+#include "Logger.h"
 #include <nlohmann/json.hpp>
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <stdexcept>
 
 using json = nlohmann::json;
 
 namespace P2P {
 
+namespace {
+
+/**
+ * Read the opcode of a packet table override
+ * @param entry One element of p2p.packet_types
+ * @param type Receives the opcode; "type" may be a number or a hex string
+ * @return false (after logging why) if the entry has no usable opcode
+ */
+bool ParsePacketType(const json& entry, uint16_t& type) {
+    if (!entry.is_object()) {
+        LOG_ERROR("Packet type override is not an object - ignoring");
+        return false;
+    }
+    auto it = entry.find("type");
+    if (it == entry.end()) {
+        LOG_ERROR("Packet type override has no \"type\" - ignoring");
+        return false;
+    }
+
+    unsigned long value = 0;
+    if (it->is_string()) {
+        const std::string& text = it->get_ref<const std::string&>();
+        size_t consumed = 0;
+        try {
+            value = std::stoul(text, &consumed, 16);
+        } catch (const std::invalid_argument&) {
+            consumed = 0;
+        } catch (const std::out_of_range&) {
+            LOG_ERROR("Packet type override \"" + text + "\" is out of range (max 0xFFFF) - ignoring");
+            return false;
+        }
+        if (consumed == 0 || consumed != text.size()) {
+            LOG_ERROR("Packet type override \"" + text + "\" is not a hex opcode - ignoring");
+            return false;
+        }
+    } else if (it->is_number_unsigned()) {
+        value = it->get<unsigned long>();
+    } else {
+        LOG_ERROR("Packet type override \"type\" must be a number or a hex string - ignoring");
+        return false;
+    }
+
+    if (value > 0xFFFF) {
+        LOG_ERROR_FMT("Packet type override 0x{:X} is out of range (max 0xFFFF) - ignoring", value);
+        return false;
+    }
+    type = static_cast<uint16_t>(value);
+    return true;
+}
+
+} // namespace
+
 ConfigManager& ConfigManager::GetInstance() {
     static ConfigManager instance;
     return instance;
@@ -71,9 +125,30 @@ bool ConfigManager::LoadFromString(const std::string& json_str) {
                 config_.p2p.packet_queue_size = p2p.value("packet_queue_size", 1000);
                 // Mesh/AOI extensions
                 config_.p2p.aoi_radius = p2p.value("aoi_radius", 100.0f);
+                config_.p2p.combat_radius = p2p.value("combat_radius", 40.0f);
                 config_.p2p.mesh_refresh_interval_ms = p2p.value("mesh_refresh_interval_ms", 5000);
                 config_.p2p.peer_score_threshold = p2p.value("peer_score_threshold", 0.5f);
                 config_.p2p.prune_interval_ms = p2p.value("prune_interval_ms", 10000);
+                config_.p2p.state_channel_enabled = p2p.value("state_channel_enabled", true);
+                config_.p2p.state_jitter_budget_ms = p2p.value("state_jitter_budget_ms", 40);
+                config_.p2p.priority_channels_enabled = p2p.value("priority_channels_enabled", true);
+                // Packet table overrides; "type" may be a number or a hex string
+                config_.p2p.packet_types.clear();
+                if (p2p.contains("packet_types")) {
+                    for (const auto& entry : p2p["packet_types"]) {
+                        PacketTypeOverride override_entry;
+                        if (!ParsePacketType(entry, override_entry.type)) {
+                            continue;
+                        }
+                        override_entry.route = entry.value("route", "");
+                        override_entry.priority = entry.value("priority", "");
+                        override_entry.fixed_length = entry.value("fixed_length", -1);
+                        override_entry.batchable = entry.contains("batchable") ? (entry.at("batchable").get<bool>() ? 1 : 0) : -1;
+                        override_entry.unreliable = entry.contains("unreliable") ? (entry.at("unreliable").get<bool>() ? 1 : 0) : -1;
+                        override_entry.interest = entry.value("interest", "");
+                        config_.p2p.packet_types.push_back(override_entry);
+                    }
+                }
             }
 
         if (j.contains("bandwidth")) {
@@ -84,6 +159,14 @@ bool ConfigManager::LoadFromString(const std::string& json_str) {
             config_.bandwidth.max_bitrate_kbps = bandwidth.value("max_bitrate_kbps", 10000.0f);
             config_.bandwidth.enable_adaptive_bitrate = bandwidth.value("enable_adaptive_bitrate", true);
             config_.bandwidth.packet_priority_enabled = bandwidth.value("packet_priority_enabled", true);
+            config_.bandwidth.traffic_shaping_enabled = bandwidth.value("traffic_shaping_enabled", true);
+            config_.bandwidth.critical_reserve_kbps = bandwidth.value("critical_reserve_kbps", 128.0f);
+            config_.bandwidth.high_priority_kbps = bandwidth.value("high_priority_kbps", 256.0f);
+            config_.bandwidth.normal_priority_kbps = bandwidth.value("normal_priority_kbps", 512.0f);
+            config_.bandwidth.low_priority_kbps = bandwidth.value("low_priority_kbps", 768.0f);
+            config_.bandwidth.background_kbps = bandwidth.value("background_kbps", 128.0f);
+            config_.bandwidth.shaper_burst_ms = bandwidth.value("shaper_burst_ms", 50);
+            config_.bandwidth.shaper_queue_packets = bandwidth.value("shaper_queue_packets", 256);
         }
 
         // Parse compression config
@@ -95,6 +178,9 @@ bool ConfigManager::LoadFromString(const std::string& json_str) {
             config_.compression.min_size_for_compression = compression.value("min_size_for_compression", 100);
             config_.compression.compression_ratio_threshold = compression.value("compression_ratio_threshold", 0.8f);
             config_.compression.enable_metrics = compression.value("enable_metrics", true);
+            config_.compression.dictionary_path = compression.value("dictionary_path", "");
+            config_.compression.adaptive_interval_ms = compression.value("adaptive_interval_ms", 2000);
+            config_.compression.cpu_budget_percent = compression.value("cpu_budget_percent", 5.0f);
         }
 
             // Parse security config
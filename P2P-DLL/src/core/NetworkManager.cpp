@@ -6,12 +6,14 @@
 #include "../../include/SignalingClient.h"
 #include "../../include/WebRTCManager.h"
 #include "../../include/PacketRouter.h"
+#include "../../include/PacketTable.h"
 #include "../../include/NetworkHooks.h"
 #include "../../include/SecurityManager.h"
 #include "../../include/BandwidthManager.h"
 #include "../../include/CompressionManager.h"
 #include "../../include/QuicTransport.h"
 #include <nlohmann/json.hpp>
+#include <algorithm>
 #include <ctime>
 
 namespace P2P {
@@ -115,6 +117,23 @@ bool NetworkManager::Initialize(const std::string& peer_id) {
         return false;
     }
 
+    // Trickle ICE: SDP and each candidate go out through signaling as soon as they exist
+    impl_->webrtc_manager->SetSignalingCallbacks(
+        [this](const std::string& remote_peer_id, const std::string& type, const std::string& sdp) {
+            nlohmann::json message = {{"type", type}, {"peer_id", remote_peer_id}, {"sdp", sdp}};
+            SendSignalingMessage(message.dump());
+        },
+        [this](const std::string& remote_peer_id, const std::string& candidate, const std::string& mid) {
+            nlohmann::json message = {{"type", "ice_candidate"}, {"peer_id", remote_peer_id},
+                                      {"candidate", candidate}, {"mid", mid}};
+            SendSignalingMessage(message.dump());
+        });
+
+    // Apply packet table overrides before anything is routed
+    if (!PacketTable::GetInstance().ApplyOverrides(config.GetP2PConfig().packet_types)) {
+        LOG_WARN("Some packet table overrides were invalid and have been ignored");
+    }
+
     // Initialize PacketRouter
     if (!impl_->packet_router->Initialize(config.GetP2PConfig().enabled)) {
         LOG_ERROR("Failed to initialize PacketRouter");
@@ -122,11 +141,17 @@ bool NetworkManager::Initialize(const std::string& peer_id) {
     }
 
     // Initialize SecurityManager
-    if (!impl_->security_manager->Initialize(config.GetSecurityConfig().encryption_enabled)) {
+    if (!impl_->security_manager->Initialize(config.GetSecurityConfig().encryption_enabled,
+                                             static_cast<size_t>(config.GetP2PConfig().max_peers))) {
         LOG_ERROR("Failed to initialize SecurityManager");
         return false;
     }
 
+    // Each peer connection runs its own ECDHE handshake into its own key slot
+    if (config.GetSecurityConfig().encryption_enabled) {
+        impl_->webrtc_manager->SetSecurityManager(impl_->security_manager.get());
+    }
+
     // Initialize BandwidthManager
     auto bandwidth_config = config.GetBandwidthConfig();
     if (!impl_->bandwidth_manager->Initialize(bandwidth_config)) {
@@ -136,11 +161,17 @@ bool NetworkManager::Initialize(const std::string& peer_id) {
 
     // Initialize CompressionManager
     auto compression_config = config.GetCompressionConfig();
-    if (!impl_->compression_manager->Initialize(compression_config)) {
+    if (!impl_->compression_manager->Initialize(
+            compression_config, static_cast<size_t>(std::max(config.GetP2PConfig().max_packet_size_bytes, 0)))) {
         LOG_ERROR("Failed to initialize CompressionManager");
         return false;
     }
 
+    // Adaptive compression weighs output bytes against the bitrate still available
+    impl_->compression_manager->SetLinkEstimator([bandwidth = impl_->bandwidth_manager]() {
+        return bandwidth->GetAvailableBitrateKbps();
+    });
+
     // Initialize NetworkHooks
     impl_->network_hooks = std::make_shared<NetworkHooks>();
     if (!impl_->network_hooks->Initialize()) {
@@ -154,6 +185,15 @@ bool NetworkManager::Initialize(const std::string& peer_id) {
     // Set bandwidth manager for packet router
     impl_->packet_router->SetBandwidthManager(impl_->bandwidth_manager.get());
 
+    // P2P packets fan out to WebRTC peers through per-peer send queues
+    impl_->webrtc_manager->ConfigureSendWorkers(config.GetPerformanceConfig());
+    impl_->webrtc_manager->ConfigureDataChannels(config.GetP2PConfig());
+    impl_->packet_router->SetWebRTCManager(impl_->webrtc_manager.get());
+    impl_->packet_router->ConfigureInterest(config.GetP2PConfig());
+
+    // Coalesce small P2P packets per PerformanceConfig
+    impl_->packet_router->ConfigureBatching(config.GetPerformanceConfig());
+
     // Set compression manager for security manager (shared ownership)
     impl_->security_manager->SetCompressionManager(impl_->compression_manager);
 
@@ -402,22 +442,12 @@ bool NetworkManager::SendPacket(const Packet& packet) {
         return false;
     }
 
-    auto decision = impl_->packet_router->DecideRoute(packet);
-    LOG_DEBUG("SendPacket: packet_id=" + std::to_string(packet.packet_id) +
-              " type=0x" + std::to_string(packet.type) +
-              " length=" + std::to_string(packet.length) +
-              " decision=" + std::to_string(static_cast<int>(decision)));
-
-    // Log bandwidth metrics for performance monitoring
-    if (impl_->bandwidth_manager) {
-        const auto& metrics = impl_->bandwidth_manager->GetOverallMetrics();
-        LOG_INFO("Bandwidth: sent=" + std::to_string(metrics.bytes_sent) +
-                 "B, recv=" + std::to_string(metrics.bytes_received) +
-                 "B, loss=" + std::to_string(metrics.packet_loss_percent) +
-                 "%, avg_latency=" + std::to_string(metrics.average_latency_ms) + "ms");
-    }
+    PacketView view = PacketView::FromPacket(packet);
+    auto decision = impl_->packet_router->DecideRoute(view);
+    LOG_DEBUG_FMT("SendPacket: packet_id={} type=0x{:04X} length={} decision={}",
+                  packet.packet_id, packet.type, packet.length, static_cast<int>(decision));
 
-    return impl_->packet_router->RoutePacket(packet, decision);
+    return impl_->packet_router->RoutePacket(view, decision);
 }
 
 void NetworkManager::HandleSignalingMessage(const std::string& message) {
@@ -441,6 +471,12 @@ void NetworkManager::HandleSignalingMessage(const std::string& message) {
                 LOG_INFO("No host_id assigned in session (single server or legacy coordinator)");
             }
 
+            // Dictionary the coordinator agreed for the session (0 or absent = none)
+            if (impl_->compression_manager) {
+                impl_->compression_manager->SetNegotiatedDictionary(
+                    json_msg.value("compression_dictionary", static_cast<uint32_t>(0)));
+            }
+
             // Handle WebRTC offer/answer exchange
             if (json_msg.contains("offer")) {
                 // Process WebRTC offer from coordinator
@@ -455,15 +491,49 @@ void NetworkManager::HandleSignalingMessage(const std::string& message) {
             std::string peer_id = json_msg.value("peer_id", "");
             LOG_INFO("Peer joined: " + peer_id);
 
+            // Exactly one side offers: the lower peer ID; the other answers
+            // when the offer arrives
+            if (!impl_->peer_id.empty() && impl_->peer_id < peer_id && impl_->webrtc_manager) {
+                impl_->webrtc_manager->CreateOffer(peer_id);
+            }
+
         } else if (msg_type == "peer_left") {
             // Peer left the session
             std::string peer_id = json_msg.value("peer_id", "");
             LOG_INFO("Peer left: " + peer_id);
 
+        } else if (msg_type == "party_members" || msg_type == "guild_members") {
+            // The coordinator resolves the party/guild roster to peer IDs; an
+            // empty list sends that group's packets back through the server
+            auto members = json_msg.value("peer_ids", std::vector<std::string>{});
+            LOG_INFO_FMT("{} members updated: {} peer(s)", msg_type == "party_members" ? "Party" : "Guild",
+                         members.size());
+            if (impl_->packet_router) {
+                if (msg_type == "party_members") {
+                    impl_->packet_router->SetPartyMembers(std::move(members));
+                } else {
+                    impl_->packet_router->SetGuildMembers(std::move(members));
+                }
+            }
+
+        } else if (msg_type == "offer") {
+            // Offer from another client; the sender is named in the message
+            if (impl_->webrtc_manager) {
+                impl_->webrtc_manager->ProcessOffer(json_msg.value("sdp", ""), json_msg.value("peer_id", ""));
+            }
+
+        } else if (msg_type == "answer") {
+            // Answer to an offer we sent
+            if (impl_->webrtc_manager) {
+                impl_->webrtc_manager->ProcessAnswer(json_msg.value("peer_id", ""), json_msg.value("sdp", ""));
+            }
+
         } else if (msg_type == "ice_candidate") {
-            // ICE candidate from another client
+            // Trickled ICE candidate from another client
             if (impl_->webrtc_manager) {
-                impl_->webrtc_manager->AddIceCandidate(message);
+                impl_->webrtc_manager->AddIceCandidate(json_msg.value("peer_id", ""),
+                                                       json_msg.value("candidate", ""),
+                                                       json_msg.value("mid", ""));
             }
 
         } else if (msg_type == "error") {
@@ -484,14 +554,19 @@ void NetworkManager::SendSessionRequest() {
     }
 
     try {
+        // Peer traffic is compressed (and sealed) only on the SecurityManager
+        // path, which peer connections use only with encryption enabled
+        bool encryption = impl_->security_manager && impl_->security_manager->IsEncryptionEnabled();
+        bool compression = encryption && impl_->compression_manager && impl_->compression_manager->IsEnabled();
         nlohmann::json session_request = {
             {"type", "create_session"},
             {"peer_id", impl_->peer_id},
             {"zone", impl_->packet_router ? impl_->packet_router->GetCurrentZone() : "unknown"},
             {"capabilities", {
                 {"webrtc", true},
-                {"encryption", true},
-                {"compression", false}
+                {"encryption", encryption},
+                {"compression", compression},
+                {"compression_dictionary", compression ? impl_->compression_manager->GetDictionaryId() : 0u}
             }}
         };
 
@@ -511,4 +586,16 @@ void NetworkManager::SendSessionRequest() {
     }
 }
 
-} // namespace P2P
\ No newline at end of file
+bool NetworkManager::SendSignalingMessage(const std::string& message) {
+    if (!impl_->signaling_client || !impl_->signaling_client->IsConnected()) {
+        LOG_WARN("Cannot send signaling message - not connected to signaling server");
+        return false;
+    }
+    if (!impl_->signaling_client->SendMessage(message)) {
+        LOG_ERROR("Failed to send signaling message");
+        return false;
+    }
+    return true;
+}
+
+} // namespace P2P
@@ -0,0 +1,135 @@
+#include "../../include/FrameSplitter.h"
+#include "../../include/PacketTable.h"
+#include "../../include/Logger.h"
+#include <algorithm>
+
+namespace P2P {
+
+size_t FrameSplitter::FrameLength(const uint8_t* data, size_t available) {
+    if (available < 2) {
+        return NEED_MORE;
+    }
+
+    uint16_t type = static_cast<uint16_t>(data[0]) | (static_cast<uint16_t>(data[1]) << 8);
+    PacketDescriptor descriptor = PacketTable::GetInstance().Lookup(type);
+
+    if (descriptor.IsVariableLength()) {
+        if (available < VARIABLE_HEADER_SIZE) {
+            return NEED_MORE;
+        }
+        size_t length = static_cast<size_t>(data[2]) | (static_cast<size_t>(data[3]) << 8);
+        // A declared length shorter than its own header is corrupt
+        return length < VARIABLE_HEADER_SIZE ? UNKNOWN_LENGTH : length;
+    }
+
+    size_t fixed_length = descriptor.FixedLength();
+    return fixed_length >= 2 ? fixed_length : UNKNOWN_LENGTH;
+}
+
+size_t FrameSplitter::EmitFrames(const uint8_t* data, size_t size, const FrameCallback& on_frame, size_t& frames) {
+    size_t offset = 0;
+    while (offset < size) {
+        size_t remaining = size - offset;
+        size_t length = FrameLength(data + offset, remaining);
+        if (length == UNKNOWN_LENGTH) {
+            // Can't find the next boundary: hand over everything that is left
+            on_frame(PacketView(data + offset, remaining));
+            ++frames;
+            return size;
+        }
+        if (length == NEED_MORE || length > remaining) {
+            break;
+        }
+        on_frame(PacketView(data + offset, length));
+        ++frames;
+        offset += length;
+    }
+    return offset;
+}
+
+size_t FrameSplitter::Split(const uint8_t* data, size_t size, const FrameCallback& on_frame) {
+    size_t frames = 0;
+    size_t consumed = EmitFrames(data, size, on_frame, frames);
+    if (consumed < size) {
+        on_frame(PacketView(data + consumed, size - consumed));
+        ++frames;
+    }
+    return frames;
+}
+
+size_t FrameSplitter::Feed(uint64_t stream_id, const uint8_t* data, size_t size, const FrameCallback& on_frame) {
+    size_t frames = 0;
+
+    // Take the stream's pending bytes out of the map so callbacks run unlocked
+    std::vector<uint8_t> pending;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = pending_.find(stream_id);
+        if (it != pending_.end()) {
+            pending = std::move(it->second);
+            pending_.erase(it);
+        }
+    }
+
+    // Finish the frame that straddled the previous chunk
+    while (!pending.empty() && size > 0) {
+        size_t needed = FrameLength(pending.data(), pending.size());
+        if (needed == UNKNOWN_LENGTH) {
+            pending.insert(pending.end(), data, data + size);
+            on_frame(PacketView(pending.data(), pending.size()));
+            ++frames;
+            pending.clear();
+            size = 0;
+            break;
+        }
+
+        size_t target = needed != NEED_MORE ? needed
+                      : (pending.size() < 2 ? 2 : VARIABLE_HEADER_SIZE);
+        size_t take = std::min(target - pending.size(), size);
+        pending.insert(pending.end(), data, data + take);
+        data += take;
+        size -= take;
+
+        if (needed != NEED_MORE && pending.size() == needed) {
+            on_frame(PacketView(pending.data(), pending.size()));
+            ++frames;
+            pending.clear();
+        }
+    }
+
+    if (pending.empty() && size > 0) {
+        size_t consumed = EmitFrames(data, size, on_frame, frames);
+        if (consumed < size) {
+            pending.assign(data + consumed, data + size);
+        }
+    }
+
+    if (!pending.empty()) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (pending_.size() >= MAX_PENDING_STREAMS) {
+            LOG_WARN_FMT("FrameSplitter: {} streams with partial frames, dropping pending data", pending_.size());
+            pending_.clear();
+        }
+        pending_[stream_id] = std::move(pending);
+    }
+
+    return frames;
+}
+
+void FrameSplitter::Reset(uint64_t stream_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.erase(stream_id);
+}
+
+void FrameSplitter::Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.clear();
+}
+
+size_t FrameSplitter::GetPendingSize(uint64_t stream_id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = pending_.find(stream_id);
+    return it != pending_.end() ? it->second.size() : 0;
+}
+
+} // namespace P2P
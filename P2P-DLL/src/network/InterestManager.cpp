@@ -0,0 +1,105 @@
+#include "../../include/InterestManager.h"
+#include "../../include/PacketTable.h"
+#include "../../include/Logger.h"
+#include <algorithm>
+
+namespace P2P {
+
+namespace {
+
+const std::shared_ptr<const InterestManager::MemberList>& EmptyMembers() {
+    static const auto empty = std::make_shared<const InterestManager::MemberList>();
+    return empty;
+}
+
+} // namespace
+
+InterestManager::InterestManager()
+    : party_members_(EmptyMembers()), guild_members_(EmptyMembers()) {
+}
+
+InterestManager::~InterestManager() = default;
+
+void InterestManager::Configure(const P2PConfig& config) {
+    float aoi = config.aoi_radius > 0.0f ? config.aoi_radius : DEFAULT_AOI_RADIUS;
+    // Combat never reaches further than movement
+    float combat = std::min(config.combat_radius > 0.0f ? config.combat_radius : DEFAULT_COMBAT_RADIUS, aoi);
+    aoi_radius_.store(aoi, std::memory_order_relaxed);
+    combat_radius_.store(combat, std::memory_order_relaxed);
+    LOG_INFO_FMT("Interest management: AOI radius {}, combat radius {}", aoi, combat);
+}
+
+InterestClass InterestManager::Classify(uint16_t type) {
+    return PacketTable::GetInstance().Lookup(type).Interest();
+}
+
+float InterestManager::GetRadius(InterestClass interest) const {
+    switch (interest) {
+        case InterestClass::AOI:
+            return aoi_radius_.load(std::memory_order_relaxed);
+        case InterestClass::COMBAT:
+            return combat_radius_.load(std::memory_order_relaxed);
+        default:
+            return 0.0f;
+    }
+}
+
+bool InterestManager::SetGroupMembers(InterestClass group, MemberList peer_ids) {
+    std::shared_ptr<const MemberList>* members = nullptr;
+    if (group == InterestClass::PARTY) {
+        members = &party_members_;
+    } else if (group == InterestClass::GUILD) {
+        members = &guild_members_;
+    } else {
+        return false;
+    }
+
+    // Sorted and unique so a peer listed twice is sent to once
+    std::sort(peer_ids.begin(), peer_ids.end());
+    peer_ids.erase(std::unique(peer_ids.begin(), peer_ids.end()), peer_ids.end());
+    LOG_DEBUG_FMT("Interest management: {} {} member(s)",
+                  peer_ids.size(), group == InterestClass::PARTY ? "party" : "guild");
+    std::atomic_store(members, std::shared_ptr<const MemberList>(std::make_shared<MemberList>(std::move(peer_ids))));
+    return true;
+}
+
+std::shared_ptr<const InterestManager::MemberList> InterestManager::GetGroupMembers(InterestClass group) const {
+    if (group == InterestClass::PARTY) {
+        return std::atomic_load(&party_members_);
+    }
+    if (group == InterestClass::GUILD) {
+        return std::atomic_load(&guild_members_);
+    }
+    return EmptyMembers();
+}
+
+bool InterestManager::DecodePosition(const PacketView& packet, float& x, float& y) {
+    if (packet.type != MOVEMENT_PACKET_TYPE || packet.length < MOVEMENT_PACKET_LENGTH) {
+        return false;
+    }
+    const uint8_t* position = packet.data + 2;
+    x = static_cast<float>((position[0] << 2) | (position[1] >> 6));
+    y = static_cast<float>(((position[1] & 0x3F) << 4) | (position[2] >> 4));
+    return true;
+}
+
+const char* InterestManager::GetDestinationKey(InterestClass interest) {
+    switch (interest) {
+        case InterestClass::AOI: return "aoi";
+        case InterestClass::COMBAT: return "combat";
+        case InterestClass::PARTY: return "party";
+        case InterestClass::GUILD: return "guild";
+        case InterestClass::ZONE:
+        default: return "";
+    }
+}
+
+InterestClass InterestManager::FromDestinationKey(const std::string& key) {
+    if (key == "aoi") return InterestClass::AOI;
+    if (key == "combat") return InterestClass::COMBAT;
+    if (key == "party") return InterestClass::PARTY;
+    if (key == "guild") return InterestClass::GUILD;
+    return InterestClass::ZONE;
+}
+
+} // namespace P2P
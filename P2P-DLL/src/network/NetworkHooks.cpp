@@ -4,6 +4,7 @@
 #include <ws2tcpip.h>
 
 #include <detours/detours.h>
+#include <algorithm>
 #include <memory>
 
 namespace P2P {
@@ -12,6 +13,7 @@ namespace P2P {
 int (WINAPI* NetworkHooks::Original_send)(SOCKET, const char*, int, int) = nullptr;
 int (WINAPI* NetworkHooks::Original_sendto)(SOCKET, const char*, int, int, const sockaddr*, int) = nullptr;
 int (WINAPI* NetworkHooks::Original_WSASend)(SOCKET, LPWSABUF, DWORD, LPDWORD, DWORD, LPWSAOVERLAPPED, LPWSAOVERLAPPED_COMPLETION_ROUTINE) = nullptr;
+int (WINAPI* NetworkHooks::Original_closesocket)(SOCKET) = nullptr;
 
 // Singleton instance
 NetworkHooks& NetworkHooks::GetInstance() {
@@ -44,8 +46,9 @@ bool NetworkHooks::Initialize() {
     Original_send = reinterpret_cast<decltype(Original_send)>(GetProcAddress(ws2_32, "send"));
     Original_sendto = reinterpret_cast<decltype(Original_sendto)>(GetProcAddress(ws2_32, "sendto"));
     Original_WSASend = reinterpret_cast<decltype(Original_WSASend)>(GetProcAddress(ws2_32, "WSASend"));
+    Original_closesocket = reinterpret_cast<decltype(Original_closesocket)>(GetProcAddress(ws2_32, "closesocket"));
 
-    if (!Original_send || !Original_sendto || !Original_WSASend) {
+    if (!Original_send || !Original_sendto || !Original_WSASend || !Original_closesocket) {
         LOG_ERROR("Failed to get original function addresses");
         FreeLibrary(ws2_32);
         return false;
@@ -58,6 +61,7 @@ bool NetworkHooks::Initialize() {
     DetourAttach(&(PVOID&)Original_send, Hooked_send);
     DetourAttach(&(PVOID&)Original_sendto, Hooked_sendto);
     DetourAttach(&(PVOID&)Original_WSASend, Hooked_WSASend);
+    DetourAttach(&(PVOID&)Original_closesocket, Hooked_closesocket);
 
     LONG error = DetourTransactionCommit();
     if (error != NO_ERROR) {
@@ -84,9 +88,11 @@ void NetworkHooks::Shutdown() {
     if (Original_send) DetourDetach(&(PVOID&)Original_send, Hooked_send);
     if (Original_sendto) DetourDetach(&(PVOID&)Original_sendto, Hooked_sendto);
     if (Original_WSASend) DetourDetach(&(PVOID&)Original_WSASend, Hooked_WSASend);
+    if (Original_closesocket) DetourDetach(&(PVOID&)Original_closesocket, Hooked_closesocket);
 
     DetourTransactionCommit();
 
+    frame_splitter_.Clear();
     hooks_installed_ = false;
     LOG_INFO("Network hooks removed");
 }
@@ -100,16 +106,22 @@ bool NetworkHooks::IsActive() const {
 }
 
 int WINAPI NetworkHooks::Hooked_send(SOCKET s, const char* buf, int len, int flags) {
-    if (len > 0 && buf) {
-        GetInstance().ProcessOutgoingPacket(buf, len);
+    int result = Original_send(s, buf, len, flags);
+    if (result > 0 && buf) {
+        // Only the accepted prefix is on the wire; the caller resends the rest
+        GetInstance().ProcessOutgoingData(s, buf, result, true);
+    } else if (result == SOCKET_ERROR && WSAGetLastError() != WSAEWOULDBLOCK) {
+        // The connection is gone; drop any partial frame carried over
+        GetInstance().ResetStream(s);
     }
-    return Original_send(s, buf, len, flags);
+    return result;
 }
 
 int WINAPI NetworkHooks::Hooked_sendto(SOCKET s, const char* buf, int len, int flags,
                                       const sockaddr* to, int tolen) {
     if (len > 0 && buf) {
-        GetInstance().ProcessOutgoingPacket(buf, len);
+        // Datagrams are self-contained, so no partial frames are carried over
+        GetInstance().ProcessOutgoingData(s, buf, len, false);
     }
     return Original_sendto(s, buf, len, flags, to, tolen);
 }
@@ -117,57 +129,89 @@ int WINAPI NetworkHooks::Hooked_sendto(SOCKET s, const char* buf, int len, int f
 int WINAPI NetworkHooks::Hooked_WSASend(SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
                                        LPDWORD lpNumberOfBytesSent, DWORD dwFlags,
                                        LPWSAOVERLAPPED lpOverlapped, LPWSAOVERLAPPED_COMPLETION_ROUTINE lpCompletionRoutine) {
-    if (dwBufferCount > 0 && lpBuffers) {
-        for (DWORD i = 0; i < dwBufferCount; ++i) {
-            if (lpBuffers[i].buf && lpBuffers[i].len > 0) {
-                GetInstance().ProcessOutgoingPacket(lpBuffers[i].buf, lpBuffers[i].len);
+    int result = Original_WSASend(s, lpBuffers, dwBufferCount, lpNumberOfBytesSent, dwFlags,
+                                  lpOverlapped, lpCompletionRoutine);
+    int error = result == SOCKET_ERROR ? WSAGetLastError() : 0;
+    if (result == SOCKET_ERROR && error != WSA_IO_PENDING) {
+        if (error != WSAEWOULDBLOCK) {
+            GetInstance().ResetStream(s);
+        }
+        return result;
+    }
+
+    // An overlapped send either completes in full or fails the connection,
+    // so a pending one (or one with no count out-parameter) counts as whole
+    DWORD remaining = MAXDWORD;
+    if (result == 0 && lpNumberOfBytesSent) {
+        remaining = *lpNumberOfBytesSent;
+    }
+    if (lpBuffers) {
+        for (DWORD i = 0; i < dwBufferCount && remaining > 0; ++i) {
+            DWORD length = std::min(lpBuffers[i].len, remaining);
+            if (lpBuffers[i].buf && length > 0) {
+                // Buffers are consecutive stream bytes; a frame may span two of them
+                GetInstance().ProcessOutgoingData(s, lpBuffers[i].buf, static_cast<int>(length), true);
             }
+            remaining -= length;
         }
     }
-    return Original_WSASend(s, lpBuffers, dwBufferCount, lpNumberOfBytesSent, dwFlags,
-                           lpOverlapped, lpCompletionRoutine);
+    if (result == SOCKET_ERROR) {
+        WSASetLastError(error);
+    }
+    return result;
+}
+
+int WINAPI NetworkHooks::Hooked_closesocket(SOCKET s) {
+    // Handles are reused; a new socket must not inherit this one's partial frame
+    GetInstance().ResetStream(s);
+    return Original_closesocket(s);
+}
+
+void NetworkHooks::ResetStream(SOCKET s) {
+    int error = WSAGetLastError();
+    frame_splitter_.Reset(static_cast<uint64_t>(s));
+    WSASetLastError(error);
 }
 
-bool NetworkHooks::ProcessOutgoingPacket(const char* data, int length) {
+bool NetworkHooks::ProcessOutgoingData(SOCKET s, const char* data, int length, bool is_stream) {
     if (!packet_router_) {
         return false;
     }
 
     try {
-        // Parse the packet (RO packets typically have 2-byte header with packet type)
-        if (length >= 2) {
-            Packet packet;
-            packet.type = *reinterpret_cast<const uint16_t*>(data);
-            packet.data.assign(data, data + length);
-            packet.length = length;
-
-            // Let the packet router decide where to send it
-            auto decision = packet_router_->DecideRoute(packet);
-            bool routed = packet_router_->RoutePacket(packet, decision);
-            // Telemetry: log routing event
-            LOG_DEBUG("Telemetry: Outgoing packet routed, type=0x" + std::to_string(packet.type) +
-                      ", length=" + std::to_string(packet.length) +
-                      ", decision=" + std::to_string(static_cast<int>(decision)) +
-                      ", routed=" + (routed ? "true" : "false"));
-            return routed;
+        // Split into individual RO packets; each frame is a view into the
+        // caller's send buffer unless it straddled two send() calls
+        bool all_routed = true;
+        auto on_frame = [this, &all_routed](const PacketView& packet) {
+            all_routed &= ProcessOutgoingPacket(packet);
+        };
+
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+        if (is_stream) {
+            frame_splitter_.Feed(static_cast<uint64_t>(s), bytes, static_cast<size_t>(length), on_frame);
+        } else {
+            FrameSplitter::Split(bytes, static_cast<size_t>(length), on_frame);
         }
+        return all_routed;
     } catch (const std::exception& e) {
-        LOG_ERROR("Error processing outgoing packet: " + std::string(e.what()));
+        LOG_ERROR("Error processing outgoing data: " + std::string(e.what()));
     }
 
     return false;
 }
 
-Packet NetworkHooks::ParsePacket(const char* data, int length) {
-    Packet packet;
-    
-    if (length >= 2) {
-        packet.type = *reinterpret_cast<const uint16_t*>(data);
-        packet.data.assign(data, data + length);
-        packet.length = length;
+bool NetworkHooks::ProcessOutgoingPacket(const PacketView& packet) {
+    if (packet.length < 2) {
+        return false;
     }
-    
-    return packet;
+
+    // Let the packet router decide where to send it
+    auto decision = packet_router_->DecideRoute(packet);
+    bool routed = packet_router_->RoutePacket(packet, decision);
+    // Telemetry: log routing event
+    LOG_DEBUG_FMT("Telemetry: Outgoing packet routed, type=0x{:04X}, length={}, decision={}, routed={}",
+                  packet.type, packet.length, static_cast<int>(decision), routed);
+    return routed;
 }
 
 } // namespace P2P
\ No newline at end of file
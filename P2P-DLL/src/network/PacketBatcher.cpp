@@ -0,0 +1,299 @@
+#include "../../include/PacketBatcher.h"
+#include "../../include/Logger.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace P2P {
+
+namespace {
+
+void WriteUint16(uint8_t* out, size_t value) {
+    out[0] = static_cast<uint8_t>(value & 0xFF);
+    out[1] = static_cast<uint8_t>((value >> 8) & 0xFF);
+}
+
+size_t ReadUint16(const uint8_t* in) {
+    return static_cast<size_t>(in[0]) | (static_cast<size_t>(in[1]) << 8);
+}
+
+} // namespace
+
+// Implementation details
+struct PacketBatcher::Impl {
+    struct Batch {
+        PacketBuffer buffer;
+        size_t count = 0;
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    // A finished batch waiting for on_flush
+    struct Sealed {
+        std::string destination;
+        PacketBuffer buffer;
+    };
+    using SealedList = std::vector<Sealed>;
+
+    std::atomic<bool> enabled{false};
+    size_t max_packets = 0;
+    std::chrono::milliseconds timeout{0};
+    FlushCallback on_flush;
+
+    std::mutex mutex;
+    std::unordered_map<std::string, Batch> batches;
+
+    // Sealed batches reach the transport in ticket order. A ticket is drawn
+    // under mutex, which is then released before waiting for its turn, so
+    // a slow on_flush never holds up threads that are only adding packets.
+    uint64_t next_ticket = 0;  // Guarded by mutex
+    std::mutex flush_mutex;
+    std::condition_variable flush_cv;
+    uint64_t now_serving = 0;  // Guarded by flush_mutex
+
+    // Timeout flusher
+    std::thread flusher_thread;
+    std::condition_variable flusher_cv;
+    bool flusher_running = false;
+
+    void Seal(const std::string& destination, Batch& batch, SealedList& sealed);
+    bool Send(std::unique_lock<std::mutex>& lock, SealedList& sealed);
+    void FlusherLoop();
+};
+
+void PacketBatcher::Impl::Seal(const std::string& destination, Batch& batch, SealedList& sealed) {
+    if (batch.count == 0) {
+        return;
+    }
+
+    if (batch.count == 1) {
+        // No point wrapping a single packet
+        batch.buffer.Consume(BATCH_HEADER_SIZE + ENTRY_HEADER_SIZE);
+    } else {
+        WriteUint16(batch.buffer.Data() + 2, batch.buffer.Size());
+    }
+
+    LOG_TRACE_FMT("Flushing batch: {} packet(s), {} bytes", batch.count, batch.buffer.Size());
+    sealed.push_back({destination, std::move(batch.buffer)});
+    batch.buffer = PacketBuffer();
+    batch.count = 0;
+}
+
+bool PacketBatcher::Impl::Send(std::unique_lock<std::mutex>& lock, SealedList& sealed) {
+    // Always take a ticket, even with nothing sealed: a caller flushing
+    // ahead of an unbatched packet must also wait out batches sealed before
+    // it that another thread is still sending
+    uint64_t ticket = next_ticket++;
+    lock.unlock();
+
+    std::unique_lock<std::mutex> flush_lock(flush_mutex);
+    flush_cv.wait(flush_lock, [&]() { return now_serving == ticket; });
+
+    bool all_sent = true;
+    for (Sealed& batch : sealed) {
+        try {
+            all_sent &= on_flush ? on_flush(batch.destination, batch.buffer) : false;
+        } catch (const std::exception& e) {
+            // Later tickets wait on this one, so it must always be served
+            LOG_ERROR("Batch flush failed: " + std::string(e.what()));
+            all_sent = false;
+        }
+    }
+    sealed.clear();
+
+    now_serving++;
+    flush_lock.unlock();
+    flush_cv.notify_all();
+    return all_sent;
+}
+
+void PacketBatcher::Impl::FlusherLoop() {
+    SealedList sealed;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (flusher_running) {
+        auto now = std::chrono::steady_clock::now();
+        auto next_deadline = now + timeout;
+
+        for (auto& entry : batches) {
+            Batch& batch = entry.second;
+            if (batch.count == 0) {
+                continue;
+            }
+            if (batch.deadline <= now) {
+                Seal(entry.first, batch, sealed);
+            } else {
+                next_deadline = std::min(next_deadline, batch.deadline);
+            }
+        }
+
+        if (!sealed.empty()) {
+            Send(lock, sealed);
+            lock.lock();
+            continue;  // Packets may have been added while we were sending
+        }
+        flusher_cv.wait_until(lock, next_deadline);
+    }
+}
+
+PacketBatcher::PacketBatcher() : impl_(std::make_unique<Impl>()) {
+}
+
+PacketBatcher::~PacketBatcher() {
+    Shutdown();
+}
+
+bool PacketBatcher::Initialize(const PerformanceConfig& config, FlushCallback on_flush) {
+    Shutdown();
+
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    impl_->on_flush = std::move(on_flush);
+    impl_->max_packets = config.packet_batch_size > 0 ? static_cast<size_t>(config.packet_batch_size) : 0;
+    impl_->timeout = std::chrono::milliseconds(std::max(config.packet_batch_timeout_ms, 1));
+    impl_->enabled = config.enable_packet_batching && impl_->max_packets > 1;
+
+    if (impl_->enabled) {
+        impl_->flusher_running = true;
+        impl_->flusher_thread = std::thread(&Impl::FlusherLoop, impl_.get());
+        LOG_INFO_FMT("Packet batching enabled: up to {} packets / {} bytes, {} ms timeout",
+                     impl_->max_packets, MAX_BATCH_BYTES, impl_->timeout.count());
+    } else {
+        LOG_INFO("Packet batching disabled");
+    }
+    return impl_->enabled;
+}
+
+void PacketBatcher::Shutdown() {
+    {
+        Impl::SealedList sealed;
+        std::unique_lock<std::mutex> lock(impl_->mutex);
+        if (!impl_->flusher_running) {
+            return;
+        }
+        for (auto& entry : impl_->batches) {
+            impl_->Seal(entry.first, entry.second, sealed);
+        }
+        impl_->batches.clear();
+        impl_->flusher_running = false;
+        impl_->enabled = false;
+        impl_->Send(lock, sealed);
+    }
+    impl_->flusher_cv.notify_all();
+    if (impl_->flusher_thread.joinable()) {
+        impl_->flusher_thread.join();
+    }
+}
+
+bool PacketBatcher::IsEnabled() const {
+    return impl_->enabled.load(std::memory_order_relaxed);
+}
+
+bool PacketBatcher::Add(const std::string& destination, const PacketView& packet) {
+    size_t entry_size = ENTRY_HEADER_SIZE + packet.length;
+    if (packet.Empty() || BATCH_HEADER_SIZE + entry_size > MAX_BATCH_BYTES) {
+        return false;
+    }
+
+    Impl::SealedList sealed;
+    std::unique_lock<std::mutex> lock(impl_->mutex);
+    if (!impl_->enabled) {
+        return false;
+    }
+
+    Impl::Batch& batch = impl_->batches[destination];
+    if (batch.count > 0 && batch.buffer.Size() + entry_size > MAX_BATCH_BYTES) {
+        impl_->Seal(destination, batch, sealed);
+    }
+
+    if (batch.count == 0) {
+        batch.buffer = PacketBufferPool::GetInstance().Acquire(MAX_BATCH_BYTES + SIGNATURE_TAILROOM);
+        uint8_t* header = batch.buffer.Append(BATCH_HEADER_SIZE);
+        WriteUint16(header, BATCH_PACKET_TYPE);
+        WriteUint16(header + 2, 0);
+        batch.deadline = std::chrono::steady_clock::now() + impl_->timeout;
+    }
+
+    uint8_t* entry = batch.buffer.Append(entry_size);
+    WriteUint16(entry, packet.length);
+    std::memcpy(entry + ENTRY_HEADER_SIZE, packet.data, packet.length);
+    batch.count++;
+
+    if (batch.count >= impl_->max_packets) {
+        impl_->Seal(destination, batch, sealed);
+    }
+    if (!sealed.empty()) {
+        impl_->Send(lock, sealed);
+    }
+    return true;
+}
+
+bool PacketBatcher::Flush(const std::string& destination) {
+    Impl::SealedList sealed;
+    std::unique_lock<std::mutex> lock(impl_->mutex);
+    auto it = impl_->batches.find(destination);
+    if (it != impl_->batches.end()) {
+        impl_->Seal(it->first, it->second, sealed);
+    }
+    return impl_->Send(lock, sealed);
+}
+
+void PacketBatcher::FlushAll() {
+    Impl::SealedList sealed;
+    std::unique_lock<std::mutex> lock(impl_->mutex);
+    for (auto& entry : impl_->batches) {
+        impl_->Seal(entry.first, entry.second, sealed);
+    }
+    impl_->Send(lock, sealed);
+}
+
+bool PacketBatcher::Unbatch(const uint8_t* data, size_t size, const PacketCallback& on_packet) {
+    if (!data || size < 2) {
+        return false;
+    }
+
+    uint16_t type = static_cast<uint16_t>(ReadUint16(data));
+    if (type != BATCH_PACKET_TYPE) {
+        on_packet(PacketView(data, size));
+        return true;
+    }
+
+    if (size < BATCH_HEADER_SIZE) {
+        LOG_WARN("Batch frame too small");
+        return false;
+    }
+    size_t total_length = ReadUint16(data + 2);
+    if (total_length < BATCH_HEADER_SIZE || total_length > size) {
+        LOG_WARN_FMT("Batch frame length invalid: declared={}, actual={}", total_length, size);
+        return false;
+    }
+
+    // Validate every entry before emitting any, so a corrupt batch is all-or-nothing
+    size_t offset = BATCH_HEADER_SIZE;
+    while (offset < total_length) {
+        if (total_length - offset < ENTRY_HEADER_SIZE) {
+            LOG_WARN("Batch entry header truncated");
+            return false;
+        }
+        size_t length = ReadUint16(data + offset);
+        offset += ENTRY_HEADER_SIZE;
+        if (length == 0 || length > total_length - offset) {
+            LOG_WARN_FMT("Batch entry length invalid: {}", length);
+            return false;
+        }
+        offset += length;
+    }
+
+    for (offset = BATCH_HEADER_SIZE; offset < total_length;) {
+        size_t length = ReadUint16(data + offset);
+        offset += ENTRY_HEADER_SIZE;
+        on_packet(PacketView(data + offset, length));
+        offset += length;
+    }
+    return true;
+}
+
+} // namespace P2P
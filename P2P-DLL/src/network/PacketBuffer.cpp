@@ -0,0 +1,116 @@
+#include "../../include/PacketBuffer.h"
+#include <algorithm>
+#include <cstring>
+
+namespace P2P {
+
+// PacketBuffer
+
+PacketBuffer::~PacketBuffer() {
+    if (!storage_.empty()) {
+        PacketBufferPool::GetInstance().Release(std::move(storage_));
+    }
+}
+
+PacketBuffer::PacketBuffer(PacketBuffer&& other) noexcept
+    : storage_(std::move(other.storage_)), offset_(other.offset_), size_(other.size_) {
+    other.storage_.clear();
+    other.offset_ = 0;
+    other.size_ = 0;
+}
+
+PacketBuffer& PacketBuffer::operator=(PacketBuffer&& other) noexcept {
+    if (this != &other) {
+        if (!storage_.empty()) {
+            PacketBufferPool::GetInstance().Release(std::move(storage_));
+        }
+        storage_ = std::move(other.storage_);
+        offset_ = other.offset_;
+        size_ = other.size_;
+        other.storage_.clear();
+        other.offset_ = 0;
+        other.size_ = 0;
+    }
+    return *this;
+}
+
+void PacketBuffer::Assign(const uint8_t* data, size_t size) {
+    size_ = 0;
+    Resize(size);
+    if (size > 0) {
+        std::memcpy(Data(), data, size);
+    }
+}
+
+uint8_t* PacketBuffer::Prepend(size_t size) {
+    if (size > offset_) {
+        return nullptr;
+    }
+    offset_ -= size;
+    size_ += size;
+    return Data();
+}
+
+void PacketBuffer::Consume(size_t size) {
+    size = std::min(size, size_);
+    offset_ += size;
+    size_ -= size;
+}
+
+uint8_t* PacketBuffer::Append(size_t size) {
+    size_t old_size = size_;
+    Resize(size_ + size);
+    return Data() + old_size;
+}
+
+void PacketBuffer::Resize(size_t size) {
+    if (offset_ + size > storage_.size()) {
+        // Out of room: grow geometrically so repeated appends stay amortised
+        storage_.resize(std::max(offset_ + size, storage_.size() * 2));
+    }
+    size_ = size;
+}
+
+// PacketBufferPool
+
+PacketBufferPool& PacketBufferPool::GetInstance() {
+    static PacketBufferPool instance;
+    return instance;
+}
+
+PacketBuffer PacketBufferPool::Acquire(size_t capacity, size_t headroom) {
+    PacketBuffer buffer;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!free_.empty()) {
+            buffer.storage_ = std::move(free_.back());
+            free_.pop_back();
+        }
+    }
+
+    // Only grow storage; reused buffers keep their (already initialised) bytes
+    size_t required = std::max(headroom + capacity, MIN_BUFFER_CAPACITY);
+    if (buffer.storage_.size() < required) {
+        buffer.storage_.resize(required);
+    }
+    buffer.offset_ = headroom;
+    buffer.size_ = 0;
+    return buffer;
+}
+
+void PacketBufferPool::Release(std::vector<uint8_t>&& storage) {
+    if (storage.size() > MAX_POOLED_CAPACITY) {
+        return; // Let oversized one-off buffers go back to the heap
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_.size() < MAX_POOLED_BUFFERS) {
+        free_.push_back(std::move(storage));
+    }
+}
+
+size_t PacketBufferPool::GetFreeCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return free_.size();
+}
+
+} // namespace P2P
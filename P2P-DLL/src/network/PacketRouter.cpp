@@ -1,11 +1,15 @@
 #include "../../include/PacketRouter.h"
+#include "../../include/PacketTable.h"
+#include "../../include/PacketBatcher.h"
+#include "../../include/InterestManager.h"
 #include "../../include/Logger.h"
-#include "../../include/bandwidth/BandwidthManager.h"
+#include "../../include/BandwidthManager.h"
 #include "../../include/WebRTCManager.h"
 #include "../../include/SecurityManager.h"
 #include <thread>
 #include <chrono>
 #include <algorithm>
+#include <atomic>
 #include <winsock2.h>
 #include <ws2tcpip.h>
 #include <windows.h>
@@ -15,26 +19,80 @@
 namespace P2P {
 
 struct PacketRouter::Impl {
-    bool p2p_enabled = false;
+    // Read and written from the game thread, the batcher flusher and the
+    // shaper scheduler
+    std::atomic<bool> p2p_enabled{false};
     std::string current_zone;
     WebRTCManager* webrtc_manager = nullptr;
     BandwidthManager* bandwidth_manager = nullptr;
     SecurityManager* security_manager = nullptr;
-    std::function<bool(const Packet&)> server_send_func;
+    std::function<bool(const PacketView&)> server_send_func;
 
     // New: Active transport (QUIC or WebRTC)
     ITransport* transport = nullptr;
 
     // Statistics
-    uint64_t packets_routed_to_server = 0;
-    uint64_t packets_routed_to_p2p = 0;
-    uint64_t packets_dropped = 0;
+    std::atomic<uint64_t> packets_routed_to_server{0};
+    std::atomic<uint64_t> packets_routed_to_p2p{0};
+    std::atomic<uint64_t> packets_dropped{0};
 
     // Configuration
     bool bandwidth_management_enabled = true;
     bool qos_enabled = true;
+
+    // Picks destination peers per opcode; batches are keyed by interest class
+    InterestManager interest;
+    PacketBatcher batcher;
+
+    enum class SendResult {
+        SENT,
+        FAILED,
+        NO_TRANSPORT
+    };
+
+    /**
+     * Hand one P2P message to the active transport (QUIC/WebRTC, else legacy WebRTCManager)
+     * @param target Interest class selecting the receiving peers. A single-link
+     *               transport has no per-peer fan-out and ignores it.
+     */
+    SendResult SendToTransport(const uint8_t* data, size_t size, InterestClass target);
+
+    /**
+     * Whether a class is a group with no known members, so P2P has no one to send to
+     */
+    bool IsEmptyGroup(InterestClass target) const {
+        return InterestManager::IsGroup(target) && interest.GetGroupMembers(target)->empty();
+    }
+
+    /**
+     * Shaper in effect for P2P packets, or nullptr to send everything at once
+     */
+    TrafficShaper* Shaper() const {
+        return bandwidth_management_enabled && bandwidth_manager ? &bandwidth_manager->GetShaper() : nullptr;
+    }
 };
 
+PacketRouter::Impl::SendResult PacketRouter::Impl::SendToTransport(const uint8_t* data, size_t size,
+                                                                   InterestClass target) {
+    if (transport && transport->IsConnected()) {
+        return transport->SendData(data, size) ? SendResult::SENT : SendResult::FAILED;
+    }
+    // Fallback: Use WebRTCManager if available and connected (legacy)
+    if (!webrtc_manager || !webrtc_manager->IsConnected()) {
+        return SendResult::NO_TRANSPORT;
+    }
+
+    bool sent;
+    if (InterestManager::IsSpatial(target)) {
+        sent = webrtc_manager->SendDataWithinRadius(data, size, interest.GetRadius(target));
+    } else if (InterestManager::IsGroup(target)) {
+        sent = webrtc_manager->SendDataToPeers(data, size, *interest.GetGroupMembers(target));
+    } else {
+        sent = webrtc_manager->SendData(data, size);
+    }
+    return sent ? SendResult::SENT : SendResult::FAILED;
+}
+
 PacketRouter::PacketRouter() : impl_(std::make_unique<Impl>()) {
     LOG_DEBUG("PacketRouter created");
 }
@@ -44,61 +102,66 @@ PacketRouter::~PacketRouter() {
 }
 
 bool PacketRouter::Initialize(bool p2p_enabled) {
-    impl_->p2p_enabled = p2p_enabled;
+    impl_->p2p_enabled.store(p2p_enabled, std::memory_order_relaxed);
     LOG_INFO("PacketRouter initialized with P2P " + std::string(p2p_enabled ? "enabled" : "disabled"));
     return true;
 }
 
 void PacketRouter::Shutdown() {
+    impl_->batcher.Shutdown();
+    // The shaper's scheduler calls back into this router
+    if (impl_->bandwidth_manager) {
+        impl_->bandwidth_manager->GetShaper().Stop();
+    }
     LOG_DEBUG("PacketRouter shutdown");
 }
 
 RouteDecision PacketRouter::DecideRoute(const Packet& packet) {
-    if (!impl_->p2p_enabled) {
+    return DecideRoute(PacketView::FromPacket(packet));
+}
+
+RouteDecision PacketRouter::DecideRoute(const PacketView& packet) {
+    if (!impl_->p2p_enabled.load(std::memory_order_relaxed)) {
         return RouteDecision::SERVER;
     }
 
-    // Critical packets always use best available route
-    if (packet.type <= static_cast<uint16_t>(PacketPriority::CRITICAL)) {
-        return RouteDecision::P2P;
-    }
+    // Route comes from the shared packet table (same source as priority)
+    return PacketTable::GetInstance().Lookup(packet.type).Route();
+}
+
+bool PacketRouter::RoutePacket(const Packet& packet, RouteDecision decision) {
+    return RoutePacket(PacketView::FromPacket(packet), decision);
+}
 
-    // Use P2P for packets that benefit from low latency
-    switch (packet.type) {
-        case 0x0089: // Movement
-        case 0x0090: // Attack
-        case 0x0091: // Skill use
-        case 0x009F: // Item pickup
-            return RouteDecision::P2P;
+bool PacketRouter::RoutePacket(const PacketView& packet, RouteDecision decision) {
+    LOG_DEBUG_FMT("Routing packet: type=0x{:04X} length={} decision={}",
+                  packet.type, packet.length, static_cast<int>(decision));
 
-        default:
-            // For other packets, use server routing
-            return RouteDecision::SERVER;
+    // The local player's moves drive AOI peer selection, whatever their route
+    float x, y;
+    if (impl_->webrtc_manager && InterestManager::DecodePosition(packet, x, y)) {
+        impl_->webrtc_manager->SetLocalPosition(x, y, 0.0f);
     }
-}
 
-bool PacketRouter::RoutePacket(const Packet& packet, RouteDecision decision) {
-    LOG_DEBUG("Routing packet: id=" + std::to_string(packet.packet_id) +
-              " type=0x" + std::to_string(packet.type) +
-              " length=" + std::to_string(packet.length) +
-              " decision=" + std::to_string(static_cast<int>(decision)));
     switch (decision) {
         case RouteDecision::P2P:
-            LOG_INFO("Routing to P2P: packet_id=" + std::to_string(packet.packet_id));
             return RouteToP2P(packet);
         case RouteDecision::SERVER:
-            LOG_INFO("Routing to server: packet_id=" + std::to_string(packet.packet_id));
             return RouteToServer(packet);
         case RouteDecision::BROADCAST:
-            // Broadcast: send to both P2P and server, return true if both succeed
-            LOG_INFO("Broadcast routing: packet_id=" + std::to_string(packet.packet_id));
+            // Broadcast: send to both P2P and server, return true if both succeed.
+            // A group with no known members has no P2P side, and RouteToP2P
+            // would hand it to the server a second time
+            if (impl_->IsEmptyGroup(InterestManager::Classify(packet.type))) {
+                return RouteToServer(packet);
+            }
             return RouteToP2P(packet) & RouteToServer(packet);
         case RouteDecision::DROP:
-            impl_->packets_dropped++;
-            LOG_WARN("Packet dropped: packet_id=" + std::to_string(packet.packet_id));
+            impl_->packets_dropped.fetch_add(1, std::memory_order_relaxed);
+            LOG_WARN_FMT("Packet dropped: type=0x{:04X}", packet.type);
             return true;
         default:
-            LOG_ERROR("Unknown routing decision: packet_id=" + std::to_string(packet.packet_id));
+            LOG_ERROR_FMT("Unknown routing decision: type=0x{:04X}", packet.type);
             return false;
     }
 }
@@ -113,12 +176,12 @@ std::string PacketRouter::GetCurrentZone() const {
 }
 
 void PacketRouter::EnableP2P(bool enabled) {
-    impl_->p2p_enabled = enabled;
+    impl_->p2p_enabled.store(enabled, std::memory_order_relaxed);
     LOG_INFO("P2P routing " + std::string(enabled ? "enabled" : "disabled"));
 }
 
 bool PacketRouter::IsP2PEnabled() const {
-    return impl_->p2p_enabled;
+    return impl_->p2p_enabled.load(std::memory_order_relaxed);
 }
 
 void PacketRouter::SetWebRTCManager(WebRTCManager* webrtc_manager) {
@@ -131,11 +194,21 @@ void PacketRouter::SetTransport(ITransport* transport) {
 }
 
 void PacketRouter::SetBandwidthManager(BandwidthManager* bandwidth_manager) {
+    if (impl_->bandwidth_manager && impl_->bandwidth_manager != bandwidth_manager) {
+        impl_->bandwidth_manager->GetShaper().Stop();
+    }
     impl_->bandwidth_manager = bandwidth_manager;
+
+    // Packets the shaper held back are sent from its scheduler thread
+    if (bandwidth_manager && impl_->bandwidth_management_enabled) {
+        bandwidth_manager->GetShaper().Start([this](PacketPriority, uint32_t tag, PacketBuffer& packet) {
+            SendToP2P(PacketView(packet.Data(), packet.Size()), static_cast<InterestClass>(tag));
+        });
+    }
 }
 
-bool PacketRouter::RouteToServer(const Packet& packet) {
-    if (packet.data.empty() || packet.length == 0) {
+bool PacketRouter::RouteToServer(const PacketView& packet) {
+    if (packet.Empty()) {
         LOG_ERROR("Invalid packet data for server routing");
         return false;
     }
@@ -145,78 +218,168 @@ bool PacketRouter::RouteToServer(const Packet& packet) {
     }
     bool result = impl_->server_send_func(packet);
     if (result) {
-        impl_->packets_routed_to_server++;
-        LOG_DEBUG("Packet routed to server: type=0x" +
-                 std::to_string(packet.type) + ", size=" + std::to_string(packet.length));
+        impl_->packets_routed_to_server.fetch_add(1, std::memory_order_relaxed);
+        LOG_DEBUG_FMT("Packet routed to server: type=0x{:04X}, size={}", packet.type, packet.length);
     } else {
-        LOG_ERROR("Failed to send packet to server: type=0x" + std::to_string(packet.type));
+        LOG_ERROR_FMT("Failed to send packet to server: type=0x{:04X}", packet.type);
     }
     return result;
 }
 
-bool PacketRouter::RouteToP2P(const Packet& packet) {
-    if (packet.data.empty() || packet.length == 0) {
+bool PacketRouter::RouteToP2P(const PacketView& packet) {
+    if (packet.Empty()) {
         LOG_ERROR("Invalid packet data for P2P routing");
         return false;
     }
 
-    // ED25519 signature (outbound)
-    std::vector<uint8_t> signed_packet;
-    std::vector<uint8_t> signature(64, 0);
-    bool signature_ok = false;
+    PacketDescriptor descriptor = PacketTable::GetInstance().Lookup(packet.type);
+    InterestClass target = descriptor.Interest();
+
+    // Nobody to send a group packet to over P2P; the server still delivers it
+    if (impl_->IsEmptyGroup(target)) {
+        LOG_DEBUG_FMT("No {} members known, routing packet to server: type=0x{:04X}",
+                      InterestManager::GetDestinationKey(target), packet.type);
+        return RouteToServer(packet);
+    }
+
+    // Batchable packets are queued per interest class; anything else flushes
+    // every queue first so packets still reach peers in the order the client sent them
+    if (impl_->batcher.IsEnabled()) {
+        if (descriptor.IsBatchable() &&
+            impl_->batcher.Add(InterestManager::GetDestinationKey(target), packet)) {
+            return true;
+        }
+        impl_->batcher.FlushAll();
+    }
+
+    // Shape by priority: CRITICAL is never held up behind lower priorities
+    if (TrafficShaper* shaper = impl_->Shaper()) {
+        switch (shaper->Submit(descriptor.Priority(), packet.data, packet.length, static_cast<uint32_t>(target))) {
+            case TrafficShaper::Verdict::SEND_NOW:
+                break;
+            case TrafficShaper::Verdict::QUEUED:
+                return true;
+            case TrafficShaper::Verdict::DROPPED:
+            default:
+                impl_->packets_dropped.fetch_add(1, std::memory_order_relaxed);
+                LOG_DEBUG_FMT("Packet dropped by traffic shaper: type=0x{:04X}", packet.type);
+                return true;
+        }
+    }
+
+    return SendToP2P(packet, target);
+}
+
+bool PacketRouter::SendToP2P(const PacketView& packet, InterestClass target) {
+    // ED25519 signature (outbound). Unsigned packets go out straight from the
+    // hooked buffer; signed ones take a pooled buffer with room for the signature.
+    PacketBuffer signed_buffer;
+    const uint8_t* send_data = packet.data;
+    size_t send_size = packet.length;
     SecurityManager* sec_mgr = impl_->security_manager;
     if (sec_mgr && sec_mgr->IsSignatureEnabled()) {
-        signature_ok = sec_mgr->SignPacketED25519(packet.data.data(), packet.length, signature);
-        if (signature_ok) {
-            signed_packet.reserve(packet.length + signature.size());
-            signed_packet.insert(signed_packet.end(), packet.data.begin(), packet.data.end());
-            signed_packet.insert(signed_packet.end(), signature.begin(), signature.end());
+        signed_buffer = PacketBufferPool::GetInstance().Acquire(
+            packet.length + SecurityManager::ED25519_SIGNATURE_SIZE);
+        signed_buffer.Assign(packet.data, packet.length);
+        uint8_t* signature = signed_buffer.Append(SecurityManager::ED25519_SIGNATURE_SIZE);
+        if (sec_mgr->SignPacketED25519(packet.data, packet.length, signature)) {
+            send_data = signed_buffer.Data();
+            send_size = signed_buffer.Size();
             LOG_DEBUG("ED25519 signature appended to outbound P2P packet");
         } else {
             LOG_WARN("Failed to generate ED25519 signature for outbound P2P packet, sending unsigned");
-            signed_packet = packet.data;
         }
-    } else {
-        signed_packet = packet.data;
     }
 
-    // Use selected transport (QUIC or WebRTC) for P2P routing
-    if (impl_->transport && impl_->transport->IsConnected()) {
-        if (impl_->transport->SendData(signed_packet.data(), signed_packet.size())) {
-            impl_->packets_routed_to_p2p++;
-            LOG_DEBUG("Packet routed to P2P via transport: type=0x" +
-                     std::to_string(packet.type) + ", size=" + std::to_string(signed_packet.size()));
+    switch (impl_->SendToTransport(send_data, send_size, target)) {
+        case Impl::SendResult::SENT:
+            impl_->packets_routed_to_p2p.fetch_add(1, std::memory_order_relaxed);
+            if (impl_->bandwidth_manager) {
+                impl_->bandwidth_manager->RecordSend(send_size, BandwidthManager::GetPacketPriority(packet.type));
+            }
+            LOG_DEBUG_FMT("Packet routed to P2P: type=0x{:04X}, size={}", packet.type, send_size);
             return true;
-        } else {
-            LOG_ERROR("Failed to send packet via selected transport, falling back to server");
+        case Impl::SendResult::FAILED:
+            LOG_ERROR("Failed to send packet via P2P transport, falling back to server");
+            return RouteToServer(packet);
+        case Impl::SendResult::NO_TRANSPORT:
+        default:
+            LOG_WARN("No active P2P transport, falling back to server-only mode");
+            impl_->p2p_enabled.store(false, std::memory_order_relaxed);
+            LOG_INFO("Switched to server-only mode due to P2P failure or disconnect");
             return RouteToServer(packet);
+    }
+}
+
+bool PacketRouter::SendBatch(InterestClass target, PacketBuffer& batch) {
+    // One signature covers the whole batch; a bare single packet is signed as usual
+    size_t payload_size = batch.Size();
+    SecurityManager* sec_mgr = impl_->security_manager;
+    if (sec_mgr && sec_mgr->IsSignatureEnabled()) {
+        bool is_batch = PacketView(batch.Data(), payload_size).type == PacketBatcher::BATCH_PACKET_TYPE;
+        uint8_t* signature = batch.Append(SecurityManager::ED25519_SIGNATURE_SIZE);
+        bool signed_ok = is_batch
+            ? sec_mgr->SignBatchED25519(batch.Data(), payload_size, signature)
+            : sec_mgr->SignPacketED25519(batch.Data(), payload_size, signature);
+        if (!signed_ok) {
+            LOG_WARN("Failed to generate ED25519 signature for outbound P2P batch, sending unsigned");
+            batch.Resize(payload_size);
         }
     }
 
-    // Fallback: Use WebRTCManager if available and connected (legacy)
-    if (impl_->webrtc_manager && impl_->webrtc_manager->IsConnected()) {
-        if (impl_->webrtc_manager->SendData(signed_packet.data(), signed_packet.size())) {
-            impl_->packets_routed_to_p2p++;
-            LOG_DEBUG("Packet routed to P2P via WebRTCManager (fallback): type=0x" +
-                     std::to_string(packet.type) + ", size=" + std::to_string(signed_packet.size()));
-            return true;
-        } else {
-            LOG_ERROR("Failed to send packet via WebRTCManager, falling back to server");
-            return RouteToServer(packet);
+    // Batches go out on the batcher's timer rather than through the shaper
+    // queues, but still count against the link at their most urgent priority
+    if (TrafficShaper* shaper = impl_->Shaper()) {
+        shaper->Charge(BandwidthManager::GetMessagePriority(batch.Data(), payload_size), batch.Size());
+    }
+
+    auto result = impl_->SendToTransport(batch.Data(), batch.Size(), target);
+    if (result == Impl::SendResult::SENT) {
+        size_t packets = 0;
+        PacketBatcher::Unbatch(batch.Data(), payload_size, [&packets](const PacketView&) { ++packets; });
+        impl_->packets_routed_to_p2p.fetch_add(packets, std::memory_order_relaxed);
+        if (impl_->bandwidth_manager) {
+            impl_->bandwidth_manager->RecordSend(batch.Size(), BandwidthManager::GetMessagePriority(batch.Data(), payload_size));
         }
+        LOG_DEBUG_FMT("Batch routed to P2P: {} packet(s), size={}", packets, batch.Size());
+        return true;
+    }
+
+    if (result == Impl::SendResult::NO_TRANSPORT) {
+        LOG_WARN("No active P2P transport, falling back to server-only mode");
+        impl_->p2p_enabled.store(false, std::memory_order_relaxed);
+    } else {
+        LOG_ERROR("Failed to send batch via P2P transport, falling back to server");
     }
+    PacketBatcher::Unbatch(batch.Data(), payload_size, [this](const PacketView& packet) {
+        RouteToServer(packet);
+    });
+    return false;
+}
+
+void PacketRouter::ConfigureBatching(const PerformanceConfig& config) {
+    impl_->batcher.Initialize(config, [this](const std::string& destination, PacketBuffer& batch) {
+        return SendBatch(InterestManager::FromDestinationKey(destination), batch);
+    });
+}
+
+void PacketRouter::ConfigureInterest(const P2PConfig& config) {
+    impl_->interest.Configure(config);
+}
+
+void PacketRouter::SetPartyMembers(std::vector<std::string> peer_ids) {
+    impl_->interest.SetGroupMembers(InterestClass::PARTY, std::move(peer_ids));
+}
 
-    LOG_WARN("No active P2P transport, falling back to server-only mode");
-    impl_->p2p_enabled = false;
-    LOG_INFO("Switched to server-only mode due to P2P failure or disconnect");
-    return RouteToServer(packet);
+void PacketRouter::SetGuildMembers(std::vector<std::string> peer_ids) {
+    impl_->interest.SetGroupMembers(InterestClass::GUILD, std::move(peer_ids));
 }
 
 void PacketRouter::SetSecurityManager(SecurityManager* security_manager) {
     impl_->security_manager = security_manager;
 }
 
-void PacketRouter::SetServerSendFunction(std::function<bool(const Packet&)> send_func) {
+void PacketRouter::SetServerSendFunction(std::function<bool(const PacketView&)> send_func) {
     impl_->server_send_func = std::move(send_func);
 }
 
@@ -0,0 +1,188 @@
+#include "../../include/PacketTable.h"
+#include "../../include/Logger.h"
+#include <algorithm>
+#include <cctype>
+#include <memory>
+
+namespace P2P {
+
+namespace {
+
+// Client-to-server opcodes the router does not treat specially. They keep
+// the default route and priority; the table only needs their length so
+// FrameSplitter can find the next packet in a coalesced send(). 0 means
+// variable length (length word in bytes 2-3).
+struct FrameLengthEntry {
+    uint16_t type;
+    uint16_t length;
+};
+
+constexpr FrameLengthEntry CLIENT_FRAME_LENGTHS[] = {
+    {0x0064, 55}, {0x0065, 17}, {0x0066, 3},  {0x0067, 37}, {0x0068, 46}, // Login and character select
+    {0x0072, 19}, {0x007D, 2},  {0x007E, 6},  {0x0094, 6},                // Map entry, name request
+    {0x0096, 0},  {0x0099, 0},  {0x009B, 5},  {0x00A9, 6},  {0x00AB, 4},  // Whisper, broadcast, direction, equip
+    {0x00B2, 3},  {0x00B8, 7},  {0x00B9, 6},  {0x00BB, 5},  {0x00BF, 3},  // Restart, NPC dialog, stats, emotion
+    {0x00C5, 7},  {0x00C8, 0},  {0x00C9, 0},                              // NPC shops
+    {0x00E4, 6},  {0x00E6, 3},  {0x00E8, 8},  {0x00EB, 2},  {0x00ED, 2},  {0x00EF, 2}, // Trade
+    {0x00F3, 8},  {0x00F5, 8},  {0x00F7, 2},                              // Storage
+    {0x00F9, 26}, {0x00FC, 6},  {0x00FF, 10}, {0x0100, 2},  {0x0102, 6},  {0x0103, 30}, // Party management
+    {0x0112, 4},  {0x0113, 10}, {0x0116, 10}, {0x0118, 2},  {0x011B, 20}, // Skills
+    {0x0126, 8},  {0x0127, 8},  {0x0128, 8},  {0x0129, 8},  {0x012A, 2},  // Cart
+    {0x012E, 2},  {0x012F, 0},  {0x0130, 6},  {0x0134, 0},                // Vending
+    {0x0143, 10}, {0x0146, 6},                                            // NPC input
+    {0x014F, 6},  {0x0165, 30}, {0x0168, 14}, {0x016B, 10}, {0x017C, 6},  // Guild management, card insertion
+    {0x0178, 4},  {0x017A, 4},  {0x018A, 4},  {0x0190, 90}, {0x0193, 6},  // Identify, logout, ground skill
+    {0x01A9, 6},  {0x01B2, 0},                                            // Pet emotion, vending (with title)
+};
+
+// Built at run time (once, on first use): evaluating all 64K entries as a
+// constant expression can exceed MSVC's constexpr step limit
+std::unique_ptr<PacketTable::Table> BuildDefaultTable() {
+    // Zero is the default descriptor, so only known opcodes need filling in.
+    // Lengths follow the classic client packet_db.
+    auto owned = std::make_unique<PacketTable::Table>();
+    PacketTable::Table& table = *owned;
+    for (const FrameLengthEntry& entry : CLIENT_FRAME_LENGTHS) {
+        table[entry.type] = PacketDescriptor::Make(RouteDecision::SERVER, PacketPriority::LOW, entry.length,
+                                                   false, entry.length == 0);
+    }
+    // Opcodes the router routes or prioritises
+    table[0x0085] = PacketDescriptor::Make(RouteDecision::P2P, PacketPriority::CRITICAL, 5, true, false, InterestClass::AOI, true); // Movement (walk request)
+    table[0x0089] = PacketDescriptor::Make(RouteDecision::P2P, PacketPriority::CRITICAL, 7, false, false, InterestClass::COMBAT); // Action (attack, sit, stand)
+    table[0x0090] = PacketDescriptor::Make(RouteDecision::P2P, PacketPriority::CRITICAL, 7, false, false, InterestClass::COMBAT); // Attack
+    table[0x0091] = PacketDescriptor::Make(RouteDecision::P2P, PacketPriority::HIGH, 22, false, false, InterestClass::COMBAT);    // Skill use
+    table[0x00A2] = PacketDescriptor::Make(RouteDecision::P2P, PacketPriority::HIGH, 6, false, false, InterestClass::COMBAT);     // Skill use (alt)
+    table[0x009F] = PacketDescriptor::Make(RouteDecision::P2P, PacketPriority::CRITICAL, 6, false, false, InterestClass::AOI);   // Item pickup
+    table[0x008C] = PacketDescriptor::Make(RouteDecision::SERVER, PacketPriority::HIGH, 0, true, true, InterestClass::AOI);      // Chat
+    table[0x00A7] = PacketDescriptor::Make(RouteDecision::SERVER, PacketPriority::NORMAL, 8, true, false, InterestClass::AOI);   // Emotion
+    table[0x00B0] = PacketDescriptor::Make(RouteDecision::SERVER, PacketPriority::NORMAL, 8, true, false, InterestClass::PARTY); // Party info
+    table[0x0108] = PacketDescriptor::Make(RouteDecision::SERVER, PacketPriority::HIGH, 0, true, true, InterestClass::PARTY);    // Party chat
+    table[0x017E] = PacketDescriptor::Make(RouteDecision::SERVER, PacketPriority::HIGH, 0, true, true, InterestClass::GUILD);    // Guild chat
+    // Internal P2P frames; never routed from the client
+    table[0xFF01] = PacketDescriptor::Make(RouteDecision::DROP, PacketPriority::CRITICAL, 0, false, true); // Batch
+    return owned;
+}
+
+const PacketTable::Table& DefaultTable() {
+    static const std::unique_ptr<const PacketTable::Table> table = BuildDefaultTable();
+    return *table;
+}
+
+std::string ToLower(std::string value) {
+    std::transform(value.begin(), value.end(), value.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return value;
+}
+
+bool ParseRoute(const std::string& name, RouteDecision& route) {
+    std::string value = ToLower(name);
+    if (value == "p2p") route = RouteDecision::P2P;
+    else if (value == "server") route = RouteDecision::SERVER;
+    else if (value == "broadcast") route = RouteDecision::BROADCAST;
+    else if (value == "drop") route = RouteDecision::DROP;
+    else return false;
+    return true;
+}
+
+bool ParsePriority(const std::string& name, PacketPriority& priority) {
+    std::string value = ToLower(name);
+    if (value == "critical") priority = PacketPriority::CRITICAL;
+    else if (value == "high") priority = PacketPriority::HIGH;
+    else if (value == "normal") priority = PacketPriority::NORMAL;
+    else if (value == "low") priority = PacketPriority::LOW;
+    else if (value == "background") priority = PacketPriority::BACKGROUND;
+    else return false;
+    return true;
+}
+
+bool ParseInterest(const std::string& name, InterestClass& interest) {
+    std::string value = ToLower(name);
+    if (value == "zone") interest = InterestClass::ZONE;
+    else if (value == "aoi") interest = InterestClass::AOI;
+    else if (value == "combat") interest = InterestClass::COMBAT;
+    else if (value == "party") interest = InterestClass::PARTY;
+    else if (value == "guild") interest = InterestClass::GUILD;
+    else return false;
+    return true;
+}
+
+} // namespace
+
+PacketTable& PacketTable::GetInstance() {
+    static PacketTable instance;
+    return instance;
+}
+
+PacketTable::PacketTable() : active_(&DefaultTable()) {
+}
+
+const PacketTable::Table& PacketTable::GetDefaultTable() {
+    return DefaultTable();
+}
+
+bool PacketTable::ApplyOverrides(const std::vector<PacketTypeOverride>& overrides) {
+    if (overrides.empty()) {
+        Reset();
+        return true;
+    }
+
+    auto table = std::make_unique<Table>(DefaultTable());
+    bool all_valid = true;
+
+    for (const auto& entry : overrides) {
+        PacketDescriptor current = (*table)[entry.type];
+        RouteDecision route = current.Route();
+        PacketPriority priority = current.Priority();
+        uint16_t fixed_length = current.FixedLength();
+        bool batchable = current.IsBatchable();
+        bool variable_length = current.IsVariableLength();
+        bool unreliable = current.IsUnreliable();
+        InterestClass interest = current.Interest();
+
+        if (!entry.route.empty() && !ParseRoute(entry.route, route)) {
+            LOG_WARN_FMT("Packet table: invalid route '{}' for type 0x{:04X}", entry.route, entry.type);
+            all_valid = false;
+            continue;
+        }
+        if (!entry.priority.empty() && !ParsePriority(entry.priority, priority)) {
+            LOG_WARN_FMT("Packet table: invalid priority '{}' for type 0x{:04X}", entry.priority, entry.type);
+            all_valid = false;
+            continue;
+        }
+        if (!entry.interest.empty() && !ParseInterest(entry.interest, interest)) {
+            LOG_WARN_FMT("Packet table: invalid interest '{}' for type 0x{:04X}", entry.interest, entry.type);
+            all_valid = false;
+            continue;
+        }
+        if (entry.fixed_length > 0xFFFF) {
+            LOG_WARN_FMT("Packet table: invalid length {} for type 0x{:04X}", entry.fixed_length, entry.type);
+            all_valid = false;
+            continue;
+        }
+        if (entry.fixed_length >= 0) {
+            fixed_length = static_cast<uint16_t>(entry.fixed_length);
+            variable_length = fixed_length == 0;
+        }
+        if (entry.batchable >= 0) {
+            batchable = entry.batchable != 0;
+        }
+        if (entry.unreliable >= 0) {
+            unreliable = entry.unreliable != 0;
+        }
+
+        (*table)[entry.type] = PacketDescriptor::Make(route, priority, fixed_length, batchable,
+                                                            variable_length, interest, unreliable);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    active_.store(table.get(), std::memory_order_release);
+    override_tables_.push_back(std::move(table));
+    LOG_INFO_FMT("Packet table: applied {} override(s)", overrides.size());
+    return all_valid;
+}
+
+void PacketTable::Reset() {
+    active_.store(&DefaultTable(), std::memory_order_release);
+}
+
+} // namespace P2P
@@ -310,7 +310,8 @@ void OverlayRenderer::RenderConnectionMode(IDirect3DDevice9* /* device */) {
     
     // Get metrics
     auto& bw_mgr = net_mgr.GetBandwidthManager();
-    auto metrics = bw_mgr.GetOverallMetrics();
+    auto snapshot = bw_mgr.GetMetricsSnapshot();
+    const auto& metrics = *snapshot;
     
     // Peer count (need to access WebRTCManager through NetworkManager implementation)
     DrawText("Peers: N/A", impl_->overlay_x, y, impl_->color_text);
@@ -354,7 +355,8 @@ void OverlayRenderer::RenderDebugMode(IDirect3DDevice9* /* device */) {
     
     // Get metrics
     auto& bw_mgr = net_mgr.GetBandwidthManager();
-    auto metrics = bw_mgr.GetOverallMetrics();
+    auto snapshot = bw_mgr.GetMetricsSnapshot();
+    const auto& metrics = *snapshot;
     
     // Bytes sent/received
     DrawText("Sent: " + FormatBytes(metrics.bytes_sent), impl_->overlay_x, y, impl_->color_text);
@@ -1,5 +1,8 @@
 #include "../../include/SecurityManager.h"
 #include "../../include/CompressionManager.h"
+#include "../../include/FrameSplitter.h"
+#include "../../include/PacketBatcher.h"
+#include "../../include/PacketBuffer.h"
 #include "../../include/Logger.h"
 #include "../../include/Types.h"
 
@@ -8,40 +11,495 @@
 #include <openssl/err.h>
 #include <openssl/ec.h>
 #include <openssl/kdf.h>
+#include <openssl/x509.h>
 #include <sodium.h>
 #include <cstring>
 #include <vector>
 #include <memory>
 #include <mutex>
 #include <fstream>
+#include <algorithm>
+#include <array>
+#include <atomic>
 
 namespace P2P {
 
+namespace {
+
+// Immutable ED25519 key material. Published as a whole via an atomic
+// shared_ptr so signing and verification never take a lock.
+struct Ed25519Keys {
+    std::array<uint8_t, 64> secret_key{};  // seed + public key
+    std::array<uint8_t, 32> public_key{};
+
+    ~Ed25519Keys() {
+        sodium_memzero(secret_key.data(), secret_key.size());
+    }
+};
+
+// Packets and batches are both signed over a BLAKE2b digest prefixed with
+// their own context tag, so neither kind of signature verifies as the other
+constexpr char PACKET_DIGEST_CONTEXT[] = "P2P-ED25519-PACKET-v1";
+constexpr char BATCH_DIGEST_CONTEXT[] = "P2P-ED25519-BATCH-v1";
+
+template <size_t N>
+void ComputeDigest(const char (&context)[N], const uint8_t* data, size_t size, uint8_t* digest_out) {
+    crypto_generichash_state state;
+    crypto_generichash_init(&state, nullptr, 0, SecurityManager::SIGNATURE_DIGEST_SIZE);
+    crypto_generichash_update(&state, reinterpret_cast<const unsigned char*>(context), N - 1);
+    crypto_generichash_update(&state, data, size);
+    crypto_generichash_final(&state, digest_out, SecurityManager::SIGNATURE_DIGEST_SIZE);
+}
+
+constexpr size_t GCM_IV_SIZE = SecurityManager::ENCRYPTION_HEADROOM;
+constexpr size_t GCM_TAG_SIZE = SecurityManager::ENCRYPTION_TAILROOM;
+static_assert(SecurityManager::PACKET_HEADROOM == GCM_IV_SIZE + CompressionManager::MAX_HEADER_SIZE,
+              "PACKET_HEADROOM must fit the IV and a stored compression header");
+
+// Process-wide key generation counter; lets per-thread contexts tell when
+// they were keyed for a different (older or other manager's) key
+std::atomic<uint64_t> g_aes_key_generation{0};
+
+// AES-256-GCM keys plus nonce state. Immutable apart from the sequence
+// counter, and published via an atomic shared_ptr like Ed25519Keys.
+//
+// An ECDHE-derived key pair has one key per direction, so the two ends
+// never encrypt under the same key and both may count nonces from zero;
+// a frame reflected back to its sender does not authenticate either. The
+// manager-wide random key is only used by its own process, so it uses the
+// same key both ways.
+struct AesKeyState {
+    std::array<uint8_t, 32> send_key{};
+    std::array<uint8_t, 32> receive_key{};
+    uint64_t generation = 0;
+    // Which per-thread context pair this key is scheduled into: 0 for the
+    // manager-wide key, handle + 1 for a peer slot
+    size_t context_index = 0;
+    mutable std::atomic<uint64_t> next_sequence{0};
+
+    ~AesKeyState() {
+        sodium_memzero(send_key.data(), send_key.size());
+        sodium_memzero(receive_key.data(), receive_key.size());
+    }
+
+    // 96-bit nonce: zero (32 bits) || sequence (64 bits), big-endian.
+    // Unique per send key, since each key has exactly one sender.
+    void NextNonce(uint8_t* iv_out) const {
+        uint64_t sequence = next_sequence.fetch_add(1, std::memory_order_relaxed);
+        std::memset(iv_out, 0, 4);
+        for (int i = 0; i < 8; ++i) {
+            iv_out[4 + i] = static_cast<uint8_t>(sequence >> (56 - 8 * i));
+        }
+    }
+};
+
+// Per-thread GCM contexts, one pair per key slot. The key schedule is
+// computed once per key generation; each packet only resets the IV, so a
+// thread fanning out to many peers keeps every peer's schedule warm.
+struct KeyedContext {
+    EVP_CIPHER_CTX* ctx = nullptr;
+    uint64_t generation = 0;
+};
+
+struct ThreadCipherContexts {
+    std::vector<KeyedContext> encrypt;
+    std::vector<KeyedContext> decrypt;
+
+    ~ThreadCipherContexts() {
+        for (KeyedContext& entry : encrypt) {
+            EVP_CIPHER_CTX_free(entry.ctx);
+        }
+        for (KeyedContext& entry : decrypt) {
+            EVP_CIPHER_CTX_free(entry.ctx);
+        }
+    }
+};
+
+EVP_CIPHER_CTX* GetKeyedContext(const AesKeyState& key, bool encrypt) {
+    thread_local ThreadCipherContexts contexts;
+    std::vector<KeyedContext>& table = encrypt ? contexts.encrypt : contexts.decrypt;
+    if (key.context_index >= table.size()) {
+        table.resize(key.context_index + 1);
+    }
+    EVP_CIPHER_CTX*& ctx = table[key.context_index].ctx;
+    uint64_t& generation = table[key.context_index].generation;
+
+    if (!ctx) {
+        ctx = EVP_CIPHER_CTX_new();
+        if (!ctx) {
+            return nullptr;
+        }
+        generation = 0;
+    }
+    if (generation != key.generation) {
+        generation = 0;
+        const uint8_t* raw_key = encrypt ? key.send_key.data() : key.receive_key.data();
+        if (EVP_CipherInit_ex(ctx, EVP_aes_256_gcm(), nullptr, nullptr, nullptr, encrypt ? 1 : 0) != 1 ||
+            EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, GCM_IV_SIZE, nullptr) != 1 ||
+            EVP_CipherInit_ex(ctx, nullptr, nullptr, raw_key, nullptr, encrypt ? 1 : 0) != 1) {
+            return nullptr;
+        }
+        generation = key.generation;
+    }
+    return ctx;
+}
+
+/**
+ * Encrypt with a fresh counter nonce. ciphertext_out may equal plaintext.
+ */
+bool SealGcm(const AesKeyState& key, const uint8_t* plaintext, size_t size,
+             uint8_t* iv_out, uint8_t* ciphertext_out, uint8_t* tag_out) {
+    EVP_CIPHER_CTX* ctx = GetKeyedContext(key, true);
+    if (!ctx) {
+        LOG_ERROR("Failed to prepare encryption context");
+        return false;
+    }
+
+    key.NextNonce(iv_out);
+    int len = 0;
+    int final_len = 0;
+    if (EVP_EncryptInit_ex(ctx, nullptr, nullptr, nullptr, iv_out) != 1 ||
+        EVP_EncryptUpdate(ctx, ciphertext_out, &len, plaintext, static_cast<int>(size)) != 1 ||
+        EVP_EncryptFinal_ex(ctx, ciphertext_out + len, &final_len) != 1 ||
+        EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, GCM_TAG_SIZE, tag_out) != 1) {
+        LOG_ERROR("Encryption failed");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Decrypt and authenticate. plaintext_out may equal ciphertext.
+ */
+bool OpenGcm(const AesKeyState& key, const uint8_t* iv, const uint8_t* ciphertext, size_t size,
+             const uint8_t* tag, uint8_t* plaintext_out) {
+    EVP_CIPHER_CTX* ctx = GetKeyedContext(key, false);
+    if (!ctx) {
+        LOG_ERROR("Failed to prepare decryption context");
+        return false;
+    }
+
+    int len = 0;
+    int final_len = 0;
+    if (EVP_DecryptInit_ex(ctx, nullptr, nullptr, nullptr, iv) != 1 ||
+        EVP_DecryptUpdate(ctx, plaintext_out, &len, ciphertext, static_cast<int>(size)) != 1 ||
+        EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, GCM_TAG_SIZE, const_cast<uint8_t*>(tag)) != 1) {
+        LOG_ERROR("Decryption failed");
+        return false;
+    }
+    // Finalize decryption (this verifies the tag)
+    if (EVP_DecryptFinal_ex(ctx, plaintext_out + len, &final_len) != 1) {
+        LOG_ERROR("Decryption finalization failed - authentication tag mismatch");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Build key state for raw AES-256 send/receive keys, with a fresh nonce space and generation
+ */
+std::shared_ptr<const AesKeyState> MakeAesKey(const uint8_t* send_key, const uint8_t* receive_key,
+                                              size_t context_index) {
+    auto state = std::make_shared<AesKeyState>();
+    std::memcpy(state->send_key.data(), send_key, state->send_key.size());
+    std::memcpy(state->receive_key.data(), receive_key, state->receive_key.size());
+    state->context_index = context_index;
+    state->generation = g_aes_key_generation.fetch_add(1, std::memory_order_relaxed) + 1;
+    return state;
+}
+
+std::string OpenSslError() {
+    return ERR_error_string(ERR_get_error(), nullptr);
+}
+
+/**
+ * Generate a secp256r1 keypair, replacing (and freeing) any existing one
+ */
+bool GenerateEcdhKeypair(EVP_PKEY*& keypair) {
+    if (keypair) {
+        EVP_PKEY_free(keypair);
+        keypair = nullptr;
+    }
+
+    // Create context for key generation
+    EVP_PKEY_CTX* pctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+    if (!pctx) {
+        LOG_ERROR("Failed to create ECDH context: " + OpenSslError());
+        return false;
+    }
+
+    // Initialize key generation
+    if (EVP_PKEY_keygen_init(pctx) <= 0) {
+        LOG_ERROR("Failed to initialize ECDH keygen: " + OpenSslError());
+        EVP_PKEY_CTX_free(pctx);
+        return false;
+    }
+
+    // Set curve to secp256r1 (NIST P-256)
+    if (EVP_PKEY_CTX_set_ec_paramgen_curve_nid(pctx, NID_X9_62_prime256v1) <= 0) {
+        LOG_ERROR("Failed to set EC curve: " + OpenSslError());
+        EVP_PKEY_CTX_free(pctx);
+        return false;
+    }
+
+    // Generate keypair
+    if (EVP_PKEY_keygen(pctx, &keypair) <= 0) {
+        LOG_ERROR("Failed to generate ECDH keypair: " + OpenSslError());
+        EVP_PKEY_CTX_free(pctx);
+        return false;
+    }
+
+    EVP_PKEY_CTX_free(pctx);
+    return true;
+}
+
+/**
+ * Serialize a keypair's public half to DER
+ */
+std::vector<uint8_t> SerializePublicKey(EVP_PKEY* keypair) {
+    if (!keypair) {
+        LOG_ERROR("ECDH keypair not generated");
+        return {};
+    }
+
+    unsigned char* der = nullptr;
+    int der_len = i2d_PUBKEY(keypair, &der);
+    if (der_len <= 0) {
+        LOG_ERROR("Failed to serialize public key: " + OpenSslError());
+        return {};
+    }
+
+    std::vector<uint8_t> pubkey(der, der + der_len);
+    OPENSSL_free(der);
+    return pubkey;
+}
+
+constexpr size_t AES_KEY_BYTES = 32; // AES-256
+
+/**
+ * ECDH with the peer's DER public key, then HKDF-SHA256 down to one
+ * AES-256 key per direction. Both public keys go into the HKDF info in
+ * byte order, so both ends derive the same pair and agree on which half
+ * each of them sends with.
+ */
+bool DeriveAesKeys(EVP_PKEY* keypair, const std::vector<uint8_t>& peer_public_key,
+                   uint8_t* send_key_out, uint8_t* receive_key_out) {
+    if (!keypair) {
+        LOG_ERROR("ECDH keypair not generated");
+        return false;
+    }
+
+    if (peer_public_key.empty()) {
+        LOG_ERROR("Peer public key is empty");
+        return false;
+    }
+
+    std::vector<uint8_t> own_public_key = SerializePublicKey(keypair);
+    if (own_public_key.empty()) {
+        return false;
+    }
+    if (own_public_key == peer_public_key) {
+        LOG_ERROR("Peer public key is our own - rejecting reflected key exchange");
+        return false;
+    }
+    bool own_key_first = own_public_key < peer_public_key;
+    const std::vector<uint8_t>& first_key = own_key_first ? own_public_key : peer_public_key;
+    const std::vector<uint8_t>& second_key = own_key_first ? peer_public_key : own_public_key;
+
+    // Deserialize peer's public key from DER format
+    const unsigned char* der_data = peer_public_key.data();
+    EVP_PKEY* peer_key = d2i_PUBKEY(nullptr, &der_data, static_cast<long>(peer_public_key.size()));
+    if (!peer_key) {
+        LOG_ERROR("Failed to deserialize peer public key: " + OpenSslError());
+        return false;
+    }
+
+    // Create derivation context
+    EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new(keypair, nullptr);
+    if (!ctx) {
+        LOG_ERROR("Failed to create derivation context: " + OpenSslError());
+        EVP_PKEY_free(peer_key);
+        return false;
+    }
+
+    // Derive shared secret
+    std::vector<uint8_t> shared_secret;
+    size_t secret_len = 0;
+    bool derived = EVP_PKEY_derive_init(ctx) > 0 &&
+                   EVP_PKEY_derive_set_peer(ctx, peer_key) > 0 &&
+                   EVP_PKEY_derive(ctx, nullptr, &secret_len) > 0;
+    if (derived) {
+        shared_secret.resize(secret_len);
+        derived = EVP_PKEY_derive(ctx, shared_secret.data(), &secret_len) > 0;
+    }
+    EVP_PKEY_CTX_free(ctx);
+    EVP_PKEY_free(peer_key);
+    if (!derived) {
+        LOG_ERROR("Failed to derive shared secret: " + OpenSslError());
+        return false;
+    }
+
+    // Derive the two AES-256 keys from the shared secret using HKDF-SHA256.
+    // Salt and label for domain separation; the first key encrypts from the
+    // lower public key to the higher one, the second the other way.
+    const unsigned char salt[] = "P2P-ECDHE-Salt-v1";
+    const unsigned char label[] = "P2P-AES256-DirectionalKeys-v2";
+    std::vector<uint8_t> info(label, label + sizeof(label) - 1);
+    info.insert(info.end(), first_key.begin(), first_key.end());
+    info.insert(info.end(), second_key.begin(), second_key.end());
+
+    EVP_PKEY_CTX* kdf_ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_HKDF, nullptr);
+    if (!kdf_ctx) {
+        LOG_ERROR("Failed to create HKDF context: " + OpenSslError());
+        sodium_memzero(shared_secret.data(), shared_secret.size());
+        return false;
+    }
+
+    std::array<uint8_t, 2 * AES_KEY_BYTES> keys;
+    size_t key_len = keys.size();
+    bool expanded = EVP_PKEY_derive_init(kdf_ctx) > 0 &&
+                    EVP_PKEY_CTX_set_hkdf_md(kdf_ctx, EVP_sha256()) > 0 &&
+                    EVP_PKEY_CTX_set1_hkdf_salt(kdf_ctx, salt, sizeof(salt) - 1) > 0 &&
+                    EVP_PKEY_CTX_set1_hkdf_key(kdf_ctx, shared_secret.data(), static_cast<int>(shared_secret.size())) > 0 &&
+                    EVP_PKEY_CTX_add1_hkdf_info(kdf_ctx, info.data(), static_cast<int>(info.size())) > 0 &&
+                    EVP_PKEY_derive(kdf_ctx, keys.data(), &key_len) > 0 &&
+                    key_len == keys.size();
+    EVP_PKEY_CTX_free(kdf_ctx);
+    sodium_memzero(shared_secret.data(), shared_secret.size());
+    if (!expanded) {
+        LOG_ERROR("Failed to derive AES keys: " + OpenSslError());
+        sodium_memzero(keys.data(), keys.size());
+        return false;
+    }
+    const uint8_t* lower_to_higher = keys.data();
+    const uint8_t* higher_to_lower = keys.data() + AES_KEY_BYTES;
+    std::memcpy(send_key_out, own_key_first ? lower_to_higher : higher_to_lower, AES_KEY_BYTES);
+    std::memcpy(receive_key_out, own_key_first ? higher_to_lower : lower_to_higher, AES_KEY_BYTES);
+    sodium_memzero(keys.data(), keys.size());
+    return true;
+}
+
+// One peer's key material. Slots live in a flat array indexed by
+// PeerKeyHandle and are padded to a cache line so handshakes on
+// neighbouring peers do not false-share.
+struct alignas(64) PeerKeySlot {
+    std::shared_ptr<const AesKeyState> aes_key; // Accessed with std::atomic_load/store
+
+    // Handshake state; serialises this peer's handshake only. The keypair
+    // is consumed by the derivation it serves, so the same key pair (and
+    // with it the same nonce space) can never be derived twice; the public
+    // half stays available to send to the peer.
+    mutable std::mutex handshake_mutex;
+    EVP_PKEY* ecdh_keypair = nullptr;
+    std::vector<uint8_t> ecdh_public_key;
+
+    // Owner, guarded by SecurityManager::Impl::peer_keys_mutex
+    std::string peer_id;
+    bool in_use = false;
+
+    ~PeerKeySlot() {
+        EVP_PKEY_free(ecdh_keypair);
+    }
+
+    void Clear() {
+        std::atomic_store(&aes_key, std::shared_ptr<const AesKeyState>());
+        std::lock_guard<std::mutex> lock(handshake_mutex);
+        EVP_PKEY_free(ecdh_keypair);
+        ecdh_keypair = nullptr;
+        ecdh_public_key.clear();
+    }
+};
+
+} // namespace
+
 struct SecurityManager::Impl {
     bool initialized = false;
-    bool encryption_enabled = false;
-    std::vector<uint8_t> encryption_key;
+    std::atomic<bool> encryption_enabled{false};
+    std::shared_ptr<const AesKeyState> aes_key; // Accessed with std::atomic_load/store
     std::shared_ptr<CompressionManager> compression_manager;
 
     // ED25519
     bool signature_enabled = true;
-    std::vector<uint8_t> ed25519_private_key; // 64 bytes (seed + key)
-    std::vector<uint8_t> ed25519_public_key;  // 32 bytes
-    std::mutex ed25519_mutex;
+    std::shared_ptr<const Ed25519Keys> ed25519_keys; // Accessed with std::atomic_load/store
+
+    std::shared_ptr<const Ed25519Keys> GetEd25519Keys() const {
+        return std::atomic_load(&ed25519_keys);
+    }
+
+    template <size_t N>
+    bool SignDigest(const char (&context)[N], const uint8_t* data, size_t size, uint8_t* signature_out) const {
+        auto keys = GetEd25519Keys();
+        if (!signature_enabled || !keys) {
+            LOG_ERROR("ED25519 signature not enabled or key not loaded");
+            return false;
+        }
+        uint8_t digest[SIGNATURE_DIGEST_SIZE];
+        ComputeDigest(context, data, size, digest);
+        if (crypto_sign_detached(signature_out, nullptr, digest, sizeof(digest), keys->secret_key.data()) != 0) {
+            LOG_ERROR("ED25519 signature generation failed");
+            return false;
+        }
+        LOG_TRACE_FMT("ED25519 signature generated ({} bytes signed)", size);
+        return true;
+    }
 
-    // ECDHE Key Exchange
+    template <size_t N>
+    bool VerifyDigest(const char (&context)[N], const uint8_t* data, size_t size, const uint8_t* signature) const {
+        auto keys = GetEd25519Keys();
+        if (!keys) {
+            LOG_ERROR("ED25519 public key not loaded");
+            return false;
+        }
+        uint8_t digest[SIGNATURE_DIGEST_SIZE];
+        ComputeDigest(context, data, size, digest);
+        return crypto_sign_verify_detached(signature, digest, sizeof(digest), keys->public_key.data()) == 0;
+    }
+
+    std::shared_ptr<const AesKeyState> GetAesKey() const {
+        return std::atomic_load(&aes_key);
+    }
+
+    bool InstallAesKey(const uint8_t* send_key, const uint8_t* receive_key);
+
+    // ECDHE Key Exchange (manager-wide key, used by the handle-less API).
+    // Consumed by DeriveSharedKey like a peer slot's keypair.
     EVP_PKEY* ecdh_keypair = nullptr;
-    bool key_derived = false;
+    std::vector<uint8_t> ecdh_public_key;
+    std::atomic<bool> key_derived{false};
     std::mutex ecdhe_mutex;
 
-    static constexpr size_t IV_SIZE = 12;
-    static constexpr size_t TAG_SIZE = 16;
-    static constexpr size_t ED25519_SIG_SIZE = 64;
+    // Per-peer keys. The array is sized once in Initialize and never moves,
+    // so the packet path indexes it without taking any lock.
+    std::unique_ptr<PeerKeySlot[]> peer_keys;
+    size_t peer_key_capacity = 0;
+    std::mutex peer_keys_mutex; // Slot allocation only
+
+    PeerKeySlot* GetPeerKeySlot(PeerKeyHandle handle) const {
+        return handle < peer_key_capacity ? &peer_keys[handle] : nullptr;
+    }
+
+    // encrypt: whether this key's traffic is sealed. The manager-wide key
+    // follows encryption_enabled; a peer slot is sealed once its key is derived.
+    bool EncryptBuffer(PacketBuffer& buffer, const AesKeyState* key, bool encrypt);
+    bool DecryptBuffer(PacketBuffer& buffer, const AesKeyState* key, bool encrypt);
+
+    static constexpr size_t IV_SIZE = GCM_IV_SIZE;
+    static constexpr size_t TAG_SIZE = GCM_TAG_SIZE;
+    static constexpr size_t ED25519_SIG_SIZE = SecurityManager::ED25519_SIGNATURE_SIZE;
     static constexpr size_t ED25519_PUBKEY_SIZE = 32;
     static constexpr size_t ED25519_PRIVKEY_SIZE = 64;
-    static constexpr size_t AES_KEY_SIZE = 32; // AES-256
+    static constexpr size_t AES_KEY_SIZE = AES_KEY_BYTES;
 };
 
+bool SecurityManager::Impl::InstallAesKey(const uint8_t* send_key, const uint8_t* receive_key) {
+    auto state = MakeAesKey(send_key, receive_key, 0);
+    if (!state) {
+        return false;
+    }
+    std::atomic_store(&aes_key, std::move(state));
+    return true;
+}
+
 SecurityManager::SecurityManager() : impl_(std::make_unique<Impl>()) {
     if (sodium_init() < 0) {
         LOG_ERROR("Failed to initialize libsodium");
@@ -50,20 +508,9 @@ SecurityManager::SecurityManager() : impl_(std::make_unique<Impl>()) {
 
 SecurityManager::~SecurityManager() noexcept {
     try {
-        // Securely wipe ED25519 private key from memory
-        if (!impl_->ed25519_private_key.empty()) {
-            sodium_memzero(impl_->ed25519_private_key.data(),
-                          impl_->ed25519_private_key.size());
-            impl_->ed25519_private_key.clear();
-        }
-        
-        // Securely wipe AES encryption key from memory
-        if (!impl_->encryption_key.empty()) {
-            sodium_memzero(impl_->encryption_key.data(),
-                          impl_->encryption_key.size());
-            impl_->encryption_key.clear();
-        }
-        
+        // ED25519 and AES key material is wiped by Ed25519Keys / AesKeyState
+        // when the last reference drops
+
         // Free ECDH keypair
         if (impl_->ecdh_keypair) {
             EVP_PKEY_free(impl_->ecdh_keypair);
@@ -85,13 +532,31 @@ SecurityManager::~SecurityManager() noexcept {
     }
 }
 
-bool SecurityManager::Initialize(bool encryption_enabled) {
+bool SecurityManager::Initialize(bool encryption_enabled, size_t max_peers) {
     impl_->encryption_enabled = encryption_enabled;
 
+    {
+        // The packet path indexes the table without a lock, so it is
+        // allocated once and never replaced
+        std::lock_guard<std::mutex> lock(impl_->peer_keys_mutex);
+        if (!impl_->peer_keys) {
+            impl_->peer_keys = std::make_unique<PeerKeySlot[]>(max_peers);
+            impl_->peer_key_capacity = max_peers;
+        } else if (impl_->peer_key_capacity != max_peers) {
+            LOG_ERROR_FMT("SecurityManager already initialized with {} peer key slots; cannot resize to {}",
+                          impl_->peer_key_capacity, max_peers);
+            return false;
+        }
+    }
+
     if (encryption_enabled) {
         // Generate random encryption key (32 bytes for AES-256)
-        impl_->encryption_key.resize(32);
-        if (RAND_bytes(reinterpret_cast<unsigned char*>(&impl_->encryption_key[0]), 32) != 1) {
+        std::array<uint8_t, Impl::AES_KEY_SIZE> key;
+        bool generated = RAND_bytes(key.data(), static_cast<int>(key.size())) == 1;
+        // Only this process encrypts and decrypts with it, so one key serves both directions
+        bool installed = generated && impl_->InstallAesKey(key.data(), key.data());
+        sodium_memzero(key.data(), key.size());
+        if (!installed) {
             LOG_ERROR("Failed to generate encryption key");
             return false;
         }
@@ -103,7 +568,15 @@ bool SecurityManager::Initialize(bool encryption_enabled) {
 }
 
 void SecurityManager::Shutdown() {
-    impl_->encryption_key.clear();
+    std::atomic_store(&impl_->aes_key, std::shared_ptr<const AesKeyState>());
+    {
+        std::lock_guard<std::mutex> lock(impl_->peer_keys_mutex);
+        for (size_t i = 0; i < impl_->peer_key_capacity; ++i) {
+            impl_->peer_keys[i].Clear();
+            impl_->peer_keys[i].peer_id.clear();
+            impl_->peer_keys[i].in_use = false;
+        }
+    }
     impl_->initialized = false;
 }
 
@@ -111,230 +584,181 @@ void SecurityManager::SetCompressionManager(std::shared_ptr<CompressionManager>
     impl_->compression_manager = compression_manager;
 }
 
-bool SecurityManager::EncryptPacket(const uint8_t* data, size_t size, std::vector<uint8_t>& encrypted_out) {
-    std::vector<uint8_t> processed_data;
-
-    // Step 1: Compress data if compression is enabled and available
-    if (impl_->compression_manager) {
-        std::vector<uint8_t> temp_data(data, data + size);
-        std::vector<uint8_t> compressed_data = impl_->compression_manager->Compress(temp_data);
-        if (!compressed_data.empty()) {
-            processed_data = std::move(compressed_data);
-            LOG_DEBUG("Compressed packet (" + std::to_string(size) + " -> " +
-                     std::to_string(processed_data.size()) + " bytes)");
-        } else {
-            // Compression failed, use original data
-            processed_data = temp_data;
-            LOG_WARN("Compression failed, using original data");
+bool SecurityManager::Impl::EncryptBuffer(PacketBuffer& buffer, const AesKeyState* key, bool encrypt) {
+    // Step 1: Frame for compression. Compressed frames go into a pooled
+    // buffer; anything not worth compressing gets a stored header in front.
+    if (compression_manager && !buffer.Empty()) {
+        CompressionManager& compressor = *compression_manager;
+        bool compressed_ok = false;
+        if (compressor.ShouldCompress(buffer.Data(), buffer.Size())) {
+            size_t bound = compressor.GetMaxCompressedSize(buffer.Size());
+            // Keep the caller's headroom so its own headers still fit after the IV
+            size_t headroom = std::max(buffer.Headroom(), ENCRYPTION_HEADROOM);
+            PacketBuffer compressed = PacketBufferPool::GetInstance().Acquire(
+                headroom + bound + ENCRYPTION_TAILROOM, headroom);
+            compressed.Resize(bound);
+
+            size_t compressed_size = 0;
+            if (compressor.CompressInto(buffer.Data(), buffer.Size(), compressed.Data(), bound, compressed_size)) {
+                LOG_TRACE_FMT("Compressed packet ({} -> {} bytes)", buffer.Size(), compressed_size);
+                compressed.Resize(compressed_size);
+                buffer = std::move(compressed);
+                compressed_ok = true;
+            }
+        }
+        if (!compressed_ok) {
+            uint8_t header[CompressionManager::MAX_HEADER_SIZE];
+            size_t header_size = CompressionManager::EncodeStoredHeader(buffer.Size(), header);
+            size_t headroom = header_size + (encrypt ? ENCRYPTION_HEADROOM : 0);
+            if (buffer.Headroom() < headroom) {
+                PacketBuffer relocated = PacketBufferPool::GetInstance().Acquire(
+                    PACKET_HEADROOM + buffer.Size() + ENCRYPTION_TAILROOM, PACKET_HEADROOM);
+                relocated.Assign(buffer.Data(), buffer.Size());
+                buffer = std::move(relocated);
+            }
+            std::memcpy(buffer.Prepend(header_size), header, header_size);
         }
-    } else {
-        processed_data.assign(data, data + size);
     }
 
-    // Step 2: Encrypt data if encryption is enabled
-    if (!impl_->encryption_enabled) {
-        encrypted_out = std::move(processed_data);
+    // Step 2: Encrypt in place if encryption is enabled
+    if (!encrypt) {
         return true;
     }
 
-    if (!impl_->initialized || impl_->encryption_key.empty()) {
+    if (!initialized || !key) {
         LOG_ERROR("SecurityManager not initialized or no encryption key");
         return false;
     }
 
-    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
-    if (!ctx) {
-        LOG_ERROR("Failed to create encryption context");
-        return false;
+    if (buffer.Headroom() < ENCRYPTION_HEADROOM) {
+        // Caller did not reserve room for the IV; move the payload once
+        PacketBuffer relocated = PacketBufferPool::GetInstance().Acquire(
+            ENCRYPTION_HEADROOM + buffer.Size() + ENCRYPTION_TAILROOM, ENCRYPTION_HEADROOM);
+        relocated.Assign(buffer.Data(), buffer.Size());
+        buffer = std::move(relocated);
     }
 
-    try {
-        // Generate random IV
-        std::vector<uint8_t> iv(Impl::IV_SIZE);
-        if (RAND_bytes(reinterpret_cast<unsigned char*>(&iv[0]), Impl::IV_SIZE) != 1) {
-            LOG_ERROR("Failed to generate IV");
-            EVP_CIPHER_CTX_free(ctx);
-            return false;
-        }
-
-        // Initialize encryption operation with AES-256-GCM
-        if (EVP_EncryptInit_ex(ctx, EVP_aes_256_gcm(), nullptr, nullptr, nullptr) != 1) {
-            LOG_ERROR("Failed to initialize encryption");
-            EVP_CIPHER_CTX_free(ctx);
-            return false;
-        }
+    // Output: IV + ciphertext + tag. Append first, since it may reallocate.
+    size_t plaintext_size = buffer.Size();
+    buffer.Append(ENCRYPTION_TAILROOM);
+    uint8_t* iv = buffer.Prepend(ENCRYPTION_HEADROOM);
+    uint8_t* payload = iv + ENCRYPTION_HEADROOM;
+    if (!SealGcm(*key, payload, plaintext_size, iv, payload, payload + plaintext_size)) {
+        buffer.Resize(0);
+        return false;
+    }
 
-        // Set IV length
-        if (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, Impl::IV_SIZE, nullptr) != 1) {
-            LOG_ERROR("Failed to set IV length");
-            EVP_CIPHER_CTX_free(ctx);
-            return false;
-        }
+    LOG_TRACE_FMT("Encrypted packet ({} -> {} bytes)", plaintext_size, buffer.Size());
+    return true;
+}
 
-        // Initialize key and IV
-        if (EVP_EncryptInit_ex(ctx, nullptr, nullptr, impl_->encryption_key.data(), iv.data()) != 1) {
-            LOG_ERROR("Failed to set key and IV");
-            EVP_CIPHER_CTX_free(ctx);
+bool SecurityManager::Impl::DecryptBuffer(PacketBuffer& buffer, const AesKeyState* key, bool encrypt) {
+    // Step 1: Decrypt in place if encryption is enabled
+    if (encrypt) {
+        if (!initialized || !key) {
+            LOG_ERROR("SecurityManager not initialized or no encryption key");
             return false;
         }
 
-        // Prepare output buffer: IV + ciphertext + tag
-        encrypted_out.resize(Impl::IV_SIZE + processed_data.size() + Impl::TAG_SIZE);
-
-        // Copy IV to output
-        std::memcpy(encrypted_out.data(), iv.data(), Impl::IV_SIZE);
-
-        // Encrypt data
-        int len = 0;
-        if (EVP_EncryptUpdate(ctx, encrypted_out.data() + Impl::IV_SIZE, &len,
-                             processed_data.data(), static_cast<int>(processed_data.size())) != 1) {
-            LOG_ERROR("Encryption failed");
-            EVP_CIPHER_CTX_free(ctx);
+        size_t size = buffer.Size();
+        if (size < IV_SIZE + TAG_SIZE) {
+            LOG_ERROR("Packet too small for encrypted data");
             return false;
         }
-        int ciphertext_len = len;
 
-        // Finalize encryption
-        if (EVP_EncryptFinal_ex(ctx, encrypted_out.data() + Impl::IV_SIZE + len, &len) != 1) {
-            LOG_ERROR("Encryption finalization failed");
-            EVP_CIPHER_CTX_free(ctx);
-            return false;
-        }
-        ciphertext_len += len;
+        // Extract IV, ciphertext, and tag
+        uint8_t* iv = buffer.Data();
+        uint8_t* ciphertext = iv + IV_SIZE;
+        size_t ciphertext_len = size - IV_SIZE - TAG_SIZE;
+        const uint8_t* tag = ciphertext + ciphertext_len;
 
-        // Get authentication tag
-        if (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, Impl::TAG_SIZE,
-                                 encrypted_out.data() + Impl::IV_SIZE + ciphertext_len) != 1) {
-            LOG_ERROR("Failed to get authentication tag");
-            EVP_CIPHER_CTX_free(ctx);
+        if (!OpenGcm(*key, iv, ciphertext, ciphertext_len, tag, ciphertext)) {
             return false;
         }
-
-        EVP_CIPHER_CTX_free(ctx);
-        LOG_DEBUG("Encrypted packet (" + std::to_string(processed_data.size()) + " -> " +
-                 std::to_string(encrypted_out.size()) + " bytes)");
-        return true;
-
-    } catch (const std::exception& e) {
-        LOG_ERROR("Encryption exception: " + std::string(e.what()));
-        EVP_CIPHER_CTX_free(ctx);
-        return false;
+        buffer.Consume(IV_SIZE);
+        buffer.Resize(ciphertext_len);
+        LOG_TRACE_FMT("Decrypted packet ({} -> {} bytes)", size, ciphertext_len);
     }
-}
-
-bool SecurityManager::DecryptPacket(const uint8_t* data, size_t size, std::vector<uint8_t>& decrypted_out) {
-    // Step 1: Decrypt data if encryption is enabled
-    std::vector<uint8_t> intermediate_data;
 
-    if (impl_->encryption_enabled) {
-        if (!impl_->initialized || impl_->encryption_key.empty()) {
-            LOG_ERROR("SecurityManager not initialized or no encryption key");
+    // Step 2: Unframe. Stored frames just drop their header; compressed ones
+    // are decoded (with the sender's algorithm) into a pooled buffer.
+    if (compression_manager && !buffer.Empty()) {
+        CompressionManager& compressor = *compression_manager;
+        CompressionManager::FrameHeader header;
+        if (!compressor.ParseFrameHeader(buffer.Data(), buffer.Size(), header)) {
+            LOG_ERROR("Invalid compression frame");
             return false;
         }
-
-        if (size < Impl::IV_SIZE + Impl::TAG_SIZE) {
-            LOG_ERROR("Packet too small for encrypted data");
-            return false;
+        if (header.stored) {
+            buffer.Consume(header.header_size);
+            return true;
         }
 
-        EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
-        if (!ctx) {
-            LOG_ERROR("Failed to create decryption context");
+        PacketBuffer decompressed = PacketBufferPool::GetInstance().Acquire(header.original_size);
+        decompressed.Resize(header.original_size);
+        size_t decompressed_size = 0;
+        if (!compressor.DecompressInto(buffer.Data(), buffer.Size(), decompressed.Data(),
+                                       header.original_size, decompressed_size)) {
             return false;
         }
+        LOG_TRACE_FMT("Decompressed packet ({} -> {} bytes)", buffer.Size(), decompressed_size);
+        buffer = std::move(decompressed);
+    }
+    return true;
+}
 
-        try {
-            // Extract IV, ciphertext, and tag
-            const uint8_t* iv = data;
-            const uint8_t* ciphertext = data + Impl::IV_SIZE;
-            const uint8_t* tag = data + size - Impl::TAG_SIZE;
-            size_t ciphertext_len = size - Impl::IV_SIZE - Impl::TAG_SIZE;
-
-            // Initialize decryption operation with AES-256-GCM
-            if (EVP_DecryptInit_ex(ctx, EVP_aes_256_gcm(), nullptr, nullptr, nullptr) != 1) {
-                LOG_ERROR("Failed to initialize decryption");
-                EVP_CIPHER_CTX_free(ctx);
-                return false;
-            }
-
-            // Set IV length
-            if (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, Impl::IV_SIZE, nullptr) != 1) {
-                LOG_ERROR("Failed to set IV length");
-                EVP_CIPHER_CTX_free(ctx);
-                return false;
-            }
-
-            // Initialize key and IV
-            if (EVP_DecryptInit_ex(ctx, nullptr, nullptr, impl_->encryption_key.data(), iv) != 1) {
-                LOG_ERROR("Failed to set key and IV");
-                EVP_CIPHER_CTX_free(ctx);
-                return false;
-            }
-
-            // Prepare output buffer
-            intermediate_data.resize(ciphertext_len);
+bool SecurityManager::EncryptPacket(PacketBuffer& buffer) {
+    auto key = impl_->GetAesKey();
+    return impl_->EncryptBuffer(buffer, key.get(), impl_->encryption_enabled);
+}
 
-            // Decrypt data
-            int len = 0;
-            if (EVP_DecryptUpdate(ctx, intermediate_data.data(), &len, ciphertext, static_cast<int>(ciphertext_len)) != 1) {
-                LOG_ERROR("Decryption failed");
-                EVP_CIPHER_CTX_free(ctx);
-                return false;
-            }
-            int plaintext_len = len;
-
-            // Set expected tag value
-            if (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, Impl::TAG_SIZE,
-                                     const_cast<uint8_t*>(tag)) != 1) {
-                LOG_ERROR("Failed to set authentication tag");
-                EVP_CIPHER_CTX_free(ctx);
-                return false;
-            }
+bool SecurityManager::DecryptPacket(PacketBuffer& buffer) {
+    auto key = impl_->GetAesKey();
+    return impl_->DecryptBuffer(buffer, key.get(), impl_->encryption_enabled);
+}
 
-            // Finalize decryption (this verifies the tag)
-            if (EVP_DecryptFinal_ex(ctx, intermediate_data.data() + len, &len) != 1) {
-                LOG_ERROR("Decryption finalization failed - authentication tag mismatch");
-                EVP_CIPHER_CTX_free(ctx);
-                return false;
-            }
-            plaintext_len += len;
+bool SecurityManager::EncryptPacket(PeerKeyHandle handle, PacketBuffer& buffer) {
+    PeerKeySlot* slot = impl_->GetPeerKeySlot(handle);
+    if (!slot) {
+        LOG_ERROR_FMT("Invalid peer key handle: {}", handle);
+        return false;
+    }
+    // Sealed once this peer has a key; before that only if encryption is
+    // required, in which case the missing key is an error
+    auto key = std::atomic_load(&slot->aes_key);
+    return impl_->EncryptBuffer(buffer, key.get(), key || impl_->encryption_enabled);
+}
 
-            // Resize to actual plaintext size
-            intermediate_data.resize(plaintext_len);
+bool SecurityManager::DecryptPacket(PeerKeyHandle handle, PacketBuffer& buffer) {
+    PeerKeySlot* slot = impl_->GetPeerKeySlot(handle);
+    if (!slot) {
+        LOG_ERROR_FMT("Invalid peer key handle: {}", handle);
+        return false;
+    }
+    auto key = std::atomic_load(&slot->aes_key);
+    return impl_->DecryptBuffer(buffer, key.get(), key || impl_->encryption_enabled);
+}
 
-            EVP_CIPHER_CTX_free(ctx);
-            LOG_DEBUG("Decrypted packet (" + std::to_string(size) + " -> " +
-                     std::to_string(intermediate_data.size()) + " bytes)");
+bool SecurityManager::EncryptPacket(const uint8_t* data, size_t size, std::vector<uint8_t>& encrypted_out) {
+    PacketBuffer buffer = PacketBufferPool::GetInstance().Acquire(
+        PACKET_HEADROOM + size + ENCRYPTION_TAILROOM, PACKET_HEADROOM);
+    buffer.Assign(data, size);
+    if (!EncryptPacket(buffer)) {
+        encrypted_out.clear();
+        return false;
+    }
+    encrypted_out.assign(buffer.Data(), buffer.Data() + buffer.Size());
+    return true;
+}
 
-        } catch (const std::exception& e) {
-            LOG_ERROR("Decryption exception: " + std::string(e.what()));
-            EVP_CIPHER_CTX_free(ctx);
-            return false;
-        }
-    } else {
-        // No encryption, use data as-is
-        intermediate_data.assign(data, data + size);
-    }
-
-    // Step 2: Decompress data if compression is enabled and available
-    if (impl_->compression_manager) {
-        std::vector<uint8_t> decompressed_data = impl_->compression_manager->Decompress(intermediate_data);
-        if (!decompressed_data.empty()) {
-            decrypted_out = std::move(decompressed_data);
-            LOG_DEBUG("Decompressed packet (" + std::to_string(intermediate_data.size()) + " -> " +
-                     std::to_string(decrypted_out.size()) + " bytes)");
-            return true;
-        } else {
-            // Decompression failed, use intermediate data
-            LOG_WARN("Decompression failed, using intermediate data");
-            decrypted_out = std::move(intermediate_data);
-            return true;
-        }
-    } else {
-        // No compression, use intermediate data
-        decrypted_out = std::move(intermediate_data);
-        return true;
+bool SecurityManager::DecryptPacket(const uint8_t* data, size_t size, std::vector<uint8_t>& decrypted_out) {
+    PacketBuffer buffer = PacketBufferPool::GetInstance().Acquire(size);
+    buffer.Assign(data, size);
+    if (!DecryptPacket(buffer)) {
+        return false;
     }
+    decrypted_out.assign(buffer.Data(), buffer.Data() + buffer.Size());
+    return true;
 }
 
 bool SecurityManager::ValidatePacket(const uint8_t* data, size_t size) {
@@ -365,35 +789,28 @@ bool SecurityManager::ValidatePacket(const uint8_t* data, size_t size) {
         // Don't reject, just warn - some custom packets might use higher ranges
     }
 
-    // If packet has length field (bytes 2-3), validate it
-    if (size >= 4) {
-        uint16_t declared_length = static_cast<uint16_t>(data[2]) | (static_cast<uint16_t>(data[3]) << 8);
-
-        // Some packets have variable length with length field
-        if (declared_length > 0 && declared_length != size) {
-            LOG_ERROR("Packet length mismatch: declared=" + std::to_string(declared_length) +
-                     ", actual=" + std::to_string(size));
-            return false;
-        }
+    // Check the length against the packet table. Only variable-length opcodes
+    // carry a length word in bytes 2-3; fixed-length opcodes must match the
+    // table and unknown opcodes can't be checked. A trailing signature is not
+    // part of the frame.
+    size_t frame_size = size;
+    if (IsSignatureEnabled() && size > Impl::ED25519_SIG_SIZE) {
+        frame_size = size - Impl::ED25519_SIG_SIZE;
+    }
+    size_t expected_length = FrameSplitter::FrameLength(data, frame_size);
+    if (expected_length != FrameSplitter::UNKNOWN_LENGTH && expected_length != frame_size) {
+        LOG_ERROR("Packet length mismatch: expected=" + std::to_string(expected_length) +
+                 ", actual=" + std::to_string(frame_size));
+        return false;
     }
 
     // If signature checking is enabled, verify ED25519 signature (last 64 bytes)
-    if (impl_->signature_enabled && size > Impl::ED25519_SIG_SIZE) {
-        size_t payload_size = size - Impl::ED25519_SIG_SIZE;
-        const uint8_t* payload = data;
-        const uint8_t* signature = data + payload_size;
-
-        std::lock_guard<std::mutex> lock(impl_->ed25519_mutex);
-        if (impl_->ed25519_public_key.size() != Impl::ED25519_PUBKEY_SIZE) {
-            LOG_ERROR("ED25519 public key not loaded");
-            return false;
-        }
-        int result = crypto_sign_verify_detached(signature, payload, payload_size, impl_->ed25519_public_key.data());
-        if (result != 0) {
+    if (IsSignatureEnabled() && size > Impl::ED25519_SIG_SIZE) {
+        size_t payload_size = 0;
+        if (!VerifyFrameED25519(data, size, payload_size)) {
             LOG_ERROR("ED25519 signature verification failed");
             return false;
         }
-        LOG_DEBUG("ED25519 signature verified for packet (" + std::to_string(payload_size) + " bytes)");
     }
 
     LOG_DEBUG("Packet validated: type=0x" + std::to_string(packet_type) + ", size=" + std::to_string(size));
@@ -405,25 +822,24 @@ bool SecurityManager::IsEncryptionEnabled() const {
 }
 
 bool SecurityManager::LoadED25519Key(const std::string& key_path) {
-    std::lock_guard<std::mutex> lock(impl_->ed25519_mutex);
     try {
         std::ifstream key_file(key_path, std::ios::binary);
         if (!key_file.is_open()) {
             LOG_ERROR("Failed to open ED25519 key file: " + key_path);
             return false;
         }
-        impl_->ed25519_private_key.resize(Impl::ED25519_PRIVKEY_SIZE);
-        key_file.read(reinterpret_cast<char*>(impl_->ed25519_private_key.data()), Impl::ED25519_PRIVKEY_SIZE);
+        auto keys = std::make_shared<Ed25519Keys>();
+        key_file.read(reinterpret_cast<char*>(keys->secret_key.data()), Impl::ED25519_PRIVKEY_SIZE);
         if (key_file.gcount() != Impl::ED25519_PRIVKEY_SIZE) {
             LOG_ERROR("ED25519 key file size invalid: " + key_path);
             return false;
         }
         // Derive public key from private key
-        impl_->ed25519_public_key.resize(Impl::ED25519_PUBKEY_SIZE);
-        if (crypto_sign_ed25519_sk_to_pk(impl_->ed25519_public_key.data(), impl_->ed25519_private_key.data()) != 0) {
+        if (crypto_sign_ed25519_sk_to_pk(keys->public_key.data(), keys->secret_key.data()) != 0) {
             LOG_ERROR("Failed to derive ED25519 public key from private key");
             return false;
         }
+        std::atomic_store(&impl_->ed25519_keys, std::shared_ptr<const Ed25519Keys>(std::move(keys)));
         LOG_INFO("Loaded ED25519 private key and derived public key from: " + key_path);
         return true;
     } catch (const std::exception& e) {
@@ -433,223 +849,206 @@ bool SecurityManager::LoadED25519Key(const std::string& key_path) {
 }
 
 bool SecurityManager::SignPacketED25519(const uint8_t* data, size_t size, std::vector<uint8_t>& signature_out) {
-    std::lock_guard<std::mutex> lock(impl_->ed25519_mutex);
-    if (!impl_->signature_enabled || impl_->ed25519_private_key.size() != Impl::ED25519_PRIVKEY_SIZE) {
-        LOG_ERROR("ED25519 signature not enabled or key not loaded");
-        return false;
-    }
     signature_out.resize(Impl::ED25519_SIG_SIZE);
-    if (crypto_sign_detached(signature_out.data(), nullptr, data, size, impl_->ed25519_private_key.data()) == 0) {
-        LOG_INFO("ED25519 signature generated for packet (" + std::to_string(size) + " bytes)");
-        return true;
-    } else {
-        LOG_ERROR("ED25519 signature generation failed");
-        return false;
-    }
+    return SignPacketED25519(data, size, signature_out.data());
 }
 
-bool SecurityManager::IsSignatureEnabled() const {
-    return impl_->signature_enabled;
+bool SecurityManager::SignPacketED25519(const uint8_t* data, size_t size, uint8_t* signature_out) {
+    return impl_->SignDigest(PACKET_DIGEST_CONTEXT, data, size, signature_out);
 }
 
-// ECDHE Key Exchange Implementation
+bool SecurityManager::SignBatchED25519(const uint8_t* data, size_t size, uint8_t* signature_out) {
+    return impl_->SignDigest(BATCH_DIGEST_CONTEXT, data, size, signature_out);
+}
 
-bool SecurityManager::GenerateECDHKeypair() {
-    std::lock_guard<std::mutex> lock(impl_->ecdhe_mutex);
-    
-    // Free existing keypair if any
-    if (impl_->ecdh_keypair) {
-        EVP_PKEY_free(impl_->ecdh_keypair);
-        impl_->ecdh_keypair = nullptr;
-    }
+bool SecurityManager::VerifyPacketED25519(const uint8_t* data, size_t size, const uint8_t* signature) {
+    return impl_->VerifyDigest(PACKET_DIGEST_CONTEXT, data, size, signature);
+}
 
-    // Create context for key generation
-    EVP_PKEY_CTX* pctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
-    if (!pctx) {
-        LOG_ERROR("Failed to create ECDH context: " + std::string(ERR_error_string(ERR_get_error(), nullptr)));
-        return false;
-    }
+bool SecurityManager::VerifyBatchED25519(const uint8_t* data, size_t size, const uint8_t* signature) {
+    return impl_->VerifyDigest(BATCH_DIGEST_CONTEXT, data, size, signature);
+}
 
-    // Initialize key generation
-    if (EVP_PKEY_keygen_init(pctx) <= 0) {
-        LOG_ERROR("Failed to initialize ECDH keygen: " + std::string(ERR_error_string(ERR_get_error(), nullptr)));
-        EVP_PKEY_CTX_free(pctx);
+bool SecurityManager::VerifyFrameED25519(const uint8_t* data, size_t size, size_t& payload_size) {
+    if (!data || size < 2 + Impl::ED25519_SIG_SIZE) {
         return false;
     }
+    payload_size = size - Impl::ED25519_SIG_SIZE;
+    const uint8_t* signature = data + payload_size;
+    return PacketView(data, payload_size).type == PacketBatcher::BATCH_PACKET_TYPE
+        ? VerifyBatchED25519(data, payload_size, signature)
+        : VerifyPacketED25519(data, payload_size, signature);
+}
 
-    // Set curve to secp256r1 (NIST P-256)
-    if (EVP_PKEY_CTX_set_ec_paramgen_curve_nid(pctx, NID_X9_62_prime256v1) <= 0) {
-        LOG_ERROR("Failed to set EC curve: " + std::string(ERR_error_string(ERR_get_error(), nullptr)));
-        EVP_PKEY_CTX_free(pctx);
-        return false;
-    }
+bool SecurityManager::IsSignatureEnabled() const {
+    return impl_->signature_enabled && impl_->GetEd25519Keys() != nullptr;
+}
 
-    // Generate keypair
-    if (EVP_PKEY_keygen(pctx, &impl_->ecdh_keypair) <= 0) {
-        LOG_ERROR("Failed to generate ECDH keypair: " + std::string(ERR_error_string(ERR_get_error(), nullptr)));
-        EVP_PKEY_CTX_free(pctx);
+// ECDHE Key Exchange Implementation
+
+bool SecurityManager::GenerateECDHKeypair() {
+    std::lock_guard<std::mutex> lock(impl_->ecdhe_mutex);
+    impl_->ecdh_public_key.clear();
+    if (!GenerateEcdhKeypair(impl_->ecdh_keypair)) {
         return false;
     }
-
-    EVP_PKEY_CTX_free(pctx);
+    impl_->ecdh_public_key = SerializePublicKey(impl_->ecdh_keypair);
     LOG_INFO("Generated ECDHE keypair (secp256r1)");
     return true;
 }
 
 std::vector<uint8_t> SecurityManager::GetPublicKey() const {
     std::lock_guard<std::mutex> lock(impl_->ecdhe_mutex);
-    
-    if (!impl_->ecdh_keypair) {
+    if (impl_->ecdh_public_key.empty()) {
         LOG_ERROR("ECDH keypair not generated");
-        return {};
-    }
-
-    // Serialize public key to DER format
-    unsigned char* der = nullptr;
-    int der_len = i2d_PUBKEY(impl_->ecdh_keypair, &der);
-    
-    if (der_len <= 0) {
-        LOG_ERROR("Failed to serialize public key: " + std::string(ERR_error_string(ERR_get_error(), nullptr)));
-        return {};
     }
-
-    std::vector<uint8_t> pubkey(der, der + der_len);
-    OPENSSL_free(der);
-    
-    LOG_INFO("Serialized public key (" + std::to_string(pubkey.size()) + " bytes)");
-    return pubkey;
+    return impl_->ecdh_public_key;
 }
 
 bool SecurityManager::DeriveSharedKey(const std::vector<uint8_t>& peer_public_key) {
     std::lock_guard<std::mutex> lock(impl_->ecdhe_mutex);
-    
     if (!impl_->ecdh_keypair) {
-        LOG_ERROR("ECDH keypair not generated");
+        LOG_ERROR("No unused ECDHE keypair - generate a new one before deriving");
         return false;
     }
 
-    if (peer_public_key.empty()) {
-        LOG_ERROR("Peer public key is empty");
-        return false;
+    std::array<uint8_t, Impl::AES_KEY_SIZE> send_key;
+    std::array<uint8_t, Impl::AES_KEY_SIZE> receive_key;
+    bool derived = DeriveAesKeys(impl_->ecdh_keypair, peer_public_key, send_key.data(), receive_key.data());
+    if (derived) {
+        // Deriving again from this keypair would restart the nonce counter
+        // under the same keys
+        EVP_PKEY_free(impl_->ecdh_keypair);
+        impl_->ecdh_keypair = nullptr;
     }
 
-    // Deserialize peer's public key from DER format
-    const unsigned char* der_data = peer_public_key.data();
-    EVP_PKEY* peer_key = d2i_PUBKEY(nullptr, &der_data, peer_public_key.size());
-    if (!peer_key) {
-        LOG_ERROR("Failed to deserialize peer public key: " + std::string(ERR_error_string(ERR_get_error(), nullptr)));
+    // New keys, new nonce space and new per-thread key schedules
+    bool installed = derived && impl_->InstallAesKey(send_key.data(), receive_key.data());
+    sodium_memzero(send_key.data(), send_key.size());
+    sodium_memzero(receive_key.data(), receive_key.size());
+    if (!installed) {
         return false;
     }
 
-    // Create derivation context
-    EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new(impl_->ecdh_keypair, nullptr);
-    if (!ctx) {
-        LOG_ERROR("Failed to create derivation context: " + std::string(ERR_error_string(ERR_get_error(), nullptr)));
-        EVP_PKEY_free(peer_key);
-        return false;
-    }
+    impl_->key_derived = true;
 
-    // Initialize key derivation
-    if (EVP_PKEY_derive_init(ctx) <= 0) {
-        LOG_ERROR("Failed to initialize key derivation: " + std::string(ERR_error_string(ERR_get_error(), nullptr)));
-        EVP_PKEY_CTX_free(ctx);
-        EVP_PKEY_free(peer_key);
-        return false;
-    }
+    LOG_INFO("Derived per-direction AES-256 keys from ECDHE shared secret");
+    return true;
+}
 
-    // Set peer key
-    if (EVP_PKEY_derive_set_peer(ctx, peer_key) <= 0) {
-        LOG_ERROR("Failed to set peer key: " + std::string(ERR_error_string(ERR_get_error(), nullptr)));
-        EVP_PKEY_CTX_free(ctx);
-        EVP_PKEY_free(peer_key);
-        return false;
-    }
+bool SecurityManager::IsKeyReady() const {
+    return impl_->GetAesKey() != nullptr && (impl_->key_derived || impl_->initialized);
+}
 
-    // Determine shared secret length
-    size_t secret_len = 0;
-    if (EVP_PKEY_derive(ctx, nullptr, &secret_len) <= 0) {
-        LOG_ERROR("Failed to determine shared secret length: " + std::string(ERR_error_string(ERR_get_error(), nullptr)));
-        EVP_PKEY_CTX_free(ctx);
-        EVP_PKEY_free(peer_key);
-        return false;
-    }
+// Per-peer keys
 
-    // Derive shared secret
-    std::vector<uint8_t> shared_secret(secret_len);
-    if (EVP_PKEY_derive(ctx, shared_secret.data(), &secret_len) <= 0) {
-        LOG_ERROR("Failed to derive shared secret: " + std::string(ERR_error_string(ERR_get_error(), nullptr)));
-        EVP_PKEY_CTX_free(ctx);
-        EVP_PKEY_free(peer_key);
-        return false;
+SecurityManager::PeerKeyHandle SecurityManager::AcquirePeerKey(const std::string& peer_id) {
+    std::lock_guard<std::mutex> lock(impl_->peer_keys_mutex);
+
+    PeerKeyHandle free_handle = INVALID_PEER_KEY;
+    for (size_t i = 0; i < impl_->peer_key_capacity; ++i) {
+        PeerKeySlot& slot = impl_->peer_keys[i];
+        if (slot.in_use && slot.peer_id == peer_id) {
+            return static_cast<PeerKeyHandle>(i);
+        }
+        if (!slot.in_use && free_handle == INVALID_PEER_KEY) {
+            free_handle = static_cast<PeerKeyHandle>(i);
+        }
     }
 
-    EVP_PKEY_CTX_free(ctx);
-    EVP_PKEY_free(peer_key);
+    if (free_handle == INVALID_PEER_KEY) {
+        LOG_ERROR_FMT("No free peer key slot for {} (capacity {})", peer_id, impl_->peer_key_capacity);
+        return INVALID_PEER_KEY;
+    }
 
-    LOG_INFO("Derived shared secret (" + std::to_string(secret_len) + " bytes)");
+    PeerKeySlot& slot = impl_->peer_keys[free_handle];
+    slot.Clear();
+    slot.peer_id = peer_id;
+    slot.in_use = true;
+    LOG_DEBUG_FMT("Peer key slot {} assigned to {}", free_handle, peer_id);
+    return free_handle;
+}
 
-    // Derive AES-256 key from shared secret using HKDF-SHA256
-    // Salt and info for domain separation
-    const unsigned char salt[] = "P2P-ECDHE-Salt-v1";
-    const unsigned char info[] = "P2P-AES256-Key-v1";
+void SecurityManager::ReleasePeerKey(PeerKeyHandle handle) {
+    std::lock_guard<std::mutex> lock(impl_->peer_keys_mutex);
+    PeerKeySlot* slot = impl_->GetPeerKeySlot(handle);
+    if (!slot || !slot->in_use) {
+        return;
+    }
+    slot->Clear();
+    slot->peer_id.clear();
+    slot->in_use = false;
+}
 
-    EVP_PKEY_CTX* kdf_ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_HKDF, nullptr);
-    if (!kdf_ctx) {
-        LOG_ERROR("Failed to create HKDF context: " + std::string(ERR_error_string(ERR_get_error(), nullptr)));
+bool SecurityManager::GenerateECDHKeypair(PeerKeyHandle handle) {
+    PeerKeySlot* slot = impl_->GetPeerKeySlot(handle);
+    if (!slot) {
+        LOG_ERROR_FMT("Invalid peer key handle: {}", handle);
         return false;
     }
 
-    if (EVP_PKEY_derive_init(kdf_ctx) <= 0) {
-        LOG_ERROR("Failed to initialize HKDF: " + std::string(ERR_error_string(ERR_get_error(), nullptr)));
-        EVP_PKEY_CTX_free(kdf_ctx);
+    std::lock_guard<std::mutex> lock(slot->handshake_mutex);
+    slot->ecdh_public_key.clear();
+    if (!GenerateEcdhKeypair(slot->ecdh_keypair)) {
         return false;
     }
+    slot->ecdh_public_key = SerializePublicKey(slot->ecdh_keypair);
+    LOG_DEBUG_FMT("Generated ECDHE keypair (secp256r1) for peer key slot {}", handle);
+    return true;
+}
 
-    if (EVP_PKEY_CTX_set_hkdf_md(kdf_ctx, EVP_sha256()) <= 0) {
-        LOG_ERROR("Failed to set HKDF hash: " + std::string(ERR_error_string(ERR_get_error(), nullptr)));
-        EVP_PKEY_CTX_free(kdf_ctx);
-        return false;
+std::vector<uint8_t> SecurityManager::GetPublicKey(PeerKeyHandle handle) const {
+    PeerKeySlot* slot = impl_->GetPeerKeySlot(handle);
+    if (!slot) {
+        LOG_ERROR_FMT("Invalid peer key handle: {}", handle);
+        return {};
     }
 
-    if (EVP_PKEY_CTX_set1_hkdf_salt(kdf_ctx, salt, sizeof(salt) - 1) <= 0) {
-        LOG_ERROR("Failed to set HKDF salt: " + std::string(ERR_error_string(ERR_get_error(), nullptr)));
-        EVP_PKEY_CTX_free(kdf_ctx);
-        return false;
+    std::lock_guard<std::mutex> lock(slot->handshake_mutex);
+    if (slot->ecdh_public_key.empty()) {
+        LOG_ERROR_FMT("ECDH keypair not generated for peer key slot {}", handle);
     }
+    return slot->ecdh_public_key;
+}
 
-    if (EVP_PKEY_CTX_set1_hkdf_key(kdf_ctx, shared_secret.data(), shared_secret.size()) <= 0) {
-        LOG_ERROR("Failed to set HKDF key: " + std::string(ERR_error_string(ERR_get_error(), nullptr)));
-        EVP_PKEY_CTX_free(kdf_ctx);
+bool SecurityManager::DeriveSharedKey(PeerKeyHandle handle, const std::vector<uint8_t>& peer_public_key) {
+    PeerKeySlot* slot = impl_->GetPeerKeySlot(handle);
+    if (!slot) {
+        LOG_ERROR_FMT("Invalid peer key handle: {}", handle);
         return false;
     }
 
-    if (EVP_PKEY_CTX_add1_hkdf_info(kdf_ctx, info, sizeof(info) - 1) <= 0) {
-        LOG_ERROR("Failed to set HKDF info: " + std::string(ERR_error_string(ERR_get_error(), nullptr)));
-        EVP_PKEY_CTX_free(kdf_ctx);
-        return false;
+    std::array<uint8_t, Impl::AES_KEY_SIZE> send_key;
+    std::array<uint8_t, Impl::AES_KEY_SIZE> receive_key;
+    bool derived;
+    {
+        std::lock_guard<std::mutex> lock(slot->handshake_mutex);
+        if (!slot->ecdh_keypair) {
+            LOG_ERROR_FMT("No unused ECDHE keypair for peer key slot {} - generate a new one before deriving", handle);
+            return false;
+        }
+        derived = DeriveAesKeys(slot->ecdh_keypair, peer_public_key, send_key.data(), receive_key.data());
+        if (derived) {
+            EVP_PKEY_free(slot->ecdh_keypair);
+            slot->ecdh_keypair = nullptr;
+        }
     }
 
-    // Derive AES-256 key (32 bytes)
-    impl_->encryption_key.resize(Impl::AES_KEY_SIZE);
-    size_t key_len = Impl::AES_KEY_SIZE;
-    if (EVP_PKEY_derive(kdf_ctx, impl_->encryption_key.data(), &key_len) <= 0) {
-        LOG_ERROR("Failed to derive AES key: " + std::string(ERR_error_string(ERR_get_error(), nullptr)));
-        EVP_PKEY_CTX_free(kdf_ctx);
+    auto state = derived ? MakeAesKey(send_key.data(), receive_key.data(), static_cast<size_t>(handle) + 1)
+                         : nullptr;
+    sodium_memzero(send_key.data(), send_key.size());
+    sodium_memzero(receive_key.data(), receive_key.size());
+    if (!state) {
         return false;
     }
-
-    EVP_PKEY_CTX_free(kdf_ctx);
-
-    impl_->key_derived = true;
-    impl_->encryption_enabled = true;
-    
-    LOG_INFO("Derived AES-256 key from ECDHE shared secret (" + std::to_string(key_len) + " bytes)");
+    std::atomic_store(&slot->aes_key, std::move(state));
+    LOG_DEBUG_FMT("Derived AES-256 keys for peer key slot {}", handle);
     return true;
 }
 
-bool SecurityManager::IsKeyReady() const {
-    std::lock_guard<std::mutex> lock(impl_->ecdhe_mutex);
-    return !impl_->encryption_key.empty() && (impl_->key_derived || impl_->initialized);
+bool SecurityManager::IsKeyReady(PeerKeyHandle handle) const {
+    PeerKeySlot* slot = impl_->GetPeerKeySlot(handle);
+    return slot && std::atomic_load(&slot->aes_key) != nullptr;
 }
 
-} // namespace P2P
\ No newline at end of file
+} // namespace P2P
@@ -3,14 +3,34 @@
 #include <spdlog/sinks/rotating_file_sink.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/async.h>
+#include <mutex>
 
 namespace P2P {
 
+namespace {
+
+// Bumped on every SetCorrelationId so threads know to refresh their cached copy
+std::atomic<uint64_t> g_correlation_generation{1};
+
+spdlog::level::level_enum ToSpdlogLevel(LogLevel level) {
+    switch (level) {
+        case LogLevel::TRACE: return spdlog::level::trace;
+        case LogLevel::DEBUG: return spdlog::level::debug;
+        case LogLevel::INFO:  return spdlog::level::info;
+        case LogLevel::WARN:  return spdlog::level::warn;
+        case LogLevel::ERR:   return spdlog::level::err;
+        case LogLevel::FATAL: return spdlog::level::critical;
+        default:              return spdlog::level::info;
+    }
+}
+
+} // namespace
+
 class Logger::Impl {
 public:
     std::shared_ptr<spdlog::logger> logger;
-    bool debug_enabled = false;
     std::string correlation_id;
+    mutable std::mutex correlation_mutex;
 };
 
 Logger& Logger::GetInstance() {
@@ -53,19 +73,25 @@ bool Logger::Initialize(const LoggingConfig& config) {
         }
 
         // Set log level
+        LogLevel level = LogLevel::INFO;
         if (config.level == "trace") {
-            impl_->logger->set_level(spdlog::level::trace);
+            level = LogLevel::TRACE;
         } else if (config.level == "debug") {
-            impl_->logger->set_level(spdlog::level::debug);
+            level = LogLevel::DEBUG;
         } else if (config.level == "info") {
-            impl_->logger->set_level(spdlog::level::info);
+            level = LogLevel::INFO;
         } else if (config.level == "warn") {
-            impl_->logger->set_level(spdlog::level::warn);
+            level = LogLevel::WARN;
         } else if (config.level == "error") {
-            impl_->logger->set_level(spdlog::level::err);
+            level = LogLevel::ERR;
         } else if (config.level == "fatal") {
-            impl_->logger->set_level(spdlog::level::critical);
+            level = LogLevel::FATAL;
         }
+        impl_->logger->set_level(ToSpdlogLevel(level));
+        impl_->correlation_id = config.correlation_id;
+        g_correlation_generation.fetch_add(1, std::memory_order_release);
+        debug_enabled_.store(config.debug_enabled, std::memory_order_relaxed);
+        min_level_.store(static_cast<int>(level), std::memory_order_relaxed);
 
         // Set pattern
         impl_->logger->set_pattern("[%Y-%m-%d %H:%M:%S.%e] [%^%l%$] [%t] %v");
@@ -85,19 +111,26 @@ bool Logger::Initialize(const LoggingConfig& config) {
 void Logger::Shutdown() {
     if (impl_ && impl_->logger) {
         impl_->logger->info("Logger shutting down");
+        min_level_.store(static_cast<int>(LogLevel::FATAL) + 1, std::memory_order_relaxed);
         impl_->logger->flush();
         spdlog::shutdown();
     }
 }
 
-void Logger::Trace(const std::string& message, const std::string& correlation_id) {
+void Logger::Write(LogLevel level, std::string_view message) {
     if (impl_ && impl_->logger) {
+        impl_->logger->log(ToSpdlogLevel(level), "[CID:{}] {}", CorrelationIdView(), message);
+    }
+}
+
+void Logger::Trace(const std::string& message, const std::string& correlation_id) {
+    if (impl_ && impl_->logger && ShouldLog(LogLevel::TRACE)) {
         impl_->logger->trace("[CID:{}] {}", correlation_id, message);
     }
 }
 
 void Logger::Debug(const std::string& message, const std::string& correlation_id) {
-    if (impl_ && impl_->logger && impl_->debug_enabled) {
+    if (impl_ && impl_->logger && ShouldLog(LogLevel::DEBUG)) {
         impl_->logger->debug("[CID:{}] {}", correlation_id, message);
     }
 }
@@ -127,17 +160,36 @@ void Logger::Fatal(const std::string& message, const std::string& correlation_id
 }
 
 void Logger::SetDebugEnabled(bool enabled) {
-    if (impl_) impl_->debug_enabled = enabled;
+    debug_enabled_.store(enabled, std::memory_order_relaxed);
 }
 bool Logger::IsDebugEnabled() const {
-    return impl_ ? impl_->debug_enabled : false;
+    return debug_enabled_.load(std::memory_order_relaxed);
 }
 void Logger::SetCorrelationId(const std::string& id) {
-    if (impl_) impl_->correlation_id = id;
+    if (impl_) {
+        std::lock_guard<std::mutex> lock(impl_->correlation_mutex);
+        impl_->correlation_id = id;
+        g_correlation_generation.fetch_add(1, std::memory_order_release);
+    }
 }
 std::string Logger::GetCorrelationId() const {
-    return impl_ ? impl_->correlation_id : "";
+    return std::string(CorrelationIdView());
+}
+std::string_view Logger::CorrelationIdView() const {
+    thread_local uint64_t cached_generation = 0;
+    thread_local std::string cached_id;
+
+    uint64_t generation = g_correlation_generation.load(std::memory_order_acquire);
+    if (generation != cached_generation) {
+        if (impl_) {
+            std::lock_guard<std::mutex> lock(impl_->correlation_mutex);
+            cached_id = impl_->correlation_id;
+        } else {
+            cached_id.clear();
+        }
+        cached_generation = generation;
+    }
+    return cached_id;
 }
 
 } // namespace P2P
-
@@ -0,0 +1,79 @@
+#include "../../include/ChannelSelector.h"
+#include "../../include/PacketBatcher.h"
+#include "../../include/PacketTable.h"
+#include <algorithm>
+#include <array>
+
+namespace P2P {
+
+namespace {
+
+constexpr std::array<const char*, 5> CHANNEL_LABELS = {
+    "urgent", "normal", "bulk", "state", "data"
+};
+
+} // namespace
+
+ChannelSelector::Selection ChannelSelector::Select(const uint8_t* data, size_t size) {
+    Selection selection;
+    if (!data || size < 2 || PacketView(data, size).type == KEY_EXCHANGE_PACKET_TYPE) {
+        return selection;
+    }
+
+    // One pass: the most urgent packet picks the channel, and the message is
+    // superseded state only if every packet in it is
+    const PacketTable& table = PacketTable::GetInstance();
+    bool any = false;
+    bool all_unreliable = true;
+    PacketPriority priority = PacketPriority::BACKGROUND;
+    PacketBatcher::Unbatch(data, size, [&](const PacketView& packet) {
+        PacketDescriptor descriptor = table.Lookup(packet.type);
+        any = true;
+        all_unreliable &= descriptor.IsUnreliable();
+        priority = std::min(priority, descriptor.Priority());
+    });
+    if (!any) {
+        // A malformed batch yields nothing; go by the frame's own type
+        priority = table.Lookup(PacketView(data, size).type).Priority();
+        all_unreliable = false;
+    }
+
+    if (all_unreliable) {
+        selection.preferred = Channel::STATE;
+        selection.fallback = ForPriority(priority);
+    } else {
+        selection.preferred = ForPriority(priority);
+    }
+    return selection;
+}
+
+ChannelSelector::Channel ChannelSelector::ForPriority(PacketPriority priority) {
+    switch (priority) {
+        case PacketPriority::CRITICAL:
+        case PacketPriority::HIGH:
+            return Channel::URGENT;
+        case PacketPriority::NORMAL:
+            return Channel::NORMAL;
+        case PacketPriority::LOW:
+        case PacketPriority::BACKGROUND:
+        default:
+            return Channel::BULK;
+    }
+}
+
+const char* ChannelSelector::GetLabel(Channel channel) {
+    size_t index = static_cast<size_t>(channel);
+    return index < CHANNEL_LABELS.size() ? CHANNEL_LABELS[index] : "data";
+}
+
+bool ChannelSelector::FromLabel(const std::string& label, Channel& channel) {
+    for (size_t i = 0; i < CHANNEL_LABELS.size(); ++i) {
+        if (label == CHANNEL_LABELS[i]) {
+            channel = static_cast<Channel>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace P2P
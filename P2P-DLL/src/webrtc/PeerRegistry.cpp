@@ -0,0 +1,152 @@
+#include "../../include/PeerRegistry.h"
+#include <functional>
+
+namespace P2P {
+
+namespace {
+
+// Keep the hash table at most half full so probe sequences stay short
+size_t BucketCountFor(size_t capacity) {
+    size_t count = 8;
+    while (count < capacity * 2) {
+        count <<= 1;
+    }
+    return count;
+}
+
+} // namespace
+
+PeerRegistry::PeerRegistry(size_t capacity) {
+    Reset(capacity);
+}
+
+PeerRegistry::~PeerRegistry() = default;
+
+void PeerRegistry::Reset(size_t capacity) {
+    capacity_ = capacity;
+    buckets_.assign(BucketCountFor(capacity), Bucket());
+    bucket_mask_ = buckets_.size() - 1;
+
+    peer_ids_.assign(capacity, std::string());
+    peers_.assign(capacity, nullptr);
+    in_use_.assign(capacity, 0);
+    live_.clear();
+    live_.reserve(capacity);
+    live_index_.assign(capacity, 0);
+
+    connected_ = std::make_unique<std::atomic<bool>[]>(capacity);
+    pos_x_.assign(capacity, 0.0f);
+    pos_y_.assign(capacity, 0.0f);
+    pos_z_.assign(capacity, 0.0f);
+    score_.assign(capacity, 1.0f);
+
+    // Hand out low handles first
+    free_handles_.clear();
+    free_handles_.reserve(capacity);
+    for (size_t i = capacity; i > 0; --i) {
+        free_handles_.push_back(static_cast<Handle>(i - 1));
+    }
+}
+
+void PeerRegistry::Clear() {
+    Reset(capacity_);
+}
+
+uint32_t PeerRegistry::Hash(const std::string& peer_id) {
+    return static_cast<uint32_t>(std::hash<std::string>()(peer_id));
+}
+
+size_t PeerRegistry::FindBucket(const std::string& peer_id, uint32_t hash) const {
+    for (size_t index = hash & bucket_mask_;; index = (index + 1) & bucket_mask_) {
+        const Bucket& bucket = buckets_[index];
+        if (bucket.handle == INVALID_HANDLE ||
+            (bucket.hash == hash && peer_ids_[bucket.handle] == peer_id)) {
+            return index;
+        }
+    }
+}
+
+PeerRegistry::Handle PeerRegistry::Insert(const std::string& peer_id, std::shared_ptr<WebRTCPeerConnection> peer) {
+    if (Full()) {
+        return INVALID_HANDLE;
+    }
+
+    uint32_t hash = Hash(peer_id);
+    size_t index = FindBucket(peer_id, hash);
+    if (buckets_[index].handle != INVALID_HANDLE) {
+        return INVALID_HANDLE;
+    }
+
+    Handle handle = free_handles_.back();
+    free_handles_.pop_back();
+
+    buckets_[index].hash = hash;
+    buckets_[index].handle = handle;
+
+    peer_ids_[handle] = peer_id;
+    peers_[handle] = std::move(peer);
+    in_use_[handle] = 1;
+    live_index_[handle] = static_cast<uint32_t>(live_.size());
+    live_.push_back(handle);
+
+    connected_[handle].store(false, std::memory_order_relaxed);
+    pos_x_[handle] = 0.0f;
+    pos_y_[handle] = 0.0f;
+    pos_z_[handle] = 0.0f;
+    score_[handle] = 1.0f;
+    return handle;
+}
+
+PeerRegistry::Handle PeerRegistry::Find(const std::string& peer_id) const {
+    return buckets_[FindBucket(peer_id, Hash(peer_id))].handle;
+}
+
+void PeerRegistry::EraseBucket(size_t index) {
+    // Backward-shift deletion: pull later entries of the probe run into the
+    // hole so lookups never need tombstones
+    size_t hole = index;
+    for (size_t next = (hole + 1) & bucket_mask_;
+         buckets_[next].handle != INVALID_HANDLE;
+         next = (next + 1) & bucket_mask_) {
+        size_t home = buckets_[next].hash & bucket_mask_;
+        // Move the entry unless its home lies cyclically within (hole, next]
+        bool home_in_range = hole <= next ? (home > hole && home <= next)
+                                          : (home > hole || home <= next);
+        if (!home_in_range) {
+            buckets_[hole] = buckets_[next];
+            hole = next;
+        }
+    }
+    buckets_[hole] = Bucket();
+}
+
+bool PeerRegistry::Erase(Handle handle) {
+    if (!IsValid(handle)) {
+        return false;
+    }
+
+    const std::string& peer_id = peer_ids_[handle];
+    EraseBucket(FindBucket(peer_id, Hash(peer_id)));
+
+    // Swap-remove from the packed live list
+    uint32_t position = live_index_[handle];
+    Handle last = live_.back();
+    live_[position] = last;
+    live_index_[last] = position;
+    live_.pop_back();
+
+    peer_ids_[handle].clear();
+    peers_[handle].reset();
+    in_use_[handle] = 0;
+    connected_[handle].store(false, std::memory_order_relaxed);
+    free_handles_.push_back(handle);
+    return true;
+}
+
+void PeerRegistry::SetPosition(Handle handle, float x, float y, float z) {
+    pos_x_[handle] = x;
+    pos_y_[handle] = y;
+    pos_z_[handle] = z;
+}
+
+} // namespace P2P
@@ -0,0 +1,167 @@
+#include "../../include/PeerSendQueue.h"
+#include "../../include/Logger.h"
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+namespace P2P {
+
+// PeerSendQueue
+
+PeerSendQueue::PeerSendQueue(std::string peer_id, SendFunction send, size_t max_queued)
+    : peer_id_(std::move(peer_id)), send_(std::move(send)), max_queued_(max_queued) {
+}
+
+bool PeerSendQueue::Push(PacketBuffer&& packet) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (queue_.size() < max_queued_) {
+            queue_.push_back(std::move(packet));
+            return true;
+        }
+    }
+    uint64_t dropped = dropped_.fetch_add(1, std::memory_order_relaxed) + 1;
+    // Rate-limit the warning to powers of two
+    if ((dropped & (dropped - 1)) == 0) {
+        LOG_WARN_FMT("Send queue full for peer {}: {} packet(s) dropped", peer_id_, dropped);
+    }
+    return false;
+}
+
+size_t PeerSendQueue::Drain(size_t max_packets) {
+    size_t sent = 0;
+    while (sent < max_packets) {
+        PacketBuffer packet;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (queue_.empty()) {
+                break;
+            }
+            packet = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        if (!send_(packet.Data(), packet.Size())) {
+            LOG_DEBUG_FMT("Transport send failed for peer {} ({} bytes)", peer_id_, packet.Size());
+        }
+        ++sent;
+    }
+    return sent;
+}
+
+bool PeerSendQueue::SendNow(const uint8_t* data, size_t size) {
+    return send_(data, size);
+}
+
+bool PeerSendQueue::Empty() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queue_.empty();
+}
+
+// SendWorkerPool
+
+struct SendWorkerPool::Impl {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<std::shared_ptr<PeerSendQueue>> ready;
+    std::vector<std::thread> threads;
+    bool running = false;
+    std::atomic<bool> accepting{false};
+
+    void Schedule(std::shared_ptr<PeerSendQueue> queue) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ready.push_back(std::move(queue));
+        }
+        cv.notify_one();
+    }
+
+    void WorkerLoop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            cv.wait(lock, [this] { return !running || !ready.empty(); });
+            if (!running) {
+                return;
+            }
+            std::shared_ptr<PeerSendQueue> queue = std::move(ready.front());
+            ready.pop_front();
+            lock.unlock();
+
+            queue->Drain(DRAIN_BUDGET);
+
+            // Unclaim, then re-check: a Push that raced with the drain saw
+            // the queue as scheduled and left the wake-up to us
+            queue->ClearScheduled();
+            if (!queue->Empty() && queue->MarkScheduled()) {
+                lock.lock();
+                ready.push_back(std::move(queue));
+                continue;
+            }
+            lock.lock();
+        }
+    }
+};
+
+SendWorkerPool::SendWorkerPool() : impl_(std::make_unique<Impl>()) {
+}
+
+SendWorkerPool::~SendWorkerPool() {
+    Stop();
+}
+
+bool SendWorkerPool::Start(size_t threads) {
+    Stop();
+    if (threads == 0) {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(impl_->mutex);
+        impl_->running = true;
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        impl_->threads.emplace_back(&Impl::WorkerLoop, impl_.get());
+    }
+    impl_->accepting = true;
+    LOG_INFO_FMT("Send worker pool started ({} thread(s))", threads);
+    return true;
+}
+
+void SendWorkerPool::Stop() {
+    impl_->accepting = false;
+    {
+        std::lock_guard<std::mutex> lock(impl_->mutex);
+        if (!impl_->running) {
+            return;
+        }
+        impl_->running = false;
+    }
+    impl_->cv.notify_all();
+    for (auto& thread : impl_->threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    impl_->threads.clear();
+
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    for (auto& queue : impl_->ready) {
+        queue->ClearScheduled();
+    }
+    impl_->ready.clear();
+}
+
+bool SendWorkerPool::IsRunning() const {
+    return impl_->accepting.load(std::memory_order_acquire);
+}
+
+bool SendWorkerPool::Submit(const std::shared_ptr<PeerSendQueue>& queue, PacketBuffer&& packet) {
+    if (!queue->Push(std::move(packet))) {
+        return false;
+    }
+    if (queue->MarkScheduled()) {
+        impl_->Schedule(queue);
+    }
+    return true;
+}
+
+} // namespace P2P
@@ -0,0 +1,128 @@
+#include "../../include/ReorderWindow.h"
+
+namespace P2P {
+
+namespace {
+
+// Slots are indexed by sequence modulo the slot count; a power of two keeps
+// that mapping consistent when the sequence number wraps
+size_t RoundUpToPowerOfTwo(size_t value) {
+    size_t result = 2;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+} // namespace
+
+ReorderWindow::ReorderWindow(int64_t jitter_budget_us, size_t capacity)
+    : slots_(RoundUpToPowerOfTwo(capacity)), jitter_budget_us_(jitter_budget_us) {
+}
+
+ReorderWindow::Result ReorderWindow::Push(uint32_t sequence, const uint8_t* data, size_t size, int64_t now_us,
+                                          const DeliverFunction& deliver) {
+    if (!started_) {
+        started_ = true;
+        next_ = sequence;
+    }
+    // Give up on gaps that have waited long enough before placing this packet
+    Poll(now_us, deliver);
+
+    int32_t distance = static_cast<int32_t>(sequence - next_);
+    if (distance < 0) {
+        stats_.stale++;
+        return Result::STALE;
+    }
+    if (static_cast<size_t>(distance) >= slots_.size()) {
+        // Too far ahead to buffer: release what we hold and restart here
+        while (Slot* first = FirstBuffered()) {
+            SkipTo(first->sequence);
+            DeliverInOrder(deliver);
+        }
+        SkipTo(sequence);
+    } else if (distance > 0 && jitter_budget_us_ <= 0) {
+        SkipTo(sequence);
+    }
+
+    if (sequence == next_) {
+        deliver(data, size);
+        stats_.delivered++;
+        next_++;
+        DeliverInOrder(deliver);
+        return Result::DELIVERED;
+    }
+
+    Slot& slot = SlotFor(sequence);
+    if (slot.used) {
+        // Every buffered packet is within one window of next_, so the slot
+        // can only hold this same sequence number
+        stats_.duplicates++;
+        return Result::DUPLICATE;
+    }
+    slot.sequence = sequence;
+    slot.arrival_us = now_us;
+    slot.used = true;
+    slot.packet = PacketBufferPool::GetInstance().Acquire(size);
+    slot.packet.Assign(data, size);
+    buffered_++;
+    return Result::BUFFERED;
+}
+
+size_t ReorderWindow::Poll(int64_t now_us, const DeliverFunction& deliver) {
+    uint64_t delivered_before = stats_.delivered;
+    while (Slot* first = FirstBuffered()) {
+        if (now_us - first->arrival_us < jitter_budget_us_) {
+            break;
+        }
+        SkipTo(first->sequence);
+        DeliverInOrder(deliver);
+    }
+    return static_cast<size_t>(stats_.delivered - delivered_before);
+}
+
+void ReorderWindow::Reset() {
+    for (Slot& slot : slots_) {
+        slot.used = false;
+        slot.packet = PacketBuffer();
+    }
+    started_ = false;
+    buffered_ = 0;
+}
+
+void ReorderWindow::DeliverInOrder(const DeliverFunction& deliver) {
+    while (buffered_ > 0) {
+        Slot& slot = SlotFor(next_);
+        if (!slot.used || slot.sequence != next_) {
+            break;
+        }
+        deliver(slot.packet.Data(), slot.packet.Size());
+        slot.used = false;
+        slot.packet = PacketBuffer();
+        buffered_--;
+        stats_.delivered++;
+        stats_.reordered++;
+        next_++;
+    }
+}
+
+ReorderWindow::Slot* ReorderWindow::FirstBuffered() {
+    if (buffered_ == 0) {
+        return nullptr;
+    }
+    for (size_t distance = 1; distance < slots_.size(); ++distance) {
+        uint32_t sequence = next_ + static_cast<uint32_t>(distance);
+        Slot& slot = SlotFor(sequence);
+        if (slot.used && slot.sequence == sequence) {
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+void ReorderWindow::SkipTo(uint32_t sequence) {
+    stats_.skipped += sequence - next_;
+    next_ = sequence;
+}
+
+} // namespace P2P
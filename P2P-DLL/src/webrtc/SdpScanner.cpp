@@ -0,0 +1,61 @@
+#include "../../include/SdpScanner.h"
+
+namespace P2P {
+
+namespace {
+
+constexpr std::string_view MID_PEER_PREFIX = "a=mid:peerid-";
+constexpr std::string_view WMS_PREFIX = "a=msid-semantic: WMS ";
+
+bool StartsWith(std::string_view line, std::string_view prefix) {
+    return line.size() >= prefix.size() && line.compare(0, prefix.size(), prefix) == 0;
+}
+
+} // namespace
+
+bool SdpScanner::Next(std::string_view& line) {
+    if (rest_.empty()) {
+        return false;
+    }
+    size_t end = rest_.find('\n');
+    if (end == std::string_view::npos) {
+        line = rest_;
+        rest_ = std::string_view();
+    } else {
+        line = rest_.substr(0, end);
+        rest_.remove_prefix(end + 1);
+    }
+    if (!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1);
+    }
+    return true;
+}
+
+std::string_view SdpScanner::FindValue(std::string_view sdp, std::string_view prefix) {
+    SdpScanner scanner(sdp);
+    std::string_view line;
+    while (scanner.Next(line)) {
+        if (StartsWith(line, prefix)) {
+            return line.substr(prefix.size());
+        }
+    }
+    return std::string_view();
+}
+
+std::string SdpScanner::ExtractPeerId(std::string_view sdp) {
+    // One pass: a tagged mid wins, the session-level WMS id is the fallback
+    std::string_view wms_id;
+    SdpScanner scanner(sdp);
+    std::string_view line;
+    while (scanner.Next(line)) {
+        if (StartsWith(line, MID_PEER_PREFIX) && line.size() > MID_PEER_PREFIX.size()) {
+            return std::string(line.substr(MID_PEER_PREFIX.size()));
+        }
+        if (wms_id.empty() && StartsWith(line, WMS_PREFIX)) {
+            wms_id = line.substr(WMS_PREFIX.size());
+        }
+    }
+    return std::string(wms_id);
+}
+
+} // namespace P2P
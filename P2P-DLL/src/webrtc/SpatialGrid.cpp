@@ -0,0 +1,223 @@
+#include "../../include/SpatialGrid.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace P2P {
+
+namespace {
+
+// Keep cell coordinates well inside int32 so ring arithmetic cannot overflow
+constexpr float MAX_CELL_COORD = 1.0e9f;
+
+} // namespace
+
+SpatialGrid::SpatialGrid(float cell_size)
+    : cell_size_(cell_size > 0.0f ? cell_size : DEFAULT_CELL_SIZE),
+      inv_cell_size_(1.0f / cell_size_) {
+}
+
+void SpatialGrid::SetCellSize(float cell_size) {
+    if (cell_size <= 0.0f || cell_size == cell_size_) {
+        return;
+    }
+    cell_size_ = cell_size;
+    inv_cell_size_ = 1.0f / cell_size;
+
+    cells_.clear();
+    for (Handle handle = 0; handle < entries_.size(); ++handle) {
+        Entry& entry = entries_[handle];
+        if (entry.present) {
+            AddToCell(handle, entry);
+        }
+    }
+}
+
+int32_t SpatialGrid::CellCoord(float value) const {
+    float cell = std::floor(value * inv_cell_size_);
+    cell = std::max(-MAX_CELL_COORD, std::min(MAX_CELL_COORD, cell));
+    return static_cast<int32_t>(cell);
+}
+
+uint64_t SpatialGrid::CellKey(int32_t cx, int32_t cy) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(cx)) << 32) | static_cast<uint32_t>(cy);
+}
+
+void SpatialGrid::AddToCell(Handle handle, Entry& entry) {
+    entry.cell = CellKey(CellCoord(entry.x), CellCoord(entry.y));
+    std::vector<Handle>& cell = cells_[entry.cell];
+    entry.slot = static_cast<uint32_t>(cell.size());
+    cell.push_back(handle);
+}
+
+void SpatialGrid::RemoveFromCell(Entry& entry) {
+    auto it = cells_.find(entry.cell);
+    if (it == cells_.end()) {
+        return;
+    }
+    std::vector<Handle>& cell = it->second;
+    Handle moved = cell.back();
+    cell[entry.slot] = moved;
+    entries_[moved].slot = entry.slot;
+    cell.pop_back();
+    if (cell.empty()) {
+        cells_.erase(it);
+    }
+}
+
+void SpatialGrid::Update(Handle handle, float x, float y, float z) {
+    if (handle >= entries_.size()) {
+        entries_.resize(handle + 1);
+    }
+    Entry& entry = entries_[handle];
+    entry.z = z;
+
+    if (entry.present && CellKey(CellCoord(x), CellCoord(y)) == entry.cell) {
+        // Same cell: only the coordinates change
+        entry.x = x;
+        entry.y = y;
+        return;
+    }
+
+    if (entry.present) {
+        RemoveFromCell(entry);
+    } else {
+        entry.present = true;
+        ++size_;
+    }
+    entry.x = x;
+    entry.y = y;
+    AddToCell(handle, entry);
+}
+
+void SpatialGrid::Remove(Handle handle) {
+    if (!Contains(handle)) {
+        return;
+    }
+    Entry& entry = entries_[handle];
+    RemoveFromCell(entry);
+    entry.present = false;
+    --size_;
+}
+
+void SpatialGrid::Clear() {
+    entries_.clear();
+    cells_.clear();
+    size_ = 0;
+}
+
+float SpatialGrid::DistanceSquared(Handle handle, float x, float y, float z) const {
+    const Entry& entry = entries_[handle];
+    float dx = entry.x - x;
+    float dy = entry.y - y;
+    float dz = entry.z - z;
+    return dx * dx + dy * dy + dz * dz;
+}
+
+void SpatialGrid::QueryRadius(float x, float y, float z, float radius, std::vector<Handle>& out) const {
+    out.clear();
+    if (size_ == 0 || radius < 0.0f) {
+        return;
+    }
+    float radius_sq = radius * radius;
+
+    auto collect = [&](const std::vector<Handle>& cell) {
+        for (Handle handle : cell) {
+            if (DistanceSquared(handle, x, y, z) <= radius_sq) {
+                out.push_back(handle);
+            }
+        }
+    };
+
+    int64_t cx0 = CellCoord(x - radius);
+    int64_t cx1 = CellCoord(x + radius);
+    int64_t cy0 = CellCoord(y - radius);
+    int64_t cy1 = CellCoord(y + radius);
+
+    // A radius wider than the populated area: walking occupied cells is cheaper
+    if (static_cast<uint64_t>(cx1 - cx0 + 1) * static_cast<uint64_t>(cy1 - cy0 + 1) > cells_.size()) {
+        for (const auto& cell : cells_) {
+            collect(cell.second);
+        }
+        return;
+    }
+
+    for (int64_t cx = cx0; cx <= cx1; ++cx) {
+        for (int64_t cy = cy0; cy <= cy1; ++cy) {
+            auto it = cells_.find(CellKey(static_cast<int32_t>(cx), static_cast<int32_t>(cy)));
+            if (it != cells_.end()) {
+                collect(it->second);
+            }
+        }
+    }
+}
+
+void SpatialGrid::QueryNearest(float x, float y, float z, size_t k, std::vector<Handle>& out) const {
+    out.clear();
+    k = std::min(k, size_);
+    if (k == 0) {
+        return;
+    }
+
+    std::vector<std::pair<float, Handle>> candidates;
+    auto collect = [&](const std::vector<Handle>& cell) {
+        for (Handle handle : cell) {
+            candidates.emplace_back(DistanceSquared(handle, x, y, z), handle);
+        }
+    };
+    auto visit = [&](int64_t cx, int64_t cy) {
+        auto it = cells_.find(CellKey(static_cast<int32_t>(cx), static_cast<int32_t>(cy)));
+        if (it != cells_.end()) {
+            collect(it->second);
+        }
+    };
+
+    // Walk square rings of cells outward. Anything outside ring r is at least
+    // r cells away in x or y, so once the k-th best candidate is closer than
+    // that, no unvisited peer can displace it.
+    int64_t cx = CellCoord(x);
+    int64_t cy = CellCoord(y);
+    for (int64_t ring = 0;; ++ring) {
+        size_t ring_cells = ring == 0 ? 1 : static_cast<size_t>(8 * ring);
+        if (ring_cells > cells_.size()) {
+            // Sparse grid: the remaining rings are mostly empty, so finish by scanning occupied cells
+            candidates.clear();
+            for (const auto& cell : cells_) {
+                collect(cell.second);
+            }
+            break;
+        }
+
+        if (ring == 0) {
+            visit(cx, cy);
+        } else {
+            for (int64_t dx = -ring; dx <= ring; ++dx) {
+                visit(cx + dx, cy - ring);
+                visit(cx + dx, cy + ring);
+            }
+            for (int64_t dy = -ring + 1; dy <= ring - 1; ++dy) {
+                visit(cx - ring, cy + dy);
+                visit(cx + ring, cy + dy);
+            }
+        }
+
+        if (candidates.size() == size_) {
+            break;
+        }
+        if (candidates.size() >= k) {
+            std::nth_element(candidates.begin(), candidates.begin() + (k - 1), candidates.end());
+            float bound = static_cast<float>(ring) * cell_size_;
+            if (candidates[k - 1].first <= bound * bound) {
+                break;
+            }
+        }
+    }
+
+    std::partial_sort(candidates.begin(), candidates.begin() + k, candidates.end());
+    out.reserve(k);
+    for (size_t i = 0; i < k; ++i) {
+        out.push_back(candidates[i].second);
+    }
+}
+
+} // namespace P2P
@@ -1,29 +1,202 @@
 #include "../../include/WebRTCManager.h"
 #include "../../include/WebRTCPeerConnection.h"
+#include "../../include/SecurityManager.h"
+#include "../../include/PeerRegistry.h"
+#include "../../include/PeerSendQueue.h"
+#include "../../include/SdpScanner.h"
+#include "../../include/InterestManager.h"
 #include "../../include/Logger.h"
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <mutex>
-#include <regex>
+#include <thread>
 
 namespace P2P {
 
+namespace {
+
+/**
+ * A peer's latest position, for choosing targets without the manager lock
+ * Written by the peer's receive callback and by SetPeerPosition.
+ */
+struct PeerPosition {
+    std::atomic<float> x{0.0f};
+    std::atomic<float> y{0.0f};
+    std::atomic<float> z{0.0f};
+
+    void Store(float px, float py, float pz) {
+        x.store(px, std::memory_order_relaxed);
+        y.store(py, std::memory_order_relaxed);
+        z.store(pz, std::memory_order_relaxed);
+    }
+
+    // Same 3D distance as WebRTCPeerConnection::IsWithinAOI
+    float DistanceSquared(float px, float py, float pz) const {
+        float dx = x.load(std::memory_order_relaxed) - px;
+        float dy = y.load(std::memory_order_relaxed) - py;
+        float dz = z.load(std::memory_order_relaxed) - pz;
+        return dx * dx + dy * dy + dz * dz;
+    }
+};
+
+} // namespace
+
 struct WebRTCManager::Impl {
-    std::vector<std::shared_ptr<WebRTCPeerConnection>> peers;
+    struct SendTarget {
+        std::shared_ptr<PeerSendQueue> queue;
+        std::shared_ptr<PeerPosition> position;
+    };
+    using SendSnapshot = std::vector<SendTarget>; // Sorted by peer ID
+    using PeerSnapshot = std::vector<std::shared_ptr<WebRTCPeerConnection>>;
+
+    PeerRegistry peers;
+    std::vector<std::shared_ptr<PeerSendQueue>> send_queues =
+        std::vector<std::shared_ptr<PeerSendQueue>>(PeerRegistry::DEFAULT_CAPACITY); // Indexed by handle
+    std::vector<std::shared_ptr<PeerPosition>> send_positions =
+        std::vector<std::shared_ptr<PeerPosition>>(PeerRegistry::DEFAULT_CAPACITY); // Indexed by handle
     std::mutex mutex;
+
+    // Peers' send queues and positions, republished under mutex on every
+    // membership change and read by senders without locking (accessed with
+    // std::atomic_load/store)
+    std::shared_ptr<const SendSnapshot> send_snapshot;
+    // Peers, published alongside send_snapshot for the state poller
+    std::shared_ptr<const PeerSnapshot> peer_snapshot;
+    SendWorkerPool send_workers;
     std::vector<std::string> stun_servers;
     std::vector<std::string> turn_servers;
     std::string turn_username;
     std::string turn_credential;
     bool initialized = false;
     int max_peers = 50;
+    SecurityManager* security_manager = nullptr;
+
+    // Signaling output; copied under its own lock and invoked outside it
+    std::mutex signaling_mutex;
+    OnLocalDescriptionCallback on_local_description;
+    OnLocalCandidateCallback on_local_candidate;
+
+    // DataChannel settings for new peers and the thread polling their state reorder windows
+    bool priority_channels_enabled = true;
+    bool state_channel_enabled = true;
+    int state_jitter_budget_ms = 40;
+    std::thread state_poller;
+    std::mutex poller_mutex;
+    std::condition_variable poller_cv;
+    bool poller_running = false;
 
     // AOI/mesh
-    float local_x = 0.0f, local_y = 0.0f, local_z = 0.0f;
+    // Written by PacketRouter for every outbound movement packet, so kept
+    // out from under mutex. Read component-wise: a query racing a move may
+    // mix old and new coordinates, which is harmless for AOI.
+    std::atomic<float> local_x{0.0f}, local_y{0.0f}, local_z{0.0f};
+
+    void GetLocalPosition(float& x, float& y, float& z) const {
+        x = local_x.load(std::memory_order_relaxed);
+        y = local_y.load(std::memory_order_relaxed);
+        z = local_z.load(std::memory_order_relaxed);
+    }
     float aoi_radius = 100.0f;
-    int mesh_refresh_interval_ms = 5000;
-    float peer_score_threshold = 0.5f;
-    int prune_interval_ms = 10000;
-    std::chrono::steady_clock::time_point last_refresh = std::chrono::steady_clock::now();
+
+    // Stop the peer's state callback from writing into a handle we no longer own.
+    // The callback runs under the peer's lock, so none is in flight afterwards.
+    // Signaling callbacks are cleared too: the peer may outlive the manager.
+    void DetachPeer(PeerRegistry::Handle handle) {
+        const auto& peer = peers.GetPeer(handle);
+        peer->SetOnStateChangeCallback(nullptr);
+        peer->SetOnLocalDescriptionCallback(nullptr);
+        peer->SetOnIceCandidateCallback(nullptr);
+    }
+
+    void ErasePeer(PeerRegistry::Handle handle) {
+        DetachPeer(handle);
+        send_queues[handle].reset();
+        send_positions[handle].reset();
+        peers.Erase(handle);
+    }
+
+    void PublishSendSnapshot() {
+        auto snapshot = std::make_shared<SendSnapshot>();
+        auto peer_list = std::make_shared<PeerSnapshot>();
+        snapshot->reserve(peers.Size());
+        peer_list->reserve(peers.Size());
+        for (PeerRegistry::Handle handle : peers.Handles()) {
+            snapshot->push_back({send_queues[handle], send_positions[handle]});
+            peer_list->push_back(peers.GetPeer(handle));
+        }
+        // Sorted so SendDataToPeers finds each target by binary search
+        std::sort(snapshot->begin(), snapshot->end(), [](const SendTarget& a, const SendTarget& b) {
+            return a.queue->GetPeerId() < b.queue->GetPeerId();
+        });
+        std::atomic_store(&send_snapshot, std::shared_ptr<const SendSnapshot>(std::move(snapshot)));
+        std::atomic_store(&peer_snapshot, std::shared_ptr<const PeerSnapshot>(std::move(peer_list)));
+    }
+
+    void StartStatePoller() {
+        StopStatePoller();
+        {
+            std::lock_guard<std::mutex> lock(poller_mutex);
+            poller_running = true;
+        }
+        // A few polls per budget bound how late a held update is released
+        auto interval = std::chrono::milliseconds(std::max(state_jitter_budget_ms / 4, 2));
+        state_poller = std::thread([this, interval]() {
+            std::unique_lock<std::mutex> lock(poller_mutex);
+            while (!poller_cv.wait_for(lock, interval, [this]() { return !poller_running; })) {
+                lock.unlock();
+                auto snapshot = std::atomic_load(&peer_snapshot);
+                if (snapshot) {
+                    for (const auto& peer : *snapshot) {
+                        peer->PollStateChannel();
+                    }
+                }
+                lock.lock();
+            }
+        });
+    }
+
+    void StopStatePoller() {
+        {
+            std::lock_guard<std::mutex> lock(poller_mutex);
+            poller_running = false;
+        }
+        poller_cv.notify_all();
+        if (state_poller.joinable()) {
+            state_poller.join();
+        }
+    }
+
+    bool SendToQueue(const std::shared_ptr<PeerSendQueue>& queue, const uint8_t* data, size_t size,
+                     bool use_workers) {
+        if (use_workers) {
+            PacketBuffer packet = PacketBufferPool::GetInstance().Acquire(size);
+            packet.Assign(data, size);
+            return send_workers.Submit(queue, std::move(packet));
+        }
+        return queue->SendNow(data, size);
+    }
+
+    bool SendToQueues(const SendSnapshot& targets, const uint8_t* data, size_t size) {
+        bool use_workers = send_workers.IsRunning();
+        bool success = false;
+        for (const auto& target : targets) {
+            if (target.queue->IsConnected()) {
+                success |= SendToQueue(target.queue, data, size, use_workers);
+            }
+        }
+        return success;
+    }
+
+    void ResetPeers(size_t capacity) {
+        for (PeerRegistry::Handle handle : peers.Handles()) {
+            DetachPeer(handle);
+        }
+        peers.Reset(capacity);
+        send_queues.assign(capacity, nullptr);
+        send_positions.assign(capacity, nullptr);
+        PublishSendSnapshot();
+    }
 };
 
 WebRTCManager::WebRTCManager() : impl_(std::make_unique<Impl>()) {
@@ -31,11 +204,10 @@ WebRTCManager::WebRTCManager() : impl_(std::make_unique<Impl>()) {
 }
 
 void WebRTCManager::SetLocalPosition(float x, float y, float z) {
-    std::lock_guard<std::mutex> lock(impl_->mutex);
-    impl_->local_x = x;
-    impl_->local_y = y;
-    impl_->local_z = z;
-    LOG_DEBUG("SetLocalPosition: (" + std::to_string(x) + "," + std::to_string(y) + "," + std::to_string(z) + ")");
+    impl_->local_x.store(x, std::memory_order_relaxed);
+    impl_->local_y.store(y, std::memory_order_relaxed);
+    impl_->local_z.store(z, std::memory_order_relaxed);
+    LOG_TRACE_FMT("SetLocalPosition: ({},{},{})", x, y, z);
 }
 
 void WebRTCManager::SetAOIRadius(float radius) {
@@ -49,42 +221,6 @@ float WebRTCManager::GetAOIRadius() const {
     return impl_->aoi_radius;
 }
 
-void WebRTCManager::RefreshMesh() {
-    std::lock_guard<std::mutex> lock(impl_->mutex);
-    auto now = std::chrono::steady_clock::now();
-    if (std::chrono::duration_cast<std::chrono::milliseconds>(now - impl_->last_refresh).count() < impl_->mesh_refresh_interval_ms) {
-        return;
-    }
-    impl_->last_refresh = now;
-
-    for (auto it = impl_->peers.begin(); it != impl_->peers.end(); ) {
-        auto& peer = *it;
-        float px, py, pz;
-        peer->GetPeerPosition(px, py, pz);
-        bool in_aoi = peer->IsWithinAOI(impl_->local_x, impl_->local_y, impl_->local_z, impl_->aoi_radius);
-        float score = peer->GetPeerScore();
-
-        LOG_DEBUG("MeshRefresh: PeerId=" + peer->GetPeerId() +
-                  " Position=(" + std::to_string(px) + "," + std::to_string(py) + "," + std::to_string(pz) + ")" +
-                  " InAOI=" + (in_aoi ? "true" : "false") +
-                  " Score=" + std::to_string(score));
-
-        // AOI/interest-based pruning
-        if (!in_aoi || score < impl_->peer_score_threshold) {
-            LOG_INFO("Pruning peer: PeerId=" + peer->GetPeerId() +
-                     " InAOI=" + (in_aoi ? "true" : "false") +
-                     " Score=" + std::to_string(score));
-            peer->Close();
-            it = impl_->peers.erase(it);
-            continue;
-        }
-        ++it;
-    }
-    LOG_INFO("MeshRefresh complete. Peer count: " + std::to_string(impl_->peers.size()));
-    // Telemetry: mesh refresh event
-    LOG_DEBUG("Telemetry: Mesh refreshed, peer count: " + std::to_string(impl_->peers.size()));
-}
-
 WebRTCManager::~WebRTCManager() noexcept {
     try {
         Shutdown();
@@ -103,104 +239,335 @@ bool WebRTCManager::Initialize(const std::vector<std::string>& stun, const std::
     impl_->turn_username = turn_username;
     impl_->turn_credential = turn_credential;
     impl_->max_peers = max;
+    {
+        std::lock_guard<std::mutex> lock(impl_->mutex);
+        impl_->ResetPeers(max > 0 ? static_cast<size_t>(max) : PeerRegistry::DEFAULT_CAPACITY);
+    }
     impl_->initialized = true;
     LOG_INFO("WebRTCManager initialized");
     return true;
 }
 
+void WebRTCManager::SetSecurityManager(SecurityManager* security_manager) {
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    impl_->security_manager = security_manager;
+}
+
+void WebRTCManager::ConfigureSendWorkers(const PerformanceConfig& config) {
+    size_t threads = config.io_thread_pool_size > 0 ? static_cast<size_t>(config.io_thread_pool_size) : 0;
+    if (!impl_->send_workers.Start(threads)) {
+        LOG_INFO("Send worker pool disabled; peers are sent to on the calling thread");
+    }
+}
+
+void WebRTCManager::ConfigureDataChannels(const P2PConfig& config) {
+    impl_->StopStatePoller();
+    {
+        std::lock_guard<std::mutex> lock(impl_->mutex);
+        impl_->priority_channels_enabled = config.priority_channels_enabled;
+        impl_->state_channel_enabled = config.state_channel_enabled;
+        impl_->state_jitter_budget_ms = std::max(config.state_jitter_budget_ms, 0);
+    }
+    if (config.state_channel_enabled && config.state_jitter_budget_ms > 0) {
+        impl_->StartStatePoller();
+    }
+    LOG_INFO_FMT("Priority channels {}, state channel {} (jitter budget {} ms)",
+                 config.priority_channels_enabled ? "enabled" : "disabled",
+                 config.state_channel_enabled ? "enabled" : "disabled", config.state_jitter_budget_ms);
+}
+
 void WebRTCManager::Shutdown() {
+    impl_->StopStatePoller();
+    impl_->send_workers.Stop();
     std::lock_guard<std::mutex> lock(impl_->mutex);
-    impl_->peers.clear();
+    impl_->ResetPeers(impl_->peers.Capacity());
     impl_->initialized = false;
 }
 
 std::shared_ptr<WebRTCPeerConnection> WebRTCManager::CreatePeerConnection(const std::string& peer_id) {
     std::lock_guard<std::mutex> lock(impl_->mutex);
+    PeerRegistry& peers = impl_->peers;
+
+    // A new connection for a known peer replaces the old one
+    PeerRegistry::Handle existing = peers.Find(peer_id);
+    if (existing != PeerRegistry::INVALID_HANDLE) {
+        peers.GetPeer(existing)->Close();
+        impl_->ErasePeer(existing);
+        impl_->PublishSendSnapshot();
+    }
+    if (peers.Full()) {
+        LOG_ERROR_FMT("Cannot create peer connection for {}: max_peers ({}) reached", peer_id, peers.Capacity());
+        return nullptr;
+    }
+
     auto peer = std::make_shared<WebRTCPeerConnection>(peer_id);
     if (!peer->Initialize(impl_->stun_servers, impl_->turn_servers,
                          impl_->turn_username, impl_->turn_credential)) {
         LOG_ERROR("Failed to initialize WebRTCPeerConnection for peer: " + peer_id);
         return nullptr;
     }
-    impl_->peers.push_back(peer);
+    if (impl_->security_manager) {
+        peer->SetSecurityManager(impl_->security_manager);
+    }
+    peer->ConfigurePriorityChannels(impl_->priority_channels_enabled);
+    peer->ConfigureStateChannel(impl_->state_channel_enabled, impl_->state_jitter_budget_ms);
+
+    // Trickle the peer's SDP and candidates out through signaling, tagged with its ID
+    Impl* impl = impl_.get();
+    peer->SetOnLocalDescriptionCallback([impl, peer_id](const std::string& type, const std::string& sdp) {
+        OnLocalDescriptionCallback callback;
+        {
+            std::lock_guard<std::mutex> lock(impl->signaling_mutex);
+            callback = impl->on_local_description;
+        }
+        if (callback) {
+            callback(peer_id, type, sdp);
+        } else {
+            LOG_WARN("No signaling callback for local " + type + " to peer: " + peer_id);
+        }
+    });
+    peer->SetOnIceCandidateCallback([impl, peer_id](const std::string& candidate, const std::string& mid) {
+        OnLocalCandidateCallback callback;
+        {
+            std::lock_guard<std::mutex> lock(impl->signaling_mutex);
+            callback = impl->on_local_candidate;
+        }
+        if (callback) {
+            callback(peer_id, candidate, mid);
+        }
+    });
+
+    // The peer's own movement packets place it for senders choosing targets by radius
+    auto position = std::make_shared<PeerPosition>();
+    peer->SetOnDataCallback([position](const uint8_t* data, size_t size) {
+        float x, y;
+        if (InterestManager::DecodePosition(PacketView(data, size), x, y)) {
+            position->Store(x, y, 0.0f);
+        }
+    });
+
+    PeerRegistry::Handle handle = peers.Insert(peer_id, peer);
+    float x, y, z;
+    peer->GetPeerPosition(x, y, z);
+    peers.SetPosition(handle, x, y, z);
+    position->Store(x, y, z);
+    impl_->send_positions[handle] = position;
+    peers.SetScore(handle, peer->GetPeerScore());
+
+    // The queue holds the peer weakly; the peer's callback holds the queue
+    // until DetachPeer clears it
+    std::weak_ptr<WebRTCPeerConnection> weak_peer = peer;
+    auto queue = std::make_shared<PeerSendQueue>(peer_id, [weak_peer](const uint8_t* data, size_t size) {
+        auto target = weak_peer.lock();
+        return target && target->SendData(data, size);
+    });
+    impl_->send_queues[handle] = queue;
+    peer->SetOnStateChangeCallback([&peers, handle, queue](bool connected) {
+        peers.SetConnected(handle, connected);
+        queue->SetConnected(connected);
+    });
+    impl_->PublishSendSnapshot();
+
     LOG_INFO("Created and initialized peer connection for: " + peer_id);
     return peer;
 }
 
 void WebRTCManager::RemovePeerConnection(const std::string& peer_id) {
     std::lock_guard<std::mutex> lock(impl_->mutex);
-    impl_->peers.erase(
-        std::remove_if(impl_->peers.begin(), impl_->peers.end(),
-            [&](const auto& p) { return p->GetPeerId() == peer_id; }),
-        impl_->peers.end()
-    );
+    PeerRegistry::Handle handle = impl_->peers.Find(peer_id);
+    if (handle != PeerRegistry::INVALID_HANDLE) {
+        impl_->ErasePeer(handle);
+        impl_->PublishSendSnapshot();
+    }
 }
 
 std::shared_ptr<WebRTCPeerConnection> WebRTCManager::GetPeerConnection(const std::string& peer_id) {
     std::lock_guard<std::mutex> lock(impl_->mutex);
-    auto it = std::find_if(impl_->peers.begin(), impl_->peers.end(),
-        [&](const auto& p) { return p->GetPeerId() == peer_id; });
-    return (it != impl_->peers.end()) ? *it : nullptr;
+    PeerRegistry::Handle handle = impl_->peers.Find(peer_id);
+    return handle != PeerRegistry::INVALID_HANDLE ? impl_->peers.GetPeer(handle) : nullptr;
+}
+
+void WebRTCManager::SetPeerPosition(const std::string& peer_id, float x, float y, float z) {
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    PeerRegistry::Handle handle = impl_->peers.Find(peer_id);
+    if (handle == PeerRegistry::INVALID_HANDLE) {
+        return;
+    }
+    impl_->peers.SetPosition(handle, x, y, z);
+    impl_->send_positions[handle]->Store(x, y, z);
+    impl_->peers.GetPeer(handle)->SetPeerPosition(x, y, z);
+}
+
+std::vector<std::string> WebRTCManager::GetPeersWithinRadius(float radius) const {
+    std::vector<std::string> result;
+    auto snapshot = std::atomic_load(&impl_->send_snapshot);
+    if (!snapshot) {
+        return result;
+    }
+    float x, y, z;
+    impl_->GetLocalPosition(x, y, z);
+    float radius_squared = radius * radius;
+    for (const auto& target : *snapshot) {
+        if (target.position->DistanceSquared(x, y, z) <= radius_squared) {
+            result.push_back(target.queue->GetPeerId());
+        }
+    }
+    return result;
+}
+
+std::vector<std::string> WebRTCManager::GetNearestPeers(size_t count) const {
+    std::vector<std::string> result;
+    auto snapshot = std::atomic_load(&impl_->send_snapshot);
+    if (!snapshot) {
+        return result;
+    }
+    float x, y, z;
+    impl_->GetLocalPosition(x, y, z);
+    std::vector<std::pair<float, const Impl::SendTarget*>> by_distance;
+    by_distance.reserve(snapshot->size());
+    for (const auto& target : *snapshot) {
+        by_distance.emplace_back(target.position->DistanceSquared(x, y, z), &target);
+    }
+    count = std::min(count, by_distance.size());
+    std::partial_sort(by_distance.begin(), by_distance.begin() + count, by_distance.end(),
+                      [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    result.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        result.push_back(by_distance[i].second->queue->GetPeerId());
+    }
+    return result;
+}
+
+void WebRTCManager::SetPeerScore(const std::string& peer_id, float score) {
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    PeerRegistry::Handle handle = impl_->peers.Find(peer_id);
+    if (handle == PeerRegistry::INVALID_HANDLE) {
+        return;
+    }
+    impl_->peers.SetScore(handle, score);
+    impl_->peers.GetPeer(handle)->SetPeerScore(score);
 }
 
 std::vector<std::string> WebRTCManager::GetConnectedPeers() const {
     std::lock_guard<std::mutex> lock(impl_->mutex);
     std::vector<std::string> result;
-    for (const auto& p : impl_->peers) {
-        if (p->IsConnected()) result.push_back(p->GetPeerId());
+    for (PeerRegistry::Handle handle : impl_->peers.Handles()) {
+        if (impl_->peers.IsConnected(handle)) result.push_back(impl_->peers.GetPeerId(handle));
     }
     return result;
 }
 
 int WebRTCManager::GetPeerCount() const {
     std::lock_guard<std::mutex> lock(impl_->mutex);
-    return static_cast<int>(impl_->peers.size());
+    return static_cast<int>(impl_->peers.Size());
 }
 
 bool WebRTCManager::IsConnected() const {
-    std::lock_guard<std::mutex> lock(impl_->mutex);
-    for (const auto& p : impl_->peers) {
-        if (p->IsConnected()) return true;
+    auto snapshot = std::atomic_load(&impl_->send_snapshot);
+    if (!snapshot) {
+        return false;
+    }
+    for (const auto& target : *snapshot) {
+        if (target.queue->IsConnected()) return true;
     }
     return false;
 }
 
-bool WebRTCManager::SendData(const void* data, size_t size) {
-    std::lock_guard<std::mutex> lock(impl_->mutex);
+bool WebRTCManager::SendDataWithinRadius(const void* data, size_t size, float radius) {
+    // Targets come from the published snapshot: with at most max_peers
+    // entries a distance check per peer is cheaper than the manager lock
+    auto snapshot = std::atomic_load(&impl_->send_snapshot);
+    if (!snapshot) {
+        return true;
+    }
+    float x, y, z;
+    impl_->GetLocalPosition(x, y, z);
+    float radius_squared = radius * radius;
+    bool use_workers = impl_->send_workers.IsRunning();
     bool success = false;
-    for (const auto& p : impl_->peers) {
-        if (p->IsConnected()) {
-            if (p->SendData(static_cast<const uint8_t*>(data), size)) {
-                success = true;
-            }
+    size_t targets = 0;
+    for (const auto& target : *snapshot) {
+        if (!target.queue->IsConnected() || target.position->DistanceSquared(x, y, z) > radius_squared) {
+            continue;
         }
+        targets++;
+        success |= impl_->SendToQueue(target.queue, static_cast<const uint8_t*>(data), size, use_workers);
     }
-    return success;
+    // Nobody in range is not a failure: there is simply no one to tell
+    return targets == 0 || success;
 }
 
-void WebRTCManager::ProcessOffer(const std::string& offer) {
-    std::lock_guard<std::mutex> lock(impl_->mutex);
-    // Extract peer_id from SDP offer using regex (look for "a=mid:peerid-<id>" or "a=msid-semantic: WMS <id>")
-    std::string peer_id = "unknown_peer";
-    std::smatch match;
-    std::regex mid_regex(R"(a=mid:peerid-([^\r\n]+))");
-    std::regex wms_regex(R"(a=msid-semantic: WMS ([^\r\n]+))");
-    if (std::regex_search(offer, match, mid_regex) && match.size() > 1) {
-        peer_id = match[1];
-    } else if (std::regex_search(offer, match, wms_regex) && match.size() > 1) {
-        peer_id = match[1];
+bool WebRTCManager::SendDataToPeers(const void* data, size_t size, const std::vector<std::string>& peer_ids) {
+    auto snapshot = std::atomic_load(&impl_->send_snapshot);
+    if (!snapshot) {
+        return true;
+    }
+    bool use_workers = impl_->send_workers.IsRunning();
+    bool success = false;
+    size_t targets = 0;
+    for (const auto& peer_id : peer_ids) {
+        auto it = std::lower_bound(snapshot->begin(), snapshot->end(), peer_id,
+                                   [](const Impl::SendTarget& target, const std::string& id) {
+                                       return target.queue->GetPeerId() < id;
+                                   });
+        if (it == snapshot->end() || it->queue->GetPeerId() != peer_id || !it->queue->IsConnected()) {
+            continue;
+        }
+        targets++;
+        success |= impl_->SendToQueue(it->queue, static_cast<const uint8_t*>(data), size, use_workers);
+    }
+    return targets == 0 || success;
+}
+
+bool WebRTCManager::SendData(const void* data, size_t size) {
+    // Lock-free fan-out: the snapshot keeps every queue alive while we use it,
+    // and queueing never waits on a DataChannel
+    auto snapshot = std::atomic_load(&impl_->send_snapshot);
+    if (!snapshot) {
+        return false;
+    }
+
+    return impl_->SendToQueues(*snapshot, static_cast<const uint8_t*>(data), size);
+}
+
+void WebRTCManager::SetSignalingCallbacks(OnLocalDescriptionCallback on_description,
+                                          OnLocalCandidateCallback on_candidate) {
+    std::lock_guard<std::mutex> lock(impl_->signaling_mutex);
+    impl_->on_local_description = std::move(on_description);
+    impl_->on_local_candidate = std::move(on_candidate);
+}
+
+bool WebRTCManager::CreateOffer(const std::string& peer_id) {
+    auto peer = GetPeerConnection(peer_id);
+    if (!peer) {
+        peer = CreatePeerConnection(peer_id);
+    }
+    if (!peer || !peer->CreateOffer()) {
+        LOG_ERROR("Failed to start offer for peer: " + peer_id);
+        return false;
+    }
+    LOG_DEBUG("Offer negotiation started for peer: " + peer_id);
+    return true;
+}
+
+void WebRTCManager::ProcessOffer(const std::string& offer, const std::string& sender_id) {
+    // The manager lock is only taken inside Get/CreatePeerConnection: SDP
+    // processing must not stall senders or other signaling.
+    // Signaling normally names the sender; older coordinators only tag the SDP.
+    std::string peer_id = sender_id.empty() ? SdpScanner::ExtractPeerId(offer) : sender_id;
+    if (peer_id.empty()) {
+        peer_id = "unknown_peer";
     }
     auto peer = GetPeerConnection(peer_id);
     if (!peer) {
         peer = CreatePeerConnection(peer_id);
     }
     if (peer && peer->SetRemoteDescription(offer)) {
-        std::string answer;
-        if (peer->CreateAnswer(answer)) {
-            LOG_INFO("Processed offer and created answer for peer: " + peer_id);
+        if (peer->CreateAnswer()) {
+            LOG_INFO("Processed offer, answer pending for peer: " + peer_id);
             // Telemetry: log event
-            LOG_DEBUG("Telemetry: Offer processed, answer created for peer " + peer_id);
-            // TODO: Send answer back to signaling server here if needed
+            LOG_DEBUG("Telemetry: Offer processed for peer " + peer_id);
         } else {
             LOG_ERROR("Failed to create answer for peer: " + peer_id);
         }
@@ -213,18 +580,32 @@ void WebRTCManager::ProcessOffer(const std::string& offer) {
     }
 }
 
-void WebRTCManager::AddIceCandidate(const std::string& candidate) {
-    std::lock_guard<std::mutex> lock(impl_->mutex);
-    // In modern WebRTC, ICE candidates are associated by MID or ufrag, but here we use a simple mapping.
-    for (const auto& peer : impl_->peers) {
-        if (peer->AddIceCandidate(candidate)) {
-            LOG_INFO("Added ICE candidate for peer: " + peer->GetPeerId());
-            // Telemetry: log event
-            LOG_DEBUG("Telemetry: ICE candidate added for peer " + peer->GetPeerId());
-            return;
-        }
+bool WebRTCManager::ProcessAnswer(const std::string& peer_id, const std::string& answer) {
+    auto peer = GetPeerConnection(peer_id);
+    if (!peer) {
+        LOG_WARN("Answer from unknown peer: " + peer_id);
+        return false;
     }
-    LOG_ERROR("No peer connection accepted the ICE candidate: " + candidate);
+    if (!peer->SetRemoteDescription(answer)) {
+        LOG_ERROR("Failed to apply answer from peer: " + peer_id);
+        return false;
+    }
+    LOG_INFO("Applied answer from peer: " + peer_id);
+    return true;
+}
+
+bool WebRTCManager::AddIceCandidate(const std::string& peer_id, const std::string& candidate, const std::string& mid) {
+    auto peer = GetPeerConnection(peer_id);
+    if (!peer) {
+        LOG_WARN("ICE candidate for unknown peer: " + peer_id);
+        return false;
+    }
+    if (!peer->AddIceCandidate(candidate, mid)) {
+        return false;
+    }
+    // Telemetry: log event
+    LOG_DEBUG("Telemetry: ICE candidate added for peer " + peer_id);
+    return true;
 }
 
 } // namespace P2P
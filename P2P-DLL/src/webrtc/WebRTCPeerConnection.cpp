@@ -1,24 +1,44 @@
 // WebRTCPeerConnection.cpp - Production implementation using libdatachannel and msquic
 #include "../../include/WebRTCPeerConnection.h"
 #include "../../include/SecurityManager.h"
+#include "../../include/ChannelSelector.h"
+#include "../../include/PacketBatcher.h"
+#include "../../include/ReorderWindow.h"
 #include "../../include/Logger.h"
 #include <rtc/rtc.hpp>
 // #include <msquic.h> // msquic integration is disabled for clean build
+#include <algorithm>
+#include <array>
 #include <mutex>
 #include <memory>
 #include <vector>
 #include <string>
-#include <thread>
+#include <chrono>
 #include <atomic>
 #include <cstring>
+#include <deque>
 
 namespace P2P {
 
+namespace {
+
+using Channel = ChannelSelector::Channel;
+
+int64_t NowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
 
 struct WebRTCPeerConnection::Impl {
     std::string peer_id;
     std::shared_ptr<rtc::PeerConnection> pc;
-    std::shared_ptr<rtc::DataChannel> dc;
+    std::shared_ptr<rtc::DataChannel> dc;        // Reliable, ordered
+    std::shared_ptr<rtc::DataChannel> state_dc;  // Unordered, no retransmissions
+    // Reliable, ordered; a separate SCTP stream per channel so urgent packets
+    // never wait behind bulk data (indexed by ChannelSelector::Channel)
+    std::array<std::shared_ptr<rtc::DataChannel>, ChannelSelector::PRIORITY_CHANNEL_COUNT> priority_dc;
     // msquic/QUIC transport is disabled for this build
     bool connected = false;
     bool initialized = false;
@@ -30,6 +50,7 @@ struct WebRTCPeerConnection::Impl {
     OnDataCallback on_data;
     OnStateChangeCallback on_state_change;
     OnIceCandidateCallback on_ice_candidate;
+    OnLocalDescriptionCallback on_local_description;
     OnPacketCallback on_packet;
 
     // Anti-cheat/reputation
@@ -38,18 +59,66 @@ struct WebRTCPeerConnection::Impl {
     int total_packet_count = 0;
     std::chrono::steady_clock::time_point last_anomaly_check = std::chrono::steady_clock::now();
 
-    // ECDHE Key Exchange
-    SecurityManager* security_manager = nullptr;
-    bool encryption_ready = false;
+    // ECDHE Key Exchange. The receive path reads these without a lock (it
+    // may run under state_mutex); they change only under key_mutex.
+    std::atomic<SecurityManager*> security_manager{nullptr};
+    std::atomic<SecurityManager::PeerKeyHandle> peer_key{SecurityManager::INVALID_PEER_KEY};
+    std::atomic<bool> encryption_ready{false}; // Set once the peer's key is installed
+
+    // Handshake progress. Handshake replies are sent while it is held, so
+    // key_mutex is taken before mutex and never under mutex or state_mutex.
+    std::mutex key_mutex;
     bool key_exchange_initiated = false;
     bool peer_key_received = false;
 
+    // Sealed messages that arrive before our key is installed: the remote
+    // installs its key first and may start sending (on any channel) before
+    // its public key reaches us. Replayed in arrival order once the key is
+    // in; early_mutex is a leaf lock, so it may be taken under any other.
+    static constexpr size_t MAX_EARLY_MESSAGES = 256;
+    std::mutex early_mutex;
+    std::deque<PacketBuffer> early_messages;
+    bool replaying_early = false;
+
     // Key exchange packet type
-    static constexpr uint16_t KEY_EXCHANGE_PACKET = 0xFF00;
+    static constexpr uint16_t KEY_EXCHANGE_PACKET = ChannelSelector::KEY_EXCHANGE_PACKET_TYPE;
+    // Marks a message sealed with this peer's key: [0xFF02][SecurityManager frame]
+    static constexpr uint16_t ENCRYPTED_PACKET = 0xFF02;
+    static constexpr size_t MARKER_SIZE = 2;
+
+    // State channel: [sequence u32][packet]
+    static constexpr size_t STATE_HEADER_SIZE = 4;
+    bool state_channel_enabled = true;
+    bool priority_channels_enabled = true;
+    uint32_t next_state_sequence = 0;
+    // Room for the IV, compression header, marker and state header, so a
+    // message is framed without being copied again
+    static constexpr size_t FRAME_HEADROOM = SecurityManager::PACKET_HEADROOM + MARKER_SIZE + STATE_HEADER_SIZE;
+
+    // Receive side of the state channel. Messages arrive on libdatachannel
+    // threads, so it has its own lock; the main mutex is never taken under it.
+    std::mutex state_mutex;
+    ReorderWindow state_window;
 
     std::mutex mutex;
-    std::string local_sdp;
-    bool gathering_complete = false;
+
+    // An open channel to send on, or nullptr (called with mutex held)
+    std::shared_ptr<rtc::DataChannel> OpenChannel(Channel channel) const {
+        std::shared_ptr<rtc::DataChannel> candidate;
+        if (channel == Channel::STATE) {
+            candidate = state_channel_enabled ? state_dc : nullptr;
+        } else if (ChannelSelector::IsPriorityChannel(channel)) {
+            candidate = priority_channels_enabled ? priority_dc[static_cast<size_t>(channel)] : nullptr;
+        } else {
+            candidate = dc;
+        }
+        return candidate && candidate->isOpen() ? candidate : nullptr;
+    }
+
+    // Trickle ICE: candidates that arrive before the remote description are
+    // held back until it is set
+    bool remote_description_set = false;
+    std::vector<rtc::Candidate> pending_candidates;
 };
 
 WebRTCPeerConnection::WebRTCPeerConnection(const std::string& peer_id)
@@ -67,6 +136,8 @@ bool WebRTCPeerConnection::Initialize(const std::vector<std::string>& stun, cons
     std::lock_guard<std::mutex> lock(impl_->mutex);
 
     rtc::Configuration config;
+    // Offers and answers are created explicitly by CreateOffer/CreateAnswer
+    config.disableAutoNegotiation = true;
     // libdatachannel >=0.17: iceServers is a vector of urls directly
     for (const auto& s : stun) {
         config.iceServers.push_back(s);
@@ -115,117 +186,54 @@ bool WebRTCPeerConnection::Initialize(const std::vector<std::string>& stun, cons
             }
         });
 
-        impl_->pc->onGatheringStateChange([this](rtc::PeerConnection::GatheringState state) {
+        impl_->pc->onGatheringStateChange([](rtc::PeerConnection::GatheringState state) {
             LOG_DEBUG("ICE Gathering state: " + std::to_string(static_cast<int>(state)));
-            if (state == rtc::PeerConnection::GatheringState::Complete) {
-                impl_->gathering_complete = true;
-            }
         });
 
+        // Signaling callbacks run outside the lock so they may call back into this peer
         impl_->pc->onLocalDescription([this](rtc::Description desc) {
-            LOG_INFO("Local SDP (" + desc.typeString() + "):\n" + desc.generateSdp());
-            std::lock_guard<std::mutex> lock(impl_->mutex);
-            impl_->local_sdp = desc.generateSdp();
+            std::string sdp = desc.generateSdp();
+            LOG_INFO("Local SDP (" + desc.typeString() + "):\n" + sdp);
+            OnLocalDescriptionCallback callback;
+            {
+                std::lock_guard<std::mutex> lock(impl_->mutex);
+                callback = impl_->on_local_description;
+            }
+            if (callback) {
+                callback(desc.typeString(), sdp);
+            }
         });
 
-        impl_->pc->onLocalCandidate([this](const rtc::Candidate& candidate) {
+        impl_->pc->onLocalCandidate([this](rtc::Candidate candidate) {
             LOG_DEBUG("Local ICE candidate: " + candidate.candidate());
-            if (impl_->on_ice_candidate) {
-                impl_->on_ice_candidate(candidate.candidate());
+            OnIceCandidateCallback callback;
+            {
+                std::lock_guard<std::mutex> lock(impl_->mutex);
+                callback = impl_->on_ice_candidate;
+            }
+            if (callback) {
+                callback(candidate.candidate(), candidate.mid());
             }
         });
 
         impl_->pc->onDataChannel([this](std::shared_ptr<rtc::DataChannel> channel) {
-            LOG_INFO("DataChannel received");
+            LOG_INFO("DataChannel received: " + channel->label());
             std::lock_guard<std::mutex> lock(impl_->mutex);
-            impl_->dc = channel;
-            // Inline SetupDataChannel logic
-            if (impl_->dc) {
-                impl_->dc->onOpen([this]() {
-                    std::lock_guard<std::mutex> lock(impl_->mutex);
-                    
-                    LOG_INFO("DataChannel open for: " + impl_->peer_id);
-                    impl_->connected = true;
-                    
-                    // Initiate key exchange if SecurityManager is set
-                    if (impl_->security_manager && !impl_->key_exchange_initiated) {
-                        InitiateKeyExchange();
-                    }
-                    
-                    if (impl_->on_state_change) {
-                        impl_->on_state_change(true);
-                    }
-                });
-                impl_->dc->onClosed([this]() {
-                    std::lock_guard<std::mutex> lock(impl_->mutex);
-                    
-                    LOG_INFO("DataChannel closed for: " + impl_->peer_id);
-                    impl_->connected = false;
-                    impl_->encryption_ready = false;
-                    impl_->key_exchange_initiated = false;
-                    impl_->peer_key_received = false;
-                    
-                    if (impl_->on_state_change) {
-                        impl_->on_state_change(false);
-                    }
-                });
-                impl_->dc->onMessage([this](rtc::message_variant data) {
-                    if (std::holds_alternative<rtc::binary>(data)) {
-                        const auto& bin = std::get<rtc::binary>(data);
-                        HandleReceivedData(reinterpret_cast<const uint8_t*>(bin.data()), bin.size());
-                    } else if (std::holds_alternative<std::string>(data)) {
-                        const auto& str = std::get<std::string>(data);
-                        HandleReceivedData(reinterpret_cast<const uint8_t*>(str.data()), str.size());
-                    }
-                });
+            Channel kind = Channel::DATA;
+            ChannelSelector::FromLabel(channel->label(), kind);
+            if (kind == Channel::STATE) {
+                impl_->state_dc = channel;
+                SetupStateChannel();
+            } else if (ChannelSelector::IsPriorityChannel(kind)) {
+                size_t index = static_cast<size_t>(kind);
+                impl_->priority_dc[index] = channel;
+                SetupPriorityChannel(index);
+            } else {
+                impl_->dc = channel;
+                SetupDataChannel();
             }
         });
 
-        // If this is the offerer, create a data channel immediately
-        if (!impl_->dc) {
-            impl_->dc = impl_->pc->createDataChannel("data");
-            // Inline SetupDataChannel logic
-            if (impl_->dc) {
-                impl_->dc->onOpen([this]() {
-                    std::lock_guard<std::mutex> lock(impl_->mutex);
-                    
-                    LOG_INFO("DataChannel open for: " + impl_->peer_id);
-                    impl_->connected = true;
-                    
-                    // Initiate key exchange if SecurityManager is set
-                    if (impl_->security_manager && !impl_->key_exchange_initiated) {
-                        InitiateKeyExchange();
-                    }
-                    
-                    if (impl_->on_state_change) {
-                        impl_->on_state_change(true);
-                    }
-                });
-                impl_->dc->onClosed([this]() {
-                    std::lock_guard<std::mutex> lock(impl_->mutex);
-                    
-                    LOG_INFO("DataChannel closed for: " + impl_->peer_id);
-                    impl_->connected = false;
-                    impl_->encryption_ready = false;
-                    impl_->key_exchange_initiated = false;
-                    impl_->peer_key_received = false;
-                    
-                    if (impl_->on_state_change) {
-                        impl_->on_state_change(false);
-                    }
-                });
-                impl_->dc->onMessage([this](rtc::message_variant data) {
-                    if (std::holds_alternative<rtc::binary>(data)) {
-                        const auto& bin = std::get<rtc::binary>(data);
-                        HandleReceivedData(reinterpret_cast<const uint8_t*>(bin.data()), bin.size());
-                    } else if (std::holds_alternative<std::string>(data)) {
-                        const auto& str = std::get<std::string>(data);
-                        HandleReceivedData(reinterpret_cast<const uint8_t*>(str.data()), str.size());
-                    }
-                });
-            }
-        }
-
         // QUIC transport (msquic) is not yet supported in this build.
         // TODO: Re-enable msquic integration after clean build.
         impl_->initialized = true;
@@ -237,61 +245,249 @@ bool WebRTCPeerConnection::Initialize(const std::vector<std::string>& stun, cons
     }
 }
 
-// SetupDataChannel removed
+void WebRTCPeerConnection::SetupDataChannel() {
+    if (!impl_->dc) {
+        return;
+    }
+    impl_->dc->onOpen([this]() {
+        {
+            std::lock_guard<std::mutex> lock(impl_->mutex);
 
-void WebRTCPeerConnection::Close() {
-    std::lock_guard<std::mutex> lock(impl_->mutex);
-    if (impl_->dc) {
-        impl_->dc->close();
-        impl_->dc.reset();
+            LOG_INFO("DataChannel open for: " + impl_->peer_id);
+            impl_->connected = true;
+
+            if (impl_->on_state_change) {
+                impl_->on_state_change(true);
+            }
+        }
+
+        // Initiate key exchange if SecurityManager is set. The public key goes
+        // out through SendData, so this runs outside the main lock.
+        std::lock_guard<std::mutex> key_lock(impl_->key_mutex);
+        if (impl_->security_manager.load() && !impl_->key_exchange_initiated) {
+            InitiateKeyExchange();
+        }
+    });
+    impl_->dc->onClosed([this]() {
+        {
+            std::lock_guard<std::mutex> key_lock(impl_->key_mutex);
+            impl_->encryption_ready = false;
+            impl_->key_exchange_initiated = false;
+            impl_->peer_key_received = false;
+            ClearEarlyMessages();
+        }
+
+        std::lock_guard<std::mutex> lock(impl_->mutex);
+
+        LOG_INFO("DataChannel closed for: " + impl_->peer_id);
+        impl_->connected = false;
+
+        if (impl_->on_state_change) {
+            impl_->on_state_change(false);
+        }
+    });
+    impl_->dc->onMessage([this](rtc::message_variant data) {
+        if (std::holds_alternative<rtc::binary>(data)) {
+            const auto& bin = std::get<rtc::binary>(data);
+            HandleReceivedData(reinterpret_cast<const uint8_t*>(bin.data()), bin.size());
+        } else if (std::holds_alternative<std::string>(data)) {
+            const auto& str = std::get<std::string>(data);
+            HandleReceivedData(reinterpret_cast<const uint8_t*>(str.data()), str.size());
+        }
+    });
+}
+
+void WebRTCPeerConnection::SetupStateChannel() {
+    if (!impl_->state_dc) {
+        return;
     }
-    if (impl_->pc) {
-        impl_->pc->close();
-        impl_->pc.reset();
+    impl_->state_dc->onOpen([this]() {
+        LOG_INFO("State channel open for: " + impl_->peer_id);
+    });
+    impl_->state_dc->onClosed([this]() {
+        LOG_INFO("State channel closed for: " + impl_->peer_id);
+        std::lock_guard<std::mutex> lock(impl_->state_mutex);
+        impl_->state_window.Reset();
+    });
+    impl_->state_dc->onMessage([this](rtc::message_variant data) {
+        if (std::holds_alternative<rtc::binary>(data)) {
+            const auto& bin = std::get<rtc::binary>(data);
+            HandleStateMessage(reinterpret_cast<const uint8_t*>(bin.data()), bin.size());
+        }
+    });
+}
+
+void WebRTCPeerConnection::SetupPriorityChannel(size_t index) {
+    const auto& channel = impl_->priority_dc[index];
+    if (!channel) {
+        return;
     }
-    // msquic/QUIC transport is disabled in this build
-    impl_->connected = false;
-    impl_->initialized = false;
-    LOG_INFO("WebRTCPeerConnection closed for: " + impl_->peer_id);
+    const char* label = ChannelSelector::GetLabel(static_cast<Channel>(index));
+    channel->onOpen([this, label]() {
+        LOG_DEBUG_FMT("Priority channel '{}' open for: {}", label, impl_->peer_id);
+    });
+    channel->onClosed([this, label]() {
+        LOG_DEBUG_FMT("Priority channel '{}' closed for: {}", label, impl_->peer_id);
+    });
+    channel->onMessage([this](rtc::message_variant data) {
+        if (std::holds_alternative<rtc::binary>(data)) {
+            const auto& bin = std::get<rtc::binary>(data);
+            HandleReceivedData(reinterpret_cast<const uint8_t*>(bin.data()), bin.size());
+        }
+    });
+}
+
+void WebRTCPeerConnection::HandleStateMessage(const uint8_t* data, size_t size) {
+    if (!data || size < Impl::STATE_HEADER_SIZE + 2) {
+        LOG_WARN("Invalid state message received from: " + impl_->peer_id);
+        return;
+    }
+    uint32_t sequence = static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) |
+                        (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+    // Key exchange replies take the main lock, which must not be taken under
+    // state_mutex; it only ever travels on the reliable channel
+    if (PacketView(data + Impl::STATE_HEADER_SIZE, size - Impl::STATE_HEADER_SIZE).type == Impl::KEY_EXCHANGE_PACKET) {
+        LOG_WARN("Key exchange packet on state channel from: " + impl_->peer_id + " - dropping");
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(impl_->state_mutex);
+    impl_->state_window.Push(sequence, data + Impl::STATE_HEADER_SIZE, size - Impl::STATE_HEADER_SIZE, NowMicros(),
+                             [this](const uint8_t* packet, size_t length) {
+                                 HandleReceivedData(packet, length);
+                             });
+}
+
+void WebRTCPeerConnection::ConfigureStateChannel(bool enabled, int jitter_budget_ms) {
+    {
+        std::lock_guard<std::mutex> lock(impl_->mutex);
+        impl_->state_channel_enabled = enabled;
+    }
+    std::lock_guard<std::mutex> lock(impl_->state_mutex);
+    impl_->state_window.SetJitterBudget(static_cast<int64_t>(std::max(jitter_budget_ms, 0)) * 1000);
 }
 
-bool WebRTCPeerConnection::CreateOffer(std::string& sdp_out) {
+void WebRTCPeerConnection::ConfigurePriorityChannels(bool enabled) {
     std::lock_guard<std::mutex> lock(impl_->mutex);
-    if (!impl_->pc) {
-        LOG_ERROR("PeerConnection not initialized");
-        return false;
+    impl_->priority_channels_enabled = enabled;
+}
+
+void WebRTCPeerConnection::PollStateChannel() {
+    std::lock_guard<std::mutex> lock(impl_->state_mutex);
+    if (impl_->state_window.GetBufferedCount() == 0) {
+        return;
     }
+    impl_->state_window.Poll(NowMicros(), [this](const uint8_t* packet, size_t length) {
+        HandleReceivedData(packet, length);
+    });
+}
+
+void WebRTCPeerConnection::Close() {
+    // The channels are closed after the locks are released: libdatachannel
+    // may run onClosed synchronously, and that handler takes key_mutex
+    std::shared_ptr<rtc::DataChannel> dc;
+    std::shared_ptr<rtc::DataChannel> state_dc;
+    std::array<std::shared_ptr<rtc::DataChannel>, ChannelSelector::PRIORITY_CHANNEL_COUNT> priority_dc;
+    std::shared_ptr<rtc::PeerConnection> pc;
+    {
+        std::lock_guard<std::mutex> key_lock(impl_->key_mutex);
+        std::lock_guard<std::mutex> lock(impl_->mutex);
+        dc = std::move(impl_->dc);
+        state_dc = std::move(impl_->state_dc);
+        for (size_t i = 0; i < priority_dc.size(); ++i) {
+            priority_dc[i] = std::move(impl_->priority_dc[i]);
+        }
+        pc = std::move(impl_->pc);
+        // msquic/QUIC transport is disabled in this build
+        impl_->connected = false;
+        impl_->initialized = false;
+        impl_->remote_description_set = false;
+        impl_->pending_candidates.clear();
+        impl_->encryption_ready = false;
+        impl_->key_exchange_initiated = false;
+        impl_->peer_key_received = false;
+        ClearEarlyMessages();
+        SecurityManager* security_manager = impl_->security_manager.load();
+        SecurityManager::PeerKeyHandle peer_key = impl_->peer_key.exchange(SecurityManager::INVALID_PEER_KEY);
+        if (security_manager && peer_key != SecurityManager::INVALID_PEER_KEY) {
+            security_manager->ReleasePeerKey(peer_key);
+        }
+    }
+
+    if (dc) {
+        dc->close();
+    }
+    if (state_dc) {
+        state_dc->close();
+    }
+    for (auto& channel : priority_dc) {
+        if (channel) {
+            channel->close();
+        }
+    }
+    {
+        std::lock_guard<std::mutex> state_lock(impl_->state_mutex);
+        impl_->state_window.Reset();
+    }
+    if (pc) {
+        pc->close();
+    }
+    LOG_INFO("WebRTCPeerConnection closed for: " + impl_->peer_id);
+}
+
+bool WebRTCPeerConnection::CreateOffer() {
+    // setLocalDescription fires onLocalDescription, which takes the lock
+    std::shared_ptr<rtc::PeerConnection> pc;
     try {
-        impl_->pc->setLocalDescription();
-        // Wait for gathering to complete (in production, use async/callback)
-        int wait_ms = 0;
-        while (!impl_->gathering_complete && wait_ms < 5000) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
-            wait_ms += 10;
+        {
+            std::lock_guard<std::mutex> lock(impl_->mutex);
+            if (!impl_->pc) {
+                LOG_ERROR("PeerConnection not initialized");
+                return false;
+            }
+            pc = impl_->pc;
+            // The offerer opens the data channels so the offer carries their SCTP section
+            if (!impl_->dc) {
+                impl_->dc = pc->createDataChannel(ChannelSelector::GetLabel(Channel::DATA));
+                SetupDataChannel();
+            }
+            if (impl_->state_channel_enabled && !impl_->state_dc) {
+                rtc::DataChannelInit init;
+                init.reliability.unordered = true;
+                init.reliability.maxRetransmits = 0;
+                impl_->state_dc = pc->createDataChannel(ChannelSelector::GetLabel(Channel::STATE), init);
+                SetupStateChannel();
+            }
+            if (impl_->priority_channels_enabled) {
+                for (size_t i = 0; i < ChannelSelector::PRIORITY_CHANNEL_COUNT; ++i) {
+                    if (!impl_->priority_dc[i]) {
+                        impl_->priority_dc[i] = pc->createDataChannel(ChannelSelector::GetLabel(static_cast<Channel>(i)));
+                        SetupPriorityChannel(i);
+                    }
+                }
+            }
         }
-        sdp_out = impl_->local_sdp;
-        return !sdp_out.empty();
+        pc->setLocalDescription(rtc::Description::Type::Offer);
+        return true;
     } catch (const std::exception& e) {
         LOG_ERROR("Failed to create offer: " + std::string(e.what()));
         return false;
     }
 }
 
-bool WebRTCPeerConnection::CreateAnswer(std::string& sdp_out) {
-    std::lock_guard<std::mutex> lock(impl_->mutex);
-    if (!impl_->pc) {
-        LOG_ERROR("PeerConnection not initialized");
-        return false;
+bool WebRTCPeerConnection::CreateAnswer() {
+    std::shared_ptr<rtc::PeerConnection> pc;
+    {
+        std::lock_guard<std::mutex> lock(impl_->mutex);
+        if (!impl_->pc) {
+            LOG_ERROR("PeerConnection not initialized");
+            return false;
+        }
+        pc = impl_->pc;
     }
     try {
-        impl_->pc->setLocalDescription();
-        int wait_ms = 0;
-        while (!impl_->gathering_complete && wait_ms < 5000) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
-            wait_ms += 10;
-        }
-        sdp_out = impl_->local_sdp;
-        return !sdp_out.empty();
+        pc->setLocalDescription(rtc::Description::Type::Answer);
+        return true;
     } catch (const std::exception& e) {
         LOG_ERROR("Failed to create answer: " + std::string(e.what()));
         return false;
@@ -299,28 +495,60 @@ bool WebRTCPeerConnection::CreateAnswer(std::string& sdp_out) {
 }
 
 bool WebRTCPeerConnection::SetRemoteDescription(const std::string& sdp) {
-    std::lock_guard<std::mutex> lock(impl_->mutex);
-    if (!impl_->pc) {
-        LOG_ERROR("PeerConnection not initialized");
-        return false;
+    std::shared_ptr<rtc::PeerConnection> pc;
+    {
+        std::lock_guard<std::mutex> lock(impl_->mutex);
+        if (!impl_->pc) {
+            LOG_ERROR("PeerConnection not initialized");
+            return false;
+        }
+        pc = impl_->pc;
     }
+
+    std::vector<rtc::Candidate> pending;
     try {
-        impl_->pc->setRemoteDescription(sdp);
-        return true;
+        pc->setRemoteDescription(rtc::Description(sdp));
+        std::lock_guard<std::mutex> lock(impl_->mutex);
+        impl_->remote_description_set = true;
+        pending.swap(impl_->pending_candidates);
     } catch (const std::exception& e) {
         LOG_ERROR("Failed to set remote description: " + std::string(e.what()));
         return false;
     }
+
+    for (auto& candidate : pending) {
+        try {
+            pc->addRemoteCandidate(std::move(candidate));
+        } catch (const std::exception& e) {
+            LOG_WARN("Dropped early ICE candidate for " + impl_->peer_id + ": " + std::string(e.what()));
+        }
+    }
+    if (!pending.empty()) {
+        LOG_DEBUG_FMT("Applied {} early ICE candidate(s) for: {}", pending.size(), impl_->peer_id);
+    }
+    return true;
 }
 
-bool WebRTCPeerConnection::AddIceCandidate(const std::string& candidate) {
-    std::lock_guard<std::mutex> lock(impl_->mutex);
-    if (!impl_->pc) {
-        LOG_ERROR("PeerConnection not initialized");
+bool WebRTCPeerConnection::AddIceCandidate(const std::string& candidate, const std::string& mid) {
+    std::shared_ptr<rtc::PeerConnection> pc;
+    try {
+        std::lock_guard<std::mutex> lock(impl_->mutex);
+        if (!impl_->pc) {
+            LOG_ERROR("PeerConnection not initialized");
+            return false;
+        }
+        if (!impl_->remote_description_set) {
+            impl_->pending_candidates.emplace_back(candidate, mid);
+            LOG_DEBUG("Queued ICE candidate until remote description for: " + impl_->peer_id);
+            return true;
+        }
+        pc = impl_->pc;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Invalid ICE candidate: " + std::string(e.what()));
         return false;
     }
     try {
-        impl_->pc->addRemoteCandidate(candidate);
+        pc->addRemoteCandidate(rtc::Candidate(candidate, mid));
         LOG_DEBUG("Added ICE candidate for: " + impl_->peer_id);
         return true;
     } catch (const std::exception& e) {
@@ -330,15 +558,69 @@ bool WebRTCPeerConnection::AddIceCandidate(const std::string& candidate) {
 }
 
 bool WebRTCPeerConnection::SendData(const uint8_t* data, size_t size) {
+    // Classify and seal before taking the lock: neither touches channel state,
+    // and each walks the message only once
+    ChannelSelector::Selection selection = ChannelSelector::Select(data, size);
+    bool key_exchange = PacketView(data, size).type == Impl::KEY_EXCHANGE_PACKET;
+    PacketBuffer frame = PacketBufferPool::GetInstance().Acquire(
+        Impl::FRAME_HEADROOM + size + SecurityManager::ENCRYPTION_TAILROOM, Impl::FRAME_HEADROOM);
+    frame.Assign(data, size);
+
+    // Everything but the handshake is sealed with this peer's key, and
+    // nothing goes out before the key exchange has completed
+    SecurityManager* security_manager = impl_->security_manager.load();
+    if (security_manager && !key_exchange) {
+        if (!impl_->encryption_ready.load(std::memory_order_acquire)) {
+            LOG_WARN_FMT("Encryption not ready for: {} - dropping packet", impl_->peer_id);
+            return false;
+        }
+        if (!security_manager->EncryptPacket(impl_->peer_key.load(), frame)) {
+            LOG_ERROR_FMT("Failed to encrypt packet for: {}", impl_->peer_id);
+            return false;
+        }
+        uint8_t* marker = frame.Prepend(Impl::MARKER_SIZE);
+        if (!marker) {
+            LOG_ERROR_FMT("No headroom for encrypted packet marker to: {}", impl_->peer_id);
+            return false;
+        }
+        marker[0] = static_cast<uint8_t>(Impl::ENCRYPTED_PACKET & 0xFF);
+        marker[1] = static_cast<uint8_t>((Impl::ENCRYPTED_PACKET >> 8) & 0xFF);
+    }
+
     std::lock_guard<std::mutex> lock(impl_->mutex);
     if (!impl_->connected || !impl_->dc || !impl_->dc->isOpen()) {
-        LOG_ERROR("Data channel not open for: " + impl_->peer_id);
+        LOG_ERROR_FMT("Data channel not open for: {}", impl_->peer_id);
         return false;
     }
     try {
-        rtc::binary bin(reinterpret_cast<const std::byte*>(data), reinterpret_cast<const std::byte*>(data) + size);
-        impl_->dc->send(bin);
-        LOG_DEBUG("Sent " + std::to_string(size) + " bytes to: " + impl_->peer_id);
+        // Superseded state prefers the state channel, which skips SCTP
+        // retransmission and ordering; everything else its priority channel,
+        // so a CRITICAL packet never queues behind bulk data. Key exchange
+        // stays on "data", as does anything whose channel is not open.
+        std::shared_ptr<rtc::DataChannel> channel = impl_->OpenChannel(selection.preferred);
+        if (!channel) {
+            channel = impl_->OpenChannel(selection.fallback);
+        }
+        if (!channel) {
+            channel = impl_->dc;
+        }
+
+        if (channel == impl_->state_dc) {
+            uint8_t* header = frame.Prepend(Impl::STATE_HEADER_SIZE);
+            if (!header) {
+                LOG_ERROR_FMT("No headroom for state header to: {}", impl_->peer_id);
+                return false;
+            }
+            uint32_t sequence = impl_->next_state_sequence++;
+            for (size_t i = 0; i < Impl::STATE_HEADER_SIZE; ++i) {
+                header[i] = static_cast<uint8_t>(sequence >> (8 * i));
+            }
+        }
+
+        // Pointer/size overload: libdatachannel copies once into its own send queue,
+        // so no intermediate rtc::binary is built here
+        channel->send(reinterpret_cast<const std::byte*>(frame.Data()), frame.Size());
+        LOG_DEBUG_FMT("Sent {} bytes to: {} on '{}'", size, impl_->peer_id, channel->label());
         return true;
     } catch (const std::exception& e) {
         LOG_ERROR("Failed to send data: " + std::string(e.what()));
@@ -372,6 +654,11 @@ void WebRTCPeerConnection::SetOnIceCandidateCallback(OnIceCandidateCallback call
     impl_->on_ice_candidate = callback;
 }
 
+void WebRTCPeerConnection::SetOnLocalDescriptionCallback(OnLocalDescriptionCallback callback) {
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    impl_->on_local_description = callback;
+}
+
 void WebRTCPeerConnection::SetOnPacketCallback(OnPacketCallback callback) {
     std::lock_guard<std::mutex> lock(impl_->mutex);
     impl_->on_packet = callback;
@@ -414,20 +701,32 @@ float WebRTCPeerConnection::GetPeerScore() const {
 }
 
 void WebRTCPeerConnection::SetSecurityManager(SecurityManager* security_manager) {
-    std::lock_guard<std::mutex> lock(impl_->mutex);
+    std::lock_guard<std::mutex> key_lock(impl_->key_mutex);
+    impl_->encryption_ready = false;
+    impl_->key_exchange_initiated = false;
+    impl_->peer_key_received = false;
+    ClearEarlyMessages();
+    SecurityManager* previous = impl_->security_manager.load();
+    SecurityManager::PeerKeyHandle previous_key = impl_->peer_key.load();
+    if (previous && previous_key != SecurityManager::INVALID_PEER_KEY) {
+        previous->ReleasePeerKey(previous_key);
+    }
+    impl_->peer_key = security_manager ? security_manager->AcquirePeerKey(impl_->peer_id)
+                                       : SecurityManager::INVALID_PEER_KEY;
     impl_->security_manager = security_manager;
     LOG_INFO("SecurityManager set for peer: " + impl_->peer_id);
 }
 
 bool WebRTCPeerConnection::IsEncryptionReady() const {
-    std::lock_guard<std::mutex> lock(impl_->mutex);
-    return impl_->encryption_ready;
+    return impl_->encryption_ready.load(std::memory_order_acquire);
 }
 
 // Private helper methods
 
+// Called with key_mutex held
 void WebRTCPeerConnection::InitiateKeyExchange() {
-    if (!impl_->security_manager) {
+    SecurityManager* security_manager = impl_->security_manager.load();
+    if (!security_manager) {
         LOG_ERROR("Cannot initiate key exchange: SecurityManager not set");
         return;
     }
@@ -438,13 +737,13 @@ void WebRTCPeerConnection::InitiateKeyExchange() {
     }
 
     // Generate ECDHE keypair
-    if (!impl_->security_manager->GenerateECDHKeypair()) {
+    if (!security_manager->GenerateECDHKeypair(impl_->peer_key.load())) {
         LOG_ERROR("Failed to generate ECDHE keypair for: " + impl_->peer_id);
         return;
     }
 
     // Get public key
-    std::vector<uint8_t> public_key = impl_->security_manager->GetPublicKey();
+    std::vector<uint8_t> public_key = security_manager->GetPublicKey(impl_->peer_key.load());
     if (public_key.empty()) {
         LOG_ERROR("Failed to get public key for: " + impl_->peer_id);
         return;
@@ -482,25 +781,111 @@ void WebRTCPeerConnection::HandleReceivedData(const uint8_t* data, size_t size)
         return;
     }
 
-    // Check if this is a key exchange packet
     uint16_t packet_type = static_cast<uint16_t>(data[0]) | (static_cast<uint16_t>(data[1]) << 8);
-    
+
     if (packet_type == Impl::KEY_EXCHANGE_PACKET) {
         HandleKeyExchangePacket(data, size);
-    } else {
-        // Regular data packet - forward to callback if encryption is ready
-        if (!impl_->security_manager || impl_->encryption_ready) {
-            if (impl_->on_data) {
-                impl_->on_data(data, size);
+        return;
+    }
+
+    SecurityManager* security_manager = impl_->security_manager.load();
+    if (!security_manager) {
+        if (packet_type == Impl::ENCRYPTED_PACKET) {
+            LOG_WARN("Received encrypted packet without a SecurityManager from: " + impl_->peer_id + " - dropping");
+            return;
+        }
+        DeliverPackets(data, size);
+        return;
+    }
+
+    if (packet_type != Impl::ENCRYPTED_PACKET) {
+        LOG_WARN("Received unencrypted packet from: " + impl_->peer_id + " - dropping");
+        return;
+    }
+
+    PacketBuffer frame = PacketBufferPool::GetInstance().Acquire(size - Impl::MARKER_SIZE);
+    frame.Assign(data + Impl::MARKER_SIZE, size - Impl::MARKER_SIZE);
+    {
+        // Until the key is in, and while earlier messages are replayed,
+        // messages queue so they are still delivered in arrival order
+        std::lock_guard<std::mutex> lock(impl_->early_mutex);
+        if (!impl_->encryption_ready.load(std::memory_order_acquire) || impl_->replaying_early) {
+            if (impl_->early_messages.size() >= Impl::MAX_EARLY_MESSAGES) {
+                LOG_WARN("Received data packet before encryption ready and early queue full - dropping");
+                return;
             }
-        } else {
-            LOG_WARN("Received data packet before encryption ready - dropping");
+            impl_->early_messages.push_back(std::move(frame));
+            return;
         }
     }
+    DecryptAndDeliver(frame);
+}
+
+void WebRTCPeerConnection::DecryptAndDeliver(PacketBuffer& frame) {
+    SecurityManager* security_manager = impl_->security_manager.load();
+    if (!security_manager || !security_manager->DecryptPacket(impl_->peer_key.load(), frame)) {
+        LOG_WARN("Failed to decrypt packet from: " + impl_->peer_id + " - dropping");
+        return;
+    }
+    DeliverPackets(frame.Data(), frame.Size());
+}
+
+void WebRTCPeerConnection::ReplayEarlyMessages() {
+    {
+        std::lock_guard<std::mutex> lock(impl_->early_mutex);
+        if (impl_->early_messages.empty() || impl_->replaying_early) {
+            return;
+        }
+        impl_->replaying_early = true;
+        LOG_DEBUG_FMT("Replaying {} message(s) received before encryption was ready from: {}",
+                      impl_->early_messages.size(), impl_->peer_id);
+    }
+    for (;;) {
+        PacketBuffer frame;
+        {
+            std::lock_guard<std::mutex> lock(impl_->early_mutex);
+            if (impl_->early_messages.empty()) {
+                impl_->replaying_early = false;
+                return;
+            }
+            frame = std::move(impl_->early_messages.front());
+            impl_->early_messages.pop_front();
+        }
+        DecryptAndDeliver(frame);
+    }
+}
+
+void WebRTCPeerConnection::ClearEarlyMessages() {
+    std::lock_guard<std::mutex> lock(impl_->early_mutex);
+    impl_->early_messages.clear();
+}
+
+void WebRTCPeerConnection::DeliverPackets(const uint8_t* data, size_t size) {
+    // PacketRouter signs every P2P frame once a signing key is loaded; the
+    // signature trails the frame (for a batch, it covers the whole batch)
+    SecurityManager* security_manager = impl_->security_manager.load();
+    if (security_manager && security_manager->IsSignatureEnabled()) {
+        size_t payload_size = 0;
+        if (!security_manager->VerifyFrameED25519(data, size, payload_size)) {
+            LOG_WARN("ED25519 signature check failed for packet from: " + impl_->peer_id + " - dropping");
+            return;
+        }
+        size = payload_size;
+    }
+    if (impl_->on_data) {
+        // Batch frames carry several packets; anything else passes through as-is
+        PacketBatcher::Unbatch(data, size, [this](const PacketView& packet) {
+            impl_->on_data(packet.data, packet.length);
+        });
+    }
 }
 
 void WebRTCPeerConnection::HandleKeyExchangePacket(const uint8_t* data, size_t size) {
-    if (!impl_->security_manager) {
+    // Serialises this peer's handshake against onOpen, onClosed and a
+    // duplicate key arriving on another channel thread
+    std::lock_guard<std::mutex> key_lock(impl_->key_mutex);
+    SecurityManager* security_manager = impl_->security_manager.load();
+    if (!security_manager) {
         LOG_ERROR("Cannot handle key exchange: SecurityManager not set");
         return;
     }
@@ -519,7 +904,7 @@ void WebRTCPeerConnection::HandleKeyExchangePacket(const uint8_t* data, size_t s
     // Extract key size
     uint16_t key_size = static_cast<uint16_t>(data[2]) | (static_cast<uint16_t>(data[3]) << 8);
     
-    if (size != 4 + key_size) {
+    if (size != 4 + static_cast<size_t>(key_size)) {
         LOG_ERROR("Key exchange packet size mismatch: expected " +
                  std::to_string(4 + key_size) + ", got " + std::to_string(size));
         return;
@@ -537,11 +922,17 @@ void WebRTCPeerConnection::HandleKeyExchangePacket(const uint8_t* data, size_t s
     }
 
     // Derive shared key
-    if (impl_->security_manager->DeriveSharedKey(peer_public_key)) {
+    // The key is published by DeriveSharedKey before encryption_ready, so a
+    // sender that sees the flag also sees the key
+    if (security_manager->DeriveSharedKey(impl_->peer_key.load(), peer_public_key)) {
         impl_->peer_key_received = true;
-        impl_->encryption_ready = true;
+        {
+            std::lock_guard<std::mutex> lock(impl_->early_mutex);
+            impl_->encryption_ready.store(true, std::memory_order_release);
+        }
         LOG_INFO("ECDHE key exchange completed for peer: " + impl_->peer_id +
                  " - Encryption is ready");
+        ReplayEarlyMessages();
     } else {
         LOG_ERROR("Failed to derive shared key for peer: " + impl_->peer_id);
     }
@@ -1,186 +1,129 @@
-#include "../../include/bandwidth/BandwidthManager.h"
-#include "../../include/Logger.h"
 #include <gtest/gtest.h>
-#include <thread>
+#include "BandwidthManager.h"
+#include "PacketBatcher.h"
 #include <chrono>
+#include <thread>
+#include <vector>
 
 namespace P2P {
 
 class BandwidthManagerTest : public ::testing::Test {
 protected:
     void SetUp() override {
-        // Initialize logger for testing
-        LoggingConfig log_config;
-        log_config.level = "debug";
-        log_config.file = "test_bandwidth.log";
-        log_config.console_output = true;
-        Logger::GetInstance().Initialize(log_config);
-        
-        // Default configuration for tests
-        config.critical_reserve_kbps = 128;
-        config.high_priority_kbps = 256;
-        config.normal_priority_kbps = 512;
-        config.low_priority_kbps = 768;
-        config.max_packet_size = 1400;
-        config.min_packet_size = 64;
-        
+        config.bandwidth_update_interval_ms = 100;
+        config.min_bitrate_kbps = 100.0f;
+        config.max_bitrate_kbps = 10000.0f;
         ASSERT_TRUE(bw_manager.Initialize(config));
     }
-    
+
     void TearDown() override {
         bw_manager.Shutdown();
     }
-    
-    EnhancedBandwidthConfig config;
+
+    BandwidthConfig config;
     BandwidthManager bw_manager;
 };
 
-TEST_F(BandwidthManagerTest, Initialization) {
-    BandwidthManager manager;
-    EnhancedBandwidthConfig test_config;
-    
-    // Test valid configuration
-    test_config.critical_reserve_kbps = 128;
-    test_config.high_priority_kbps = 256;
-    test_config.normal_priority_kbps = 512;
-    test_config.low_priority_kbps = 768;
-    test_config.max_packet_size = 1400;
-    test_config.min_packet_size = 64;
-    EXPECT_TRUE(manager.Initialize(test_config));
-    
-    // Test invalid configuration
-    test_config.max_packet_size = 0;
-    EXPECT_FALSE(manager.Initialize(test_config));
+TEST_F(BandwidthManagerTest, ConfiguresShaper) {
+    EXPECT_FLOAT_EQ(bw_manager.GetShaper().GetLinkRate(), config.max_bitrate_kbps);
+    // No scheduler running: nothing is held back
+    EXPECT_TRUE(bw_manager.CanSendPacket(PacketPriority::BACKGROUND));
 }
 
 TEST_F(BandwidthManagerTest, PacketPriorityClassification) {
-    // Test critical packets
-    EXPECT_EQ(BandwidthManager::GetPriorityForPacketType(0x0089), PacketPriority::CRITICAL); // Movement
-    EXPECT_EQ(BandwidthManager::GetPriorityForPacketType(0x0090), PacketPriority::CRITICAL); // Attack
-    
-    // Test high priority packets
-    EXPECT_EQ(BandwidthManager::GetPriorityForPacketType(0x008C), PacketPriority::HIGH); // Chat
-    EXPECT_EQ(BandwidthManager::GetPriorityForPacketType(0x0094), PacketPriority::HIGH); // NPC interaction
-    
-    // Test normal priority packets
-    EXPECT_EQ(BandwidthManager::GetPriorityForPacketType(0x008D), PacketPriority::NORMAL); // Global chat
-    EXPECT_EQ(BandwidthManager::GetPriorityForPacketType(0x008E), PacketPriority::NORMAL); // Party chat
-    
-    // Test low priority packets
-    EXPECT_EQ(BandwidthManager::GetPriorityForPacketType(0x00B0), PacketPriority::LOW); // Status effects
-    
-    // Test background priority for unknown packets
-    EXPECT_EQ(BandwidthManager::GetPriorityForPacketType(0xFFFF), PacketPriority::BACKGROUND);
+    EXPECT_EQ(BandwidthManager::GetPacketPriority(0x0085), PacketPriority::CRITICAL);  // Movement
+    EXPECT_EQ(BandwidthManager::GetPacketPriority(0x0089), PacketPriority::CRITICAL);  // Action
+    EXPECT_EQ(BandwidthManager::GetPacketPriority(0x0090), PacketPriority::CRITICAL);  // Attack
+    EXPECT_EQ(BandwidthManager::GetPacketPriority(0x008C), PacketPriority::HIGH);      // Chat
 }
 
-TEST_F(BandwidthManagerTest, BandwidthAllocation) {
-    // Test that we can send critical packets
-    EXPECT_TRUE(bw_manager.CanSendPacket(PacketPriority::CRITICAL, 100));
-    
-    // Send a packet and check bandwidth usage
-    bw_manager.PacketSent(PacketPriority::CRITICAL, 100);
-    uint32_t usage = bw_manager.GetCurrentUsage(PacketPriority::CRITICAL);
-    EXPECT_GT(usage, 0);
-}
+TEST_F(BandwidthManagerTest, MessagePriorityUsesMostUrgentBatchedPacket) {
+    const uint8_t emote[] = {0xA7, 0x00, 1, 2, 3};  // NORMAL
+    const uint8_t chat[] = {0x8C, 0x00, 1, 2, 3};   // HIGH
+    EXPECT_EQ(BandwidthManager::GetMessagePriority(emote, sizeof(emote)), PacketPriority::NORMAL);
+    EXPECT_EQ(BandwidthManager::GetMessagePriority(emote, 1), PacketPriority::LOW);
 
-TEST_F(BandwidthManagerTest, CongestionDetection) {
-    // Simulate high bandwidth usage
-    for (int i = 0; i < 100; ++i) {
-        bw_manager.PacketSent(PacketPriority::NORMAL, 1000); // 1KB packets
-    }
-    
-    // Should detect congestion
-    EXPECT_TRUE(bw_manager.IsCongested());
-    
-    // Critical packets should still be allowed
-    EXPECT_TRUE(bw_manager.CanSendPacket(PacketPriority::CRITICAL, 100));
-    
-    // Non-critical packets should be blocked
-    EXPECT_FALSE(bw_manager.CanSendPacket(PacketPriority::NORMAL, 100));
+    std::vector<uint8_t> batch;
+    PacketBatcher batcher;
+    PerformanceConfig performance;
+    performance.enable_packet_batching = true;
+    performance.packet_batch_size = 2;
+    performance.packet_batch_timeout_ms = 1000;
+    ASSERT_TRUE(batcher.Initialize(performance, [&](const std::string&, PacketBuffer& frame) {
+        batch.assign(frame.Data(), frame.Data() + frame.Size());
+        return true;
+    }));
+    batcher.Add("", PacketView(emote, sizeof(emote)));
+    batcher.Add("", PacketView(chat, sizeof(chat)));
+    batcher.Shutdown();
+    ASSERT_FALSE(batch.empty());
+    EXPECT_EQ(BandwidthManager::GetMessagePriority(batch.data(), batch.size()), PacketPriority::HIGH);
 }
 
-TEST_F(BandwidthManagerTest, QoSStatistics) {
-    // Update latency and packet loss
-    bw_manager.UpdateLatency(50.0);
-    bw_manager.UpdatePacketLoss(0.05);
-    
-    const auto& stats = bw_manager.GetQoSStats();
-    EXPECT_DOUBLE_EQ(stats.latency_ms, 50.0);
-    EXPECT_DOUBLE_EQ(stats.packet_loss_rate, 0.05);
-    EXPECT_GT(stats.jitter_ms, 0.0);
+TEST_F(BandwidthManagerTest, PacketSentChargesShaper) {
+    bw_manager.PacketSent(PacketPriority::LOW, 1000);
+    EXPECT_EQ(bw_manager.GetShaper().GetSentBytes(PacketPriority::LOW), 1000u);
 }
 
-TEST_F(BandwidthManagerTest, DynamicBandwidthAdjustment) {
-    // Simulate poor network conditions
-    bw_manager.UpdateLatency(200.0);
-    bw_manager.UpdatePacketLoss(0.2);
-    
-    // Should automatically adjust bandwidth
-    bw_manager.AdjustBandwidthBasedOnConditions();
-    
-    // Bandwidth should be reduced (check congestion state instead)
-    EXPECT_TRUE(bw_manager.IsCongested());
-}
+TEST_F(BandwidthManagerTest, RecommendedBitrateFollowsController) {
+    // Nothing sent yet: the configured target
+    EXPECT_FLOAT_EQ(bw_manager.GetRecommendedBitrate("peer"), config.target_bitrate_kbps);
+    EXPECT_FALSE(bw_manager.IsCongested("peer"));
 
-TEST_F(BandwidthManagerTest, PacketSizeValidation) {
-    // Valid packet size
-    EXPECT_TRUE(bw_manager.CanSendPacket(PacketPriority::NORMAL, config.max_packet_size));
-    
-    // Packet too large
-    EXPECT_FALSE(bw_manager.CanSendPacket(PacketPriority::NORMAL, config.max_packet_size + 1));
-    
-    // Packet too small
-    EXPECT_TRUE(bw_manager.CanSendPacket(PacketPriority::NORMAL, config.min_packet_size));
+    // Once the controller has feedback it decides, not the reported latency
+    bw_manager.UpdateLatency("peer", 400.0f);
+    int64_t now_us = CongestionController::NowMicros();
+    bw_manager.OnPacketSent("peer", 1, 1000, now_us);
+    EXPECT_TRUE(bw_manager.IsCongested("peer"));
+    EXPECT_TRUE(bw_manager.OnPacketAcked("peer", 1, now_us + 20000));
+    EXPECT_FALSE(bw_manager.IsCongested("peer"));
+    EXPECT_FALSE(bw_manager.OnPacketAcked("peer", 1, now_us + 20000));
+    EXPECT_FALSE(bw_manager.OnPacketLost("other", 1));
+    EXPECT_DOUBLE_EQ(bw_manager.GetPacingRate("peer"), bw_manager.GetRecommendedBitrate("peer") * 1000.0 / 8.0);
 }
 
-TEST_F(BandwidthManagerTest, PriorityBasedAccess) {
-    // Fill up bandwidth with low priority packets
-    for (int i = 0; i < 50; ++i) {
-        bw_manager.PacketSent(PacketPriority::LOW, 1000);
+TEST_F(BandwidthManagerTest, ReportedMetricsDecideWithoutFeedback) {
+    // Latency over 300 ms, then loss over 10%, with no controller feedback
+    bw_manager.UpdateLatency("slow", 400.0f);
+    EXPECT_TRUE(bw_manager.IsCongested("slow"));
+    EXPECT_FLOAT_EQ(bw_manager.GetRecommendedBitrate("slow"), config.target_bitrate_kbps * 0.6f);
+
+    bw_manager.UpdateLatency("lossy", 150.0f);
+    for (int i = 0; i < 9; ++i) {
+        bw_manager.UpdateReceivedMetrics("lossy", 100);
     }
-    
-    // High priority should still have access
-    EXPECT_TRUE(bw_manager.CanSendPacket(PacketPriority::HIGH, 100));
-    
-    // Critical priority should definitely have access
-    EXPECT_TRUE(bw_manager.CanSendPacket(PacketPriority::CRITICAL, 100));
-}
+    bw_manager.UpdatePacketLoss("lossy", 1);  // Exactly 10%
+    EXPECT_FALSE(bw_manager.IsCongested("lossy"));
+    EXPECT_FLOAT_EQ(bw_manager.GetRecommendedBitrate("lossy"), config.target_bitrate_kbps * 0.7f * 0.8f);
+    bw_manager.UpdatePacketLoss("lossy", 1);
+    EXPECT_TRUE(bw_manager.IsCongested("lossy"));
 
-TEST_F(BandwidthManagerTest, OptimalPacketSizeCalculation) {
-    // Good network - larger packets
-    bw_manager.UpdateLatency(20.0);
-    bw_manager.UpdatePacketLoss(0.01);
-    uint32_t size1 = bw_manager.CalculateOptimalPacketSize();
-    EXPECT_GE(size1, config.min_packet_size);
-    EXPECT_LE(size1, config.max_packet_size);
-    
-    // Poor network - smaller packets
-    bw_manager.UpdateLatency(100.0);
-    bw_manager.UpdatePacketLoss(0.1);
-    uint32_t size2 = bw_manager.CalculateOptimalPacketSize();
-    EXPECT_GE(size2, config.min_packet_size);
-    EXPECT_LE(size2, config.max_packet_size);
+    // Sending alone is not feedback
+    bw_manager.OnPacketSent("slow", 1, 1000, CongestionController::NowMicros());
+    EXPECT_TRUE(bw_manager.IsCongested("slow"));
 }
 
-TEST_F(BandwidthManagerTest, PacketDelayDecision) {
-    // Good conditions - no delay
-    bw_manager.UpdateLatency(30.0);
-    bw_manager.UpdatePacketLoss(0.02);
-    EXPECT_FALSE(bw_manager.ShouldDelayPacket(PacketPriority::NORMAL));
-    
-    // Poor conditions - delay non-critical packets
-    for (int i = 0; i < 100; ++i) {
-        bw_manager.PacketSent(PacketPriority::NORMAL, 1000);
+TEST_F(BandwidthManagerTest, CongestionLowersLinkRate) {
+    // Every packet lost: the loss-based rate halves each window down to the minimum
+    int64_t now_us = CongestionController::NowMicros();
+    for (uint64_t sequence = 0; sequence < 10 * CongestionController::LOSS_WINDOW_PACKETS; ++sequence) {
+        bw_manager.OnPacketSent("peer", sequence, 1000, now_us);
+        ASSERT_TRUE(bw_manager.OnPacketLost("peer", sequence));
+    }
+    EXPECT_TRUE(bw_manager.IsCongested("peer"));
+    EXPECT_FLOAT_EQ(bw_manager.GetRecommendedBitrate("peer"), config.min_bitrate_kbps);
+    EXPECT_FLOAT_EQ(bw_manager.GetMetrics("peer").packet_loss_percent, 100.0f);
+
+    // The sampler moves the shaper's link rate down to the slowest peer's rate
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (bw_manager.GetShaper().GetLinkRate() > config.min_bitrate_kbps &&
+           std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
     }
-    EXPECT_TRUE(bw_manager.ShouldDelayPacket(PacketPriority::NORMAL));
-    
-    // Critical packets should never be delayed
-    EXPECT_FALSE(bw_manager.ShouldDelayPacket(PacketPriority::CRITICAL));
+    EXPECT_FLOAT_EQ(bw_manager.GetShaper().GetLinkRate(), config.min_bitrate_kbps);
+
+    bw_manager.ResetMetrics("peer");
+    EXPECT_FALSE(bw_manager.IsCongested("peer"));
 }
 
 } // namespace P2P
-
-int main(int argc, char** argv) {
-    ::testing::InitGoogleTest(&argc, argv);
-    return RUN_ALL_TESTS();
-}
\ No newline at end of file
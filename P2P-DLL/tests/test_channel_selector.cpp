@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+#include "ChannelSelector.h"
+#include "PacketBatcher.h"
+#include <initializer_list>
+#include <vector>
+
+using namespace P2P;
+
+namespace {
+
+using Channel = ChannelSelector::Channel;
+
+const std::vector<uint8_t> MOVE = {0x85, 0x00, 0x25, 0x8C, 0x83};     // CRITICAL, unreliable
+const std::vector<uint8_t> ATTACK = {0x90, 0x00, 1, 2, 3, 4, 5};      // CRITICAL
+const std::vector<uint8_t> SKILL = {0xA2, 0x00, 1, 2, 3, 4};          // HIGH
+const std::vector<uint8_t> EMOTE = {0xA7, 0x00, 1, 2, 3, 4, 5, 6};    // NORMAL
+
+// Batch frame: [0xFF01][total length][length, packet]...
+std::vector<uint8_t> Batch(std::initializer_list<std::vector<uint8_t>> packets) {
+    std::vector<uint8_t> frame = {0x01, 0xFF, 0x00, 0x00};
+    for (const auto& packet : packets) {
+        frame.push_back(static_cast<uint8_t>(packet.size() & 0xFF));
+        frame.push_back(static_cast<uint8_t>(packet.size() >> 8));
+        frame.insert(frame.end(), packet.begin(), packet.end());
+    }
+    frame[2] = static_cast<uint8_t>(frame.size() & 0xFF);
+    frame[3] = static_cast<uint8_t>(frame.size() >> 8);
+    return frame;
+}
+
+ChannelSelector::Selection Select(const std::vector<uint8_t>& message) {
+    return ChannelSelector::Select(message.data(), message.size());
+}
+
+} // namespace
+
+TEST(ChannelSelectorTest, KeyExchangeStaysOnData) {
+    const std::vector<uint8_t> key_exchange = {0x00, 0xFF, 0x02, 0x00, 0xAA, 0xBB};
+    auto selection = Select(key_exchange);
+    EXPECT_EQ(selection.preferred, Channel::DATA);
+    EXPECT_EQ(selection.fallback, Channel::DATA);
+}
+
+TEST(ChannelSelectorTest, UnreliablePacketPrefersStateChannel) {
+    auto selection = Select(MOVE);
+    EXPECT_EQ(selection.preferred, Channel::STATE);
+    EXPECT_EQ(selection.fallback, Channel::URGENT);
+
+    selection = Select(Batch({MOVE, MOVE}));
+    EXPECT_EQ(selection.preferred, Channel::STATE);
+}
+
+TEST(ChannelSelectorTest, MixedBatchIsReliableOnMostUrgentChannel) {
+    auto selection = Select(Batch({EMOTE, MOVE}));
+    EXPECT_EQ(selection.preferred, Channel::URGENT);
+    EXPECT_EQ(selection.fallback, Channel::DATA);
+
+    EXPECT_EQ(Select(Batch({EMOTE, EMOTE})).preferred, Channel::NORMAL);
+}
+
+TEST(ChannelSelectorTest, CombatClassesShareOneChannel) {
+    // A skill and the attack after it must not be reordered
+    EXPECT_EQ(Select(ATTACK).preferred, Channel::URGENT);
+    EXPECT_EQ(Select(SKILL).preferred, Channel::URGENT);
+    EXPECT_EQ(Select(EMOTE).preferred, Channel::NORMAL);
+
+    EXPECT_EQ(ChannelSelector::ForPriority(PacketPriority::CRITICAL), Channel::URGENT);
+    EXPECT_EQ(ChannelSelector::ForPriority(PacketPriority::HIGH), Channel::URGENT);
+    EXPECT_EQ(ChannelSelector::ForPriority(PacketPriority::NORMAL), Channel::NORMAL);
+    EXPECT_EQ(ChannelSelector::ForPriority(PacketPriority::LOW), Channel::BULK);
+    EXPECT_EQ(ChannelSelector::ForPriority(PacketPriority::BACKGROUND), Channel::BULK);
+}
+
+TEST(ChannelSelectorTest, MalformedBatchUsesFrameType) {
+    std::vector<uint8_t> frame = Batch({EMOTE});
+    frame[2] = 0xFF;  // Declared length beyond the frame
+    auto selection = Select(frame);
+    EXPECT_NE(selection.preferred, Channel::STATE);
+    EXPECT_TRUE(ChannelSelector::IsPriorityChannel(selection.preferred));
+}
+
+TEST(ChannelSelectorTest, LabelsRoundTrip) {
+    for (Channel channel : {Channel::URGENT, Channel::NORMAL, Channel::BULK, Channel::STATE, Channel::DATA}) {
+        Channel parsed = Channel::DATA;
+        ASSERT_TRUE(ChannelSelector::FromLabel(ChannelSelector::GetLabel(channel), parsed));
+        EXPECT_EQ(parsed, channel);
+    }
+    Channel parsed = Channel::URGENT;
+    EXPECT_FALSE(ChannelSelector::FromLabel("critical", parsed));
+    EXPECT_EQ(parsed, Channel::URGENT);
+}
@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+#include "CompressionDictionary.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace P2P;
+
+namespace {
+
+CompressionDictionary MakeSet() {
+    CompressionDictionary set;
+    EXPECT_TRUE(set.SetGeneric({'g', 'e', 'n'}));
+    EXPECT_TRUE(set.AddClass({0x0089}, {0x89, 0x00, 0x01, 0x02}));
+    EXPECT_TRUE(set.AddClass({0x008C, 0x0108, 0x017E}, {'c', 'h', 'a', 't'}));
+    return set;
+}
+
+} // namespace
+
+TEST(CompressionDictionaryTest, ClassifiesOpcodes) {
+    CompressionDictionary set = MakeSet();
+    EXPECT_EQ(set.GetClassCount(), 3u);
+    EXPECT_EQ(set.ClassOf(0x0089), 1);
+    EXPECT_EQ(set.ClassOf(0x0108), 2);
+    EXPECT_EQ(set.ClassOf(0xBEEF), CompressionDictionary::GENERIC_CLASS);
+    EXPECT_EQ(set.GetDictionary(2), (std::vector<uint8_t>{'c', 'h', 'a', 't'}));
+    EXPECT_TRUE(set.GetDictionary(7).empty());
+}
+
+TEST(CompressionDictionaryTest, RejectsInvalidClasses) {
+    CompressionDictionary set = MakeSet();
+    EXPECT_FALSE(set.AddClass({0x0090, 0x0089}, {1}));  // 0x0089 already has a class
+    EXPECT_EQ(set.ClassOf(0x0090), CompressionDictionary::GENERIC_CLASS);
+    EXPECT_FALSE(set.AddClass({}, {1}));
+    EXPECT_FALSE(set.AddClass({0x0090}, std::vector<uint8_t>(CompressionDictionary::MAX_DICTIONARY_SIZE + 1)));
+
+    while (set.GetClassCount() < CompressionDictionary::MAX_CLASSES) {
+        ASSERT_TRUE(set.AddClass({static_cast<uint16_t>(0x0200 + set.GetClassCount())}, {1}));
+    }
+    EXPECT_FALSE(set.AddClass({0x0090}, {1}));
+}
+
+TEST(CompressionDictionaryTest, SerializeRoundTripKeepsId) {
+    CompressionDictionary set = MakeSet();
+    std::vector<uint8_t> bytes = set.Serialize();
+    auto parsed = CompressionDictionary::Deserialize(bytes.data(), bytes.size());
+    ASSERT_NE(parsed, nullptr);
+    EXPECT_EQ(parsed->GetId(), set.GetId());
+    EXPECT_NE(parsed->GetId(), 0u);
+    EXPECT_EQ(parsed->ClassOf(0x017E), 2);
+    EXPECT_EQ(parsed->GetOpcodes(2), (std::vector<uint16_t>{0x008C, 0x0108, 0x017E}));
+
+    // Any content change gives a different ID
+    CompressionDictionary other = MakeSet();
+    ASSERT_TRUE(other.SetGeneric({'g', 'e', 'N'}));
+    EXPECT_NE(other.GetId(), set.GetId());
+}
+
+TEST(CompressionDictionaryTest, RejectsMalformedData) {
+    std::vector<uint8_t> bytes = MakeSet().Serialize();
+
+    EXPECT_EQ(CompressionDictionary::Deserialize(bytes.data(), bytes.size() - 1), nullptr);
+
+    std::vector<uint8_t> trailing = bytes;
+    trailing.push_back(0);
+    EXPECT_EQ(CompressionDictionary::Deserialize(trailing.data(), trailing.size()), nullptr);
+
+    std::vector<uint8_t> bad_magic = bytes;
+    bad_magic[0] ^= 0xFF;
+    EXPECT_EQ(CompressionDictionary::Deserialize(bad_magic.data(), bad_magic.size()), nullptr);
+
+    EXPECT_EQ(CompressionDictionary::Deserialize(nullptr, 0), nullptr);
+}
+
+TEST(CompressionDictionaryTest, FileRoundTrip) {
+    const std::string path = "test_compression_dictionary.bin";
+    CompressionDictionary set = MakeSet();
+    ASSERT_TRUE(set.SaveToFile(path));
+    auto loaded = CompressionDictionary::LoadFromFile(path);
+    std::remove(path.c_str());
+    ASSERT_NE(loaded, nullptr);
+    EXPECT_EQ(loaded->GetId(), set.GetId());
+
+    EXPECT_EQ(CompressionDictionary::LoadFromFile("does_not_exist.bin"), nullptr);
+}
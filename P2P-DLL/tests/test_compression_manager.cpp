@@ -0,0 +1,215 @@
+#include <gtest/gtest.h>
+#include "CompressionManager.h"
+#include "CompressionDictionary.h"
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace P2P;
+
+namespace {
+
+CompressionConfig MakeConfig(const std::string& algorithm, int level = 6) {
+    CompressionConfig config;
+    config.algorithm = algorithm;
+    config.compression_level = level;
+    config.enable_metrics = false;
+    return config;
+}
+
+// Repetitive payload behind a chat opcode, well over min_size_for_compression
+std::vector<uint8_t> Compressible(size_t size, uint8_t seed = 0) {
+    std::vector<uint8_t> data = {0x8C, 0x00};
+    const std::string text = "player says hello to the party ";
+    while (data.size() < size) {
+        data.push_back(static_cast<uint8_t>(text[data.size() % text.size()] + seed));
+    }
+    return data;
+}
+
+std::vector<uint8_t> Random(size_t size) {
+    std::mt19937 rng(1234);
+    std::vector<uint8_t> data(size);
+    for (auto& byte : data) {
+        byte = static_cast<uint8_t>(rng());
+    }
+    return data;
+}
+
+} // namespace
+
+TEST(CompressionManagerTest, RoundTripsEachAlgorithm) {
+    struct Case { const char* algorithm; int level; CompressionManager::Algorithm wire; };
+    const Case cases[] = {
+        {"lz4", 1, CompressionManager::Algorithm::LZ4},
+        {"lz4", 12, CompressionManager::Algorithm::LZ4},  // LZ4HC
+        {"zlib", 6, CompressionManager::Algorithm::ZLIB},
+    };
+    const std::vector<uint8_t> data = Compressible(600);
+
+    for (const Case& c : cases) {
+        SCOPED_TRACE(std::string(c.algorithm) + " level " + std::to_string(c.level));
+        CompressionManager manager;
+        ASSERT_TRUE(manager.Initialize(MakeConfig(c.algorithm, c.level)));
+
+        std::vector<uint8_t> frame = manager.Compress(data);
+        ASSERT_LT(frame.size(), data.size());
+        CompressionManager::FrameHeader header;
+        ASSERT_TRUE(manager.ParseFrameHeader(frame.data(), frame.size(), header));
+        EXPECT_FALSE(header.stored);
+        EXPECT_EQ(header.algorithm, c.wire);
+        EXPECT_EQ(header.original_size, data.size());
+
+        EXPECT_EQ(manager.Decompress(frame), data);
+
+        // The receiver decodes with the sender's algorithm, not its own
+        CompressionManager other;
+        ASSERT_TRUE(other.Initialize(MakeConfig(c.wire == CompressionManager::Algorithm::ZLIB ? "lz4" : "zlib")));
+        EXPECT_EQ(other.Decompress(frame), data);
+    }
+}
+
+TEST(CompressionManagerTest, IncompressibleInputIsStored) {
+    CompressionManager manager;
+    ASSERT_TRUE(manager.Initialize(MakeConfig("zlib")));
+
+    const std::vector<uint8_t> data = Random(600);
+    uint8_t out[700];
+    size_t out_size = 0;
+    EXPECT_FALSE(manager.CompressInto(data.data(), data.size(), out, sizeof(out), out_size));
+
+    std::vector<uint8_t> frame = manager.Compress(data);
+    CompressionManager::FrameHeader header;
+    ASSERT_TRUE(manager.ParseFrameHeader(frame.data(), frame.size(), header));
+    EXPECT_TRUE(header.stored);
+    EXPECT_EQ(frame.size(), header.header_size + data.size());
+    EXPECT_EQ(manager.Decompress(frame), data);
+
+    // Under min_size_for_compression (and with no dictionary) is stored too
+    const std::vector<uint8_t> small = Compressible(40);
+    EXPECT_FALSE(manager.ShouldCompress(small.data(), small.size()));
+    frame = manager.Compress(small);
+    ASSERT_TRUE(manager.ParseFrameHeader(frame.data(), frame.size(), header));
+    EXPECT_TRUE(header.stored);
+    EXPECT_EQ(manager.Decompress(frame), small);
+}
+
+TEST(CompressionManagerTest, RejectsOversizeFrames) {
+    CompressionManager sender;
+    ASSERT_TRUE(sender.Initialize(MakeConfig("lz4")));
+    CompressionManager receiver;
+    ASSERT_TRUE(receiver.Initialize(MakeConfig("lz4"), 256));
+
+    const std::vector<uint8_t> data = Compressible(600);
+    std::vector<uint8_t> frame = sender.Compress(data);
+    ASSERT_EQ(sender.Decompress(frame), data);
+    EXPECT_EQ(receiver.GetDecompressedSize(frame.data(), frame.size()), 0u);
+    EXPECT_TRUE(receiver.Decompress(frame).empty());
+
+    // A header claiming more than the hard cap, whatever the configuration
+    uint8_t header[CompressionManager::MAX_HEADER_SIZE + 1] = {};
+    size_t header_size = CompressionManager::EncodeStoredHeader(CompressionManager::MAX_DECOMPRESSED_SIZE + 1, header);
+    EXPECT_EQ(sender.GetDecompressedSize(header, header_size + 1), 0u);
+
+    // The output buffer must hold the original size
+    std::vector<uint8_t> out(data.size() - 1);
+    size_t out_size = 0;
+    EXPECT_FALSE(sender.DecompressInto(frame.data(), frame.size(), out.data(), out.size(), out_size));
+}
+
+TEST(CompressionManagerTest, RejectsTruncatedFrames) {
+    CompressionManager manager;
+    ASSERT_TRUE(manager.Initialize(MakeConfig("zlib")));
+
+    const std::vector<uint8_t> data = Compressible(600);
+    for (const std::vector<uint8_t>& frame : {manager.Compress(data), manager.Compress(Random(600))}) {
+        std::vector<uint8_t> truncated(frame.begin(), frame.end() - 1);
+        EXPECT_TRUE(manager.Decompress(truncated).empty());
+
+        std::vector<uint8_t> header_only(frame.begin(), frame.begin() + 1);
+        EXPECT_TRUE(manager.Decompress(header_only).empty());
+    }
+
+    // A varint with no terminating byte
+    const std::vector<uint8_t> unterminated = {0x80, 0x80};
+    EXPECT_TRUE(manager.Decompress(unterminated).empty());
+    EXPECT_TRUE(manager.Decompress({}).empty());
+}
+
+TEST(CompressionManagerTest, DictionaryNeedsMatchingId) {
+    const std::string path = "test_compression_manager.bin";
+    const std::vector<uint8_t> packet = {0x89, 0x00, 0x10, 0x20, 0x30, 0x40, 0x50, 0x60,
+                                         0x10, 0x20, 0x30, 0x40, 0x50, 0x60, 0x70, 0x80};
+    CompressionDictionary set;
+    ASSERT_TRUE(set.AddClass({0x0089}, std::vector<uint8_t>(packet.begin(), packet.end())));
+    ASSERT_TRUE(set.SaveToFile(path));
+
+    CompressionConfig config = MakeConfig("lz4");
+    config.dictionary_path = path;
+    CompressionManager sender;
+    ASSERT_TRUE(sender.Initialize(config));
+    CompressionManager receiver;
+    ASSERT_TRUE(receiver.Initialize(config));
+    std::remove(path.c_str());
+    ASSERT_EQ(sender.GetDictionaryId(), set.GetId());
+
+    // Loaded but not agreed: small packets stay stored
+    EXPECT_FALSE(sender.IsDictionaryActive());
+    EXPECT_FALSE(sender.ShouldCompress(packet.data(), packet.size()));
+
+    // An ID the session agreed on that is not ours
+    EXPECT_FALSE(sender.SetNegotiatedDictionary(set.GetId() + 1));
+    EXPECT_FALSE(sender.IsDictionaryActive());
+
+    ASSERT_TRUE(sender.SetNegotiatedDictionary(set.GetId()));
+    std::vector<uint8_t> frame = sender.Compress(packet);
+    CompressionManager::FrameHeader header;
+    ASSERT_TRUE(sender.ParseFrameHeader(frame.data(), frame.size(), header));
+    EXPECT_TRUE(header.dictionary);
+    EXPECT_LT(frame.size(), packet.size());
+
+    // The receiver can't decode until it agrees on the same dictionary
+    EXPECT_TRUE(receiver.Decompress(frame).empty());
+    EXPECT_FALSE(receiver.SetNegotiatedDictionary(set.GetId() ^ 0xFFFF));
+    EXPECT_TRUE(receiver.Decompress(frame).empty());
+    ASSERT_TRUE(receiver.SetNegotiatedDictionary(set.GetId()));
+    EXPECT_EQ(receiver.Decompress(frame), packet);
+
+    // Session without a dictionary turns it off again
+    EXPECT_FALSE(receiver.SetNegotiatedDictionary(0));
+    EXPECT_TRUE(receiver.Decompress(frame).empty());
+}
+
+TEST(CompressionManagerTest, ThreadsKeepTheirOwnState) {
+    // One shared manager; each thread gets its own LZ4/zlib state, so
+    // concurrent packets never see each other's streams
+    CompressionManager lz4;
+    ASSERT_TRUE(lz4.Initialize(MakeConfig("lz4", 12)));
+    CompressionManager zlib;
+    ASSERT_TRUE(zlib.Initialize(MakeConfig("zlib")));
+
+    constexpr int THREADS = 4;
+    constexpr int ITERATIONS = 200;
+    std::vector<int> failures(THREADS, 0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < ITERATIONS; ++i) {
+                CompressionManager& manager = (i + t) % 2 ? zlib : lz4;
+                std::vector<uint8_t> data = Compressible(200 + 50 * t + i % 7, static_cast<uint8_t>(t));
+                std::vector<uint8_t> frame = manager.Compress(data);
+                if (frame.size() >= data.size() || manager.Decompress(frame) != data) {
+                    ++failures[t];
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (int t = 0; t < THREADS; ++t) {
+        EXPECT_EQ(failures[t], 0) << "thread " << t;
+    }
+}
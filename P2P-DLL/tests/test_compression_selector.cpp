@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include "CompressionSelector.h"
+#include <vector>
+
+using namespace P2P;
+using Codec = CompressionSelector::Codec;
+
+namespace {
+
+constexpr uint64_t INTERVAL_NS = 1000000000;  // 1 s
+constexpr size_t CLS = 1;
+
+// Feed one codec enough samples to be trusted: bytes_out per 1000 bytes in, ns per byte
+void Feed(CompressionSelector& selector, Codec codec, size_t out_per_1000, uint64_t ns_per_byte) {
+    for (int i = 0; i < 10; ++i) {
+        selector.Record(CLS, codec, 1000, out_per_1000, 1000 * ns_per_byte);
+    }
+}
+
+} // namespace
+
+TEST(CompressionSelectorTest, StartsWithInitialCodecAndExplores) {
+    CompressionSelector selector(Codec::ZLIB);
+    EXPECT_EQ(selector.GetChoice(CLS), Codec::ZLIB);
+
+    // Every EXPLORE_INTERVAL-th packet tries the next candidate in turn
+    std::vector<Codec> explored;
+    for (uint32_t i = 0; i < 3 * CompressionSelector::EXPLORE_INTERVAL; ++i) {
+        Codec codec = selector.Choose(CLS);
+        if (i % CompressionSelector::EXPLORE_INTERVAL == CompressionSelector::EXPLORE_INTERVAL - 1) {
+            explored.push_back(codec);
+        } else {
+            EXPECT_EQ(codec, Codec::ZLIB);
+        }
+    }
+    EXPECT_EQ(explored, (std::vector<Codec>{Codec::LZ4_FAST, Codec::LZ4_HC, Codec::ZLIB}));
+}
+
+TEST(CompressionSelectorTest, SlowLinkPrefersStrongerCodec) {
+    CompressionSelector selector(Codec::LZ4_FAST, 1.0);
+    Feed(selector, Codec::LZ4_FAST, 600, 2);
+    Feed(selector, Codec::ZLIB, 400, 20);
+
+    // 100 kbps: 80000 ns per byte on the link dwarfs the CPU cost
+    selector.Evaluate(100.0f, INTERVAL_NS);
+    EXPECT_EQ(selector.GetChoice(CLS), Codec::ZLIB);
+    // Classes without samples keep their codec
+    EXPECT_EQ(selector.GetChoice(CLS + 1), Codec::LZ4_FAST);
+}
+
+TEST(CompressionSelectorTest, FastLinkSendsUncompressed) {
+    CompressionSelector selector(Codec::LZ4_FAST, 1.0);
+    Feed(selector, Codec::LZ4_FAST, 900, 5);
+
+    // 10 Gbps: 0.8 ns per byte on the link, less than compressing costs
+    selector.Evaluate(10000000.0f, INTERVAL_NS);
+    EXPECT_EQ(selector.GetChoice(CLS), Codec::NONE);
+}
+
+TEST(CompressionSelectorTest, NoLinkEstimateKeepsChoice) {
+    CompressionSelector selector(Codec::LZ4_FAST, 1.0);
+    Feed(selector, Codec::ZLIB, 100, 1);
+    selector.Evaluate(0.0f, INTERVAL_NS);
+    EXPECT_EQ(selector.GetChoice(CLS), Codec::LZ4_FAST);
+}
+
+TEST(CompressionSelectorTest, BacksOffWhenOverCpuBudget) {
+    CompressionSelector selector(Codec::LZ4_FAST, 0.05);
+    selector.Record(CLS, Codec::LZ4_FAST, 1000, 500, INTERVAL_NS / 10);  // 10% of the interval
+    selector.Evaluate(1000.0f, INTERVAL_NS);
+    EXPECT_TRUE(selector.IsCpuBound());
+    EXPECT_EQ(selector.Choose(CLS), Codec::NONE);
+
+    // Recovers after CPU_BACKOFF_INTERVALS quiet intervals
+    for (int i = 0; i < CompressionSelector::CPU_BACKOFF_INTERVALS; ++i) {
+        selector.Evaluate(1000.0f, INTERVAL_NS);
+    }
+    EXPECT_FALSE(selector.IsCpuBound());
+}
+
+TEST(CompressionSelectorTest, EvaluateDecaysStats) {
+    CompressionSelector selector;
+    selector.Record(CLS, Codec::ZLIB, 1000, 400, 800);
+    selector.Evaluate(1000.0f, INTERVAL_NS);
+    CompressionSelector::Stats stats = selector.GetStats(CLS, Codec::ZLIB);
+    EXPECT_EQ(stats.bytes_in, 500u);
+    EXPECT_EQ(stats.bytes_out, 200u);
+    EXPECT_EQ(stats.nanoseconds, 400u);
+}
@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+#include "CongestionController.h"
+
+using namespace P2P;
+
+namespace {
+
+constexpr size_t PACKET_SIZE = 1000;
+constexpr int64_t SEND_INTERVAL_US = 10000;  // 1000 B every 10 ms = 800 kbps
+
+BandwidthConfig StartAt(float target_kbps) {
+    BandwidthConfig config;
+    config.min_bitrate_kbps = 100.0f;
+    config.max_bitrate_kbps = 10000.0f;
+    config.target_bitrate_kbps = target_kbps;
+    return config;
+}
+
+// Sends one packet per interval over a path whose one-way delay grows by
+// queue_growth_us per packet; feedback arrives 20 ms after the packet
+struct SimulatedPath {
+    CongestionController& controller;
+    uint64_t sequence = 0;
+    int64_t now_us = 1000000;
+    int64_t queue_us = 0;
+
+    bool saw_overuse = false;
+    float lowest_kbps = 1e9f;
+
+    void Run(int packets, int64_t queue_growth_us) {
+        for (int i = 0; i < packets; ++i) {
+            controller.OnPacketSent(sequence, PACKET_SIZE, now_us);
+            int64_t arrival_us = now_us + 20000 + queue_us + 5000000;  // Receiver clock is offset
+            queue_us += queue_growth_us;
+            controller.OnPacketAcked(sequence, arrival_us, now_us + 40000 + queue_us);
+            ++sequence;
+            now_us += SEND_INTERVAL_US;
+
+            saw_overuse |= controller.GetUsage() == CongestionController::Usage::OVERUSING;
+            lowest_kbps = std::min(lowest_kbps, controller.GetTargetBitrateKbps());
+        }
+    }
+};
+
+} // namespace
+
+TEST(CongestionControllerTest, StartsAtTargetBitrate) {
+    CongestionController controller(StartAt(2000.0f));
+    EXPECT_FLOAT_EQ(controller.GetTargetBitrateKbps(), 2000.0f);
+    EXPECT_DOUBLE_EQ(controller.GetPacingRateBytesPerSecond(), 250000.0);
+    EXPECT_FALSE(controller.IsCongested());
+
+    // Start rates outside the bounds are clamped
+    EXPECT_FLOAT_EQ(CongestionController(StartAt(50000.0f)).GetTargetBitrateKbps(), 10000.0f);
+}
+
+TEST(CongestionControllerTest, StableDelayRaisesRateTowardsThroughput) {
+    CongestionController controller(StartAt(500.0f));
+    SimulatedPath path{controller};
+    path.Run(500, 0);
+
+    EXPECT_FALSE(path.saw_overuse);
+    EXPECT_FALSE(controller.IsCongested());
+    EXPECT_GT(controller.GetTargetBitrateKbps(), 600.0f);
+    // Never more than 1.5x what the peer acknowledged (~800 kbps)
+    EXPECT_LE(controller.GetTargetBitrateKbps(), 1.5f * 800.0f + 20.0f);
+    EXPECT_NEAR(controller.GetRttMs(), 40.0f, 1.0f);
+}
+
+TEST(CongestionControllerTest, GrowingDelayBacksOffBelowThroughput) {
+    CongestionController controller(StartAt(2000.0f));
+    SimulatedPath path{controller};
+    path.Run(100, 0);
+    EXPECT_FALSE(path.saw_overuse);
+
+    // A queue building on the path: each packet waits 2 ms longer
+    path.Run(100, 2000);
+    EXPECT_TRUE(path.saw_overuse);
+    EXPECT_LT(path.lowest_kbps, 800.0f);
+    EXPECT_GE(path.lowest_kbps, 100.0f);
+}
+
+TEST(CongestionControllerTest, LossBacksOff) {
+    CongestionController controller(StartAt(2000.0f));
+    int64_t now_us = 1000000;
+    uint64_t sequence = 0;
+
+    // 5 of 20 lost: 25% loss cuts the rate by 12.5%
+    for (uint32_t i = 0; i < CongestionController::LOSS_WINDOW_PACKETS; ++i, ++sequence) {
+        controller.OnPacketSent(sequence, PACKET_SIZE, now_us);
+        if (i % 4 == 0) {
+            EXPECT_TRUE(controller.OnPacketLost(sequence, now_us));
+        } else {
+            EXPECT_TRUE(controller.OnPacketAcked(sequence, now_us + 20000, now_us + 40000));
+        }
+    }
+    EXPECT_FLOAT_EQ(controller.GetLossFraction(), 0.25f);
+    EXPECT_TRUE(controller.IsCongested());
+    EXPECT_NEAR(controller.GetTargetBitrateKbps(), 1750.0f, 1.0f);
+
+    // A clean window clears congestion and lets the loss-based rate grow again
+    for (uint32_t i = 0; i < CongestionController::LOSS_WINDOW_PACKETS; ++i, ++sequence) {
+        controller.OnPacketSent(sequence, PACKET_SIZE, now_us);
+        EXPECT_TRUE(controller.OnPacketAcked(sequence, now_us + 20000, now_us + 40000));
+    }
+    EXPECT_FLOAT_EQ(controller.GetLossFraction(), 0.0f);
+    EXPECT_FALSE(controller.IsCongested());
+    EXPECT_NEAR(controller.GetTargetBitrateKbps(), 1750.0f * CongestionController::LOSS_INCREASE, 1.0f);
+}
+
+TEST(CongestionControllerTest, IgnoresUnknownFeedback) {
+    CongestionController controller(StartAt(2000.0f));
+    EXPECT_FALSE(controller.OnPacketAcked(7, 0, 0));
+    EXPECT_FALSE(controller.OnPacketLost(7, 0));
+
+    controller.OnPacketSent(7, PACKET_SIZE, 1000);
+    EXPECT_FALSE(controller.HasFeedback());
+    EXPECT_TRUE(controller.OnPacketAcked(7, 5000, 9000));
+    EXPECT_TRUE(controller.HasFeedback());
+    EXPECT_FALSE(controller.OnPacketAcked(7, 5000, 9000));  // Duplicate
+
+    // A sequence number that reuses the slot forgets the old packet
+    controller.OnPacketSent(8, PACKET_SIZE, 2000);
+    controller.OnPacketSent(8 + CongestionController::MAX_IN_FLIGHT, PACKET_SIZE, 3000);
+    EXPECT_FALSE(controller.OnPacketLost(8, 4000));
+    EXPECT_TRUE(controller.OnPacketLost(8 + CongestionController::MAX_IN_FLIGHT, 4000));
+}
@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+#include "FrameSplitter.h"
+#include <vector>
+
+using namespace P2P;
+
+namespace {
+
+struct Frame {
+    const uint8_t* data;
+    size_t length;
+    uint16_t type;
+};
+
+// Action (0x0089) is fixed at 7 bytes, chat (0x008C) is variable length
+const uint8_t ACTION[] = {0x89, 0x00, 1, 2, 3, 4, 5};
+const uint8_t CHAT[] = {0x8C, 0x00, 0x08, 0x00, 'h', 'e', 'y', 0};
+
+std::vector<uint8_t> Concat(std::initializer_list<std::pair<const uint8_t*, size_t>> parts) {
+    std::vector<uint8_t> out;
+    for (const auto& part : parts) {
+        out.insert(out.end(), part.first, part.first + part.second);
+    }
+    return out;
+}
+
+} // namespace
+
+TEST(FrameSplitterTest, FrameLengthUsesPacketTable) {
+    EXPECT_EQ(FrameSplitter::FrameLength(ACTION, sizeof(ACTION)), 7u);
+    EXPECT_EQ(FrameSplitter::FrameLength(CHAT, sizeof(CHAT)), 8u);
+    EXPECT_EQ(FrameSplitter::FrameLength(CHAT, 3), FrameSplitter::NEED_MORE);
+    const uint8_t unknown[] = {0xEF, 0xBE, 0, 0};
+    EXPECT_EQ(FrameSplitter::FrameLength(unknown, sizeof(unknown)), FrameSplitter::UNKNOWN_LENGTH);
+}
+
+TEST(FrameSplitterTest, SplitsCoalescedBufferWithoutCopying) {
+    auto buffer = Concat({{ACTION, sizeof(ACTION)}, {CHAT, sizeof(CHAT)}, {ACTION, sizeof(ACTION)}});
+    std::vector<Frame> frames;
+    FrameSplitter splitter;
+    size_t count = splitter.Feed(1, buffer.data(), buffer.size(), [&](const PacketView& view) {
+        frames.push_back({view.data, view.length, view.type});
+    });
+
+    ASSERT_EQ(count, 3u);
+    EXPECT_EQ(frames[0].type, 0x0089);
+    EXPECT_EQ(frames[1].type, 0x008C);
+    EXPECT_EQ(frames[1].length, sizeof(CHAT));
+    EXPECT_EQ(frames[1].data, buffer.data() + sizeof(ACTION));
+    EXPECT_EQ(frames[2].data, buffer.data() + sizeof(ACTION) + sizeof(CHAT));
+    EXPECT_EQ(splitter.GetPendingSize(1), 0u);
+}
+
+TEST(FrameSplitterTest, KeepsPartialFramesPerStream) {
+    auto buffer = Concat({{ACTION, sizeof(ACTION)}, {CHAT, sizeof(CHAT)}});
+    FrameSplitter splitter;
+    std::vector<std::vector<uint8_t>> frames;
+    auto collect = [&](const PacketView& view) {
+        frames.emplace_back(view.data, view.data + view.length);
+    };
+
+    // Split inside the chat header, and interleave another socket
+    EXPECT_EQ(splitter.Feed(1, buffer.data(), 10, collect), 1u);
+    EXPECT_EQ(splitter.GetPendingSize(1), 3u);
+    EXPECT_EQ(splitter.Feed(2, ACTION, 3, collect), 0u);
+    EXPECT_EQ(splitter.Feed(1, buffer.data() + 10, 2, collect), 0u);
+    EXPECT_EQ(splitter.Feed(1, buffer.data() + 12, buffer.size() - 12, collect), 1u);
+    EXPECT_EQ(splitter.Feed(2, ACTION + 3, sizeof(ACTION) - 3, collect), 1u);
+
+    ASSERT_EQ(frames.size(), 3u);
+    EXPECT_EQ(frames[1], std::vector<uint8_t>(CHAT, CHAT + sizeof(CHAT)));
+    EXPECT_EQ(frames[2], std::vector<uint8_t>(ACTION, ACTION + sizeof(ACTION)));
+    EXPECT_EQ(splitter.GetPendingSize(1), 0u);
+    EXPECT_EQ(splitter.GetPendingSize(2), 0u);
+}
+
+TEST(FrameSplitterTest, UnknownOpcodeFallsBackToWholeBuffer) {
+    const uint8_t unknown[] = {0xEF, 0xBE, 1, 2, 3};
+    auto buffer = Concat({{ACTION, sizeof(ACTION)}, {unknown, sizeof(unknown)}});
+    std::vector<size_t> lengths;
+    size_t count = FrameSplitter::Split(buffer.data(), buffer.size(), [&](const PacketView& view) {
+        lengths.push_back(view.length);
+    });
+    ASSERT_EQ(count, 2u);
+    EXPECT_EQ(lengths[0], sizeof(ACTION));
+    EXPECT_EQ(lengths[1], sizeof(unknown));
+}
+
+TEST(FrameSplitterTest, DelimitsServerOnlyClientPackets) {
+    // Name request (0x0094, 6 bytes) and whisper (0x0096, variable) are not
+    // routed P2P but must still split, so the walk request after them is found
+    const uint8_t name_request[] = {0x94, 0x00, 1, 2, 3, 4};
+    const uint8_t whisper[] = {0x96, 0x00, 0x06, 0x00, 'h', 'i'};
+    const uint8_t walk[] = {0x85, 0x00, 0x25, 0x8C, 0x83};
+    auto buffer = Concat({{name_request, sizeof(name_request)}, {whisper, sizeof(whisper)}, {walk, sizeof(walk)}});
+    std::vector<uint16_t> types;
+    size_t count = FrameSplitter::Split(buffer.data(), buffer.size(), [&](const PacketView& view) {
+        types.push_back(view.type);
+    });
+    ASSERT_EQ(count, 3u);
+    EXPECT_EQ(types, (std::vector<uint16_t>{0x0094, 0x0096, 0x0085}));
+}
+
+TEST(FrameSplitterTest, ResetDropsPartialFrame) {
+    FrameSplitter splitter;
+    std::vector<uint16_t> types;
+    auto collect = [&](const PacketView& view) { types.push_back(view.type); };
+
+    // A closed socket's half-sent chat must not prefix the next socket's data
+    EXPECT_EQ(splitter.Feed(7, CHAT, 5, collect), 0u);
+    splitter.Reset(7);
+    EXPECT_EQ(splitter.GetPendingSize(7), 0u);
+    EXPECT_EQ(splitter.Feed(7, ACTION, sizeof(ACTION), collect), 1u);
+    EXPECT_EQ(types, (std::vector<uint16_t>{0x0089}));
+}
@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+#include "InterestManager.h"
+#include "PacketTable.h"
+#include <string>
+#include <vector>
+
+using namespace P2P;
+
+class InterestManagerTest : public ::testing::Test {
+protected:
+    void TearDown() override {
+        PacketTable::GetInstance().Reset();
+    }
+};
+
+TEST_F(InterestManagerTest, ClassifiesMovementAndCombat) {
+    EXPECT_EQ(InterestManager::Classify(0x0085), InterestClass::AOI);
+    for (uint16_t type : {0x0089, 0x0090, 0x0091, 0x00A2}) {
+        EXPECT_EQ(InterestManager::Classify(type), InterestClass::COMBAT);
+    }
+    EXPECT_EQ(InterestManager::Classify(0x0108), InterestClass::PARTY);
+    EXPECT_EQ(InterestManager::Classify(0x017E), InterestClass::GUILD);
+    EXPECT_EQ(InterestManager::Classify(0xBEEF), InterestClass::ZONE);
+}
+
+TEST_F(InterestManagerTest, OverrideChangesInterest) {
+    PacketTypeOverride emotion;
+    emotion.type = 0x00A7;
+    emotion.interest = "Party";
+    PacketTypeOverride bogus;
+    bogus.type = 0x0085;
+    bogus.interest = "everyone";
+
+    EXPECT_FALSE(PacketTable::GetInstance().ApplyOverrides({emotion, bogus}));
+    EXPECT_EQ(InterestManager::Classify(0x00A7), InterestClass::PARTY);
+    EXPECT_EQ(InterestManager::Classify(0x0085), InterestClass::AOI);  // Invalid override skipped
+}
+
+TEST_F(InterestManagerTest, CombatRadiusNeverExceedsAOI) {
+    InterestManager interest;
+    EXPECT_FLOAT_EQ(interest.GetRadius(InterestClass::AOI), InterestManager::DEFAULT_AOI_RADIUS);
+    EXPECT_FLOAT_EQ(interest.GetRadius(InterestClass::COMBAT), InterestManager::DEFAULT_COMBAT_RADIUS);
+    EXPECT_FLOAT_EQ(interest.GetRadius(InterestClass::ZONE), 0.0f);
+
+    P2PConfig config{};
+    config.aoi_radius = 20.0f;
+    config.combat_radius = 50.0f;
+    interest.Configure(config);
+    EXPECT_FLOAT_EQ(interest.GetRadius(InterestClass::AOI), 20.0f);
+    EXPECT_FLOAT_EQ(interest.GetRadius(InterestClass::COMBAT), 20.0f);
+}
+
+TEST_F(InterestManagerTest, GroupMembersAreDeduplicatedSnapshots) {
+    InterestManager interest;
+    EXPECT_TRUE(interest.GetGroupMembers(InterestClass::PARTY)->empty());
+
+    EXPECT_TRUE(interest.SetGroupMembers(InterestClass::PARTY, {"bob", "alice", "bob"}));
+    auto party = interest.GetGroupMembers(InterestClass::PARTY);
+    EXPECT_EQ(*party, (std::vector<std::string>{"alice", "bob"}));
+
+    // Replacing the list leaves earlier snapshots intact
+    EXPECT_TRUE(interest.SetGroupMembers(InterestClass::PARTY, {"carol"}));
+    EXPECT_EQ(party->size(), 2u);
+    EXPECT_EQ(interest.GetGroupMembers(InterestClass::PARTY)->size(), 1u);
+    EXPECT_TRUE(interest.GetGroupMembers(InterestClass::GUILD)->empty());
+
+    EXPECT_FALSE(interest.SetGroupMembers(InterestClass::AOI, {"dave"}));
+}
+
+TEST_F(InterestManagerTest, DestinationKeysRoundTrip) {
+    for (InterestClass value : {InterestClass::ZONE, InterestClass::AOI, InterestClass::COMBAT,
+                                InterestClass::PARTY, InterestClass::GUILD}) {
+        EXPECT_EQ(InterestManager::FromDestinationKey(InterestManager::GetDestinationKey(value)), value);
+    }
+    EXPECT_STREQ(InterestManager::GetDestinationKey(InterestClass::ZONE), "");
+    EXPECT_EQ(InterestManager::FromDestinationKey("nowhere"), InterestClass::ZONE);
+}
+
+TEST_F(InterestManagerTest, DecodesPackedMovementPosition) {
+    // Walk request to x=150, y=200, direction 3, as the client sends it
+    const uint8_t move[] = {0x85, 0x00, 0x25, 0x8C, 0x83};
+    ASSERT_EQ(sizeof(move), PacketTable::GetInstance().Lookup(InterestManager::MOVEMENT_PACKET_TYPE).FixedLength());
+    float x = 0.0f, y = 0.0f;
+    ASSERT_TRUE(InterestManager::DecodePosition(PacketView(move, sizeof(move)), x, y));
+    EXPECT_FLOAT_EQ(x, 150.0f);
+    EXPECT_FLOAT_EQ(y, 200.0f);
+
+    const uint8_t corner[] = {0x85, 0x00, 0xFF, 0xFF, 0xF0};
+    ASSERT_TRUE(InterestManager::DecodePosition(PacketView(corner, sizeof(corner)), x, y));
+    EXPECT_FLOAT_EQ(x, 1023.0f);
+    EXPECT_FLOAT_EQ(y, 1023.0f);
+
+    x = y = -1.0f;
+    EXPECT_FALSE(InterestManager::DecodePosition(PacketView(move, 4), x, y));         // Truncated
+    const uint8_t action[] = {0x89, 0x00, 0x25, 0x8C, 0x83, 0x00, 0x00};
+    EXPECT_FALSE(InterestManager::DecodePosition(PacketView(action, sizeof(action)), x, y));
+    EXPECT_FLOAT_EQ(x, -1.0f);
+}
@@ -0,0 +1,206 @@
+#include <gtest/gtest.h>
+#include "PacketBatcher.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace P2P;
+
+namespace {
+
+const uint8_t MOVE[] = {0x89, 0x00, 1, 2, 3, 4, 5};
+const uint8_t EMOTE[] = {0xA7, 0x00, 1, 2, 3, 4, 5, 6};
+
+PerformanceConfig MakeConfig(int batch_size, int timeout_ms) {
+    PerformanceConfig config;
+    config.enable_packet_batching = true;
+    config.packet_batch_size = batch_size;
+    config.packet_batch_timeout_ms = timeout_ms;
+    return config;
+}
+
+std::vector<std::vector<uint8_t>> Unpack(const std::vector<uint8_t>& message) {
+    std::vector<std::vector<uint8_t>> packets;
+    EXPECT_TRUE(PacketBatcher::Unbatch(message.data(), message.size(), [&](const PacketView& view) {
+        packets.emplace_back(view.data, view.data + view.length);
+    }));
+    return packets;
+}
+
+} // namespace
+
+TEST(PacketBatcherTest, FlushesOnBatchSize) {
+    std::vector<std::vector<uint8_t>> messages;
+    PacketBatcher batcher;
+    ASSERT_TRUE(batcher.Initialize(MakeConfig(3, 1000), [&](const std::string&, PacketBuffer& batch) {
+        EXPECT_GE(batch.Tailroom(), PacketBatcher::SIGNATURE_TAILROOM);
+        messages.emplace_back(batch.Data(), batch.Data() + batch.Size());
+        return true;
+    }));
+
+    EXPECT_TRUE(batcher.Add("", PacketView(MOVE, sizeof(MOVE))));
+    EXPECT_TRUE(batcher.Add("", PacketView(EMOTE, sizeof(EMOTE))));
+    EXPECT_TRUE(messages.empty());
+    EXPECT_TRUE(batcher.Add("", PacketView(MOVE, sizeof(MOVE))));
+    ASSERT_EQ(messages.size(), 1u);
+
+    auto packets = Unpack(messages[0]);
+    ASSERT_EQ(packets.size(), 3u);
+    EXPECT_EQ(packets[1], std::vector<uint8_t>(EMOTE, EMOTE + sizeof(EMOTE)));
+    batcher.Shutdown();
+}
+
+TEST(PacketBatcherTest, SinglePacketIsSentBare) {
+    std::vector<std::vector<uint8_t>> messages;
+    PacketBatcher batcher;
+    batcher.Initialize(MakeConfig(10, 1000), [&](const std::string&, PacketBuffer& batch) {
+        messages.emplace_back(batch.Data(), batch.Data() + batch.Size());
+        return true;
+    });
+    batcher.Add("peer", PacketView(MOVE, sizeof(MOVE)));
+    EXPECT_TRUE(batcher.Flush("peer"));
+    ASSERT_EQ(messages.size(), 1u);
+    EXPECT_EQ(messages[0], std::vector<uint8_t>(MOVE, MOVE + sizeof(MOVE)));
+}
+
+TEST(PacketBatcherTest, FlushesOnTimeout) {
+    std::mutex mutex;
+    size_t flushed = 0;
+    PacketBatcher batcher;
+    batcher.Initialize(MakeConfig(10, 5), [&](const std::string&, PacketBuffer&) {
+        std::lock_guard<std::mutex> lock(mutex);
+        flushed++;
+        return true;
+    });
+    batcher.Add("", PacketView(MOVE, sizeof(MOVE)));
+    batcher.Add("", PacketView(MOVE, sizeof(MOVE)));
+
+    for (int i = 0; i < 100; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        std::lock_guard<std::mutex> lock(mutex);
+        if (flushed > 0) {
+            break;
+        }
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    EXPECT_EQ(flushed, 1u);
+}
+
+TEST(PacketBatcherTest, AddDoesNotWaitForSlowFlush) {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool in_flush = false;
+    bool release = false;
+    PacketBatcher batcher;
+    batcher.Initialize(MakeConfig(2, 1000), [&](const std::string&, PacketBuffer&) {
+        std::unique_lock<std::mutex> lock(mutex);
+        in_flush = true;
+        cv.notify_all();
+        cv.wait(lock, [&]() { return release; });
+        return true;
+    });
+
+    // The second packet completes the batch; its flush blocks in the transport
+    std::thread sender([&]() {
+        batcher.Add("aoi", PacketView(MOVE, sizeof(MOVE)));
+        batcher.Add("aoi", PacketView(MOVE, sizeof(MOVE)));
+    });
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        ASSERT_TRUE(cv.wait_for(lock, std::chrono::seconds(5), [&]() { return in_flush; }));
+    }
+
+    // Queueing that does not complete a batch goes ahead meanwhile
+    std::atomic<bool> added{false};
+    std::thread adder([&]() {
+        batcher.Add("party", PacketView(EMOTE, sizeof(EMOTE)));
+        added = true;
+    });
+    for (int i = 0; i < 200 && !added; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    EXPECT_TRUE(added);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        release = true;
+    }
+    cv.notify_all();
+    sender.join();
+    adder.join();
+}
+
+TEST(PacketBatcherTest, QueuedFlushDoesNotBlockAdd) {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool in_flush = false;
+    bool release = false;
+    std::vector<std::string> order;
+    PacketBatcher batcher;
+    batcher.Initialize(MakeConfig(2, 1000), [&](const std::string& destination, PacketBuffer&) {
+        std::unique_lock<std::mutex> lock(mutex);
+        order.push_back(destination);
+        in_flush = true;
+        cv.notify_all();
+        cv.wait(lock, [&]() { return release; });
+        return true;
+    });
+
+    std::thread first([&]() {
+        batcher.Add("aoi", PacketView(MOVE, sizeof(MOVE)));
+        batcher.Add("aoi", PacketView(MOVE, sizeof(MOVE)));
+    });
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        ASSERT_TRUE(cv.wait_for(lock, std::chrono::seconds(5), [&]() { return in_flush; }));
+    }
+
+    // A second batch completes while the first is still in the transport;
+    // it waits its turn without holding up a third producer
+    std::thread second([&]() {
+        batcher.Add("party", PacketView(EMOTE, sizeof(EMOTE)));
+        batcher.Add("party", PacketView(EMOTE, sizeof(EMOTE)));
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::atomic<bool> added{false};
+    std::thread adder([&]() {
+        batcher.Add("guild", PacketView(MOVE, sizeof(MOVE)));
+        added = true;
+    });
+    for (int i = 0; i < 200 && !added; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    EXPECT_TRUE(added);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        release = true;
+    }
+    cv.notify_all();
+    first.join();
+    second.join();
+    adder.join();
+    batcher.Shutdown();
+    ASSERT_GE(order.size(), 2u);
+    EXPECT_EQ(order[0], "aoi");
+    EXPECT_EQ(order[1], "party");
+}
+
+TEST(PacketBatcherTest, DisabledBatcherRejectsPackets) {
+    PerformanceConfig config = MakeConfig(10, 5);
+    config.enable_packet_batching = false;
+    PacketBatcher batcher;
+    EXPECT_FALSE(batcher.Initialize(config, nullptr));
+    EXPECT_FALSE(batcher.Add("", PacketView(MOVE, sizeof(MOVE))));
+}
+
+TEST(PacketBatcherTest, RejectsMalformedBatch) {
+    // Declares a 9-byte entry but only 3 bytes follow
+    const uint8_t bad[] = {0x01, 0xFF, 0x09, 0x00, 0x09, 0x00, 1, 2, 3};
+    size_t packets = 0;
+    EXPECT_FALSE(PacketBatcher::Unbatch(bad, sizeof(bad), [&](const PacketView&) { packets++; }));
+    EXPECT_EQ(packets, 0u);
+}
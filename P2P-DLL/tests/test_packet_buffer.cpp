@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+#include "PacketBuffer.h"
+#include <cstring>
+
+using namespace P2P;
+
+TEST(PacketViewTest, ReadsLittleEndianType) {
+    const uint8_t data[] = {0x89, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05};
+    PacketView view(data, sizeof(data));
+    EXPECT_EQ(view.type, 0x0089);
+    EXPECT_EQ(view.length, sizeof(data));
+    EXPECT_EQ(view.data, data);
+    EXPECT_FALSE(view.Empty());
+}
+
+TEST(PacketViewTest, FromPacketPointsIntoPacketData) {
+    Packet packet;
+    packet.packet_id = 1;
+    packet.type = 0x0090;
+    packet.data = {0x90, 0x00, 0xAA};
+    packet.length = packet.data.size();
+
+    PacketView view = PacketView::FromPacket(packet);
+    EXPECT_EQ(view.data, packet.data.data());
+    EXPECT_EQ(view.type, 0x0090);
+    EXPECT_EQ(view.length, 3u);
+}
+
+TEST(PacketBufferTest, HeadroomAndTailroom) {
+    PacketBuffer buffer = PacketBufferPool::GetInstance().Acquire(64, 12);
+    EXPECT_EQ(buffer.Headroom(), 12u);
+    EXPECT_GE(buffer.Tailroom(), 64u);
+
+    const uint8_t payload[] = {1, 2, 3, 4};
+    buffer.Assign(payload, sizeof(payload));
+    EXPECT_EQ(buffer.Size(), 4u);
+
+    uint8_t* header = buffer.Prepend(12);
+    ASSERT_NE(header, nullptr);
+    EXPECT_EQ(buffer.Size(), 16u);
+    EXPECT_EQ(buffer.Headroom(), 0u);
+    EXPECT_EQ(buffer.Prepend(1), nullptr);
+
+    uint8_t* tail = buffer.Append(16);
+    std::memset(tail, 0xEE, 16);
+    EXPECT_EQ(buffer.Size(), 32u);
+    EXPECT_EQ(std::memcmp(buffer.Data() + 12, payload, sizeof(payload)), 0);
+
+    buffer.Consume(12);
+    EXPECT_EQ(buffer.Size(), 20u);
+    EXPECT_EQ(buffer.Data()[0], 1);
+}
+
+TEST(PacketBufferTest, AppendGrowsPastCapacity) {
+    PacketBuffer buffer = PacketBufferPool::GetInstance().Acquire(4);
+    size_t capacity = buffer.Capacity();
+    buffer.Append(capacity + 100);
+    EXPECT_EQ(buffer.Size(), capacity + 100);
+    EXPECT_GE(buffer.Capacity(), capacity + 100);
+}
+
+TEST(PacketBufferTest, StorageReturnsToPool) {
+    auto& pool = PacketBufferPool::GetInstance();
+    {
+        // Make sure the pool holds at least one buffer
+        PacketBuffer warmup = pool.Acquire(128);
+    }
+    size_t before = pool.GetFreeCount();
+    ASSERT_GE(before, 1u);
+    {
+        PacketBuffer a = pool.Acquire(128);
+        EXPECT_EQ(pool.GetFreeCount(), before - 1);
+        PacketBuffer b = std::move(a);
+        EXPECT_EQ(a.Capacity(), 0u);
+        EXPECT_GE(b.Capacity(), 128u);
+    }
+    // Only the moved-to buffer hands storage back
+    EXPECT_EQ(pool.GetFreeCount(), before);
+}
@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+#include "PacketTable.h"
+#include "BandwidthManager.h"
+#include "ConfigManager.h"
+
+using namespace P2P;
+
+class PacketTableTest : public ::testing::Test {
+protected:
+    void TearDown() override {
+        PacketTable::GetInstance().Reset();
+    }
+};
+
+TEST_F(PacketTableTest, DescriptorRoundTrips) {
+    auto descriptor = PacketDescriptor::Make(RouteDecision::DROP, PacketPriority::BACKGROUND, 1234, true);
+    EXPECT_EQ(descriptor.Route(), RouteDecision::DROP);
+    EXPECT_EQ(descriptor.Priority(), PacketPriority::BACKGROUND);
+    EXPECT_EQ(descriptor.FixedLength(), 1234);
+    EXPECT_TRUE(descriptor.IsBatchable());
+    EXPECT_FALSE(descriptor.IsVariableLength());
+    EXPECT_TRUE(descriptor.IsDefined());
+    EXPECT_FALSE(descriptor.IsUnreliable());
+}
+
+TEST_F(PacketTableTest, OnlyMovementIsUnreliableByDefault) {
+    auto& table = PacketTable::GetInstance();
+    EXPECT_TRUE(table.Lookup(0x0085).IsUnreliable());
+    EXPECT_EQ(table.Lookup(0x0085).Interest(), InterestClass::AOI);
+    for (uint16_t type : {0x0089, 0x0090, 0x008C, 0x00A7}) {
+        EXPECT_FALSE(table.Lookup(type).IsUnreliable());
+    }
+
+    PacketTypeOverride emotion;
+    emotion.type = 0x00A7;
+    emotion.unreliable = 1;
+    EXPECT_TRUE(table.ApplyOverrides({emotion}));
+    EXPECT_TRUE(table.Lookup(0x00A7).IsUnreliable());
+    EXPECT_TRUE(table.Lookup(0x00A7).IsBatchable());
+}
+
+TEST_F(PacketTableTest, UnknownOpcodeUsesDefaults) {
+    auto descriptor = PacketTable::GetInstance().Lookup(0xBEEF);
+    EXPECT_FALSE(descriptor.IsDefined());
+    EXPECT_EQ(descriptor.Route(), RouteDecision::SERVER);
+    EXPECT_EQ(descriptor.Priority(), PacketPriority::LOW);
+    EXPECT_EQ(descriptor.FixedLength(), 0);
+}
+
+TEST_F(PacketTableTest, DefaultTableKeepsSafeDefaults) {
+    const auto& table = PacketTable::GetDefaultTable();
+    EXPECT_EQ(table[0x0000].Route(), RouteDecision::SERVER);
+    EXPECT_EQ(table[0x0000].Priority(), PacketPriority::LOW);
+    EXPECT_EQ(table[0x0000].Interest(), InterestClass::ZONE);
+    EXPECT_EQ(table[0x0085].Route(), RouteDecision::P2P);
+    EXPECT_EQ(table[0x0085].Priority(), PacketPriority::CRITICAL);
+    EXPECT_EQ(table[0x0085].FixedLength(), 5);
+    EXPECT_TRUE(table[0x008C].IsVariableLength());
+    EXPECT_EQ(&PacketTable::GetDefaultTable(), &table);
+}
+
+TEST_F(PacketTableTest, RouteAndPriorityAgreeForSkills) {
+    auto& table = PacketTable::GetInstance();
+    for (uint16_t type : {0x0091, 0x00A2}) {
+        EXPECT_EQ(table.Lookup(type).Route(), RouteDecision::P2P);
+        EXPECT_EQ(BandwidthManager::GetPacketPriority(type), PacketPriority::HIGH);
+    }
+}
+
+TEST_F(PacketTableTest, OverridesApplyOnTopOfDefaults) {
+    PacketTypeOverride chat;
+    chat.type = 0x008C;
+    chat.route = "P2P";
+    PacketTypeOverride bogus;
+    bogus.type = 0x1234;
+    bogus.priority = "urgent";
+
+    auto& table = PacketTable::GetInstance();
+    EXPECT_FALSE(table.ApplyOverrides({chat, bogus}));
+
+    auto descriptor = table.Lookup(0x008C);
+    EXPECT_EQ(descriptor.Route(), RouteDecision::P2P);
+    EXPECT_EQ(descriptor.Priority(), PacketPriority::HIGH);  // Untouched field keeps its default
+    EXPECT_TRUE(descriptor.IsVariableLength());
+    EXPECT_FALSE(table.Lookup(0x1234).IsDefined());
+
+    table.Reset();
+    EXPECT_EQ(table.Lookup(0x008C).Route(), RouteDecision::SERVER);
+}
+
+TEST_F(PacketTableTest, ConfigSkipsMalformedOverrideTypes) {
+    auto& config = ConfigManager::GetInstance();
+    ASSERT_TRUE(config.LoadFromString(R"({
+        "coordinator": {
+            "rest_api_url": "http://localhost:8001/api/v1",
+            "websocket_url": "ws://localhost:8001/api/v1/signaling/ws"
+        },
+        "p2p": {
+            "packet_types": [
+                {"type": "0x00A7", "route": "p2p"},
+                {"type": 264, "priority": "low"},
+                {"type": "zz", "route": "p2p"},
+                {"type": "0x89zz", "route": "drop"},
+                {"type": "0x10089", "route": "drop"},
+                {"type": 70000, "route": "drop"},
+                {"type": "0xFFFFFFFFFFFFFFFFFF", "route": "drop"},
+                {"type": -1, "route": "drop"},
+                {"route": "drop"},
+                "0x0090"
+            ]
+        },
+        "logging": {
+            "level": "info",
+            "file": "test.log"
+        }
+    })"));
+
+    const auto& overrides = config.GetP2PConfig().packet_types;
+    ASSERT_EQ(overrides.size(), 2u);
+    EXPECT_EQ(overrides[0].type, 0x00A7);
+    EXPECT_EQ(overrides[0].route, "p2p");
+    EXPECT_EQ(overrides[1].type, 0x0108);
+    EXPECT_EQ(overrides[1].priority, "low");
+}
@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+#include "PeerMetricsTable.h"
+#include <thread>
+#include <vector>
+
+using namespace P2P;
+
+TEST(PeerMetricsTableTest, AcquireAndFind) {
+    PeerMetricsTable table(2);
+    EXPECT_EQ(table.Find("a"), PeerMetricsTable::INVALID_HANDLE);
+
+    PeerMetricsTable::Handle a = table.Acquire("a");
+    PeerMetricsTable::Handle b = table.Acquire("b");
+    EXPECT_NE(a, PeerMetricsTable::INVALID_HANDLE);
+    EXPECT_NE(b, PeerMetricsTable::INVALID_HANDLE);
+    EXPECT_NE(a, b);
+    EXPECT_EQ(table.Acquire("a"), a);
+    EXPECT_EQ(table.Find("b"), b);
+    EXPECT_EQ(table.Size(), 2u);
+
+    // Full
+    EXPECT_EQ(table.Acquire("c"), PeerMetricsTable::INVALID_HANDLE);
+
+    // A released handle is reused with zeroed counters
+    table.AddSent(a, 100);
+    table.Release("a");
+    EXPECT_EQ(table.Find("a"), PeerMetricsTable::INVALID_HANDLE);
+    EXPECT_EQ(table.Acquire("c"), a);
+    EXPECT_EQ(table.Read(a).bytes_sent, 0u);
+}
+
+TEST(PeerMetricsTableTest, CountersAndLoss) {
+    PeerMetricsTable table;
+    PeerMetricsTable::Handle peer = table.Acquire("peer");
+
+    table.AddSent(peer, 100);
+    table.AddSent(peer, 50);
+    for (int i = 0; i < 9; ++i) {
+        table.AddReceived(peer, 10);
+    }
+    table.AddLost(peer, 1);
+    table.AddLatencySample(peer, 100.0f);
+    table.AddLatencySample(peer, 200.0f);
+
+    BandwidthMetrics metrics = table.Read(peer);
+    EXPECT_EQ(metrics.bytes_sent, 150u);
+    EXPECT_EQ(metrics.packets_sent, 2u);
+    EXPECT_EQ(metrics.bytes_received, 90u);
+    EXPECT_EQ(metrics.packets_received, 9u);
+    EXPECT_EQ(metrics.packets_lost, 1u);
+    EXPECT_FLOAT_EQ(metrics.packet_loss_percent, 10.0f);
+    EXPECT_FLOAT_EQ(metrics.average_latency_ms, 120.0f);
+
+    table.Reset(peer);
+    EXPECT_EQ(table.Read(peer).bytes_sent, 0u);
+    EXPECT_EQ(table.Find("peer"), peer);
+
+    // Invalid handles are ignored
+    table.AddSent(PeerMetricsTable::INVALID_HANDLE, 100);
+    EXPECT_EQ(table.Read(PeerMetricsTable::INVALID_HANDLE).bytes_sent, 0u);
+}
+
+TEST(PeerMetricsTableTest, AggregateAcrossPeers) {
+    PeerMetricsTable table;
+    PeerMetricsTable::Handle a = table.Acquire("a");
+    PeerMetricsTable::Handle b = table.Acquire("b");
+    table.AddSent(a, 100);
+    table.AddSent(b, 300);
+    table.SetLatency(a, 10.0f);
+    table.SetLatency(b, 30.0f);
+    table.AddReceived(b, 10);
+    table.AddLost(b, 1);
+
+    BandwidthMetrics overall = table.Aggregate();
+    EXPECT_EQ(overall.bytes_sent, 400u);
+    EXPECT_EQ(overall.packets_sent, 2u);
+    EXPECT_FLOAT_EQ(overall.average_latency_ms, 20.0f);
+    EXPECT_FLOAT_EQ(overall.packet_loss_percent, 25.0f);  // (0% + 50%) / 2
+
+    table.Clear();
+    EXPECT_EQ(table.Aggregate().bytes_sent, 0u);
+    EXPECT_EQ(table.Size(), 0u);
+}
+
+TEST(PeerMetricsTableTest, ConcurrentUpdates) {
+    PeerMetricsTable table;
+    PeerMetricsTable::Handle peer = table.Acquire("peer");
+
+    constexpr int THREADS = 4;
+    constexpr int PACKETS = 10000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&table, peer]() {
+            for (int i = 0; i < PACKETS; ++i) {
+                table.AddSent(peer, 10);
+                table.AddLatencySample(peer, 50.0f);
+            }
+        });
+    }
+    // Registration and aggregation alongside the updates
+    for (int i = 0; i < 100; ++i) {
+        table.Acquire("other" + std::to_string(i % 10));
+        table.Aggregate();
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    BandwidthMetrics metrics = table.Read(peer);
+    EXPECT_EQ(metrics.packets_sent, static_cast<uint64_t>(THREADS * PACKETS));
+    EXPECT_EQ(metrics.bytes_sent, static_cast<uint64_t>(THREADS * PACKETS * 10));
+    EXPECT_FLOAT_EQ(metrics.average_latency_ms, 50.0f);
+}
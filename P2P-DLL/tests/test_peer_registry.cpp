@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+#include "PeerRegistry.h"
+#include <algorithm>
+#include <string>
+
+using namespace P2P;
+
+TEST(PeerRegistryTest, InsertFindErase) {
+    PeerRegistry registry(4);
+    PeerRegistry::Handle a = registry.Insert("alice", nullptr);
+    PeerRegistry::Handle b = registry.Insert("bob", nullptr);
+    ASSERT_NE(a, PeerRegistry::INVALID_HANDLE);
+    ASSERT_NE(b, PeerRegistry::INVALID_HANDLE);
+    EXPECT_NE(a, b);
+
+    EXPECT_EQ(registry.Find("alice"), a);
+    EXPECT_EQ(registry.Find("bob"), b);
+    EXPECT_EQ(registry.Find("carol"), PeerRegistry::INVALID_HANDLE);
+    EXPECT_EQ(registry.GetPeerId(b), "bob");
+
+    // Duplicate IDs are rejected
+    EXPECT_EQ(registry.Insert("alice", nullptr), PeerRegistry::INVALID_HANDLE);
+
+    EXPECT_TRUE(registry.Erase(a));
+    EXPECT_FALSE(registry.Erase(a));
+    EXPECT_EQ(registry.Find("alice"), PeerRegistry::INVALID_HANDLE);
+    EXPECT_EQ(registry.Find("bob"), b);
+    EXPECT_EQ(registry.Size(), 1u);
+}
+
+TEST(PeerRegistryTest, RejectsInsertWhenFull) {
+    PeerRegistry registry(2);
+    EXPECT_NE(registry.Insert("a", nullptr), PeerRegistry::INVALID_HANDLE);
+    EXPECT_NE(registry.Insert("b", nullptr), PeerRegistry::INVALID_HANDLE);
+    EXPECT_TRUE(registry.Full());
+    EXPECT_EQ(registry.Insert("c", nullptr), PeerRegistry::INVALID_HANDLE);
+
+    // Freed handles are reused
+    PeerRegistry::Handle a = registry.Find("a");
+    registry.Erase(a);
+    EXPECT_EQ(registry.Insert("c", nullptr), a);
+}
+
+TEST(PeerRegistryTest, LookupsSurviveChurn) {
+    // Enough peers and removals to exercise probe runs and backward-shift deletion
+    const size_t capacity = 50;
+    PeerRegistry registry(capacity);
+    for (int round = 0; round < 20; ++round) {
+        for (size_t i = 0; i < capacity; ++i) {
+            registry.Insert("peer-" + std::to_string(round) + "-" + std::to_string(i), nullptr);
+        }
+        ASSERT_TRUE(registry.Full());
+
+        // Drop every other peer, then check the rest are still found
+        for (size_t i = 0; i < capacity; i += 2) {
+            ASSERT_TRUE(registry.Erase(registry.Find("peer-" + std::to_string(round) + "-" + std::to_string(i))));
+        }
+        for (size_t i = 0; i < capacity; ++i) {
+            PeerRegistry::Handle handle = registry.Find("peer-" + std::to_string(round) + "-" + std::to_string(i));
+            EXPECT_EQ(handle == PeerRegistry::INVALID_HANDLE, i % 2 == 0);
+        }
+        registry.Clear();
+    }
+}
+
+TEST(PeerRegistryTest, HandlesStayPackedAndHotFieldsReset) {
+    PeerRegistry registry(8);
+    PeerRegistry::Handle a = registry.Insert("a", nullptr);
+    PeerRegistry::Handle b = registry.Insert("b", nullptr);
+    PeerRegistry::Handle c = registry.Insert("c", nullptr);
+
+    registry.SetConnected(b, true);
+    registry.SetPosition(b, 1.0f, 2.0f, 3.0f);
+    registry.SetScore(b, 0.25f);
+    EXPECT_TRUE(registry.IsConnected(b));
+    EXPECT_FLOAT_EQ(registry.GetPositionY(b), 2.0f);
+    EXPECT_FLOAT_EQ(registry.GetScore(b), 0.25f);
+
+    registry.Erase(a);
+    const auto& live = registry.Handles();
+    ASSERT_EQ(live.size(), 2u);
+    EXPECT_NE(std::find(live.begin(), live.end(), b), live.end());
+    EXPECT_NE(std::find(live.begin(), live.end(), c), live.end());
+
+    registry.Erase(b);
+    PeerRegistry::Handle d = registry.Insert("d", nullptr);
+    EXPECT_FALSE(registry.IsConnected(d));
+    EXPECT_FLOAT_EQ(registry.GetPositionX(d), 0.0f);
+    EXPECT_FLOAT_EQ(registry.GetScore(d), 1.0f);
+}
@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+#include "PeerSendQueue.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace P2P;
+
+namespace {
+
+PacketBuffer MakePacket(uint8_t value) {
+    PacketBuffer packet = PacketBufferPool::GetInstance().Acquire(1);
+    packet.Assign(&value, 1);
+    return packet;
+}
+
+template <typename Predicate>
+bool WaitFor(Predicate predicate) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!predicate()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+} // namespace
+
+TEST(PeerSendQueueTest, DropsWhenFull) {
+    PeerSendQueue queue("peer", [](const uint8_t*, size_t) { return true; }, 2);
+    EXPECT_TRUE(queue.Push(MakePacket(1)));
+    EXPECT_TRUE(queue.Push(MakePacket(2)));
+    EXPECT_FALSE(queue.Push(MakePacket(3)));
+    EXPECT_EQ(queue.GetDroppedCount(), 1u);
+
+    EXPECT_EQ(queue.Drain(1), 1u);
+    EXPECT_EQ(queue.Drain(10), 1u);
+    EXPECT_TRUE(queue.Empty());
+}
+
+TEST(SendWorkerPoolTest, PreservesPerPeerOrder) {
+    std::mutex mutex;
+    std::vector<uint8_t> received;
+    auto queue = std::make_shared<PeerSendQueue>("peer", [&](const uint8_t* data, size_t) {
+        std::lock_guard<std::mutex> lock(mutex);
+        received.push_back(data[0]);
+        return true;
+    });
+
+    SendWorkerPool pool;
+    ASSERT_TRUE(pool.Start(4));
+    for (int i = 0; i < 200; ++i) {
+        ASSERT_TRUE(pool.Submit(queue, MakePacket(static_cast<uint8_t>(i))));
+    }
+
+    ASSERT_TRUE(WaitFor([&] {
+        std::lock_guard<std::mutex> lock(mutex);
+        return received.size() == 200;
+    }));
+    for (int i = 0; i < 200; ++i) {
+        EXPECT_EQ(received[i], static_cast<uint8_t>(i));
+    }
+    pool.Stop();
+}
+
+TEST(SendWorkerPoolTest, SlowPeerDoesNotStallOthers) {
+    std::atomic<bool> release{false};
+    std::atomic<int> fast_sent{0};
+    auto slow = std::make_shared<PeerSendQueue>("slow", [&](const uint8_t*, size_t) {
+        while (!release) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    });
+    auto fast = std::make_shared<PeerSendQueue>("fast", [&](const uint8_t*, size_t) {
+        ++fast_sent;
+        return true;
+    });
+
+    SendWorkerPool pool;
+    ASSERT_TRUE(pool.Start(2));
+
+    // Submitting never waits on the blocked transport
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 10; ++i) {
+        pool.Submit(slow, MakePacket(0));
+        pool.Submit(fast, MakePacket(0));
+    }
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(1));
+
+    EXPECT_TRUE(WaitFor([&] { return fast_sent == 10; }));
+    release = true;
+    pool.Stop();
+}
@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+#include "ReorderWindow.h"
+#include <vector>
+
+using namespace P2P;
+
+namespace {
+
+// Packets are one byte holding their own sequence number
+class DeliveryLog {
+public:
+    ReorderWindow::DeliverFunction Function() {
+        return [this](const uint8_t* data, size_t size) {
+            ASSERT_EQ(size, 1u);
+            order.push_back(data[0]);
+        };
+    }
+
+    ReorderWindow::Result Push(ReorderWindow& window, uint32_t sequence, int64_t now_us) {
+        uint8_t payload = static_cast<uint8_t>(sequence);
+        return window.Push(sequence, &payload, 1, now_us, Function());
+    }
+
+    std::vector<uint8_t> order;
+};
+
+} // namespace
+
+TEST(ReorderWindowTest, DeliversInOrderPacketsImmediately) {
+    ReorderWindow window(40000);
+    DeliveryLog log;
+    for (uint32_t sequence = 10; sequence < 15; ++sequence) {
+        EXPECT_EQ(log.Push(window, sequence, 0), ReorderWindow::Result::DELIVERED);
+    }
+    EXPECT_EQ(log.order, (std::vector<uint8_t>{10, 11, 12, 13, 14}));
+    EXPECT_EQ(window.GetBufferedCount(), 0u);
+}
+
+TEST(ReorderWindowTest, ReordersWithinBudget) {
+    ReorderWindow window(40000);
+    DeliveryLog log;
+    EXPECT_EQ(log.Push(window, 1, 0), ReorderWindow::Result::DELIVERED);
+    EXPECT_EQ(log.Push(window, 3, 1000), ReorderWindow::Result::BUFFERED);
+    EXPECT_EQ(log.Push(window, 4, 2000), ReorderWindow::Result::BUFFERED);
+    EXPECT_EQ(log.Push(window, 3, 2500), ReorderWindow::Result::DUPLICATE);
+    EXPECT_EQ(log.order, (std::vector<uint8_t>{1}));
+
+    // The late packet unblocks the ones behind it
+    EXPECT_EQ(log.Push(window, 2, 5000), ReorderWindow::Result::DELIVERED);
+    EXPECT_EQ(log.order, (std::vector<uint8_t>{1, 2, 3, 4}));
+    EXPECT_EQ(window.GetStats().reordered, 2u);
+    EXPECT_EQ(window.GetStats().duplicates, 1u);
+
+    // Anything older than what was delivered is stale
+    EXPECT_EQ(log.Push(window, 2, 6000), ReorderWindow::Result::STALE);
+    EXPECT_EQ(log.Push(window, 0, 6000), ReorderWindow::Result::STALE);
+}
+
+TEST(ReorderWindowTest, SkipsGapAfterBudget) {
+    ReorderWindow window(40000);
+    DeliveryLog log;
+    log.Push(window, 1, 0);
+    EXPECT_EQ(log.Push(window, 3, 10000), ReorderWindow::Result::BUFFERED);
+
+    EXPECT_EQ(window.Poll(49000, log.Function()), 0u);
+    EXPECT_EQ(window.Poll(50000, log.Function()), 1u);
+    EXPECT_EQ(log.order, (std::vector<uint8_t>{1, 3}));
+    EXPECT_EQ(window.GetStats().skipped, 1u);
+
+    // The lost packet turning up late is dropped
+    EXPECT_EQ(log.Push(window, 2, 60000), ReorderWindow::Result::STALE);
+}
+
+TEST(ReorderWindowTest, ZeroBudgetNeverHolds) {
+    ReorderWindow window(0);
+    DeliveryLog log;
+    log.Push(window, 1, 0);
+    EXPECT_EQ(log.Push(window, 3, 0), ReorderWindow::Result::DELIVERED);
+    EXPECT_EQ(log.Push(window, 2, 0), ReorderWindow::Result::STALE);
+    EXPECT_EQ(log.order, (std::vector<uint8_t>{1, 3}));
+}
+
+TEST(ReorderWindowTest, FarAheadRestartsWindow) {
+    ReorderWindow window(40000, 8);
+    DeliveryLog log;
+    log.Push(window, 1, 0);
+    log.Push(window, 3, 0);
+    EXPECT_EQ(log.Push(window, 100, 0), ReorderWindow::Result::DELIVERED);
+    EXPECT_EQ(log.order, (std::vector<uint8_t>{1, 3, 100}));
+    EXPECT_EQ(window.GetBufferedCount(), 0u);
+}
+
+TEST(ReorderWindowTest, HandlesSequenceWraparound) {
+    ReorderWindow window(40000);
+    DeliveryLog log;
+    log.Push(window, 0xFFFFFFFEu, 0);
+    EXPECT_EQ(log.Push(window, 0, 0), ReorderWindow::Result::BUFFERED);
+    EXPECT_EQ(log.Push(window, 0xFFFFFFFFu, 0), ReorderWindow::Result::DELIVERED);
+    EXPECT_EQ(log.order, (std::vector<uint8_t>{0xFE, 0xFF, 0x00}));
+}
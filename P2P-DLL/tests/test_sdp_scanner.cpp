@@ -0,0 +1,44 @@
+#include <gtest/gtest.h>
+#include "SdpScanner.h"
+#include <string>
+#include <vector>
+
+using namespace P2P;
+
+namespace {
+
+const char* OFFER =
+    "v=0\r\n"
+    "o=- 4611731400430051336 2 IN IP4 127.0.0.1\r\n"
+    "s=-\r\n"
+    "a=msid-semantic: WMS stream-7\r\n"
+    "m=application 9 UDP/DTLS/SCTP webrtc-datachannel\r\n"
+    "a=mid:peerid-player42\r\n"
+    "a=sctp-port:5000\r\n";
+
+} // namespace
+
+TEST(SdpScannerTest, SplitsCrlfAndBareLfLines) {
+    SdpScanner scanner("v=0\r\ns=-\na=x");
+    std::vector<std::string> lines;
+    std::string_view line;
+    while (scanner.Next(line)) {
+        lines.emplace_back(line);
+    }
+    EXPECT_EQ(lines, (std::vector<std::string>{"v=0", "s=-", "a=x"}));
+}
+
+TEST(SdpScannerTest, FindValueReturnsRestOfFirstMatchingLine) {
+    EXPECT_EQ(SdpScanner::FindValue(OFFER, "a=sctp-port:"), "5000");
+    EXPECT_TRUE(SdpScanner::FindValue(OFFER, "a=fingerprint:").empty());
+}
+
+TEST(SdpScannerTest, MidTagWinsOverWms) {
+    EXPECT_EQ(SdpScanner::ExtractPeerId(OFFER), "player42");
+}
+
+TEST(SdpScannerTest, FallsBackToWmsThenEmpty) {
+    EXPECT_EQ(SdpScanner::ExtractPeerId("v=0\r\na=msid-semantic: WMS stream-7\r\na=mid:0\r\n"), "stream-7");
+    EXPECT_EQ(SdpScanner::ExtractPeerId("v=0\r\na=mid:peerid-\r\na=mid:0\r\n"), "");
+    EXPECT_EQ(SdpScanner::ExtractPeerId(""), "");
+}
@@ -0,0 +1,409 @@
+#include <gtest/gtest.h>
+#include "SecurityManager.h"
+#include "PacketBatcher.h"
+#include "PacketBuffer.h"
+#include <sodium.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace P2P;
+
+namespace {
+
+PacketBuffer MakePacket(const std::vector<uint8_t>& payload) {
+    PacketBuffer buffer = PacketBufferPool::GetInstance().Acquire(
+        SecurityManager::PACKET_HEADROOM + payload.size() + SecurityManager::ENCRYPTION_TAILROOM,
+        SecurityManager::PACKET_HEADROOM);
+    buffer.Assign(payload.data(), payload.size());
+    return buffer;
+}
+
+std::vector<uint8_t> Contents(const PacketBuffer& buffer) {
+    return std::vector<uint8_t>(buffer.Data(), buffer.Data() + buffer.Size());
+}
+
+// Two managers, each holding one end of a per-peer ECDHE handshake
+class SecurityManagerPeerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_TRUE(alice_.Initialize(true, 4));
+        ASSERT_TRUE(bob_.Initialize(true, 4));
+        alice_key_ = alice_.AcquirePeerKey("bob");
+        bob_key_ = bob_.AcquirePeerKey("alice");
+        ASSERT_NE(alice_key_, SecurityManager::INVALID_PEER_KEY);
+        ASSERT_NE(bob_key_, SecurityManager::INVALID_PEER_KEY);
+
+        ASSERT_TRUE(alice_.GenerateECDHKeypair(alice_key_));
+        ASSERT_TRUE(bob_.GenerateECDHKeypair(bob_key_));
+        ASSERT_TRUE(alice_.DeriveSharedKey(alice_key_, bob_.GetPublicKey(bob_key_)));
+        ASSERT_TRUE(bob_.DeriveSharedKey(bob_key_, alice_.GetPublicKey(alice_key_)));
+    }
+
+    SecurityManager alice_;
+    SecurityManager bob_;
+    SecurityManager::PeerKeyHandle alice_key_ = SecurityManager::INVALID_PEER_KEY;
+    SecurityManager::PeerKeyHandle bob_key_ = SecurityManager::INVALID_PEER_KEY;
+    const std::vector<uint8_t> payload_ = {0x89, 0x00, 0x10, 0x20, 0x30, 0x40, 0x50};
+};
+
+} // namespace
+
+TEST_F(SecurityManagerPeerTest, PeerKeyRoundTrip) {
+    EXPECT_TRUE(alice_.IsKeyReady(alice_key_));
+    EXPECT_TRUE(bob_.IsKeyReady(bob_key_));
+
+    PacketBuffer packet = MakePacket(payload_);
+    ASSERT_TRUE(alice_.EncryptPacket(alice_key_, packet));
+    EXPECT_EQ(packet.Size(),
+              payload_.size() + SecurityManager::ENCRYPTION_HEADROOM + SecurityManager::ENCRYPTION_TAILROOM);
+    EXPECT_NE(Contents(packet), payload_);
+
+    ASSERT_TRUE(bob_.DecryptPacket(bob_key_, packet));
+    EXPECT_EQ(Contents(packet), payload_);
+}
+
+TEST_F(SecurityManagerPeerTest, RejectsTamperedFrame) {
+    PacketBuffer packet = MakePacket(payload_);
+    ASSERT_TRUE(alice_.EncryptPacket(alice_key_, packet));
+
+    // Flip one bit each in the IV, the ciphertext and the tag
+    for (size_t offset : {size_t{0}, SecurityManager::ENCRYPTION_HEADROOM, packet.Size() - 1}) {
+        PacketBuffer tampered = MakePacket(Contents(packet));
+        tampered.Data()[offset] ^= 0x01;
+        EXPECT_FALSE(bob_.DecryptPacket(bob_key_, tampered)) << "offset " << offset;
+    }
+
+    PacketBuffer truncated = MakePacket(std::vector<uint8_t>(packet.Data(), packet.Data() + 8));
+    EXPECT_FALSE(bob_.DecryptPacket(bob_key_, truncated));
+}
+
+TEST_F(SecurityManagerPeerTest, RejectsStaleAndInvalidHandles) {
+    PacketBuffer packet = MakePacket(payload_);
+    ASSERT_TRUE(alice_.EncryptPacket(alice_key_, packet));
+
+    bob_.ReleasePeerKey(bob_key_);
+    EXPECT_FALSE(bob_.IsKeyReady(bob_key_));
+    PacketBuffer sealed = MakePacket(Contents(packet));
+    EXPECT_FALSE(bob_.DecryptPacket(bob_key_, sealed));
+
+    alice_.ReleasePeerKey(alice_key_);
+    PacketBuffer plain = MakePacket(payload_);
+    EXPECT_FALSE(alice_.EncryptPacket(alice_key_, plain));
+
+    PacketBuffer other = MakePacket(payload_);
+    EXPECT_FALSE(alice_.EncryptPacket(4, other));
+    EXPECT_FALSE(alice_.EncryptPacket(SecurityManager::INVALID_PEER_KEY, other));
+}
+
+TEST_F(SecurityManagerPeerTest, WrongPeerKeyFailsToDecrypt) {
+    SecurityManager::PeerKeyHandle carol_key = bob_.AcquirePeerKey("carol");
+    ASSERT_NE(carol_key, bob_key_);
+    ASSERT_TRUE(bob_.GenerateECDHKeypair(carol_key));
+    SecurityManager carol;
+    ASSERT_TRUE(carol.Initialize(true, 4));
+    SecurityManager::PeerKeyHandle carol_bob = carol.AcquirePeerKey("bob");
+    ASSERT_TRUE(carol.GenerateECDHKeypair(carol_bob));
+    ASSERT_TRUE(bob_.DeriveSharedKey(carol_key, carol.GetPublicKey(carol_bob)));
+
+    PacketBuffer packet = MakePacket(payload_);
+    ASSERT_TRUE(alice_.EncryptPacket(alice_key_, packet));
+    EXPECT_FALSE(bob_.DecryptPacket(carol_key, packet));
+}
+
+TEST(SecurityManagerTest, ReinitializeKeepsPeerKeyTable) {
+    SecurityManager manager;
+    ASSERT_TRUE(manager.Initialize(true, 2));
+    SecurityManager::PeerKeyHandle handle = manager.AcquirePeerKey("peer");
+    ASSERT_NE(handle, SecurityManager::INVALID_PEER_KEY);
+
+    EXPECT_FALSE(manager.Initialize(true, 8));
+    EXPECT_TRUE(manager.Initialize(true, 2));
+    EXPECT_EQ(manager.AcquirePeerKey("peer"), handle);
+    EXPECT_TRUE(manager.GenerateECDHKeypair(handle));
+}
+
+TEST(SecurityManagerTest, ConcurrentHandshakesUseSeparateKeys) {
+    constexpr size_t PEERS = 8;
+    SecurityManager hub;
+    SecurityManager remotes[PEERS];
+    ASSERT_TRUE(hub.Initialize(true, PEERS));
+    SecurityManager::PeerKeyHandle hub_keys[PEERS];
+    SecurityManager::PeerKeyHandle remote_keys[PEERS];
+    for (size_t i = 0; i < PEERS; ++i) {
+        ASSERT_TRUE(remotes[i].Initialize(true, 1));
+        hub_keys[i] = hub.AcquirePeerKey("peer" + std::to_string(i));
+        remote_keys[i] = remotes[i].AcquirePeerKey("hub");
+        ASSERT_NE(hub_keys[i], SecurityManager::INVALID_PEER_KEY);
+    }
+
+    // Every handshake runs on its own thread against the same hub, while
+    // the hub keeps encrypting for peers whose key is already installed
+    std::atomic<size_t> failures{0};
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < PEERS; ++i) {
+        threads.emplace_back([&, i] {
+            bool ok = hub.GenerateECDHKeypair(hub_keys[i]) &&
+                      remotes[i].GenerateECDHKeypair(remote_keys[i]) &&
+                      remotes[i].DeriveSharedKey(remote_keys[i], hub.GetPublicKey(hub_keys[i])) &&
+                      hub.DeriveSharedKey(hub_keys[i], remotes[i].GetPublicKey(remote_keys[i]));
+            for (int n = 0; ok && n < 50; ++n) {
+                PacketBuffer packet = MakePacket({0x90, 0x00, static_cast<uint8_t>(i), static_cast<uint8_t>(n)});
+                ok = hub.EncryptPacket(hub_keys[i], packet) && remotes[i].DecryptPacket(remote_keys[i], packet) &&
+                     packet.Size() == 4 && packet.Data()[2] == i;
+            }
+            if (!ok) {
+                failures.fetch_add(1);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(failures.load(), 0u);
+
+    // A frame for one peer never opens with another peer's key
+    PacketBuffer packet = MakePacket({0x90, 0x00, 0x01});
+    ASSERT_TRUE(hub.EncryptPacket(hub_keys[0], packet));
+    EXPECT_FALSE(remotes[1].DecryptPacket(remote_keys[1], packet));
+}
+
+TEST_F(SecurityManagerPeerTest, InterleavedPeersOnOneThread) {
+    // One thread fanning out to two peers alternates between their cached
+    // key schedules; each frame must still seal under its own peer's key
+    SecurityManager::PeerKeyHandle carol_key = alice_.AcquirePeerKey("carol");
+    SecurityManager carol;
+    ASSERT_TRUE(carol.Initialize(true, 4));
+    SecurityManager::PeerKeyHandle carol_alice = carol.AcquirePeerKey("alice");
+    ASSERT_TRUE(alice_.GenerateECDHKeypair(carol_key));
+    ASSERT_TRUE(carol.GenerateECDHKeypair(carol_alice));
+    ASSERT_TRUE(alice_.DeriveSharedKey(carol_key, carol.GetPublicKey(carol_alice)));
+    ASSERT_TRUE(carol.DeriveSharedKey(carol_alice, alice_.GetPublicKey(carol_key)));
+
+    for (int n = 0; n < 20; ++n) {
+        PacketBuffer to_bob = MakePacket(payload_);
+        PacketBuffer to_carol = MakePacket(payload_);
+        ASSERT_TRUE(alice_.EncryptPacket(alice_key_, to_bob));
+        ASSERT_TRUE(alice_.EncryptPacket(carol_key, to_carol));
+        PacketBuffer misdirected = MakePacket(Contents(to_carol));
+        EXPECT_FALSE(bob_.DecryptPacket(bob_key_, misdirected));
+        ASSERT_TRUE(bob_.DecryptPacket(bob_key_, to_bob));
+        ASSERT_TRUE(carol.DecryptPacket(carol_alice, to_carol));
+        EXPECT_EQ(Contents(to_bob), payload_);
+        EXPECT_EQ(Contents(to_carol), payload_);
+    }
+}
+
+TEST_F(SecurityManagerPeerTest, NoncesAreUniqueAcrossThreads) {
+    constexpr int THREADS = 4;
+    constexpr int PER_THREAD = 500;
+    std::vector<std::vector<std::vector<uint8_t>>> ivs(THREADS);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&, t] {
+            for (int n = 0; n < PER_THREAD; ++n) {
+                PacketBuffer packet = MakePacket(payload_);
+                if (alice_.EncryptPacket(alice_key_, packet)) {
+                    ivs[t].emplace_back(packet.Data(), packet.Data() + SecurityManager::ENCRYPTION_HEADROOM);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::set<std::vector<uint8_t>> unique;
+    for (const auto& per_thread : ivs) {
+        ASSERT_EQ(per_thread.size(), static_cast<size_t>(PER_THREAD));
+        unique.insert(per_thread.begin(), per_thread.end());
+    }
+    EXPECT_EQ(unique.size(), static_cast<size_t>(THREADS * PER_THREAD));
+}
+
+TEST_F(SecurityManagerPeerTest, DirectionsUseDifferentKeys) {
+    // Both ends start counting nonces at zero, so the first frames each way
+    // share an IV; they must still be sealed under different keys
+    PacketBuffer from_alice = MakePacket(payload_);
+    PacketBuffer from_bob = MakePacket(payload_);
+    ASSERT_TRUE(alice_.EncryptPacket(alice_key_, from_alice));
+    ASSERT_TRUE(bob_.EncryptPacket(bob_key_, from_bob));
+    ASSERT_TRUE(std::equal(from_alice.Data(), from_alice.Data() + SecurityManager::ENCRYPTION_HEADROOM,
+                           from_bob.Data()));
+    EXPECT_NE(Contents(from_alice), Contents(from_bob));
+
+    // A frame reflected back to its sender does not authenticate
+    PacketBuffer reflected = MakePacket(Contents(from_alice));
+    EXPECT_FALSE(alice_.DecryptPacket(alice_key_, reflected));
+
+    ASSERT_TRUE(alice_.DecryptPacket(alice_key_, from_bob));
+    EXPECT_EQ(Contents(from_bob), payload_);
+}
+
+TEST_F(SecurityManagerPeerTest, RekeyRejectsFramesUnderOldKey) {
+    PacketBuffer old_frame = MakePacket(payload_);
+    ASSERT_TRUE(alice_.EncryptPacket(alice_key_, old_frame));
+
+    // Fresh handshake on both ends
+    ASSERT_TRUE(alice_.GenerateECDHKeypair(alice_key_));
+    ASSERT_TRUE(bob_.GenerateECDHKeypair(bob_key_));
+    ASSERT_TRUE(alice_.DeriveSharedKey(alice_key_, bob_.GetPublicKey(bob_key_)));
+    ASSERT_TRUE(bob_.DeriveSharedKey(bob_key_, alice_.GetPublicKey(alice_key_)));
+
+    EXPECT_FALSE(bob_.DecryptPacket(bob_key_, old_frame));
+
+    PacketBuffer new_frame = MakePacket(payload_);
+    ASSERT_TRUE(alice_.EncryptPacket(alice_key_, new_frame));
+    ASSERT_TRUE(bob_.DecryptPacket(bob_key_, new_frame));
+    EXPECT_EQ(Contents(new_frame), payload_);
+}
+
+TEST_F(SecurityManagerPeerTest, RefusesSecondDerivationFromSameKeypair) {
+    // Deriving again from the same keypairs would give the same keys with
+    // the nonce counter back at zero
+    PacketBuffer first = MakePacket(payload_);
+    ASSERT_TRUE(alice_.EncryptPacket(alice_key_, first));
+    EXPECT_FALSE(alice_.DeriveSharedKey(alice_key_, bob_.GetPublicKey(bob_key_)));
+
+    PacketBuffer second = MakePacket(payload_);
+    ASSERT_TRUE(alice_.EncryptPacket(alice_key_, second));
+    EXPECT_FALSE(std::equal(first.Data(), first.Data() + SecurityManager::ENCRYPTION_HEADROOM, second.Data()));
+    ASSERT_TRUE(bob_.DecryptPacket(bob_key_, first));
+    ASSERT_TRUE(bob_.DecryptPacket(bob_key_, second));
+    EXPECT_EQ(Contents(second), payload_);
+}
+
+TEST(SecurityManagerTest, PeerKeyDoesNotEnableManagerEncryption) {
+    SecurityManager alice;
+    SecurityManager bob;
+    ASSERT_TRUE(alice.Initialize(false, 2));
+    ASSERT_TRUE(bob.Initialize(false, 2));
+    SecurityManager::PeerKeyHandle alice_bob = alice.AcquirePeerKey("bob");
+    SecurityManager::PeerKeyHandle alice_carol = alice.AcquirePeerKey("carol");
+    SecurityManager::PeerKeyHandle bob_alice = bob.AcquirePeerKey("alice");
+    ASSERT_TRUE(alice.GenerateECDHKeypair(alice_bob));
+    ASSERT_TRUE(bob.GenerateECDHKeypair(bob_alice));
+    ASSERT_TRUE(alice.DeriveSharedKey(alice_bob, bob.GetPublicKey(bob_alice)));
+    ASSERT_TRUE(bob.DeriveSharedKey(bob_alice, alice.GetPublicKey(alice_bob)));
+    EXPECT_FALSE(alice.IsEncryptionEnabled());
+
+    const std::vector<uint8_t> payload = {0x89, 0x00, 0x10, 0x20, 0x30};
+    // A peer with a key is sealed...
+    PacketBuffer sealed = MakePacket(payload);
+    ASSERT_TRUE(alice.EncryptPacket(alice_bob, sealed));
+    EXPECT_NE(Contents(sealed), payload);
+    ASSERT_TRUE(bob.DecryptPacket(bob_alice, sealed));
+    EXPECT_EQ(Contents(sealed), payload);
+
+    // ...a peer without one still goes out in the clear
+    PacketBuffer plain = MakePacket(payload);
+    ASSERT_TRUE(alice.EncryptPacket(alice_carol, plain));
+    EXPECT_EQ(Contents(plain), payload);
+}
+
+TEST_F(SecurityManagerPeerTest, RejectsReflectedPublicKey) {
+    SecurityManager::PeerKeyHandle other = alice_.AcquirePeerKey("mallory");
+    ASSERT_TRUE(alice_.GenerateECDHKeypair(other));
+    EXPECT_FALSE(alice_.DeriveSharedKey(other, alice_.GetPublicKey(other)));
+    EXPECT_FALSE(alice_.IsKeyReady(other));
+}
+
+namespace {
+
+// A manager signing with a freshly generated key, loaded from a key file
+class SecurityManagerSignatureTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        unsigned char public_key[crypto_sign_PUBLICKEYBYTES];
+        unsigned char secret_key[crypto_sign_SECRETKEYBYTES];
+        ASSERT_EQ(crypto_sign_keypair(public_key, secret_key), 0);
+        key_path_ = testing::TempDir() + "p2p_test_ed25519.key";
+        {
+            std::ofstream key_file(key_path_, std::ios::binary);
+            key_file.write(reinterpret_cast<const char*>(secret_key), sizeof(secret_key));
+        }
+        sodium_memzero(secret_key, sizeof(secret_key));
+        ASSERT_TRUE(security_.LoadED25519Key(key_path_));
+    }
+
+    void TearDown() override {
+        std::remove(key_path_.c_str());
+    }
+
+    SecurityManager security_;
+    std::string key_path_;
+};
+
+} // namespace
+
+TEST_F(SecurityManagerSignatureTest, SignsAndVerifiesPackets) {
+    SecurityManager unkeyed;
+    EXPECT_FALSE(unkeyed.IsSignatureEnabled());
+    EXPECT_TRUE(security_.IsSignatureEnabled());
+
+    std::vector<uint8_t> packet = {0x90, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05};
+    uint8_t signature[SecurityManager::ED25519_SIGNATURE_SIZE];
+    ASSERT_TRUE(security_.SignPacketED25519(packet.data(), packet.size(), signature));
+    EXPECT_TRUE(security_.VerifyPacketED25519(packet.data(), packet.size(), signature));
+
+    packet[3] ^= 0x01;
+    EXPECT_FALSE(security_.VerifyPacketED25519(packet.data(), packet.size(), signature));
+}
+
+TEST_F(SecurityManagerSignatureTest, BatchAndPacketSignaturesAreNotInterchangeable) {
+    std::vector<uint8_t> frame = {0x01, 0xFF, 0x0C, 0x00, 0x05, 0x00, 0x89, 0x00, 0x01, 0x02, 0x03};
+    frame[2] = static_cast<uint8_t>(frame.size());
+
+    uint8_t batch_signature[SecurityManager::ED25519_SIGNATURE_SIZE];
+    uint8_t packet_signature[SecurityManager::ED25519_SIGNATURE_SIZE];
+    ASSERT_TRUE(security_.SignBatchED25519(frame.data(), frame.size(), batch_signature));
+    ASSERT_TRUE(security_.SignPacketED25519(frame.data(), frame.size(), packet_signature));
+
+    EXPECT_TRUE(security_.VerifyBatchED25519(frame.data(), frame.size(), batch_signature));
+    EXPECT_TRUE(security_.VerifyPacketED25519(frame.data(), frame.size(), packet_signature));
+    EXPECT_FALSE(security_.VerifyPacketED25519(frame.data(), frame.size(), batch_signature));
+    EXPECT_FALSE(security_.VerifyBatchED25519(frame.data(), frame.size(), packet_signature));
+}
+
+TEST_F(SecurityManagerSignatureTest, VerifiesTrailingFrameSignature) {
+    // A batch frame as PacketBatcher builds it, with its signature appended
+    std::vector<uint8_t> frame;
+    PerformanceConfig config;
+    config.enable_packet_batching = true;
+    config.packet_batch_size = 2;
+    config.packet_batch_timeout_ms = 1000;
+    PacketBatcher batcher;
+    ASSERT_TRUE(batcher.Initialize(config, [&](const std::string&, PacketBuffer& batch) {
+        frame.assign(batch.Data(), batch.Data() + batch.Size());
+        return true;
+    }));
+    const uint8_t first[] = {0x89, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05};
+    const uint8_t second[] = {0x9F, 0x00, 0x0A, 0x0B, 0x0C, 0x0D};
+    batcher.Add("", PacketView(first, sizeof(first)));
+    batcher.Add("", PacketView(second, sizeof(second)));
+    batcher.Shutdown();
+    ASSERT_EQ(PacketView(frame.data(), frame.size()).type, PacketBatcher::BATCH_PACKET_TYPE);
+
+    size_t frame_size = frame.size();
+    frame.resize(frame_size + SecurityManager::ED25519_SIGNATURE_SIZE);
+    ASSERT_TRUE(security_.SignBatchED25519(frame.data(), frame_size, frame.data() + frame_size));
+
+    size_t payload_size = 0;
+    ASSERT_TRUE(security_.VerifyFrameED25519(frame.data(), frame.size(), payload_size));
+    EXPECT_EQ(payload_size, frame_size);
+
+    // The batch signature does not pass once the frame is relabelled as a packet
+    std::vector<uint8_t> relabelled = frame;
+    relabelled[0] = 0x89;
+    relabelled[1] = 0x00;
+    EXPECT_FALSE(security_.VerifyFrameED25519(relabelled.data(), relabelled.size(), payload_size));
+
+    frame[frame_size - 1] ^= 0x01;
+    EXPECT_FALSE(security_.VerifyFrameED25519(frame.data(), frame.size(), payload_size));
+    EXPECT_FALSE(security_.VerifyFrameED25519(frame.data(), SecurityManager::ED25519_SIGNATURE_SIZE, payload_size));
+}
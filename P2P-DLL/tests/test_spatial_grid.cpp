@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+#include "SpatialGrid.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace P2P;
+
+namespace {
+
+struct Point {
+    float x, y, z;
+    bool present;
+};
+
+float DistanceSquared(const Point& p, float x, float y, float z) {
+    return (p.x - x) * (p.x - x) + (p.y - y) * (p.y - y) + (p.z - z) * (p.z - z);
+}
+
+} // namespace
+
+TEST(SpatialGridTest, RadiusQueryIsInclusive) {
+    SpatialGrid grid(10.0f);
+    grid.Update(0, 0.0f, 0.0f, 0.0f);
+    grid.Update(1, 5.0f, 0.0f, 0.0f);
+    grid.Update(2, 25.0f, 0.0f, 0.0f);
+
+    std::vector<SpatialGrid::Handle> found;
+    grid.QueryRadius(0.0f, 0.0f, 0.0f, 5.0f, found);
+    std::sort(found.begin(), found.end());
+    EXPECT_EQ(found, (std::vector<SpatialGrid::Handle>{0, 1}));
+
+    // Moving across cells is tracked
+    grid.Update(2, 3.0f, 3.0f, 0.0f);
+    grid.QueryRadius(0.0f, 0.0f, 0.0f, 5.0f, found);
+    EXPECT_EQ(found.size(), 3u);
+
+    grid.Remove(1);
+    grid.QueryRadius(0.0f, 0.0f, 0.0f, 5.0f, found);
+    std::sort(found.begin(), found.end());
+    EXPECT_EQ(found, (std::vector<SpatialGrid::Handle>{0, 2}));
+    EXPECT_EQ(grid.Size(), 2u);
+}
+
+TEST(SpatialGridTest, NearestIsSortedByDistance) {
+    SpatialGrid grid(4.0f);
+    grid.Update(7, 100.0f, 100.0f, 0.0f);
+    grid.Update(3, 1.0f, 0.0f, 0.0f);
+    grid.Update(5, -2.0f, 0.0f, 0.0f);
+
+    std::vector<SpatialGrid::Handle> found;
+    grid.QueryNearest(0.0f, 0.0f, 0.0f, 2, found);
+    EXPECT_EQ(found, (std::vector<SpatialGrid::Handle>{3, 5}));
+
+    grid.QueryNearest(0.0f, 0.0f, 0.0f, 10, found);
+    EXPECT_EQ(found, (std::vector<SpatialGrid::Handle>{3, 5, 7}));
+}
+
+TEST(SpatialGridTest, MatchesBruteForceUnderChurn) {
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> coord(-300.0f, 300.0f);
+    std::uniform_int_distribution<int> pick(0, 63);
+
+    SpatialGrid grid(16.0f);
+    std::vector<Point> points(64, Point{0.0f, 0.0f, 0.0f, false});
+
+    for (int step = 0; step < 2000; ++step) {
+        SpatialGrid::Handle handle = static_cast<SpatialGrid::Handle>(pick(rng));
+        if (step % 7 == 0) {
+            grid.Remove(handle);
+            points[handle].present = false;
+        } else {
+            Point p{coord(rng), coord(rng), coord(rng) * 0.1f, true};
+            grid.Update(handle, p.x, p.y, p.z);
+            points[handle] = p;
+        }
+
+        if (step % 50 != 0) {
+            continue;
+        }
+        float qx = coord(rng), qy = coord(rng);
+        float radius = std::uniform_real_distribution<float>(0.0f, 200.0f)(rng);
+
+        std::vector<SpatialGrid::Handle> expected;
+        std::vector<std::pair<float, SpatialGrid::Handle>> by_distance;
+        for (SpatialGrid::Handle h = 0; h < points.size(); ++h) {
+            if (!points[h].present) continue;
+            float d = DistanceSquared(points[h], qx, qy, 0.0f);
+            if (d <= radius * radius) expected.push_back(h);
+            by_distance.emplace_back(d, h);
+        }
+        std::sort(by_distance.begin(), by_distance.end());
+
+        std::vector<SpatialGrid::Handle> found;
+        grid.QueryRadius(qx, qy, 0.0f, radius, found);
+        std::sort(found.begin(), found.end());
+        ASSERT_EQ(found, expected);
+
+        grid.QueryNearest(qx, qy, 0.0f, 5, found);
+        ASSERT_EQ(found.size(), std::min<size_t>(5, by_distance.size()));
+        for (size_t i = 0; i < found.size(); ++i) {
+            EXPECT_FLOAT_EQ(DistanceSquared(points[found[i]], qx, qy, 0.0f), by_distance[i].first);
+        }
+    }
+}
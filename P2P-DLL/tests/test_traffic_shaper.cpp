@@ -0,0 +1,201 @@
+#include <gtest/gtest.h>
+#include "TrafficShaper.h"
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace P2P;
+
+namespace {
+
+// Shaper config with no link tokens: only CRITICAL's reserve lets anything out
+BandwidthConfig ClosedLinkConfig() {
+    BandwidthConfig config;
+    config.max_bitrate_kbps = 0.0f;
+    config.critical_reserve_kbps = 8.0f;  // 1000 B/s, 1500 B burst
+    return config;
+}
+
+class TransmitLog {
+public:
+    TrafficShaper::TransmitFunction Function() {
+        return [this](PacketPriority priority, uint32_t tag, PacketBuffer& packet) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            priorities_.push_back(priority);
+            tags_.push_back(tag);
+            EXPECT_GT(packet.Size(), 0u);
+        };
+    }
+
+    bool WaitFor(size_t count) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (std::chrono::steady_clock::now() < deadline) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (priorities_.size() >= count) {
+                    return true;
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return false;
+    }
+
+    std::vector<PacketPriority> Priorities() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return priorities_;
+    }
+
+    std::vector<uint32_t> Tags() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return tags_;
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<PacketPriority> priorities_;
+    std::vector<uint32_t> tags_;
+};
+
+} // namespace
+
+TEST(TrafficShaperTest, SendsEverythingWhenNotRunning) {
+    TrafficShaper shaper;
+    shaper.Configure(ClosedLinkConfig());
+    std::vector<uint8_t> packet(1000, 0xAB);
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_EQ(shaper.Submit(PacketPriority::LOW, packet.data(), packet.size(), 0),
+                  TrafficShaper::Verdict::SEND_NOW);
+    }
+    EXPECT_EQ(shaper.GetSentBytes(PacketPriority::LOW), 10000u);
+    EXPECT_TRUE(shaper.CanSend(PacketPriority::LOW));
+}
+
+TEST(TrafficShaperTest, CriticalUsesReserveWhenLinkIsFull) {
+    TrafficShaper shaper;
+    shaper.Configure(ClosedLinkConfig());
+    TransmitLog log;
+    ASSERT_TRUE(shaper.Start(log.Function()));
+
+    std::vector<uint8_t> packet(1000, 0xAB);
+    for (int i = 0; i < 5; ++i) {
+        EXPECT_EQ(shaper.Submit(PacketPriority::LOW, packet.data(), packet.size(), 0),
+                  TrafficShaper::Verdict::QUEUED);
+    }
+    EXPECT_FALSE(shaper.CanSend(PacketPriority::LOW));
+    EXPECT_TRUE(shaper.CanSend(PacketPriority::CRITICAL));
+
+    // The reserve admits while it holds any tokens, then CRITICAL queues too
+    EXPECT_EQ(shaper.Submit(PacketPriority::CRITICAL, packet.data(), packet.size(), 1),
+              TrafficShaper::Verdict::SEND_NOW);
+    EXPECT_EQ(shaper.Submit(PacketPriority::CRITICAL, packet.data(), packet.size(), 1),
+              TrafficShaper::Verdict::SEND_NOW);
+    EXPECT_EQ(shaper.Submit(PacketPriority::CRITICAL, packet.data(), packet.size(), 1),
+              TrafficShaper::Verdict::QUEUED);
+    EXPECT_EQ(shaper.GetQueuedPackets(PacketPriority::LOW), 5u);
+    EXPECT_EQ(shaper.GetQueuedPackets(PacketPriority::CRITICAL), 1u);
+
+    // Opening the link releases the queued CRITICAL packet before any LOW one
+    shaper.SetLinkRate(10000.0f);
+    ASSERT_TRUE(log.WaitFor(6));
+    std::vector<PacketPriority> order = log.Priorities();
+    EXPECT_EQ(order.front(), PacketPriority::CRITICAL);
+    EXPECT_EQ(log.Tags().front(), 1u);
+    for (size_t i = 1; i < order.size(); ++i) {
+        EXPECT_EQ(order[i], PacketPriority::LOW);
+    }
+    shaper.Stop();
+}
+
+TEST(TrafficShaperTest, DropsWhenQueueIsFull) {
+    BandwidthConfig config = ClosedLinkConfig();
+    config.shaper_queue_packets = 2;
+    TrafficShaper shaper;
+    shaper.Configure(config);
+    TransmitLog log;
+    ASSERT_TRUE(shaper.Start(log.Function()));
+
+    std::vector<uint8_t> packet(100, 0xAB);
+    EXPECT_EQ(shaper.Submit(PacketPriority::BACKGROUND, packet.data(), packet.size(), 0),
+              TrafficShaper::Verdict::QUEUED);
+    EXPECT_EQ(shaper.Submit(PacketPriority::BACKGROUND, packet.data(), packet.size(), 0),
+              TrafficShaper::Verdict::QUEUED);
+    EXPECT_EQ(shaper.Submit(PacketPriority::BACKGROUND, packet.data(), packet.size(), 0),
+              TrafficShaper::Verdict::DROPPED);
+    EXPECT_EQ(shaper.GetDroppedPackets(PacketPriority::BACKGROUND), 1u);
+    // Other priorities have their own queues
+    EXPECT_EQ(shaper.Submit(PacketPriority::NORMAL, packet.data(), packet.size(), 0),
+              TrafficShaper::Verdict::QUEUED);
+
+    // Stop discards what is still queued and counts it as dropped
+    shaper.Stop();
+    EXPECT_EQ(shaper.GetQueuedPackets(PacketPriority::BACKGROUND), 0u);
+    EXPECT_EQ(shaper.GetDroppedPackets(PacketPriority::BACKGROUND), 3u);
+    EXPECT_EQ(shaper.GetDroppedPackets(PacketPriority::NORMAL), 1u);
+    EXPECT_TRUE(log.Priorities().empty());
+}
+
+TEST(TrafficShaperTest, PacketLargerThanDeficitCapDrains) {
+    TrafficShaper shaper;
+    shaper.Configure(ClosedLinkConfig());
+    TransmitLog log;
+    ASSERT_TRUE(shaper.Start(log.Function()));
+
+    // Well over twice the minimum quantum
+    std::vector<uint8_t> packet(4 * TrafficShaper::MIN_QUANTUM_BYTES, 0xAB);
+    ASSERT_EQ(shaper.Submit(PacketPriority::LOW, packet.data(), packet.size(), 7),
+              TrafficShaper::Verdict::QUEUED);
+
+    shaper.SetLinkRate(10000.0f);
+    ASSERT_TRUE(log.WaitFor(1));
+    EXPECT_EQ(log.Tags().front(), 7u);
+    EXPECT_EQ(shaper.GetQueuedPackets(PacketPriority::LOW), 0u);
+    shaper.Stop();
+}
+
+TEST(TrafficShaperTest, RoundRobinKeepsLowPriorityMoving) {
+    TrafficShaper shaper;
+    shaper.Configure(ClosedLinkConfig());
+    TransmitLog log;
+    ASSERT_TRUE(shaper.Start(log.Function()));
+
+    std::vector<uint8_t> packet(200, 0xAB);
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_EQ(shaper.Submit(PacketPriority::HIGH, packet.data(), packet.size(), 0),
+                  TrafficShaper::Verdict::QUEUED);
+    }
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_EQ(shaper.Submit(PacketPriority::LOW, packet.data(), packet.size(), 0),
+                  TrafficShaper::Verdict::QUEUED);
+    }
+
+    shaper.SetLinkRate(10000.0f);
+    ASSERT_TRUE(log.WaitFor(20));
+    std::vector<PacketPriority> order = log.Priorities();
+    size_t first_low = 0;
+    while (order[first_low] != PacketPriority::LOW) {
+        ++first_low;
+    }
+    size_t last_high = order.size() - 1;
+    while (order[last_high] != PacketPriority::HIGH) {
+        --last_high;
+    }
+    EXPECT_LT(first_low, last_high);
+    shaper.Stop();
+}
+
+TEST(TrafficShaperTest, ChargeTakesLinkTokens) {
+    BandwidthConfig config;
+    config.max_bitrate_kbps = 8.0f;  // 1000 B/s, 1500 B burst
+    TrafficShaper shaper;
+    shaper.Configure(config);
+    TransmitLog log;
+    ASSERT_TRUE(shaper.Start(log.Function()));
+
+    EXPECT_TRUE(shaper.CanSend(PacketPriority::NORMAL));
+    shaper.Charge(PacketPriority::NORMAL, 3000);
+    EXPECT_FALSE(shaper.CanSend(PacketPriority::NORMAL));
+    EXPECT_EQ(shaper.GetSentBytes(PacketPriority::NORMAL), 3000u);
+    shaper.Stop();
+}
@@ -0,0 +1,283 @@
+// Offline tool: train a CompressionDictionary from captured packet traces
+//
+// Each input file is a raw client-to-server byte stream (for example a TCP
+// stream exported from a capture). Streams are split into packets with the
+// packet table, the heaviest opcodes get a dictionary of their own and
+// everything else shares the generic dictionary.
+//
+// Dictionaries are built COVER-style: samples are split into epochs and each
+// epoch contributes the segment whose d-mers occur in the most samples not
+// already covered. Segments picked first end up last in the dictionary,
+// closest to the data, where LZ4 and zlib encode matches most cheaply.
+//
+// usage: dictionary_trainer [-o out.dict] [--size bytes] [--classes n]
+//                           [--min-samples n] trace...
+
+#include "CompressionDictionary.h"
+#include "FrameSplitter.h"
+#include <zlib.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace P2P;
+
+namespace {
+
+using Sample = std::vector<uint8_t>;
+
+constexpr size_t DMER_SIZE = 6;
+constexpr size_t SEGMENT_SIZE = 32;
+
+struct Options {
+    std::string output = "p2p_compression.dict";
+    size_t dictionary_size = 4096;
+    size_t classes = CompressionDictionary::MAX_CLASSES;
+    size_t min_samples = 200;
+    std::vector<std::string> traces;
+};
+
+uint64_t DmerKey(const uint8_t* data) {
+    uint64_t key = 0;
+    std::memcpy(&key, data, DMER_SIZE);
+    return key;
+}
+
+std::vector<uint8_t> TrainDictionary(const std::vector<const Sample*>& samples, size_t dictionary_size) {
+    // Dense d-mer IDs per sample, and in how many samples each d-mer occurs
+    std::unordered_map<uint64_t, uint32_t> ids;
+    std::vector<std::vector<uint32_t>> sample_dmers;
+    std::vector<uint32_t> frequency;
+    std::vector<size_t> last_sample;
+    sample_dmers.reserve(samples.size());
+    for (size_t s = 0; s < samples.size(); ++s) {
+        const Sample& sample = *samples[s];
+        std::vector<uint32_t> dmers;
+        for (size_t i = 0; i + DMER_SIZE <= sample.size(); ++i) {
+            auto inserted = ids.emplace(DmerKey(sample.data() + i), static_cast<uint32_t>(ids.size()));
+            uint32_t id = inserted.first->second;
+            if (inserted.second) {
+                frequency.push_back(0);
+                last_sample.push_back(SIZE_MAX);
+            }
+            if (last_sample[id] != s) {
+                last_sample[id] = s;
+                ++frequency[id];
+            }
+            dmers.push_back(id);
+        }
+        sample_dmers.push_back(std::move(dmers));
+    }
+
+    std::vector<Sample> segments;
+    size_t used = 0;
+    size_t epochs = std::max<size_t>(1, dictionary_size / SEGMENT_SIZE);
+    size_t epoch_size = (samples.size() + epochs - 1) / std::max<size_t>(1, epochs);
+    std::vector<uint16_t> window_count(frequency.size(), 0);
+
+    bool progress = true;
+    while (used < dictionary_size && progress && epoch_size > 0) {
+        progress = false;
+        for (size_t begin = 0; begin < samples.size() && used < dictionary_size; begin += epoch_size) {
+            // Best segment in this epoch by the summed frequency of its distinct d-mers
+            uint64_t best_score = 0;
+            size_t best_sample = 0;
+            size_t best_start = 0;
+            size_t best_length = 0;
+            size_t end = std::min(samples.size(), begin + epoch_size);
+            for (size_t s = begin; s < end; ++s) {
+                const auto& dmers = sample_dmers[s];
+                size_t window = std::min(SEGMENT_SIZE, samples[s]->size());
+                if (window < DMER_SIZE) {
+                    continue;
+                }
+                size_t per_window = window - DMER_SIZE + 1;
+                uint64_t score = 0;
+                for (size_t i = 0; i < dmers.size(); ++i) {
+                    if (window_count[dmers[i]]++ == 0) {
+                        score += frequency[dmers[i]];
+                    }
+                    if (i >= per_window) {
+                        uint32_t out = dmers[i - per_window];
+                        if (--window_count[out] == 0) {
+                            score -= frequency[out];
+                        }
+                    }
+                    if (i + 1 >= per_window && score > best_score) {
+                        best_score = score;
+                        best_sample = s;
+                        best_start = i + 1 - per_window;
+                        best_length = window;
+                    }
+                }
+                for (size_t i = dmers.size() > per_window ? dmers.size() - per_window : 0; i < dmers.size(); ++i) {
+                    window_count[dmers[i]] = 0;
+                }
+            }
+            if (best_score == 0) {
+                continue;
+            }
+
+            // Take the segment and stop counting its d-mers
+            const Sample& sample = *samples[best_sample];
+            best_length = std::min(best_length, dictionary_size - used);
+            segments.emplace_back(sample.begin() + best_start, sample.begin() + best_start + best_length);
+            for (size_t i = best_start; i + DMER_SIZE <= best_start + best_length; ++i) {
+                frequency[sample_dmers[best_sample][i]] = 0;
+            }
+            used += best_length;
+            progress = true;
+        }
+    }
+
+    std::vector<uint8_t> dictionary;
+    dictionary.reserve(used);
+    for (auto it = segments.rbegin(); it != segments.rend(); ++it) {
+        dictionary.insert(dictionary.end(), it->begin(), it->end());
+    }
+    return dictionary;
+}
+
+// zlib bytes for a set of samples, with or without a dictionary
+size_t DeflatedSize(const std::vector<const Sample*>& samples, const std::vector<uint8_t>& dictionary) {
+    size_t total = 0;
+    std::vector<uint8_t> out;
+    for (const Sample* sample : samples) {
+        z_stream stream{};
+        if (deflateInit(&stream, Z_DEFAULT_COMPRESSION) != Z_OK) {
+            return 0;
+        }
+        if (!dictionary.empty()) {
+            deflateSetDictionary(&stream, dictionary.data(), static_cast<uInt>(dictionary.size()));
+        }
+        out.resize(deflateBound(&stream, static_cast<uLong>(sample->size())));
+        stream.next_in = const_cast<Bytef*>(sample->data());
+        stream.avail_in = static_cast<uInt>(sample->size());
+        stream.next_out = out.data();
+        stream.avail_out = static_cast<uInt>(out.size());
+        deflate(&stream, Z_FINISH);
+        total += stream.total_out;
+        deflateEnd(&stream);
+    }
+    return total;
+}
+
+void Report(const char* name, const std::vector<const Sample*>& samples, const std::vector<uint8_t>& dictionary) {
+    size_t raw = 0;
+    for (const Sample* sample : samples) {
+        raw += sample->size();
+    }
+    std::printf("%-16s %8zu %10zu %8zu %12zu %12zu\n", name, samples.size(), raw, dictionary.size(),
+                DeflatedSize(samples, {}), DeflatedSize(samples, dictionary));
+}
+
+bool ParseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "-o" && has_value) {
+            options.output = argv[++i];
+        } else if (arg == "--size" && has_value) {
+            options.dictionary_size = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--classes" && has_value) {
+            options.classes = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--min-samples" && has_value) {
+            options.min_samples = std::strtoul(argv[++i], nullptr, 10);
+        } else if (!arg.empty() && arg[0] == '-') {
+            return false;
+        } else {
+            options.traces.push_back(arg);
+        }
+    }
+    return !options.traces.empty() &&
+           options.dictionary_size > 0 && options.dictionary_size <= CompressionDictionary::MAX_DICTIONARY_SIZE &&
+           options.classes > 0 && options.classes <= CompressionDictionary::MAX_CLASSES;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        std::fprintf(stderr,
+                     "usage: %s [-o out.dict] [--size bytes<=%zu] [--classes n<=%zu] [--min-samples n] trace...\n",
+                     argv[0], CompressionDictionary::MAX_DICTIONARY_SIZE, CompressionDictionary::MAX_CLASSES);
+        return 2;
+    }
+
+    // Split every trace into packets, grouped by opcode
+    std::map<uint16_t, std::vector<Sample>> by_type;
+    for (const auto& path : options.traces) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            std::fprintf(stderr, "cannot open %s\n", path.c_str());
+            return 1;
+        }
+        std::vector<uint8_t> stream((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        FrameSplitter::Split(stream.data(), stream.size(), [&](const PacketView& frame) {
+            if (frame.length >= 2) {
+                by_type[frame.type].emplace_back(frame.data, frame.data + frame.length);
+            }
+        });
+    }
+
+    // Heaviest opcodes (by bytes) with enough samples get their own class
+    std::vector<std::pair<size_t, uint16_t>> weights;
+    for (const auto& entry : by_type) {
+        size_t bytes = 0;
+        for (const auto& sample : entry.second) {
+            bytes += sample.size();
+        }
+        if (entry.second.size() >= options.min_samples) {
+            weights.emplace_back(bytes, entry.first);
+        }
+    }
+    std::sort(weights.rbegin(), weights.rend());
+    if (weights.size() > options.classes - 1) {
+        weights.resize(options.classes - 1);
+    }
+
+    CompressionDictionary set;
+    std::vector<const Sample*> generic_samples;
+    std::vector<bool> has_class(65536, false);
+    std::printf("%-16s %8s %10s %8s %12s %12s\n", "class", "packets", "bytes", "dict", "zlib", "zlib+dict");
+    for (const auto& weight : weights) {
+        std::vector<const Sample*> samples;
+        for (const auto& sample : by_type[weight.second]) {
+            samples.push_back(&sample);
+        }
+        std::vector<uint8_t> dictionary = TrainDictionary(samples, options.dictionary_size);
+        if (dictionary.empty() || !set.AddClass({weight.second}, dictionary)) {
+            continue;
+        }
+        has_class[weight.second] = true;
+        char name[16];
+        std::snprintf(name, sizeof(name), "0x%04X", weight.second);
+        Report(name, samples, dictionary);
+    }
+    for (const auto& entry : by_type) {
+        if (!has_class[entry.first]) {
+            for (const auto& sample : entry.second) {
+                generic_samples.push_back(&sample);
+            }
+        }
+    }
+    std::vector<uint8_t> generic = TrainDictionary(generic_samples, options.dictionary_size);
+    set.SetGeneric(generic);
+    Report("generic", generic_samples, generic);
+
+    if (!set.SaveToFile(options.output)) {
+        std::fprintf(stderr, "cannot write %s\n", options.output.c_str());
+        return 1;
+    }
+    std::printf("wrote %s: %zu classes, dictionary id %08x\n",
+                options.output.c_str(), set.GetClassCount(), set.GetId());
+    return 0;
+}